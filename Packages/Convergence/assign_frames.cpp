@@ -56,7 +56,9 @@ string fullHelpMessage(void) {
     "writing the assignments to assignments.asc.\n"
     "\n"
     "NOTES\n"
-    "\tThe selection used here must match that given to ufidpick\n"
+    "\tThe selection used here must match that given to ufidpick.  Frames may be\n"
+    "assigned in parallel by giving the number of threads to use (0 means use all\n"
+    "available processors).\n"
     "SEE ALSO\n"
     "\tufidpick, effsize.pl, hierarchy, neff\n";
 
@@ -67,8 +69,8 @@ string fullHelpMessage(void) {
 int main(int argc, char *argv[]) {
   string hdr = invocationHeader(argc, argv);
 
-  if (argc != 6) {
-    cerr << "Usage - " << argv[0] << " model trajectory range selection fiducials.dcd >assignments.asc\n";
+  if (argc < 6 || argc > 7) {
+    cerr << "Usage - " << argv[0] << " model trajectory range selection fiducials.dcd [threads] >assignments.asc\n";
     fullHelpMessage();
     exit(-1);
   }
@@ -84,6 +86,9 @@ int main(int argc, char *argv[]) {
   ref_model.resetAtomIndices();
   
   pTraj fiducials = createTrajectory(argv[k++], ref_model);
+  uint nthreads = 1;
+  if (k < argc)
+    nthreads = strtoul(argv[k++], 0, 10);
 
   vecUint frames;
   if (range == "all")
@@ -97,7 +102,7 @@ int main(int argc, char *argv[]) {
   readTrajectory(refs, ref_model, fiducials);
   cerr << "Read in " << refs.size() << " fiducials.\n";
   cerr << "Assigning...\n";
-  vecUint assigned = assignStructures(subset, traj, frames, refs);
+  vecUint assigned = assignStructures(subset, traj, frames, refs, nthreads);
   cout << "# " << hdr << endl;
   copy(assigned.begin(), assigned.end(), ostream_iterator<uint>(cout, "\n"));
 
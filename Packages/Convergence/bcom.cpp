@@ -34,6 +34,7 @@
 
 #include "ConvergenceOptions.hpp"
 #include "bcomlib.hpp"
+#include "blocklib.hpp"
 
 
 using namespace std;
@@ -65,6 +66,7 @@ uint ntries;
 vector<uint> blocksizes;
 uint seed;
 string gold_standard_trajectory_name;
+uint memory_mb;
 
 string fullHelpMessage() {
 
@@ -95,6 +97,15 @@ string fullHelpMessage() {
     "USAGE NOTES\n"
     "The --skip command is NOT used by this tool.\n"
     "\n"
+    "All block sizes are computed from running sums over the trajectory.\n"
+    "Each block size needs its own copy of the covariance sums, which takes\n"
+    "about 4*(3N)^2 bytes for N selected atoms (i.e. about 9 MB for 500\n"
+    "atoms).  At most --memory megabytes are used for these.  If the block\n"
+    "sizes need more than that, they are split into groups and the\n"
+    "trajectory is gone over once per group, which is slower but gives the\n"
+    "same results.  This is in addition to the full covariance matrix of\n"
+    "the selection, 8*(3N)^2 bytes.\n"
+    "\n"
     //
     "EXAMPLES\n"
     "bcom -s 'name==\"CA\"' --blocks 25:25:500 model.pdb traj.dcd > bcom_output\n"
@@ -147,7 +158,8 @@ public:
       ("zscore,Z", po::value<bool>(&use_zscore)->default_value(false), "Use Z-score rather than covariance overlap")
       ("ntries,N", po::value<uint>(&ntries)->default_value(20), "Number of tries for Z-score")
       ("local", po::value<bool>(&local_average)->default_value(true), "Use local avg in block PCA rather than global")
-      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead");
+      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead")
+      ("memory", po::value<uint>(&memory_mb)->default_value(256), "Memory (in MB) for the per-block-size covariance sums");
 
   }
 
@@ -161,12 +173,13 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("blocks='%s', zscore=%d, ntries=%d, local=%d, gold='%s'")
+    oss << boost::format("blocks='%s', zscore=%d, ntries=%d, local=%d, gold='%s', memory=%d")
       % blocks_spec
       % use_zscore
       % ntries
       % local_average
-      % gold_standard_trajectory_name;
+      % gold_standard_trajectory_name
+      % memory_mb;
     return(oss.str());
   }
 
@@ -191,35 +204,29 @@ struct Datum {
 
 
 
-vGroup subgroup(const vGroup& A, const uint a, const uint b) {
-  vGroup B;
-
-  for (uint i=a; i<b; ++i)
-    B.push_back(A[i]);
-
-  return(B);
-}
-
+// Computes the PCA for each block and the covariance overlap with
+// the full PCA, collecting the results by block size...
 
-// Breaks the ensemble up into blocks and computes the PCA for each
-// block and the statistics for the covariance overlaps...
+struct BlockCoverlaps {
+  BlockCoverlaps(const BlockStatistics& stats_, const RealMatrix& Ua_, const RealMatrix& sa_,
+                 const vector<double>& avg_, const uint nsizes, ProgressCounter<PercentTrigger, EstimatingCounter>& slayer_) :
+    stats(stats_), Ua(Ua_), sa(sa_), avg(avg_), coverlaps(nsizes), slayer(slayer_)
+  { }
 
-template<class ExtractPolicy>
-Datum blocker(const RealMatrix& Ua, const RealMatrix sa, vGroup& ensemble, const uint blocksize, ExtractPolicy& policy) {
+  void operator()(const BlockStatistics::Block& block) {
+    // The last block in the trajectory is never used
+    if (block.start + block.size >= stats.samples())
+      return;
 
-
-  TimeSeries<double> coverlaps;
-
-  for (uint i=0; i<ensemble.size() - blocksize; i += blocksize) {
-    vGroup subset = subgroup(ensemble, i, i+blocksize);
-    boost::tuple<RealMatrix, RealMatrix> pca_result = pca(subset, policy);
+    RealMatrix C = local_average ? stats.scatter(block) : stats.scatter(block, avg);
+    boost::tuple<RealMatrix, RealMatrix> pca_result = pcaFromScatter(C);
     RealMatrix s = boost::get<0>(pca_result);
     RealMatrix U = boost::get<1>(pca_result);
 
     // Scale the singular values by block-size
     if (length_normalize)
       for (uint j=0; j<s.rows(); ++j)
-        s[j] /= blocksize;
+        s[j] /= block.size;
 
     double val;
     if (use_zscore) {
@@ -228,10 +235,31 @@ Datum blocker(const RealMatrix& Ua, const RealMatrix sa, vGroup& ensemble, const
     } else
       val = covarianceOverlap(sa, Ua, s, U);
 
-    coverlaps.push_back(val);
+    coverlaps[block.index].push_back(val);
+    slayer.update();
   }
 
-  return( Datum(coverlaps.average(), coverlaps.variance(), coverlaps.size()) );
+  Datum result(const uint i) const {
+    return( Datum(coverlaps[i].average(), coverlaps[i].variance(), coverlaps[i].size()) );
+  }
+
+  const BlockStatistics& stats;
+  RealMatrix Ua, sa;
+  vector<double> avg;
+  vector< TimeSeries<double> > coverlaps;
+  ProgressCounter<PercentTrigger, EstimatingCounter>& slayer;
+};
+
+
+vector<double> structureAsVector(const AtomicGroup& model) {
+  vector<double> v;
+  for (uint i=0; i<model.size(); ++i) {
+    GCoord c = model[i]->coords();
+    v.push_back(c.x());
+    v.push_back(c.y());
+    v.push_back(c.z());
+  }
+  return(v);
 }
 
 
@@ -285,11 +313,12 @@ int main(int argc, char *argv[]) {
 
   // Handle the gold-standard, either using the whole input traj, or the alternate traj...
   NoAlignPolicy policy;
+  AtomicGroup avg;
   RealMatrix Us;
   RealMatrix UA;
 
   if (gold_standard_trajectory_name.empty()) {
-    AtomicGroup avg = averageStructure(ensemble);
+    avg = averageStructure(ensemble);
     policy = NoAlignPolicy(avg, local_average);
     boost::tuple<RealMatrix, RealMatrix> res = pca(ensemble, policy);
 
@@ -307,7 +336,7 @@ int main(int argc, char *argv[]) {
     boost::tuple<vector<XForm>, greal, int> bres = iterativeAlignment(gold_ensemble);
     cout << "# Gold Alignment converged to " << boost::get<1>(bres) << " in " << boost::get<2>(bres) << " iterations\n";
 
-    AtomicGroup avg = averageStructure(gold_ensemble);
+    avg = averageStructure(gold_ensemble);
     policy = NoAlignPolicy(avg, local_average);
     boost::tuple<RealMatrix, RealMatrix> res = pca(gold_ensemble, policy);
 
@@ -322,18 +351,30 @@ int main(int argc, char *argv[]) {
 
 
 
-  // Now iterate over all requested block sizes
+  // Now run through the trajectory, picking up every block of each
+  // requested size along the way
+  BlockStatistics stats(ensemble, true);
+  stats.memoryLimit(static_cast<ulong>(memory_mb) << 20);
+  if (stats.passes(blocksizes.size()) > 1)
+    cout << "# Block sizes are split over " << stats.passes(blocksizes.size()) << " passes (see --memory)\n";
+
+  uint nblocks = 0;
+  for (vector<uint>::iterator i = blocksizes.begin(); i != blocksizes.end(); ++i)
+    if (*i > 0)
+      nblocks += (ensemble.size() - 1) / *i;
 
   // Provide user-feedback since this can be a slow computation
   PercentProgress watcher;
-  ProgressCounter<PercentTrigger, EstimatingCounter> slayer(PercentTrigger(0.1), EstimatingCounter(blocksizes.size()));
+  ProgressCounter<PercentTrigger, EstimatingCounter> slayer(PercentTrigger(0.1), EstimatingCounter(nblocks));
   slayer.attach(&watcher);
   slayer.start();
 
-  for (vector<uint>::iterator i = blocksizes.begin(); i != blocksizes.end(); ++i) {
-    Datum result = blocker(UA, Us, ensemble, *i, policy);
-    cout << *i << "\t" << result.avg_coverlap << "\t" << result.var_coverlap << "\t" << result.nblocks << endl;
-    slayer.update();
+  BlockCoverlaps blocker(stats, UA, Us, structureAsVector(avg), blocksizes.size(), slayer);
+  stats.forEachBlock(blocksizes, blocker);
+
+  for (uint i=0; i<blocksizes.size(); ++i) {
+    Datum result = blocker.result(i);
+    cout << blocksizes[i] << "\t" << result.avg_coverlap << "\t" << result.var_coverlap << "\t" << result.nblocks << endl;
   }
 
   slayer.finish();
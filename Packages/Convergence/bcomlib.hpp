@@ -67,6 +67,24 @@ namespace Convergence {
         M(j, i) -= avg[j];
   }
 
+  // Subtracts the average column of M from each column (i.e. removes
+  // the local average structure from a matrix of coordinates)
+  template<typename T>
+  void subtractAverage(T& M) {
+    std::vector<double> avg(M.rows(), 0.0);
+    for (uint i=0; i<M.cols(); ++i)
+      for (uint j=0; j<M.rows(); ++j)
+        avg[j] += M(j, i);
+
+    std::vector<float> favg(M.rows());
+    for (uint j=0; j<M.rows(); ++j)
+      favg[j] = avg[j] / M.cols();
+
+    for (uint i=0; i<M.cols(); ++i)
+      for (uint j=0; j<M.rows(); ++j)
+        M(j, i) -= favg[j];
+  }
+
   // Computes the cosine content for a col-vector
   template<typename T>
   double cosineContent(T& V, const uint col) {
@@ -148,20 +166,16 @@ namespace Convergence {
 
 
 
-  // Compute the PCA of an ensemble using the specified coordinate
-  // extraction policy...
+  // Compute the PCA given the scatter matrix (M * M') of a matrix of
+  // coordinates.  C is overwritten by the eigenvectors...
   //
 
-  template<class ExtractPolicy>
-  boost::tuple<loos::RealMatrix, loos::RealMatrix> pca(std::vector<loos::AtomicGroup>& ensemble, ExtractPolicy& extractor) {
-
-    loos::RealMatrix M = extractor(ensemble);
-    loos::RealMatrix C = loos::Math::MMMultiply(M, M, false, true);
+  inline boost::tuple<loos::RealMatrix, loos::RealMatrix> pcaFromScatter(loos::RealMatrix& C) {
 
     // Compute [U,D] = eig(C)
     char jobz = 'V';
     char uplo = 'L';
-    f77int n = M.rows();
+    f77int n = C.rows();
     f77int lda = n;
     float dummy;
     loos::RealMatrix W(n, 1);
@@ -173,9 +187,9 @@ namespace Convergence {
 
    
     lwork = static_cast<f77int>(dummy);
-    float *work = new float[lwork+1];
+    std::vector<float> work(lwork+1);
 
-    ssyev_(&jobz, &uplo, &n, C.get(), &lda, W.get(), work, &lwork, &info);
+    ssyev_(&jobz, &uplo, &n, C.get(), &lda, W.get(), &work[0], &lwork, &info);
     if (info != 0)
       throw(loos::NumericalError("ssyev failed in loos::pca()", info));
   
@@ -193,6 +207,26 @@ namespace Convergence {
   }
 
 
+  // Compute the PCA of a matrix of coordinates (with the average
+  // already removed)...
+  //
+
+  inline boost::tuple<loos::RealMatrix, loos::RealMatrix> pca(const loos::RealMatrix& M) {
+    loos::RealMatrix C = loos::Math::MMMultiply(M, M, false, true);
+    return(pcaFromScatter(C));
+  }
+
+
+  // Compute the PCA of an ensemble using the specified coordinate
+  // extraction policy...
+  //
+
+  template<class ExtractPolicy>
+  boost::tuple<loos::RealMatrix, loos::RealMatrix> pca(std::vector<loos::AtomicGroup>& ensemble, ExtractPolicy& extractor) {
+    return(pca(extractor(ensemble)));
+  }
+
+
 
   // Get just the RSVs (this is for cosine-content calculations)
   // given an extraction policy...
@@ -42,8 +42,11 @@
 
 #include <loos.hpp>
 
+#include "blocklib.hpp"
+
 using namespace std;
 using namespace loos;
+using namespace Convergence;
 
 string fullHelpMessage(void)
     {
@@ -68,7 +71,8 @@ string fullHelpMessage(void)
 "TimeSeriesFile      columnated text file (blank lines and lines starting \n"
 "                    with \"#\" are ignored) containing the time series data\n"
 "column              which column to use for analysis (1-based)\n"
-"max_blocks          maximum number of blocks to use in the analysis\n"
+"max_blocks          maximum number of blocks to use in the analysis (0 means\n"
+"                    use block sizes that are powers of 2, see below)\n"
 "skip                number of frames to skip from the beginning of the \n"
 "                    trajectory\n"
 "  \n"
@@ -110,6 +114,13 @@ string fullHelpMessage(void)
 "Note: If the number of blocks doesn't evenly divide the number of points,\n"
 "then the remainder will be discarded from the end of the trajectory.\n"
 "\n"
+"If max_blocks is 0, the data are blocked by repeatedly averaging pairs of\n"
+"consecutive points, as Flyvbjerg and Petersen describe, so the block sizes\n"
+"are 1, 2, 4, 8, etc.  The file is read one point at a time and the series\n"
+"is never stored, so this works for series of any length.  An extra column\n"
+"gives the uncertainty in each standard error, which grows as the number of\n"
+"blocks shrinks.\n"
+"\n"
 "\n"
 "See references 1 and 2 for more discussion of the block averaging algorithm.\n"
 "\n"
@@ -153,6 +164,105 @@ string fullHelpMessage(void)
     }
 
 
+// Accumulates the mean and mean-square of the block averages for
+// each number of blocks.  Only the first n blocks of each size are
+// used, so any remainder is discarded from the end of the data.
+struct BlockVariances
+    {
+    BlockVariances(const BlockStatistics& stats_,
+                   const vector<uint>& num_blocks_)
+        : stats(stats_), num_blocks(num_blocks_),
+          block_ave(num_blocks_.size(), 0.0),
+          block_ave2(num_blocks_.size(), 0.0)
+        {
+        }
+
+    void operator()(const BlockStatistics::Block& block)
+        {
+        uint k = block.index;
+        if (block.start / block.size >= num_blocks[k])
+            return;
+
+        double ave = stats.mean(block)[0];
+        block_ave[k] += ave;
+        block_ave2[k] += ave*ave;
+        }
+
+    // The variance must be computed with N-1, not N, because
+    // we determine the mean from the data (as opposed to independently
+    // specifying it)
+    double variance(const uint k) const
+        {
+        double n = num_blocks[k];
+        double ave = block_ave[k] / n;
+        double ave2 = block_ave2[k] / n;
+        return((ave2 - ave*ave) * n / (n - 1.0));
+        }
+
+    const BlockStatistics& stats;
+    vector<uint> num_blocks;
+    vector<double> block_ave, block_ave2;
+    };
+
+
+// Streams the requested column through a BlockAverager, so the
+// series is never held in memory
+void pairwiseBlocking(const string& datafile, const int column,
+                      const unsigned int skip)
+    {
+    ifstream ifs(datafile.c_str());
+    if (!ifs)
+        {
+        throw(runtime_error("Cannot open timeseries file " + datafile));
+        }
+
+    BlockAverager blocks;
+    unsigned int num_read = 0;
+    string line;
+    while (getline(ifs, line))
+        {
+        if ( (line.substr(0,1) == "#") || (line.empty()) )
+            {
+            continue;
+            }
+
+        istringstream iss(line);
+        double val;
+        for (int i=0; i<column; i++)
+            {
+            if (!(iss >> val))
+                {
+                throw(runtime_error("Problem reading timeseries file "
+                                    + datafile));
+                }
+            }
+
+        if (num_read++ >= skip)
+            {
+            blocks.push_back(val);
+            }
+        }
+
+    if (blocks.levels() == 0)
+        {
+        cerr << "Need at least 2 points after skipping " << skip
+             << " to do block averaging."
+             << endl;
+        exit(-1);
+        }
+
+    cout << "# Num_Blocks\tBlockLen\tStdErr\tStdErrErr" << endl;
+    for (unsigned int k=0; k<blocks.levels(); k++)
+        {
+        cout << blocks.blocks(k) << "\t\t"
+             << blocks.blockSize(k) << "\t\t"
+             << blocks.standardError(k) << "\t"
+             << blocks.standardErrorError(k)
+             << endl;
+        }
+    }
+
+
 void Usage()
     {
     cerr << "Usage: block_average TimeSeriesFile column max_blocks skip"
@@ -189,6 +299,12 @@ int column = atoi(argv[2]);
 unsigned int max_blocks = atoi(argv[3]);
 unsigned int skip = atoi(argv[4]);
 
+if (max_blocks == 0)
+    {
+    pairwiseBlocking(datafile, column, skip);
+    exit(0);
+    }
+
 // Read the TimeSeries file
 TimeSeries<float> data = TimeSeries<float>(datafile, column);
 unsigned int num_points = data.size();
@@ -219,15 +335,31 @@ if (max_blocks > num_points)
     exit(-1);
     }
 
-// Loop over the number of blocks, computing the variance of the averages for
-// each number of blocks
+// Compute the variance of the averages for each number of blocks.  The block
+// averages for all of the block sizes come from a single pass over the data.
 
-cout << "# Num_Blocks\tBlockLen\tStdErr" << endl;
+DoubleMatrix series(1, num_points);
+for (unsigned int i=0; i<num_points; i++)
+    series[i] = data[i];
+BlockStatistics stats(series);
 
+vector<uint> num_blocks, block_sizes;
 for (int i=max_blocks; i>=2; i--)
     {
-    int time = num_points / i;
-    float variance = data.block_var(i);
+    num_blocks.push_back(i);
+    block_sizes.push_back(num_points / i);
+    }
+
+BlockVariances variances(stats, num_blocks);
+stats.forEachBlock(block_sizes, variances);
+
+cout << "# Num_Blocks\tBlockLen\tStdErr" << endl;
+
+for (unsigned int k=0; k<num_blocks.size(); k++)
+    {
+    int i = num_blocks[k];
+    int time = block_sizes[k];
+    float variance = variances.variance(k);
     float std_err = sqrt(variance/i);
     cout << i << "\t\t"
          << time << "\t\t"
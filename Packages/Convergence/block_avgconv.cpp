@@ -38,29 +38,40 @@
 #include <loos.hpp>
 #include <boost/format.hpp>
 
+#include "blocklib.hpp"
+
 using namespace loos;
 using namespace std;
+using namespace Convergence;
 
 
 const uint default_starting_number_of_blocks = 500;
 const double default_fraction_of_trajectory = 0.25;    
 
 
-AtomicGroup averageSelectedSubset(const vector<AtomicGroup>& ensemble, const vector<uint>& indices) {
-  AtomicGroup avg = ensemble[0].copy();
-  for (AtomicGroup::iterator i = avg.begin(); i != avg.end(); ++i)
-    (*i)->coords() = GCoord(0,0,0);
+// Collects the average structure for every block, by block size
+struct BlockAverages {
+  BlockAverages(const BlockStatistics& stats_, const AtomicGroup& model_, const uint nsizes) :
+    stats(stats_), model(model_), averages(nsizes)
+  { }
 
-  uint n = avg.size();
-  for (vector<uint>::const_iterator j = indices.begin(); j != indices.end(); ++j)
-    for (uint i=0; i<n; ++i)
-      avg[i]->coords() += ensemble[*j][i]->coords();
+  void operator()(const BlockStatistics::Block& block) {
+    // The last block in the trajectory is never used
+    if (block.start + block.size >= stats.samples())
+      return;
 
-  for (AtomicGroup::iterator i = avg.begin(); i != avg.end(); ++i)
-    (*i)->coords() /= indices.size();
+    vector<double> avg = stats.mean(block);
+    AtomicGroup structure = model.copy();
+    for (uint i=0; i<structure.size(); ++i)
+      structure[i]->coords() = GCoord(avg[3*i], avg[3*i+1], avg[3*i+2]);
 
-  return(avg);
-}
+    averages[block.index].push_back(structure);
+  }
+
+  const BlockStatistics& stats;
+  AtomicGroup model;
+  vector< vector<AtomicGroup> > averages;
+};
 
 
 
@@ -141,23 +152,19 @@ int main(int argc, char *argv[]) {
   } else
     cerr << "Trajectory is already aligned!\n";
 
+  // All block averages come from one pass through the trajectory
+  BlockStatistics stats(ensemble);
+  BlockAverages blocks(stats, ensemble[0], sizes.size());
+  stats.forEachBlock(sizes, blocks);
+
   cerr << "Processing- ";
   for (uint block = 0; block < sizes.size(); ++block) {
     if (block % 50)
       cerr << ".";
 
     uint blocksize = sizes[block];
+    vector<AtomicGroup>& averages = blocks.averages[block];
 
-    vector<AtomicGroup> averages;
-    for (uint i=0; i<ensemble.size() - blocksize; i += blocksize) {
-
-      vector<uint> indices(blocksize);
-      for (uint j=0; j<blocksize; ++j)
-        indices[j] = i+j;
-      
-      averages.push_back(averageSelectedSubset(ensemble, indices));
-    }
-    
     TimeSeries<double> rmsds;
     for (uint j=0; j<averages.size() - 1; ++j)
       for (uint i=j+1; i<averages.size(); ++i) {
@@ -0,0 +1,165 @@
+/*
+  blocklib
+
+  Block statistics library
+*/
+
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2010, Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "blocklib.hpp"
+
+using namespace std;
+using namespace loos;
+
+
+namespace Convergence {
+
+
+  BlockStatistics::BlockStatistics(const DoubleMatrix& data, const bool covariance) :
+    rows_(data.rows()), cols_(data.cols()), covariance_(covariance), memory_limit_(default_memory_limit),
+    data_(data.get(), data.get() + data.rows() * data.cols())
+  {
+    initialize();
+  }
+
+
+  BlockStatistics::BlockStatistics(const vector<AtomicGroup>& ensemble, const bool covariance) :
+    rows_(ensemble.empty() ? 0 : 3 * ensemble[0].size()), cols_(ensemble.size()), covariance_(covariance),
+    memory_limit_(default_memory_limit), data_(rows_ * cols_)
+  {
+    uint k = 0;
+    for (vector<AtomicGroup>::const_iterator i = ensemble.begin(); i != ensemble.end(); ++i) {
+      if (3 * i->size() != rows_)
+        throw(LOOSError("All structures in the ensemble must have the same number of atoms"));
+      for (AtomicGroup::const_iterator j = i->begin(); j != i->end(); ++j) {
+        const GCoord& c = (*j)->coords();
+        data_[k++] = c.x();
+        data_[k++] = c.y();
+        data_[k++] = c.z();
+      }
+    }
+
+    initialize();
+  }
+
+
+  void BlockStatistics::initialize() {
+    center_.assign(rows_, 0.0);
+    for (uint j=0; j<cols_; ++j)
+      for (uint i=0; i<rows_; ++i)
+        center_[i] += data_[j * rows_ + i];
+
+    if (cols_)
+      for (uint i=0; i<rows_; ++i)
+        center_[i] /= cols_;
+  }
+
+
+  // Adds samples [begin, end) to the running sums.  The outer
+  // products go through BLAS as a single rank-k update of the lower
+  // triangle.
+  void BlockStatistics::accumulate(const uint begin, const uint end, vector<double>& sum, vector<double>& scatter, vector<double>& batch) const {
+    uint m = rows_;
+    uint n = end - begin;
+
+    for (uint j=0; j<n; ++j) {
+      const double* x = &data_[(begin + j) * m];
+      double* d = &batch[j * m];
+      for (uint i=0; i<m; ++i) {
+        d[i] = x[i] - center_[i];
+        sum[i] += d[i];
+      }
+    }
+
+    if (!covariance_ || n == 0)
+      return;
+
+#if defined(__linux__) || defined(__CYGWIN__) || defined(__FreeBSD__)
+    char uplo = 'L';
+    char trans = 'N';
+    f77int fm = m;
+    f77int fn = n;
+    double one = 1.0;
+
+    dsyrk_(&uplo, &trans, &fm, &fn, &one, &batch[0], &fm, &one, &scatter[0], &fm);
+#else
+    cblas_dsyrk(CblasColMajor, CblasLower, CblasNoTrans, m, n, 1.0, &batch[0], m, 1.0, &scatter[0], m);
+#endif
+  }
+
+
+
+  vector<double> BlockStatistics::mean(const Block& b) const {
+    vector<double> avg(rows_);
+    for (uint i=0; i<rows_; ++i)
+      avg[i] = center_[i] + b.sum[i] / b.size;
+
+    return(avg);
+  }
+
+
+  RealMatrix BlockStatistics::scatter(const Block& b) const {
+    if (!b.scatter)
+      throw(LOOSError("BlockStatistics was not asked to track covariances"));
+
+    uint m = rows_;
+    RealMatrix C(m, m);
+    const double* q = b.scatter;
+    for (uint j=0; j<m; ++j)
+      for (uint i=j; i<m; ++i) {
+        double c = *q++ - b.sum[i] * b.sum[j] / b.size;
+        C(i, j) = C(j, i) = c;
+      }
+
+    return(C);
+  }
+
+
+  // With d = about - center and s, Q the block's sums about the center,
+  //   sum (x - about)(x - about)' = Q - s d' - d s' + n d d'
+  RealMatrix BlockStatistics::scatter(const Block& b, const vector<double>& about) const {
+    if (!b.scatter)
+      throw(LOOSError("BlockStatistics was not asked to track covariances"));
+    if (about.size() != rows_)
+      throw(LOOSError("Vector has the wrong size in BlockStatistics::scatter()"));
+
+    uint m = rows_;
+    vector<double> d(m);
+    for (uint i=0; i<m; ++i)
+      d[i] = about[i] - center_[i];
+
+    RealMatrix C(m, m);
+    const double* q = b.scatter;
+    for (uint j=0; j<m; ++j)
+      for (uint i=j; i<m; ++i) {
+        double c = *q++ - b.sum[i] * d[j] - d[i] * b.sum[j] + b.size * d[i] * d[j];
+        C(i, j) = C(j, i) = c;
+      }
+
+    return(C);
+  }
+
+}
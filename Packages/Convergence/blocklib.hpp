@@ -0,0 +1,214 @@
+/*
+  Block statistics library
+*/
+
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2010, Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// @cond PACKAGES_INTERNAL
+
+#if !defined(LOOS_BLOCKLIB_HPP)
+#define LOOS_BLOCKLIB_HPP
+
+
+#include <climits>
+
+#include <loos.hpp>
+
+
+namespace Convergence {
+
+  // Means and covariances of consecutive blocks of several sizes, from one pass over the data
+  //
+  // Each column of the data is one sample (i.e. a frame of
+  // coordinates).  The samples are accumulated as running (prefix)
+  // sums of their values and, optionally, of their outer products.
+  // The sums for a block are the difference of the running sums at
+  // its ends, so every block size is handled in the same pass and the
+  // cost of a block does not depend on its size.  Only the running
+  // sums at the start of the current block of each size are kept
+  // (i.e. memory grows with the number of block sizes, not with the
+  // number of blocks).
+  //
+  // Sums are of the difference from the mean of all samples (see
+  // center()) to limit round-off.
+  //
+  // With covariances, each block size needs its own snapshot of the
+  // running outer-product sums, i.e. m(m+1)/2 doubles for m rows
+  // (only the lower triangle is kept).  For large selections and many
+  // block sizes, this can be a lot of memory, so the block sizes are
+  // split into groups whose snapshots fit in memoryLimit() bytes, and
+  // the samples are gone over once for each group.
+  class BlockStatistics {
+  public:
+
+    // A block of samples [start, start+size), passed to the functor given to forEachBlock()
+    struct Block {
+      Block(const uint i, const uint st, const uint sz, const double* s, const double* ss) :
+        index(i), start(st), size(sz), sum(s), scatter(ss) { }
+
+      uint index;              // Which of the block sizes this block is
+      uint start;
+      uint size;
+      const double* sum;       // Sum of (x - center) over the block
+      const double* scatter;   // Sum of (x - center)(x - center)' (lower triangle, packed by columns), or 0
+    };
+
+
+    BlockStatistics(const loos::DoubleMatrix& data, const bool covariance = false);
+
+    // Uses the coordinates of each structure as a sample
+    BlockStatistics(const std::vector<loos::AtomicGroup>& ensemble, const bool covariance = false);
+
+    uint rows() const { return(rows_); }
+    uint samples() const { return(cols_); }
+
+    // Mean of all samples
+    const std::vector<double>& center() const { return(center_); }
+
+    // Bytes allowed for the per-block-size covariance snapshots
+    ulong memoryLimit() const { return(memory_limit_); }
+    void memoryLimit(const ulong bytes) { memory_limit_ = bytes; }
+
+    // Number of passes over the samples forEachBlock() will take for this many block sizes
+    uint passes(const uint nsizes) const {
+      uint per_pass = sizesPerPass();
+      return(per_pass ? (nsizes + per_pass - 1) / per_pass : 1);
+    }
+
+
+    // Calls op(block) for every complete block of each size, starting
+    // from the first sample.  Within each group of block sizes (see
+    // above), blocks are visited in the order they end.
+    template<class Op>
+    void forEachBlock(const std::vector<uint>& sizes, Op& op) const {
+      uint per_pass = sizesPerPass();
+      if (per_pass == 0)
+        per_pass = sizes.size();
+
+      for (uint first = 0; first < sizes.size(); first += per_pass) {
+        uint last = first + per_pass < sizes.size() ? first + per_pass : sizes.size();
+        blockPass(sizes, first, last, op);
+      }
+    }
+
+
+    // Mean of the samples in a block
+    std::vector<double> mean(const Block& b) const;
+
+    // Scatter matrix about the block's mean, sum (x - mean)(x - mean)'
+    loos::RealMatrix scatter(const Block& b) const;
+
+    // Scatter matrix about a given vector, sum (x - about)(x - about)'
+    loos::RealMatrix scatter(const Block& b, const std::vector<double>& about) const;
+
+  private:
+    static const uint max_batch = 256;
+    static const ulong default_memory_limit = 256ul << 20;
+
+    // Number of lower-triangle entries in an outer product (0 without covariances)
+    ulong packedSize() const { return(covariance_ ? static_cast<ulong>(rows_) * (rows_ + 1) / 2 : 0); }
+
+    // Block sizes whose snapshots fit in the memory limit (at least 1), or 0 for no limit
+    uint sizesPerPass() const {
+      ulong bytes = packedSize() * sizeof(double);
+      if (bytes == 0)
+        return(0);
+      ulong n = memory_limit_ / bytes;
+      return(n < 1 ? 1 : (n > UINT_MAX ? UINT_MAX : n));
+    }
+
+
+    // One pass over the samples for the block sizes [first, last)
+    template<class Op>
+    void blockPass(const std::vector<uint>& sizes, const uint first, const uint last, Op& op) const {
+      uint m = rows_;
+      ulong np = packedSize();
+      uint nsizes = last - first;
+
+      std::vector<double> sum(m, 0.0), scatter(covariance_ ? static_cast<ulong>(m) * m : 0, 0.0);
+      std::vector<double> sum0(nsizes * m, 0.0), scatter0(nsizes * np, 0.0);
+      std::vector<double> bsum(m), bscatter(np);
+      std::vector<double> batch(m * max_batch);
+
+      uint t = 0;
+      while (t < cols_) {
+        // Frames are added in batches that stop at the next block boundary
+        uint end = t + max_batch < cols_ ? t + max_batch : cols_;
+        for (uint k=first; k<last; ++k)
+          if (sizes[k] > 0) {
+            uint next = (t / sizes[k] + 1) * sizes[k];
+            if (next < end)
+              end = next;
+          }
+
+        accumulate(t, end, sum, scatter, batch);
+        t = end;
+
+        for (uint k=first; k<last; ++k) {
+          if (sizes[k] == 0 || t % sizes[k] != 0)
+            continue;
+
+          uint s = k - first;
+          for (uint i=0; i<m; ++i) {
+            bsum[i] = sum[i] - sum0[s*m + i];
+            sum0[s*m + i] = sum[i];
+          }
+
+          // The running sums are a full matrix (for BLAS), but only
+          // their lower triangle is filled in and kept
+          if (covariance_) {
+            double* snap = &scatter0[s * np];
+            ulong p = 0;
+            for (uint j=0; j<m; ++j)
+              for (uint i=j; i<m; ++i, ++p) {
+                double q = scatter[static_cast<ulong>(j)*m + i];
+                bscatter[p] = q - snap[p];
+                snap[p] = q;
+              }
+          }
+
+          op(Block(k, t - sizes[k], sizes[k], &bsum[0], covariance_ ? &bscatter[0] : 0));
+        }
+      }
+    }
+
+
+    void initialize();
+    void accumulate(const uint begin, const uint end, std::vector<double>& sum, std::vector<double>& scatter, std::vector<double>& batch) const;
+
+    uint rows_, cols_;
+    bool covariance_;
+    ulong memory_limit_;
+    std::vector<double> data_;
+    std::vector<double> center_;
+  };
+
+
+}
+
+
+#endif
+
+
+// @endcond PACKAGES_INTERNAL
@@ -31,6 +31,7 @@
 #include <loos.hpp>
 #include "ConvergenceOptions.hpp"
 #include "bcomlib.hpp"
+#include "bootlib.hpp"
 
 using namespace std;
 using namespace loos;
@@ -40,9 +41,6 @@ namespace opts = loos::OptionsFramework;
 namespace po = boost::program_options;
 
 
-const bool debug = false;
-
-
 typedef vector<AtomicGroup>                               vGroup;
 typedef boost::tuple<RealMatrix, RealMatrix, RealMatrix>  SVDResult;
 
@@ -57,6 +55,7 @@ uint nsteps = 25;
 vector<uint> blocksizes;
 bool local_average;
 uint nreps;
+uint nthreads;
 string gold_standard_trajectory_name;
 
 
@@ -155,7 +154,8 @@ public:
       ("steps", po::value<uint>(&nsteps)->default_value(25), "Max number of blocks for auto-ranging")
       ("reps", po::value<uint>(&nreps)->default_value(20), "Number of replicates for bootstrap")
       ("local", po::value<bool>(&local_average)->default_value(true), "Use local avg in block PCA rather than global")
-      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead");
+      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use for replicates (0 = all available)");
 
 
   }
@@ -169,11 +169,12 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("blocks='%s', local=%d, reps=%d, gold='%s'")
+    oss << boost::format("blocks='%s', local=%d, reps=%d, gold='%s', threads=%d")
       % blocks_spec
       % local_average
       % nreps
-      % gold_standard_trajectory_name;
+      % gold_standard_trajectory_name
+      % nthreads;
     return(oss.str());
   }
 
@@ -194,71 +195,52 @@ struct Datum {
 // @endcond
 
 
-// Randomly pick frames
-vector<uint> pickFrames(const uint nframes, const uint blocksize) {
-  
-  boost::uniform_int<uint> imap(0,nframes-1);
-  boost::variate_generator< base_generator_type&, boost::uniform_int<uint> > rng(rng_singleton(), imap);
-  vector<uint> picks;
-
-  for (uint i=0; i<blocksize; ++i)
-    picks.push_back(rng());
-
-  return(picks);
-}
-
-
-void dumpPicks(const vector<uint>& picks) {
-  cerr << "Picks:\n";
-  for (vector<uint>::const_iterator ci = picks.begin(); ci != picks.end(); ++ci)
-    cerr << "\t" << *ci << endl;
-}
-
-
-// Extract a subgroup of the vector<AtomicGroup> given the indices in picks...
-vGroup subgroup(const vGroup& A, const vector<uint>& picks) {
-  vGroup B;
-  
-  for (vector<uint>::const_iterator ci = picks.begin(); ci != picks.end(); ++ci)
-    B.push_back(A[*ci]);
-
-  return(B);
-}
-
-
-
-// Breaks the ensemble up into blocks and computes the PCA for each
-// block and the statistics for the covariance overlaps...
-
-template<class ExtractPolicy>
-Datum blocker(const RealMatrix& Ua, const RealMatrix sa, const vGroup& ensemble, const uint blocksize, uint repeats, ExtractPolicy& policy) {
+// Computes the covariance overlap between the PCA of a bootstrap
+// replicate and the full (gold-standard) PCA.  This is called from
+// multiple threads, so it only reads its state.
+struct CoverlapEstimator {
+  CoverlapEstimator(const RealMatrix& Ua_, const RealMatrix& sa_, const AtomicGroup& avg_, const bool local_) :
+    Ua(Ua_), sa(sa_), local(local_)
+  {
+    for (uint i=0; i<avg_.size(); ++i) {
+      GCoord c = avg_[i]->coords();
+      avg.push_back(c.x());
+      avg.push_back(c.y());
+      avg.push_back(c.z());
+    }
+  }
 
+  double operator()(RealMatrix& M) const {
+    if (local)
+      subtractAverage(M);
+    else
+      for (uint i=0; i<M.cols(); ++i)
+        for (uint j=0; j<M.rows(); ++j)
+          M(j, i) -= avg[j];
 
-  
-  TimeSeries<double> coverlaps;
-
-  for (uint i=0; i<repeats; ++i) {
-    vector<uint> picks = pickFrames(ensemble.size(), blocksize);
-    
-    if (debug) {
-      cerr << "***Block " << blocksize << ", replica " << i << ", picks " << picks.size() << endl;
-      dumpPicks(picks);
-    }
-    
-    vGroup subset = subgroup(ensemble, picks);
-    boost::tuple<RealMatrix, RealMatrix> pca_result = pca(subset, policy);
+    boost::tuple<RealMatrix, RealMatrix> pca_result = pca(M);
     RealMatrix s = boost::get<0>(pca_result);
     RealMatrix U = boost::get<1>(pca_result);
 
     if (length_normalize)
       for (uint j=0; j<s.rows(); ++j)
-        s[j] /= blocksize;
+        s[j] /= M.cols();
 
-    coverlaps.push_back(covarianceOverlap(sa, Ua, s, U));
+    return(covarianceOverlap(sa, Ua, s, U));
   }
 
-  return( Datum(coverlaps.average(), coverlaps.variance(), coverlaps.size()) );
+  RealMatrix Ua, sa;
+  vector<float> avg;
+  bool local;
+};
 
+
+// Pulls random blocks from the ensemble and computes the PCA for each
+// block and the statistics for the covariance overlaps...
+
+Datum blocker(const Bootstrap& boot, const uint blocksize, uint repeats, const CoverlapEstimator& estimator) {
+  TimeSeries<double> coverlaps = boot.run(blocksize, repeats, estimator);
+  return( Datum(coverlaps.average(), coverlaps.variance(), coverlaps.size()) );
 }
 
 
@@ -313,11 +295,12 @@ int main(int argc, char *argv[]) {
 
   // Handle the gold-standard, either using the whole input traj, or the alternate traj...
   NoAlignPolicy policy;
+  AtomicGroup avg;
   RealMatrix Us;
   RealMatrix UA;
 
   if (gold_standard_trajectory_name.empty()) {
-    AtomicGroup avg = averageStructure(ensemble);
+    avg = averageStructure(ensemble);
     policy = NoAlignPolicy(avg, local_average);
     boost::tuple<RealMatrix, RealMatrix> res = pca(ensemble, policy);
 
@@ -335,7 +318,7 @@ int main(int argc, char *argv[]) {
     boost::tuple<vector<XForm>, greal, int> bres = iterativeAlignment(gold_ensemble);
     cout << "# Gold Alignment converged to " << boost::get<1>(bres) << " in " << boost::get<2>(bres) << " iterations\n";
 
-    AtomicGroup avg = averageStructure(gold_ensemble);
+    avg = averageStructure(gold_ensemble);
     policy = NoAlignPolicy(avg, local_average);
     boost::tuple<RealMatrix, RealMatrix> res = pca(gold_ensemble, policy);
 
@@ -348,6 +331,10 @@ int main(int argc, char *argv[]) {
         Us[i] /= gold->nframes();
   }
 
+  // The replicates only need the coordinates of the (aligned) ensemble...
+  Bootstrap boot(ensemble, nthreads);
+  CoverlapEstimator estimator(UA, Us, avg, local_average);
+
   // Now iterate over all requested block sizes...
 
   PercentProgress watcher;
@@ -357,7 +344,7 @@ int main(int argc, char *argv[]) {
 
 
   for (vector<uint>::iterator i = blocksizes.begin(); i != blocksizes.end(); ++i) {
-    Datum result = blocker(UA, Us, ensemble, *i, nreps, policy);
+    Datum result = blocker(boot, *i, nreps, estimator);
     cout << *i << "\t" << result.avg_coverlap << "\t" << result.var_coverlap << "\t" << result.nblocks << endl;
     slayer.update();
   }
@@ -0,0 +1,100 @@
+/*
+  bootlib
+
+  Bootstrap library
+*/
+
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2010, Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "bootlib.hpp"
+
+#include <cstring>
+
+using namespace std;
+using namespace loos;
+
+
+namespace Convergence {
+
+
+  Bootstrap::Bootstrap(const vector<AtomicGroup>& ensemble, const uint nthreads) :
+    coords_(extractCoords(ensemble))
+  {
+    threads(nthreads);
+  }
+
+
+  Bootstrap::Bootstrap(const RealMatrix& coords, const uint nthreads) :
+    coords_(coords)
+  {
+    threads(nthreads);
+  }
+
+
+  void Bootstrap::threads(const uint n) {
+    nthreads_ = n;
+    if (nthreads_ == 0) {
+      nthreads_ = boost::thread::hardware_concurrency();
+      if (nthreads_ == 0)
+        nthreads_ = 1;
+    }
+  }
+
+
+  vector<uint> Bootstrap::pickFrames(const uint blocksize, base_generator_type& rng) const {
+    boost::uniform_int<uint> imap(0, coords_.cols() - 1);
+    boost::variate_generator< base_generator_type&, boost::uniform_int<uint> > pick(rng, imap);
+
+    vector<uint> picks(blocksize);
+    for (uint i=0; i<blocksize; ++i)
+      picks[i] = pick();
+
+    return(picks);
+  }
+
+
+  // Frames are columns, so each one is a contiguous run of the matrix
+  RealMatrix Bootstrap::extractFrames(const vector<uint>& picks) const {
+    uint m = coords_.rows();
+    RealMatrix block(m, picks.size());
+
+    for (uint i=0; i<picks.size(); ++i)
+      memcpy(block.get() + i * m, coords_.get() + picks[i] * m, m * sizeof(float));
+
+    return(block);
+  }
+
+
+  vector<uint> Bootstrap::replicaSeeds(const uint n) const {
+    base_generator_type& rng = rng_singleton();
+    vector<uint> seeds(n);
+    for (uint i=0; i<n; ++i)
+      seeds[i] = rng();
+
+    return(seeds);
+  }
+
+}
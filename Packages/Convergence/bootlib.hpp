@@ -0,0 +1,137 @@
+/*
+  Bootstrap library
+*/
+
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2010, Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// @cond PACKAGES_INTERNAL
+
+#if !defined(LOOS_BOOTLIB_HPP)
+#define LOOS_BOOTLIB_HPP
+
+
+#include <loos.hpp>
+
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
+
+namespace Convergence {
+
+  // Bootstrap replicas drawn from a cached ensemble, evaluated in parallel
+  //
+  // The coordinates of the ensemble are stored once, with each frame
+  // as a column (as with loos::extractCoords()).  A replica is a set of
+  // frames picked at random (with replacement), copied into its own
+  // matrix and handed to an estimator functor,
+  //
+  //    double operator()(loos::RealMatrix& block) const;
+  //
+  // which is free to modify the block, but must be safe to call from
+  // multiple threads.
+  //
+  // Each replica has its own random number generator, seeded from a
+  // sequence drawn from the LOOS rng_singleton() before any work
+  // starts.  The frames picked (and so the results) depend only on the
+  // LOOS seed, not on the number of threads.
+  class Bootstrap {
+  public:
+    // nthreads = 0 means use all available
+    Bootstrap(const std::vector<loos::AtomicGroup>& ensemble, const uint nthreads = 1);
+    Bootstrap(const loos::RealMatrix& coords, const uint nthreads = 1);
+
+    uint frames() const { return(coords_.cols()); }
+    const loos::RealMatrix& coords() const { return(coords_); }
+
+    uint threads() const { return(nthreads_); }
+    void threads(const uint n);
+
+    // Picks blocksize frames at random (with replacement)
+    std::vector<uint> pickFrames(const uint blocksize, loos::base_generator_type& rng) const;
+
+    // Copies the given frames into a new matrix
+    loos::RealMatrix extractFrames(const std::vector<uint>& picks) const;
+
+    // Evaluates nreps replicas of blocksize frames each, returning the
+    // estimates in replica order
+    template<class Estimator>
+    loos::TimeSeries<double> run(const uint blocksize, const uint nreps, const Estimator& estimator) const {
+      std::vector<uint> seeds = replicaSeeds(nreps);
+      std::vector<double> results(nreps);
+      Worker<Estimator> worker(*this, blocksize, seeds, estimator, results);
+
+      uint nthreads = nthreads_ < nreps ? nthreads_ : nreps;
+      if (nthreads <= 1)
+        worker(0, nreps);
+      else {
+        boost::thread_group threads;
+        uint chunk = (nreps + nthreads - 1) / nthreads;
+        for (uint begin = 0; begin < nreps; begin += chunk) {
+          uint end = begin + chunk < nreps ? begin + chunk : nreps;
+          threads.create_thread(boost::bind<void>(boost::cref(worker), begin, end));
+        }
+        threads.join_all();
+      }
+
+      return(loos::TimeSeries<double>(results));
+    }
+
+  private:
+
+    template<class Estimator>
+    struct Worker {
+      Worker(const Bootstrap& boot_, const uint blocksize_, const std::vector<uint>& seeds_,
+             const Estimator& estimator_, std::vector<double>& results_) :
+        boot(boot_), blocksize(blocksize_), seeds(seeds_), estimator(estimator_), results(results_) { }
+
+      void operator()(const uint begin, const uint end) const {
+        for (uint i=begin; i<end; ++i) {
+          loos::base_generator_type rng(seeds[i]);
+          loos::RealMatrix block = boot.extractFrames(boot.pickFrames(blocksize, rng));
+          results[i] = estimator(block);
+        }
+      }
+
+      const Bootstrap& boot;
+      uint blocksize;
+      const std::vector<uint>& seeds;
+      const Estimator& estimator;
+      std::vector<double>& results;
+    };
+
+
+    std::vector<uint> replicaSeeds(const uint n) const;
+
+    loos::RealMatrix coords_;
+    uint nthreads_;
+  };
+
+
+}
+
+
+#endif
+
+
+// @endcond PACKAGES_INTERNAL
@@ -0,0 +1,330 @@
+/*
+  cluster-lib
+
+  Clustering library
+*/
+
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2010, Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "cluster-lib.hpp"
+
+#include <limits>
+
+using namespace std;
+using namespace loos;
+
+
+
+namespace {
+
+  // Distances are kept as the packed upper triangle (without the diagonal)
+  class CondensedMatrix {
+  public:
+    CondensedMatrix(const DoubleMatrix& D) : n_(D.rows()), data_(n_ * (n_ - 1) / 2) {
+      for (uint i=0; i<n_; ++i)
+        for (uint j=i+1; j<n_; ++j)
+          data_[index(i, j)] = D(i, j);
+    }
+
+    double& operator()(const uint i, const uint j) {
+      return(i < j ? data_[index(i, j)] : data_[index(j, i)]);
+    }
+
+  private:
+    ulong index(const ulong i, const ulong j) const { return(n_ * i - i * (i + 1) / 2 + j - i - 1); }
+
+    ulong n_;
+    vecDouble data_;
+  };
+
+
+  // Relabels merges recorded by representative structure into
+  // linkage order (n+i for the i'th merge)
+  class LinkageUnionFind {
+  public:
+    LinkageUnionFind(const uint n) : parent_(2*n - 1), size_(2*n - 1, 1), next_(n) {
+      for (uint i=0; i<parent_.size(); ++i)
+        parent_[i] = i;
+    }
+
+    uint merge(const uint x, const uint y) {
+      parent_[x] = parent_[y] = next_;
+      size_[next_] = size_[x] + size_[y];
+      return(size_[next_++]);
+    }
+
+    uint find(uint x) {
+      uint root = x;
+      while (parent_[root] != root)
+        root = parent_[root];
+      while (parent_[x] != root) {
+        uint p = parent_[x];
+        parent_[x] = root;
+        x = p;
+      }
+      return(root);
+    }
+
+  private:
+    vecUint parent_, size_;
+    uint next_;
+  };
+
+
+  bool mergeDistanceLess(const ClusterMerge& a, const ClusterMerge& b) {
+    return(a.distance < b.distance);
+  }
+
+
+  // Largest merge distance within each merge's subtree
+  vecDouble maxDistances(const vecMerge& merges) {
+    uint n = merges.size() + 1;
+    vecDouble md(merges.size());
+
+    for (uint i=0; i<merges.size(); ++i) {
+      double d = merges[i].distance;
+      if (merges[i].first >= n && md[merges[i].first - n] > d)
+        d = md[merges[i].first - n];
+      if (merges[i].second >= n && md[merges[i].second - n] > d)
+        d = md[merges[i].second - n];
+      md[i] = d;
+    }
+
+    return(md);
+  }
+
+
+  struct CenterDistances {
+    CenterDistances(const vecDouble& center_, const double ss_, const uint id_, vecUint& assignments_, vecDouble& distances_) :
+      center(center_), ss(ss_), id(id_), assignments(assignments_), distances(distances_) { }
+
+    void operator()(const double* crds, const double* crd_ss, const uint offset, const uint n) const {
+      uint natoms = center.size() / 3;
+      for (uint i=0; i<n; ++i) {
+        double d = superposedRMSD(crds + i * 3 * natoms, crd_ss[i], &center[0], ss, natoms);
+        if (d < distances[offset + i]) {
+          distances[offset + i] = d;
+          assignments[offset + i] = id;
+        }
+      }
+    }
+
+    const vecDouble& center;
+    double ss;
+    uint id;
+    vecUint& assignments;
+    vecDouble& distances;
+  };
+
+}
+
+
+
+// This follows scipy's nn_chain(): the merged cluster takes the place
+// of the higher-numbered of the pair, and the merges are sorted
+// (stably) and relabeled at the end.
+vecMerge averageLinkage(const DoubleMatrix& Dinput) {
+  uint n = Dinput.rows();
+  if (Dinput.cols() != n)
+    throw(LOOSError("Distance matrix must be square"));
+  if (n < 2)
+    throw(LOOSError("Need at least two structures to cluster"));
+
+  CondensedMatrix D(Dinput);
+  vecUint size(n, 1);
+  vecUint chain;
+  vecMerge merges;
+  merges.reserve(n - 1);
+
+  for (uint k=0; k<n-1; ++k) {
+    if (chain.empty())
+      for (uint i=0; i<n; ++i)
+        if (size[i]) {
+          chain.push_back(i);
+          break;
+        }
+
+    // Walk the chain of nearest neighbors until a reciprocal pair turns up.
+    // The previous link is preferred on ties so the chain can never cycle.
+    uint x, y;
+    double current;
+    while (true) {
+      x = chain.back();
+      if (chain.size() > 1) {
+        y = chain[chain.size() - 2];
+        current = D(x, y);
+      } else {
+        y = x;
+        current = numeric_limits<double>::infinity();
+      }
+
+      for (uint i=0; i<n; ++i) {
+        if (!size[i] || i == x)
+          continue;
+        double d = D(x, i);
+        if (d < current) {
+          current = d;
+          y = i;
+        }
+      }
+
+      if (chain.size() > 1 && y == chain[chain.size() - 2])
+        break;
+      chain.push_back(y);
+    }
+
+    chain.pop_back();
+    chain.pop_back();
+    if (x > y)
+      swap(x, y);
+
+    uint nx = size[x];
+    uint ny = size[y];
+    merges.push_back(ClusterMerge(x, y, current, nx + ny));
+    size[x] = 0;
+    size[y] = nx + ny;
+
+    for (uint i=0; i<n; ++i) {
+      if (!size[i] || i == y)
+        continue;
+      D(i, y) = (nx * D(i, x) + ny * D(i, y)) / (nx + ny);
+    }
+  }
+
+  stable_sort(merges.begin(), merges.end(), mergeDistanceLess);
+
+  LinkageUnionFind uf(n);
+  for (vecMerge::iterator i = merges.begin(); i != merges.end(); ++i) {
+    uint a = uf.find(i->first);
+    uint b = uf.find(i->second);
+    i->first = a < b ? a : b;
+    i->second = a < b ? b : a;
+    i->size = uf.merge(a, b);
+  }
+
+  return(merges);
+}
+
+
+
+// The threshold is the smallest merge height that leaves at most k
+// clusters.  Clusters are then numbered in the same depth-first order
+// as scipy's cluster_monocrit().
+vecUint flatClusters(const vecMerge& merges, const uint k) {
+  uint n = merges.size() + 1;
+  vecUint labels(n);
+
+  if (k >= n) {
+    for (uint i=0; i<n; ++i)
+      labels[i] = i + 1;
+    return(labels);
+  }
+
+  vecDouble md = maxDistances(merges);
+  vecDouble heights(md);
+  sort(heights.begin(), heights.end());
+  double cutoff = k == 0 ? heights.back() : heights[n - k - 1];
+
+  vector<bool> visited(2*n - 1, false);
+  vecUint stack(1, 2*n - 2);
+  uint nclusters = 0;
+  int leader = -1;
+
+  while (!stack.empty()) {
+    uint root = stack.back() - n;
+    uint left = merges[root].first;
+    uint right = merges[root].second;
+
+    if (leader < 0 && md[root] <= cutoff) {
+      leader = root;
+      ++nclusters;
+    }
+
+    if (left >= n && !visited[left]) {
+      visited[left] = true;
+      stack.push_back(left);
+      continue;
+    }
+    if (right >= n && !visited[right]) {
+      visited[right] = true;
+      stack.push_back(right);
+      continue;
+    }
+
+    if (left < n) {
+      if (leader < 0)
+        ++nclusters;
+      labels[left] = nclusters;
+    }
+    if (right < n) {
+      if (leader < 0)
+        ++nclusters;
+      labels[right] = nclusters;
+    }
+
+    if (leader == static_cast<int>(root))
+      leader = -1;
+    stack.pop_back();
+  }
+
+  return(labels);
+}
+
+
+
+boost::tuple<vecUint, vecUint, vecDouble> pickCenters(AtomicGroup& model, pTraj& traj, const vecUint& frames, const uint k, const uint nthreads) {
+  if (frames.empty())
+    throw(LOOSError("No frames to cluster"));
+
+  uint threads = resolveThreads(nthreads);
+  vecUint centers;
+  vecUint assignments(frames.size(), 0);
+  vecDouble distances(frames.size(), numeric_limits<double>::infinity());
+  vecDouble center(3 * model.size());
+
+  uint next = 0;
+  while (centers.size() < k) {
+    centers.push_back(next);
+
+    traj->readFrame(frames[next]);
+    traj->updateGroupCoords(model);
+    double ss = centeredCoords(model, &center[0]);
+
+    CenterDistances op(center, ss, centers.size() - 1, assignments, distances);
+    processFrames(model, traj, frames, threads, op);
+    distances[next] = 0.0;
+    assignments[next] = centers.size() - 1;
+
+    next = 0;
+    for (uint i=1; i<distances.size(); ++i)
+      if (distances[i] > distances[next])
+        next = i;
+    if (distances[next] == 0.0)
+      break;
+  }
+
+  return(boost::tuple<vecUint, vecUint, vecDouble>(centers, assignments, distances));
+}
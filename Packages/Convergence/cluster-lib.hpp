@@ -0,0 +1,86 @@
+/*
+  Clustering library
+*/
+
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2010, Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// @cond PACKAGES_INTERNAL
+
+#if !defined(LOOS_CLUSTERLIB_HPP)
+#define LOOS_CLUSTERLIB_HPP
+
+
+#include <loos.hpp>
+#include "fid-lib.hpp"
+
+
+
+// One merge of a hierarchical clustering, laid out as a row of a
+// scipy linkage matrix.  Structures are numbered 0..n-1 and the
+// cluster made by the i'th merge is numbered n+i.
+struct ClusterMerge {
+  ClusterMerge() : first(0), second(0), distance(0.0), size(0) { }
+  ClusterMerge(const uint a, const uint b, const double d, const uint s) :
+    first(a), second(b), distance(d), size(s) { }
+
+  uint first, second;
+  double distance;
+  uint size;              // Number of structures in the merged cluster
+};
+
+typedef std::vector<ClusterMerge> vecMerge;
+
+
+// Average-linkage (UPGMA) clustering of a symmetric distance matrix
+//
+// Uses the nearest-neighbor chain algorithm, so it takes O(N^2) time
+// and needs only a single working copy of the distances.  The merges
+// are sorted by distance and numbered the same way scipy's
+// linkage(method='average') numbers them.
+vecMerge averageLinkage(const loos::DoubleMatrix& D);
+
+// Cuts the tree into at most k flat clusters, numbered from 1
+// (i.e. scipy's fcluster(Z, k, criterion='maxclust'))
+vecUint flatClusters(const vecMerge& merges, const uint k);
+
+
+// Partitions the frames by the k-centers (farthest-first) heuristic
+//
+// The first frame is the first center.  Each new center is the frame
+// farthest (by superposed RMSD) from all of the current centers, so
+// the largest distance from any frame to its center is within a
+// factor of two of the best possible.  Each center costs one pass
+// through the trajectory, with frames compared against it in
+// parallel; no distance matrix is ever built.
+//
+// Returns the indices (into frames) of the centers, which center each
+// frame belongs to, and the distance to it.  Fewer than k centers are
+// picked if every frame is already on top of a center.
+boost::tuple<vecUint, vecUint, vecDouble> pickCenters(loos::AtomicGroup& model, loos::pTraj& traj, const vecUint& frames, const uint k, const uint nthreads = 1);
+
+
+#endif
+
+
+// @endcond PACKAGES_INTERNAL
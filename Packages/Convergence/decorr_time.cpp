@@ -48,6 +48,7 @@ const bool debugging = false;
 uint verbosity;
 
 uint nreps = 5;
+uint nthreads = 1;
 double frac;
 
 vecUint trange;
@@ -115,7 +116,8 @@ public:
     o.add_options()
       ("nrange", po::value<string>(&nrange_spec)->default_value("2,4,10"), "Range of N to use")
       ("frac", po::value<double>(&frac)->default_value(0.05), "Bin fraction")
-      ("reps", po::value<uint>(&nreps)->default_value(5), "# of repetitions to use for each N");
+      ("reps", po::value<uint>(&nreps)->default_value(5), "# of repetitions to use for each N")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "# of threads to use for assigning frames (0 = all available)");
   }
 
   bool postConditions(po::variables_map& vm) {
@@ -125,10 +127,11 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("nrange='%s', frac=%f, reps=%f")
+    oss << boost::format("nrange='%s', frac=%f, reps=%f, threads=%d")
       % nrange_spec
       % frac
-      % nreps;
+      % nreps
+      % nthreads;
     return(oss.str());
   }
 
@@ -332,9 +335,9 @@ int main(int argc, char *argv[]) {
     if (verbosity > 0)
       cerr << "Replica #" << k << endl;
 
-    boost::tuple<vecGroup, vecUint> fids = pickFiducials(subset, traj, indices, frac);
+    boost::tuple<vecGroup, vecUint> fids = pickFiducials(subset, traj, indices, frac, nthreads);
     vecGroup fiducials = boost::get<0>(fids);
-    vecUint assignments = assignStructures(subset, traj, indices, fiducials);
+    vecUint assignments = assignStructures(subset, traj, indices, fiducials, nthreads);
     uint S = fiducials.size();
     
     DoubleMatrix M(trange.size(), nrange.size() + 1);
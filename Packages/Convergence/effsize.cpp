@@ -0,0 +1,198 @@
+/*
+  effsize
+
+  Effective sample size of a trajectory, a la Zhang, Bhatt, and Zuckerman;
+  JCTC, DOI: 10.1021/ct1002384
+
+  This does the work of effsize.pl (ufidpick, assign_frames, hierarchy,
+  and neff, repeated several times) in one pass over the trajectory.
+*/
+
+
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2010, Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <loos.hpp>
+
+#include "fid-lib.hpp"
+#include "neff-lib.hpp"
+#include "ConvergenceOptions.hpp"
+
+using namespace std;
+using namespace loos;
+
+namespace opts = loos::OptionsFramework;
+namespace po = loos::OptionsFramework::po;
+
+
+
+string fullHelpMessage(void) {
+  string msg =
+    "\n"
+    "SYNOPSIS\n"
+    "\tEstimate the effective sample size of a trajectory\n"
+    "\n"
+    "DESCRIPTION\n"
+    "\n"
+    "\tThis tool estimates the number of statistically independent samples\n"
+    "in a trajectory, using the method of Zhang, Bhatt, and Zuckerman, JCTC\n"
+    "(2010) 6:3048-57.  It does the same analysis as effsize.pl, but without\n"
+    "running separate tools or writing intermediate files.\n"
+    "\n"
+    "\tThe trajectory is clipped so its length is a multiple of the number of\n"
+    "bins, and the selected atoms for each frame are read once and kept in\n"
+    "memory.  For each replica, a uniform structural histogram is built\n"
+    "(as ufidpick does), each frame is assigned to its closest fiducial\n"
+    "(as assign_frames does), the fiducial bins are clustered into states\n"
+    "(as hierarchy does), and the effective sample size is found from the\n"
+    "variance in the state populations (as neff does).  The average over\n"
+    "replicas is reported at the end.\n"
+    "\n"
+    "EXAMPLES\n"
+    "\n"
+    "\teffsize --selection 'name == \"CA\"' --threads 0 model.pdb sim.dcd\n"
+    "This estimates the effective sample size of sim.dcd using the alpha-carbons,\n"
+    "with 20 bins and 10 replicas (the defaults), using all available processors.\n"
+    "\n"
+    "SEE ALSO\n"
+    "\teffsize.pl, ufidpick, assign_frames, hierarchy, neff\n";
+
+  return(msg);
+}
+
+
+
+class ToolOptions : public opts::OptionsPackage {
+public:
+  ToolOptions() : nbins(20), nreps(10), nthreads(1) { }
+
+  void addGeneric(po::options_description& o) {
+    o.add_options()
+      ("nbins", po::value<uint>(&nbins)->default_value(nbins), "Number of bins to use to partition space")
+      ("nreps", po::value<uint>(&nreps)->default_value(nreps), "Number of times to repeat the analysis")
+      ("threads", po::value<uint>(&nthreads)->default_value(nthreads), "# of threads to use (0 = all available)");
+  }
+
+  bool postConditions(po::variables_map&) {
+    if (nbins < 2) {
+      cerr << "Error- must use at least 2 bins\n";
+      return(false);
+    }
+    if (nreps == 0) {
+      cerr << "Error- must have at least 1 replica\n";
+      return(false);
+    }
+    return(true);
+  }
+
+  string print() const {
+    ostringstream oss;
+    oss << boost::format("nbins=%d, nreps=%d, threads=%d") % nbins % nreps % nthreads;
+    return(oss.str());
+  }
+
+  uint nbins, nreps, nthreads;
+};
+
+
+
+int main(int argc, char *argv[]) {
+  string hdr = invocationHeader(argc, argv);
+
+  opts::BasicOptions* bopts = new opts::BasicOptions(fullHelpMessage());
+  opts::BasicSelection* sopts = new opts::BasicSelection("name == 'CA'");
+  opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices;
+  opts::BasicConvergence* copts = new opts::BasicConvergence;
+  ToolOptions* topts = new ToolOptions;
+
+  opts::AggregateOptions options;
+  options.add(bopts).add(sopts).add(tropts).add(copts).add(topts);
+  if (!options.parse(argc, argv))
+    exit(-1);
+
+  AtomicGroup model = tropts->model;
+  model.clearBonds();
+  pTraj traj = tropts->trajectory;
+  AtomicGroup subset = selectAtoms(model, sopts->selection);
+  vecUint frames = tropts->frameList();
+
+  // As with effsize.pl, the trajectory is clipped so that the last
+  // bin does not have fewer structures in it
+  uint nbins = topts->nbins;
+  double frac = 1.0 / nbins;
+  uint binsize = frames.size() / nbins;
+  if (binsize < 1)
+    binsize = 1;
+  uint nused = binsize * nbins;
+  if (nused > frames.size()) {
+    cerr << boost::format("Error- need at least %d frames for %d bins\n") % nused % nbins;
+    exit(-1);
+  }
+  frames.resize(nused);
+  uint range = nused - 1;
+
+  cout << "# " << hdr << endl;
+  cout << "# seed = " << copts->seed << endl;
+  cout << boost::format("# binsize=%d, frac=%f, range=%d\n") % binsize % frac % range;
+  cout << "# iter\tneff\tneff Total\n";
+
+  FrameCache cache(subset, traj, frames);
+
+  vecDouble neffs;
+  for (uint rep = 0; rep < topts->nreps; ++rep) {
+    boost::tuple<vecGroup, vecUint> result = pickFiducials(subset, cache, frac, topts->nthreads);
+    FiducialAssigner assigner(boost::get<0>(result), topts->nthreads);
+    vecUint assignments = assigner.assign(cache);
+
+    vvUint states = hierarchicalStates(assignments);
+    vecDouble sizes = stateSampleSizes(assignments, states, binsize);
+    double neff = *(min_element(sizes.begin(), sizes.end()));
+
+    cout << boost::format("%-3d\t%f\t%f\n") % rep % neff % (neff * nbins);
+    neffs.push_back(neff);
+  }
+
+  double mean = 0.0;
+  for (vecDouble::const_iterator i = neffs.begin(); i != neffs.end(); ++i)
+    mean += *i;
+  mean /= neffs.size();
+
+  double stddev = 0.0;
+  if (neffs.size() > 1) {
+    for (vecDouble::const_iterator i = neffs.begin(); i != neffs.end(); ++i)
+      stddev += (*i - mean) * (*i - mean);
+    stddev = sqrt(stddev / (neffs.size() - 1));
+  }
+
+  cout << "# Average effective sample size = " << mean << " += " << stddev << endl;
+
+  double total_samples = mean * nbins;
+  double total_std = stddev * nbins;
+  cout << "# Total samples = " << total_samples << " += " << total_std << endl;
+
+  double low_td = range / (total_samples + total_std);
+  double high_td = range / (total_samples - total_std);
+  cout << "# Effective Td = " << low_td << " - " << high_td << endl;
+}
@@ -36,6 +36,246 @@ using namespace loos;
 
 
 
+namespace {
+
+  // Pruning is only used with at least this many fiducials per pivot...
+  const uint fiducials_per_pivot = 8;
+  const uint max_pivots = 32;
+
+  // Candidates whose lower bound is within this of the best distance
+  // are still checked, so round-off in the bounds can never change
+  // an assignment
+  const double bound_tolerance = 1e-6;
+
+
+  struct AssignFrames {
+    AssignFrames(const FiducialAssigner& assigner_, vecUint& assignments_) :
+      assigner(assigner_), assignments(assignments_) { }
+
+    void operator()(const double* crds, const double* ss, const uint offset, const uint n) const {
+      assigner.assign(crds, ss, n, &assignments[offset]);
+    }
+
+    const FiducialAssigner& assigner;
+    vecUint& assignments;
+  };
+
+
+  struct FiducialDistances {
+    FiducialDistances(const vecDouble& fiducial_, const double ss_, const vecUint& indices_, vecDouble& distances_) :
+      fiducial(fiducial_), ss(ss_), indices(indices_), distances(distances_) { }
+
+    void operator()(const double* crds, const double* crd_ss, const uint offset, const uint n) const {
+      uint natoms = fiducial.size() / 3;
+      for (uint i=0; i<n; ++i)
+        distances[indices[offset + i]] = superposedRMSD(crds + i * 3 * natoms, crd_ss[i], &fiducial[0], ss, natoms);
+    }
+
+    const vecDouble& fiducial;
+    double ss;
+    const vecUint& indices;
+    vecDouble& distances;
+  };
+
+
+  // Distances from a fiducial to the cached frames listed in indices
+  struct CachedDistances {
+    CachedDistances(const FrameCache& cache_, const vecDouble& fiducial_, const double ss_, const vecUint& indices_, vecDouble& distances_) :
+      cache(cache_), fiducial(fiducial_), ss(ss_), indices(indices_), distances(distances_) { }
+
+    void operator()(const uint begin, const uint end) const {
+      for (uint i=begin; i<end; ++i) {
+        uint j = indices[i];
+        distances[j] = superposedRMSD(cache.coords(j), cache.sumOfSquares(j), &fiducial[0], ss, cache.natoms());
+      }
+    }
+
+    const FrameCache& cache;
+    const vecDouble& fiducial;
+    double ss;
+    const vecUint& indices;
+    vecDouble& distances;
+  };
+
+
+  struct AssignCached {
+    AssignCached(const FiducialAssigner& assigner_, const FrameCache& cache_, vecUint& assignments_) :
+      assigner(assigner_), cache(cache_), assignments(assignments_) { }
+
+    void operator()(const uint begin, const uint end) const {
+      if (begin < end)
+        assigner.assign(cache.coords(begin), &cache.sumOfSquares(begin), end - begin, &assignments[begin]);
+    }
+
+    const FiducialAssigner& assigner;
+    const FrameCache& cache;
+    vecUint& assignments;
+  };
+
+
+  // Splits [0,n) into one contiguous chunk per thread
+  template<class Op>
+  void processRange(const uint n, const uint nthreads, const Op& op) {
+    if (nthreads == 1 || n < nthreads) {
+      op(0, n);
+      return;
+    }
+
+    boost::thread_group threads;
+    uint chunk = (n + nthreads - 1) / nthreads;
+    for (uint i=0; i<n; i += chunk) {
+      uint m = i + chunk < n ? i + chunk : n;
+      threads.create_thread(boost::bind<void>(boost::cref(op), i, m));
+    }
+    threads.join_all();
+  }
+
+
+  // Fiducials are picked from a source of frames, which is either the
+  // trajectory or a FrameCache.  Each source supplies the structure
+  // for a picked frame and the distances from a fiducial to the
+  // remaining frames.
+  class TrajectoryFrames {
+  public:
+    TrajectoryFrames(AtomicGroup& model, pTraj& traj, const vecUint& frames, const uint nthreads) :
+      model_(model), traj_(traj), frames_(frames), nthreads_(nthreads) { }
+
+    uint size() const { return(frames_.size()); }
+
+    AtomicGroup structure(const uint i) {
+      traj_->readFrame(frames_[i]);
+      traj_->updateGroupCoords(model_);
+      return(model_.copy());
+    }
+
+    void distances(const vecDouble& fiducial, const double ss, const vecUint& indices, vecDouble& distances) {
+      vecUint unassigned_frames;
+      for (vecUint::const_iterator i = indices.begin(); i != indices.end(); ++i)
+        unassigned_frames.push_back(frames_[*i]);
+
+      FiducialDistances op(fiducial, ss, indices, distances);
+      processFrames(model_, traj_, unassigned_frames, nthreads_, op);
+    }
+
+  private:
+    AtomicGroup& model_;
+    pTraj& traj_;
+    const vecUint& frames_;
+    uint nthreads_;
+  };
+
+
+  class CachedFrames {
+  public:
+    CachedFrames(const AtomicGroup& model, const FrameCache& cache, const uint nthreads) :
+      model_(model), cache_(cache), nthreads_(nthreads) { }
+
+    uint size() const { return(cache_.size()); }
+
+    AtomicGroup structure(const uint i) { return(cache_.structure(i, model_)); }
+
+    void distances(const vecDouble& fiducial, const double ss, const vecUint& indices, vecDouble& distances) {
+      CachedDistances op(cache_, fiducial, ss, indices, distances);
+      processRange(indices.size(), nthreads_, op);
+    }
+
+  private:
+    const AtomicGroup& model_;
+    const FrameCache& cache_;
+    uint nthreads_;
+  };
+
+
+  template<class Frames>
+  boost::tuple<vecGroup, vecUint> pickFrom(Frames& source, const double f) {
+
+    // Size of bin
+    uint bin_size = f * source.size();
+
+    // Initialize a RNG to use a uniform random distribution.
+    // Use the LOOS generator singleton so the random number stream can
+    // be seeded (or automatically seeded) by LOOS...
+    boost::uniform_real<> rmap;
+    boost::variate_generator< base_generator_type&, boost::uniform_real<> > rng(rng_singleton(), rmap);
+
+    // Vector of AtomicGroup's representing the fiducial structures
+    vecGroup fiducials;
+
+    // Track which trajectory frame has been assigned to which fiducial
+    vecInt assignments(source.size(), -1);
+
+    // The indices (frame #'s) of the structures picked to be fiducials
+    vecUint refs;
+    vecDouble radii;
+  
+    // Unassigned frames...bootstrap the loop
+    vecUint possible_frames = findFreeFrames(assignments);
+
+    // Are there any unassigned frames left?
+    while (! possible_frames.empty()) {
+      // Randomly pick one
+      uint pick = possible_frames[static_cast<uint>(floor(possible_frames.size() * rng()))];
+
+      // Make a copy and assign a new bin # to the fiducial
+      AtomicGroup fiducial = source.structure(pick);
+      fiducial.centerAtOrigin();
+      uint myid = fiducials.size();
+      if (assignments[pick] >= 0) {
+        cerr << "INTERNAL ERROR - " << pick << " pick was already assigned to " << assignments[pick] << endl;
+        exit(-99);
+      }
+
+      fiducials.push_back(fiducial);
+      refs.push_back(pick);
+    
+      // Now find the distance from every unassigned frame to this new fiducial (aligning
+      // them first), and then sort by distance...
+      vecDouble fiducial_crds(3 * fiducial.size());
+      double fiducial_ss = centeredCoords(fiducial, &fiducial_crds[0]);
+
+      vector<double> distances(assignments.size(), numeric_limits<double>::max());
+      source.distances(fiducial_crds, fiducial_ss, possible_frames, distances);
+
+      vecUint indices = sortedIndex(distances);
+      uint picked = 0;
+      double maxd = 0.0;
+
+      // Pick the first bin_size of them (or however many are remaining)
+      // and assign these to the newly picked fiducial
+      for (uint i=0; i<assignments.size() && picked < bin_size; ++i) {
+        if (assignments[indices[i]] < 0) {
+          assignments[indices[i]] = myid;
+          ++picked;
+          if (distances[indices[i]] > maxd)
+            maxd = distances[indices[i]];
+        }
+      }
+      radii.push_back(maxd);
+      possible_frames = findFreeFrames(assignments);
+    }
+
+    // Safety check...
+    for (vecInt::const_iterator i = assignments.begin(); i != assignments.end(); ++i)
+      if (*i < 0)
+        throw(runtime_error("A frame was not assigned in binFrames()"));
+
+    boost::tuple<vecGroup, vecUint> result(fiducials, refs);
+    return(result);
+  }
+
+}
+
+
+
+
+uint resolveThreads(const uint n) {
+  if (n)
+    return(n);
+  uint m = boost::thread::hardware_concurrency();
+  return(m ? m : 1);
+}
+
+
 
 vecUint findFreeFrames(const vecInt& map) {
   vecUint indices;
@@ -49,130 +289,321 @@ vecUint findFreeFrames(const vecInt& map) {
 
 
 
-vecUint assignStructures(AtomicGroup& model, pTraj& traj, const vecUint& frames, const vecGroup& refs) {
-  vecUint assignments(frames.size(), 0);
-  uint j = 0;
+double centeredCoords(const AtomicGroup& grp, double* crds) {
+  uint n = grp.size();
+  double c[3] = {0.0, 0.0, 0.0};
 
-  for (vecUint::const_iterator frame = frames.begin(); frame != frames.end(); ++frame) {
-    traj->readFrame(*frame);
-    traj->updateGroupCoords(model);
+  for (uint i=0; i<n; ++i) {
+    const GCoord& x = grp[i]->coords();
+    for (uint k=0; k<3; ++k) {
+      crds[3*i+k] = x[k];
+      c[k] += x[k];
+    }
+  }
 
-    double mind = numeric_limits<double>::max();
-    uint mini = refs.size() + 1;
-    
-    for (uint i = 0; i < refs.size(); ++i) {
-      model.alignOnto(refs[i]);
-      double d = model.rmsd(refs[i]);
-      if (d < mind) {
-        mind = d;
-        mini = i;
-      }
+  for (uint k=0; k<3; ++k)
+    c[k] /= n;
+
+  double ss = 0.0;
+  for (uint i=0; i<n; ++i)
+    for (uint k=0; k<3; ++k) {
+      crds[3*i+k] -= c[k];
+      ss += crds[3*i+k] * crds[3*i+k];
     }
 
-    assignments[j++] = mini;
-  }
+  return(ss);
+}
 
-  return(assignments);
+
+
+// This is the same calculation as alignment::centeredRMSD(), but
+// with the correlation matrix built directly and everything kept on
+// the stack...
+double superposedRMSD(const double* u, const double ssu, const double* v, const double ssv, const uint n) {
+  double R[9] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+  for (uint i=0; i<3*n; i += 3)
+    for (uint col=0; col<3; ++col) {
+      double vc = v[i+col];
+      R[3*col] += u[i] * vc;
+      R[3*col+1] += u[i+1] * vc;
+      R[3*col+2] += u[i+2] * vc;
+    }
+
+  char joba = 'G';
+  char jobu = 'U', jobv = 'V';
+  f77int mv = 0;
+  f77int m = 3, lda = 3, ldv = 3, lwork = 100, info;
+  f77int nn = 3;
+  double work[100];
+  double S[3];
+  double V[9];
+
+  dgesvj_(&joba, &jobu, &jobv, &m, &nn, R, &lda, S, &mv, V, &ldv, work, &lwork, &info);
+  if (info < 0)
+    throw(NumericalError("SVD in superposedRMSD() returned an error", info));
+
+  double dR = R[0]*R[4]*R[8] + R[3]*R[7]*R[2] + R[6]*R[1]*R[5] -
+    R[0]*R[7]*R[5] - R[3]*R[1]*R[8] - R[6]*R[4]*R[2];
+  double dV = V[0]*V[4]*V[8] + V[3]*V[7]*V[2] + V[6]*V[1]*V[5] -
+    V[0]*V[7]*V[5] - V[3]*V[1]*V[8] - V[6]*V[4]*V[2];
+  if (dR * dV < 0.0)
+    S[2] = -S[2];
+
+  double E0 = ssu + ssv;
+  return(sqrt(fabs(E0 - 2.0 * (S[0] + S[1] + S[2])) / n));
 }
 
 
-vecUint trimFrames(const vecUint& frames, const double frac) {
-  uint bin_size = frac * frames.size();
-  uint remainder = frames.size() - static_cast<uint>(bin_size / frac);
 
-  vecUint truncated;
-  vecUint::const_iterator vi = frames.begin();
-  for (uint i = 0; i<frames.size() - remainder; ++i)
-    truncated.push_back(*vi++);
-  
-  return(truncated);
+FrameCache::FrameCache(AtomicGroup& model, pTraj& traj, const vecUint& frames) :
+  natoms_(model.size()),
+  nframes_(frames.size()),
+  coords_(nframes_ * 3 * natoms_),
+  ss_(nframes_)
+{
+  for (uint i=0; i<nframes_; ++i) {
+    traj->readFrame(frames[i]);
+    traj->updateGroupCoords(model);
+    ss_[i] = centeredCoords(model, &coords_[i * 3 * natoms_]);
+  }
 }
 
 
+AtomicGroup FrameCache::structure(const uint i, const AtomicGroup& model) const {
+  if (model.size() != natoms_)
+    throw(LOOSError("Model does not have the same number of atoms as the cached frames"));
 
+  AtomicGroup structure = model.copy();
+  const double* crds = coords(i);
+  for (uint j=0; j<natoms_; ++j)
+    structure[j]->coords(GCoord(crds[3*j], crds[3*j+1], crds[3*j+2]));
 
-boost::tuple<vecGroup, vecUint> pickFiducials(AtomicGroup& model, pTraj& traj, const vecUint& frames, const double f) {
+  return(structure);
+}
 
-  // Size of bin
-  uint bin_size = f * frames.size();
 
-  // Initialize a RNG to use a uniform random distribution.
-  // Use the LOOS generator singleton so the random number stream can
-  // be seeded (or automatically seeded) by LOOS...
-  boost::uniform_real<> rmap;
-  boost::variate_generator< base_generator_type&, boost::uniform_real<> > rng(rng_singleton(), rmap);
 
-  // Vector of AtomicGroup's representing the fiducial structures
-  vecGroup fiducials;
+FiducialAssigner::FiducialAssigner(const vecGroup& refs, const uint nthreads) :
+  natoms_(refs.empty() ? 0 : refs[0].size()),
+  stride_(3 * natoms_),
+  nrefs_(refs.size()),
+  nthreads_(resolveThreads(nthreads)),
+  coords_(nrefs_ * stride_),
+  ss_(nrefs_),
+  is_pivot_(nrefs_, false)
+{
+  for (uint j=0; j<nrefs_; ++j) {
+    if (refs[j].size() != natoms_)
+      throw(LOOSError("All fiducials must have the same number of atoms"));
+    ss_[j] = centeredCoords(refs[j], &coords_[j * stride_]);
+  }
 
-  // Track which trajectory frame has been assigned to which fiducial
-  vecInt assignments(frames.size(), -1);
+  pickPivots();
+}
 
-  // The indices (frame #'s) of the structures picked to be fiducials
-  vecUint refs;
-  vecDouble radii;
-  
-  // Unassigned frames...bootstrap the loop
-  vecUint possible_frames = findFreeFrames(assignments);
 
-  // Are there any unassigned frames left?
-  while (! possible_frames.empty()) {
-    // Randomly pick one
-    uint pick = possible_frames[static_cast<uint>(floor(possible_frames.size() * rng()))];
+void FiducialAssigner::threads(const uint n) {
+  nthreads_ = resolveThreads(n);
+}
 
-    traj->readFrame(frames[pick]);
-    traj->updateGroupCoords(model);
 
-    // Make a copy and assign a new bin # to the fiducial
-    AtomicGroup fiducial = model.copy();
-    fiducial.centerAtOrigin();
-    uint myid = fiducials.size();
-    if (assignments[pick] >= 0) {
-      cerr << "INTERNAL ERROR - " << pick << " pick was already assigned to " << assignments[pick] << endl;
-      exit(-99);
+// Pivots are picked by farthest-first traversal (each new pivot is
+// the fiducial farthest from all current pivots), so they spread out
+// over the fiducials and give tight bounds.  The distances found
+// along the way fill in the pivot table.
+void FiducialAssigner::pickPivots() {
+  uint npivots = nrefs_ / fiducials_per_pivot;
+  if (npivots > max_pivots)
+    npivots = max_pivots;
+  if (npivots < 2)
+    return;
+
+  vecDouble table(npivots * nrefs_);
+  vecDouble nearest(nrefs_, numeric_limits<double>::max());
+  uint next = 0;
+
+  while (pivots_.size() < npivots) {
+    uint p = pivots_.size();
+    pivots_.push_back(next);
+    is_pivot_[next] = true;
+
+    const double* pc = &coords_[next * stride_];
+    for (uint j=0; j<nrefs_; ++j) {
+      double d = (j == next) ? 0.0 : superposedRMSD(pc, ss_[next], &coords_[j * stride_], ss_[j], natoms_);
+      table[p * nrefs_ + j] = d;
+      if (d < nearest[j])
+        nearest[j] = d;
     }
 
-    fiducials.push_back(fiducial);
-    refs.push_back(pick);
-    
-    // Now find the distance from every unassigned frame to this new fiducial (aligning
-    // them first), and then sort by distance...
-    vector<double> distances(assignments.size(), numeric_limits<double>::max());
-    for (uint i = 0; i<assignments.size(); ++i) {
-      if (assignments[i] >= 0)
-        continue;
-      traj->readFrame(frames[i]);
-      traj->updateGroupCoords(model);
-      model.centerAtOrigin();
-      model.alignOnto(fiducial);
-      distances[i] = model.rmsd(fiducial);
-    }
-
-    vecUint indices = sortedIndex(distances);
-    uint picked = 0;
     double maxd = 0.0;
+    for (uint j=0; j<nrefs_; ++j)
+      if (nearest[j] > maxd) {
+        maxd = nearest[j];
+        next = j;
+      }
+    if (maxd == 0.0)     // Everything is a duplicate of a pivot...
+      break;
+  }
+
+  // Reorder so the distances for a fiducial are contiguous
+  npivots = pivots_.size();
+  pivot_table_.resize(npivots * nrefs_);
+  for (uint j=0; j<nrefs_; ++j)
+    for (uint p=0; p<npivots; ++p)
+      pivot_table_[j * npivots + p] = table[p * nrefs_ + j];
+}
 
-    // Pick the first bin_size of them (or however many are remaining)
-    // and assign these to the newly picked fiducial
-    for (uint i=0; i<assignments.size() && picked < bin_size; ++i) {
-      if (assignments[indices[i]] < 0) {
-        assignments[indices[i]] = myid;
-        ++picked;
-        if (distances[indices[i]] > maxd)
-          maxd = distances[indices[i]];
+
+
+uint FiducialAssigner::assign(const double* crds, const double ss, const uint guess) const {
+  Scratch scratch;
+  return(assign(crds, ss, guess, scratch));
+}
+
+
+uint FiducialAssigner::assign(const double* crds, const double ss, const uint guess, Scratch& scratch) const {
+  double best = numeric_limits<double>::max();
+  uint besti = nrefs_;
+
+  if (pivots_.empty()) {
+    for (uint j=0; j<nrefs_; ++j) {
+      double d = distance(crds, ss, j);
+      if (d < best) {
+        best = d;
+        besti = j;
       }
     }
-    radii.push_back(maxd);
-    possible_frames = findFreeFrames(assignments);
+    return(besti);
   }
 
-  // Safety check...
-  for (vecInt::const_iterator i = assignments.begin(); i != assignments.end(); ++i)
-    if (*i < 0)
-      throw(runtime_error("A frame was not assigned in binFrames()"));
+  uint npivots = pivots_.size();
+  vecDouble& dp = scratch.pivot_distances;
+  dp.resize(npivots);
+  for (uint p=0; p<npivots; ++p) {
+    uint j = pivots_[p];
+    double d = distance(crds, ss, j);
+    dp[p] = d;
+    if (d < best || (d == best && j < besti)) {
+      best = d;
+      besti = j;
+    }
+  }
+
+  uint g = guess < nrefs_ ? guess : 0;
+  if (!is_pivot_[g]) {
+    double d = distance(crds, ss, g);
+    if (d < best || (d == best && g < besti)) {
+      best = d;
+      besti = g;
+    }
+  }
+
+  std::vector< std::pair<double, uint> >& candidates = scratch.candidates;
+  candidates.clear();
+  for (uint j=0; j<nrefs_; ++j) {
+    if (is_pivot_[j] || j == g)
+      continue;
+
+    const double* table = &pivot_table_[j * npivots];
+    double bound = 0.0;
+    for (uint p=0; p<npivots; ++p) {
+      double b = fabs(dp[p] - table[p]);
+      if (b > bound)
+        bound = b;
+    }
+    if (bound <= best + bound_tolerance)
+      candidates.push_back(std::pair<double, uint>(bound, j));
+  }
+
+  sort(candidates.begin(), candidates.end());
+  for (std::vector< std::pair<double, uint> >::const_iterator i = candidates.begin(); i != candidates.end(); ++i) {
+    if (i->first > best + bound_tolerance)
+      break;
+    double d = distance(crds, ss, i->second);
+    if (d < best || (d == best && i->second < besti)) {
+      best = d;
+      besti = i->second;
+    }
+  }
+
+  return(besti);
+}
+
+
+// Consecutive frames are usually closest to the same fiducial, so
+// each assignment is the guess for the next
+void FiducialAssigner::assign(const double* crds, const double* ss, const uint n, uint* assignments) const {
+  Scratch scratch;
+  scratch.candidates.reserve(nrefs_);
+
+  uint guess = 0;
+  for (uint i=0; i<n; ++i) {
+    guess = assign(crds + i * stride_, ss[i], guess, scratch);
+    assignments[i] = guess;
+  }
+}
+
+
+vecUint FiducialAssigner::assign(AtomicGroup& model, pTraj& traj, const vecUint& frames) const {
+  if (model.size() != natoms_)
+    throw(LOOSError("Model does not have the same number of atoms as the fiducials"));
+
+  vecUint assignments(frames.size(), 0);
+  AssignFrames op(*this, assignments);
+  processFrames(model, traj, frames, nthreads_, op);
+
+  return(assignments);
+}
+
+
+
+vecUint FiducialAssigner::assign(const FrameCache& cache) const {
+  if (cache.natoms() != natoms_)
+    throw(LOOSError("Cached frames do not have the same number of atoms as the fiducials"));
+
+  vecUint assignments(cache.size(), 0);
+  AssignCached op(*this, cache, assignments);
+  processRange(cache.size(), nthreads_, op);
+
+  return(assignments);
+}
+
+
+
+vecUint assignStructures(AtomicGroup& model, pTraj& traj, const vecUint& frames, const vecGroup& refs, const uint nthreads) {
+  FiducialAssigner assigner(refs, nthreads);
+  return(assigner.assign(model, traj, frames));
+}
+
+
+vecUint trimFrames(const vecUint& frames, const double frac) {
+  uint bin_size = frac * frames.size();
+  uint remainder = frames.size() - static_cast<uint>(bin_size / frac);
+
+  vecUint truncated;
+  vecUint::const_iterator vi = frames.begin();
+  for (uint i = 0; i<frames.size() - remainder; ++i)
+    truncated.push_back(*vi++);
+  
+  return(truncated);
+}
+
+
+
+
+boost::tuple<vecGroup, vecUint> pickFiducials(AtomicGroup& model, pTraj& traj, const vecUint& frames, const double f, const uint nthreads) {
+  TrajectoryFrames source(model, traj, frames, resolveThreads(nthreads));
+  return(pickFrom(source, f));
+}
+
+
+boost::tuple<vecGroup, vecUint> pickFiducials(const AtomicGroup& model, const FrameCache& cache, const double f, const uint nthreads) {
+  if (model.size() != cache.natoms())
+    throw(LOOSError("Model does not have the same number of atoms as the cached frames"));
 
-  boost::tuple<vecGroup, vecUint> result(fiducials, refs);
-  return(result);
+  CachedFrames source(model, cache, resolveThreads(nthreads));
+  return(pickFrom(source, f));
 }
 
 
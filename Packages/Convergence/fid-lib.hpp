@@ -34,6 +34,9 @@
 
 #include <loos.hpp>
 
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
 
 typedef std::vector<int>                   vecInt;
 typedef std::vector<uint>                 vecUint;
@@ -46,9 +49,145 @@ typedef std::vector<double>             vecDouble;
 // Return indices of non-zero entries in the vector (i.e. frames that are not assigned)
 vecUint findFreeFrames(const vecInt& map);
 
+
+// Copies the coordinates of grp into crds (as x,y,z triples), centered at
+// the origin, and returns their sum of squares
+double centeredCoords(const loos::AtomicGroup& grp, double* crds);
+
+// RMSD between two centered structures of n atoms after optimal superposition.
+// ssu and ssv are the sums of squares of each set of coordinates (see
+// centeredCoords()).  Nothing is allocated, so this is safe to call from
+// multiple threads.
+double superposedRMSD(const double* u, const double ssu, const double* v, const double ssv, const uint n);
+
+
+// Number of threads to use, where 0 means all available
+uint resolveThreads(const uint n);
+
+// Reads the requested frames in blocks, centering each, then calls
+// op(crds, ss, offset, n) for each thread's share of the block.
+// crds and ss hold the coordinates and sums of squares of frames
+// [offset, offset+n).
+template<class Op>
+void processFrames(loos::AtomicGroup& model, loos::pTraj& traj, const vecUint& frames, const uint nthreads, Op& op) {
+  const uint frames_per_thread = 64;
+
+  uint stride = 3 * model.size();
+  uint block = frames_per_thread * nthreads;
+  vecDouble crds(block * stride);
+  vecDouble ss(block);
+
+  for (uint begin = 0; begin < frames.size(); begin += block) {
+    uint n = frames.size() - begin < block ? frames.size() - begin : block;
+    for (uint i=0; i<n; ++i) {
+      traj->readFrame(frames[begin + i]);
+      traj->updateGroupCoords(model);
+      ss[i] = centeredCoords(model, &crds[i * stride]);
+    }
+
+    if (nthreads == 1) {
+      op(&crds[0], &ss[0], begin, n);
+      continue;
+    }
+
+    boost::thread_group threads;
+    uint chunk = (n + nthreads - 1) / nthreads;
+    for (uint i=0; i<n; i += chunk) {
+      uint m = i + chunk < n ? chunk : n - i;
+      threads.create_thread(boost::bind<void>(boost::ref(op), &crds[i * stride], &ss[i], begin + i, m));
+    }
+    threads.join_all();
+  }
+}
+
+
+// Centered coordinates of a set of trajectory frames, read once and kept in memory
+//
+// Analyses that go over the same frames many times (e.g. picking and
+// assigning fiducials for several replicas) can work from the cache
+// rather than rereading the trajectory.  Frames are stored one after
+// another in the order given, as processFrames() passes them.
+class FrameCache {
+public:
+  FrameCache(loos::AtomicGroup& model, loos::pTraj& traj, const vecUint& frames);
+
+  uint size() const { return(nframes_); }
+  uint natoms() const { return(natoms_); }
+
+  const double* coords(const uint i) const { return(&coords_[i * 3 * natoms_]); }
+  const double& sumOfSquares(const uint i) const { return(ss_[i]); }
+
+  // A copy of model with the (centered) coordinates of cached frame i
+  loos::AtomicGroup structure(const uint i, const loos::AtomicGroup& model) const;
+
+private:
+  uint natoms_, nframes_;
+  vecDouble coords_, ss_;
+};
+
+
+// Finds the closest fiducial to a structure (by RMSD after superposition)
+//
+// The fiducials are centered and stored once.  A handful of them are
+// picked as "pivots" and the distance from each pivot to every
+// fiducial is precomputed.  Since RMSD is a metric, |d(x,p) - d(p,f)|
+// is a lower bound on d(x,f), so once the distances from a structure
+// to the pivots are known, most fiducials never need to be
+// superimposed.  Candidates are checked in order of their bound,
+// starting with a guess (typically the previous frame's assignment).
+// Ties go to the lowest numbered fiducial, as with a brute-force
+// search.
+//
+// Trajectory frames are read in blocks and assigned in parallel.
+class FiducialAssigner {
+public:
+  // nthreads = 0 means use all available
+  FiducialAssigner(const vecGroup& refs, const uint nthreads = 1);
+
+  uint size() const { return(nrefs_); }
+  uint natoms() const { return(natoms_); }
+
+  uint threads() const { return(nthreads_); }
+  void threads(const uint n);
+
+  // Closest fiducial to the centered coordinates crds (with sum of squares ss)
+  uint assign(const double* crds, const double ss, const uint guess = 0) const;
+
+  // Assigns n centered structures stored one after another in crds
+  void assign(const double* crds, const double* ss, const uint n, uint* assignments) const;
+
+  // Closest fiducial to model for each of the given frames
+  vecUint assign(loos::AtomicGroup& model, loos::pTraj& traj, const vecUint& frames) const;
+
+  // Closest fiducial for each cached frame
+  vecUint assign(const FrameCache& cache) const;
+
+private:
+  // Per-thread work space
+  struct Scratch {
+    vecDouble pivot_distances;
+    std::vector< std::pair<double, uint> > candidates;
+  };
+
+  double distance(const double* crds, const double ss, const uint j) const {
+    return(superposedRMSD(crds, ss, &coords_[j * stride_], ss_[j], natoms_));
+  }
+
+  uint assign(const double* crds, const double ss, const uint guess, Scratch& scratch) const;
+  void pickPivots();
+
+  uint natoms_, stride_, nrefs_, nthreads_;
+  vecDouble coords_;              // Centered fiducials, one after another
+  vecDouble ss_;                  // Sum of squares for each fiducial
+  vecUint pivots_;
+  std::vector<bool> is_pivot_;
+  vecDouble pivot_table_;         // Distance from each fiducial to each pivot (fiducial-major)
+};
+
+
 // Given a set of reference structures and a trajectory, classify the trajectory
 // based on which reference structure is closest to each trajectory frame
-vecUint assignStructures(loos::AtomicGroup& model, loos::pTraj& traj, const vecUint& frames, const vecGroup& refs);
+vecUint assignStructures(loos::AtomicGroup& model, loos::pTraj& traj, const vecUint& frames, const vecGroup& refs, const uint nthreads = 1);
 
 // Given a vector that contains indices into a trajectory, will trim off the
 // end so the # of frames is an even multiple of the requested bin size (via frac)
@@ -56,7 +195,10 @@ vecUint trimFrames(const vecUint& frames, const double frac);
 
 // Randomly partition trajectory space
 // f = the fractional bin size (i.e. probability)
-boost::tuple<vecGroup, vecUint> pickFiducials(loos::AtomicGroup& model, loos::pTraj& traj, const vecUint& frames, const double f);
+boost::tuple<vecGroup, vecUint> pickFiducials(loos::AtomicGroup& model, loos::pTraj& traj, const vecUint& frames, const double f, const uint nthreads = 1);
+
+// As above, but picking from cached frames (the picks are indices into the cache)
+boost::tuple<vecGroup, vecUint> pickFiducials(const loos::AtomicGroup& model, const FrameCache& cache, const double f, const uint nthreads = 1);
 
 // Find the max value in the vector
 int findMaxBin(const vecInt& assignments);
@@ -0,0 +1,223 @@
+/*
+  Average-linkage hierarchical clustering of a distance matrix
+*/
+
+
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2013, Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <loos.hpp>
+
+#include "cluster-lib.hpp"
+
+using namespace std;
+using namespace loos;
+
+namespace opts = loos::OptionsFramework;
+namespace po = loos::OptionsFramework::po;
+
+
+
+string fullHelpMessage(void) {
+  string msg =
+    "\n"
+    "SYNOPSIS\n"
+    "\tHierarchical clustering of structures given a matrix of distances\n"
+    "\n"
+    "DESCRIPTION\n"
+    "\n"
+    "\tThis tool clusters structures using the UPGMA (average linkage)\n"
+    "algorithm: the distance between two clusters is the average of the\n"
+    "distances between all pairs of structures in them.  The tree is then\n"
+    "cut into (at most) the requested number of clusters, numbered from 1.\n"
+    "\n"
+    "\tThe distance matrix could be, for example, the output of rmsds.\n"
+    "The clustering takes time proportional to the square of the number of\n"
+    "structures, so it is practical for tens of thousands of structures.\n"
+    "\n"
+    "\tTwo files are always written, PREFIX_N.dat and PREFIX_N.hist, where\n"
+    "PREFIX defaults to 'all' and N is the number of clusters.  The .dat\n"
+    "file is the time series of cluster assignments and the .hist file is\n"
+    "the normalized population of each cluster (the first entry is for the\n"
+    "unused cluster 0).  With --link, the linkage matrix is written to\n"
+    "PREFIX.link in the same layout scipy uses (two clusters, the distance\n"
+    "between them, and the size of the new cluster).\n"
+    "\n"
+    "\tIf an index file is given, a .dat and .hist are also written for\n"
+    "each trajectory listed in it.  The format is\n"
+    "\t  START_FRAME   END_FRAME   FILENAME\n"
+    "using 0-based indices.  Any leading path and extension are removed from\n"
+    "FILENAME to make the output names.\n"
+    "\n"
+    "\tThis produces the same output as hierarchical-cluster.py, without\n"
+    "needing scipy.\n"
+    "\n"
+    "EXAMPLES\n"
+    "\n"
+    "\trmsds model.pdb sim.dcd >rmsds.asc\n"
+    "\thcluster rmsds.asc 10\n"
+    "This clusters the frames of sim.dcd into 10 clusters, writing all_10.dat\n"
+    "and all_10.hist.\n"
+    "\n"
+    "SEE ALSO\n"
+    "\trmsds, kcenters, hierarchical-cluster.py\n";
+
+  return(msg);
+}
+
+
+
+class ToolOptions : public opts::OptionsPackage {
+public:
+  ToolOptions() : prefix("all"), link(false) { }
+
+  void addGeneric(po::options_description& o) {
+    o.add_options()
+      ("index", po::value<string>(&index_file), "File identifying which rows come from which trajectory")
+      ("prefix", po::value<string>(&prefix)->default_value(prefix), "Core of the output filenames")
+      ("link", po::value<bool>(&link)->default_value(link), "Write out the linkage matrix");
+  }
+
+  string print() const {
+    ostringstream oss;
+    oss << boost::format("index='%s', prefix='%s', link=%d") % index_file % prefix % link;
+    return(oss.str());
+  }
+
+  string index_file, prefix;
+  bool link;
+};
+
+
+
+struct TrajectoryRange {
+  TrajectoryRange(const string& n, const uint f, const uint l) : name(n), first(f), last(l) { }
+
+  string name;
+  uint first, last;
+};
+
+
+// Strips any leading path and extension, so /foo/bar/baz.dcd becomes baz
+string trajectoryName(const string& fname) {
+  string::size_type slash = fname.rfind('/');
+  string name = slash == string::npos ? fname : fname.substr(slash + 1);
+
+  string::size_type dot = name.rfind('.');
+  if (dot != string::npos && dot > 0)
+    name = name.substr(0, dot);
+
+  return(name);
+}
+
+
+vector<TrajectoryRange> readIndexFile(const string& fname) {
+  ifstream ifs(fname.c_str());
+  if (!ifs)
+    throw(FileOpenError(fname));
+
+  vector<TrajectoryRange> ranges;
+  uint first, last;
+  string name;
+  while (ifs >> first >> last >> name)
+    ranges.push_back(TrajectoryRange(trajectoryName(name), first, last));
+
+  return(ranges);
+}
+
+
+void writeCluster(const string& name, const string& hdr, const vecUint& assignments, const TrajectoryRange& range, const uint k) {
+  if (range.first > range.last || range.last >= assignments.size())
+    throw(LOOSError("Bad range for " + range.name + " in index file"));
+
+  ostringstream oss;
+  oss << name << "_" << k;
+
+  ofstream dat((oss.str() + ".dat").c_str());
+  dat << "# " << hdr << endl;
+  vecUint hist(k+1, 0);
+  for (uint i=range.first; i<=range.last; ++i) {
+    dat << assignments[i] << endl;
+    ++hist[assignments[i]];
+  }
+
+  ofstream ofs((oss.str() + ".hist").c_str());
+  ofs << "# " << hdr << endl;
+  double n = range.last - range.first + 1;
+  for (uint i=0; i<=k; ++i)
+    ofs << boost::format("%.18e") % (hist[i] / n) << endl;
+}
+
+
+
+int main(int argc, char *argv[]) {
+  string hdr = invocationHeader(argc, argv);
+
+  opts::BasicOptions* bopts = new opts::BasicOptions(fullHelpMessage());
+  ToolOptions* topts = new ToolOptions;
+  opts::RequiredArguments* ropts = new opts::RequiredArguments;
+  ropts->addArgument("matrix", "distance-matrix");
+  ropts->addArgument("clusters", "number-of-clusters");
+
+  opts::AggregateOptions options;
+  options.add(bopts).add(topts).add(ropts);
+  if (!options.parse(argc, argv))
+    exit(-1);
+
+  cout << "# " << hdr << endl;
+
+  uint k = parseStringAs<uint>(ropts->value("clusters"));
+  if (k == 0) {
+    cerr << "Error- must ask for at least one cluster\n";
+    exit(-1);
+  }
+
+  DoubleMatrix D;
+  readAsciiMatrix(ropts->value("matrix"), D);
+
+  vecMerge merges = averageLinkage(D);
+
+  if (topts->link) {
+    ofstream ofs((topts->prefix + ".link").c_str());
+    ofs << "# " << hdr << endl;
+    for (vecMerge::const_iterator i = merges.begin(); i != merges.end(); ++i)
+      ofs << boost::format("%.18e %.18e %.18e %.18e")
+        % static_cast<double>(i->first)
+        % static_cast<double>(i->second)
+        % i->distance
+        % static_cast<double>(i->size)
+          << endl;
+  }
+
+  vecUint assignments = flatClusters(merges, k);
+
+  vector<TrajectoryRange> ranges;
+  if (!topts->index_file.empty())
+    ranges = readIndexFile(topts->index_file);
+  ranges.push_back(TrajectoryRange(topts->prefix, 0, assignments.size() - 1));
+
+  for (vector<TrajectoryRange>::const_iterator i = ranges.begin(); i != ranges.end(); ++i)
+    writeCluster(i->name, hdr, assignments, *i, k);
+}
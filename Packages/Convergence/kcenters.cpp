@@ -0,0 +1,156 @@
+/*
+  Cluster the frames of a trajectory by k-centers
+*/
+
+
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2013, Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <loos.hpp>
+
+#include "cluster-lib.hpp"
+
+using namespace std;
+using namespace loos;
+
+namespace opts = loos::OptionsFramework;
+namespace po = loos::OptionsFramework::po;
+
+
+
+string fullHelpMessage(void) {
+  string msg =
+    "\n"
+    "SYNOPSIS\n"
+    "\tCluster the frames of a trajectory by k-centers\n"
+    "\n"
+    "DESCRIPTION\n"
+    "\n"
+    "\tThis tool partitions a trajectory into k clusters by RMSD (after\n"
+    "optimal superposition) using the farthest-first heuristic.  The first\n"
+    "frame is the first cluster center.  Each new center is the frame that is\n"
+    "farthest from all of the centers picked so far.  Every frame belongs to\n"
+    "its closest center.  The largest distance from a frame to its center is\n"
+    "guaranteed to be within a factor of two of the best possible.\n"
+    "\n"
+    "\tUnlike clustering a matrix of RMSDs, no distance matrix is built.  Each\n"
+    "center takes one pass through the trajectory, so the time grows with\n"
+    "k times the number of frames.  Frames are compared with the\n"
+    "center in parallel.\n"
+    "\n"
+    "\tThe output is a table giving, for each frame, the cluster it belongs to\n"
+    "(numbered from 0) and the distance to the cluster center.  The center of\n"
+    "each cluster is written to PREFIX-N.pdb.\n"
+    "\n"
+    "EXAMPLES\n"
+    "\n"
+    "\tkcenters -s 'name == \"CA\"' --threads 0 model.pdb sim.dcd 10 sim >sim_kc.asc\n"
+    "This partitions sim.dcd into 10 clusters using the alpha-carbons, with\n"
+    "all available processors.  The centers are written to sim-0.pdb through\n"
+    "sim-9.pdb.\n"
+    "\n"
+    "SEE ALSO\n"
+    "\thcluster, ufidpick, assign_frames\n";
+
+  return(msg);
+}
+
+
+
+class ToolOptions : public opts::OptionsPackage {
+public:
+  ToolOptions() : nthreads(1) { }
+
+  void addGeneric(po::options_description& o) {
+    o.add_options()
+      ("threads", po::value<uint>(&nthreads)->default_value(nthreads), "# of threads to use (0 = all available)");
+  }
+
+  string print() const {
+    ostringstream oss;
+    oss << boost::format("threads=%d") % nthreads;
+    return(oss.str());
+  }
+
+  uint nthreads;
+};
+
+
+
+int main(int argc, char *argv[]) {
+  string hdr = invocationHeader(argc, argv);
+
+  opts::BasicOptions* bopts = new opts::BasicOptions(fullHelpMessage());
+  opts::BasicSelection* sopts = new opts::BasicSelection("name == 'CA'");
+  opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices;
+  ToolOptions* topts = new ToolOptions;
+  opts::RequiredArguments* ropts = new opts::RequiredArguments;
+  ropts->addArgument("k", "clusters");
+  ropts->addArgument("prefix", "output-prefix");
+
+  opts::AggregateOptions options;
+  options.add(bopts).add(sopts).add(tropts).add(topts).add(ropts);
+  if (!options.parse(argc, argv))
+    exit(-1);
+
+  uint k = parseStringAs<uint>(ropts->value("k"));
+  if (k == 0) {
+    cerr << "Error- must ask for at least one cluster\n";
+    exit(-1);
+  }
+  string prefix = ropts->value("prefix");
+
+  AtomicGroup model = tropts->model;
+  pTraj traj = tropts->trajectory;
+  AtomicGroup subset = selectAtoms(model, sopts->selection);
+  vecUint frames = tropts->frameList();
+
+  boost::tuple<vecUint, vecUint, vecDouble> result = pickCenters(subset, traj, frames, k, topts->nthreads);
+  vecUint centers = boost::get<0>(result);
+  vecUint assignments = boost::get<1>(result);
+  vecDouble distances = boost::get<2>(result);
+
+  if (centers.size() < k)
+    cerr << "Warning- only " << centers.size() << " distinct centers were found\n";
+
+  cout << "# " << hdr << endl;
+  for (uint j=0; j<centers.size(); ++j)
+    cout << "# Center " << j << " = frame " << frames[centers[j]] << endl;
+  cout << "# Frame\tCluster\tDistance\n";
+  for (uint i=0; i<frames.size(); ++i)
+    cout << frames[i] << "\t" << assignments[i] << "\t" << distances[i] << endl;
+
+  for (uint j=0; j<centers.size(); ++j) {
+    traj->readFrame(frames[centers[j]]);
+    traj->updateGroupCoords(model);
+
+    PDB pdb = PDB::fromAtomicGroup(subset.copy());
+    pdb.remarks().add(hdr);
+    ostringstream oss;
+    oss << prefix << "-" << j << ".pdb";
+    ofstream ofs(oss.str().c_str());
+    ofs << pdb;
+  }
+}
@@ -0,0 +1,350 @@
+/*
+  neff-lib
+
+  Effective sample size library
+
+  Based on Zhang, Bhatt, and Zuckerman; JCTC, DOI: 10.1021/ct1002384
+  and code provided by the Zuckerman Lab
+  (http://www.ccbb.pitt.edu/Faculty/zuckerman/software.html)
+*/
+
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2010, Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "neff-lib.hpp"
+
+using namespace std;
+using namespace loos;
+
+
+
+namespace {
+
+  // Simple class to sort pairs of numbers based on a third (the rate)
+  struct RatePair {
+    RatePair(const double d, const uint a, const uint b) :
+      rate(d), pair(a,b) { }
+
+    bool operator<(const RatePair& x) const {
+      return(rate > x.rate);
+    }
+
+    double rate;
+    uPair pair;
+  };
+
+
+  // Rate of first passage from state x to state y.  A passage starts at
+  // the first visit to x after the previous passage ended (or the start
+  // of the trajectory) and ends at the next visit to y.  The visits to
+  // each state are in order, so each step is a binary search rather than
+  // a scan of the whole trajectory.
+  double mfpt(const vvUint& visits, const uint x, const uint y) {
+    double fpt = 0.0;
+    uint n = 0;
+
+    const vecUint& xs = visits[x];
+    const vecUint& ys = visits[y];
+    vecUint::const_iterator xi = xs.begin();
+    vecUint::const_iterator yi = ys.begin();
+    uint from = 0;
+
+    while (true) {
+      xi = lower_bound(xi, xs.end(), from);
+      if (xi == xs.end())
+        break;
+      uint start = *xi;
+
+      yi = upper_bound(yi, ys.end(), start);
+      if (yi == ys.end())
+        break;
+
+      fpt += (*yi - start);
+      ++n;
+      from = *yi + 1;
+    }
+
+    return(n != 0 ? static_cast<double>(n)/fpt : 0.0);
+  }
+
+
+  // Tracks which pairs of bins have been seen so far, so that checking
+  // whether two bins are connected doesn't mean searching the list of
+  // pairs
+  class PairTable {
+  public:
+    PairTable(const uint n) : n_(n), seen_(n*n, false) { }
+
+    void add(const uPair& p) {
+      seen_[p.first * n_ + p.second] = true;
+      seen_[p.second * n_ + p.first] = true;
+    }
+
+    bool operator()(const uint a, const uint b) const { return(seen_[a * n_ + b]); }
+
+  private:
+    uint n_;
+    vector<bool> seen_;
+  };
+
+}
+
+
+
+DoubleMatrix transitionRates(const vecUint& assignments) {
+  uint nbins = 0;
+  for (vecUint::const_iterator i = assignments.begin(); i != assignments.end(); ++i)
+    if (*i > nbins)
+      nbins = *i;
+
+  ++nbins;   // Bins are 0-based
+
+  vvUint visits(nbins);
+  for (uint j=0; j<assignments.size(); ++j)
+    visits[assignments[j]].push_back(j);
+
+  DoubleMatrix M(nbins, nbins);
+  for (uint j=0; j<nbins; ++j)
+    for (uint i=0; i<nbins; ++i) {
+      if (i == j)
+        continue;
+      M(j, i) = mfpt(visits, j, i);
+    }
+
+  for (uint j=0; j<nbins-1; ++j)
+    for (uint i=j+1; i<nbins; ++i)
+      if (M(j, i) > 0.0 && M(i, j) > 0.0) {
+        double d = (M(j, i) + M(i, j)) / 2.0;
+        M(j, i) = d;
+      } else
+        M(j, i) = 0.0;
+
+  return(M);
+}
+
+
+
+vector<uPair> sortRates(const DoubleMatrix& M) {
+  vector<RatePair> rates;
+  for (uint j=0; j<M.cols()-1; ++j)
+    for (uint i=j+1; i<M.cols(); ++i)
+      if (M(j, i) != 0.0)
+        rates.push_back(RatePair(M(j, i), j, i));
+
+  sort(rates.begin(), rates.end());
+
+  vector<uPair> pairs;
+  for (vector<RatePair>::iterator i = rates.begin(); i != rates.end(); ++i)
+    pairs.push_back(i->pair);
+
+  return(pairs);
+}
+
+
+
+// Bins are added to states (clusters) in order of decreasing rate.  A
+// bin only joins a state if it has been paired with every bin already
+// in that state, and two states only merge if every bin in one has
+// been paired with every bin in the other.  The last pair is skipped
+// so there are always at least 2 states.
+vvUint clusterStates(const vector<uPair>& pairs) {
+  vvUint states;
+  vecUint list;
+
+  uint nbins = 0;
+  for (vector<uPair>::const_iterator i = pairs.begin(); i != pairs.end(); ++i)
+    nbins = max(nbins, max(i->first, i->second) + 1);
+
+  // Which state each bin is in (or -1 if unassigned)
+  vector<int> state_of(nbins, -1);
+  PairTable seen(nbins);
+
+  list.push_back(pairs[0].first);
+  list.push_back(pairs[0].second);
+  states.push_back(list);
+  state_of[pairs[0].first] = state_of[pairs[0].second] = 0;
+  seen.add(pairs[0]);
+
+  // Skip the last pair so we have 2 states...
+
+  for (uint i=1; i<pairs.size()-1; ++i) {
+    seen.add(pairs[i]);
+
+    bool flag1 = state_of[pairs[i].first] >= 0;
+    bool flag2 = state_of[pairs[i].second] >= 0;
+    uint bin1_state = flag1 ? state_of[pairs[i].first] : 0;
+    uint bin2_state = flag2 ? state_of[pairs[i].second] : 0;
+
+    if (flag1 && flag2) {
+      uint big = bin1_state;
+      uint small = bin2_state;
+      if (bin1_state < bin2_state) {
+        big = bin2_state;
+        small = bin1_state;
+      }
+
+      bool flag3 = false;
+      for (uint w = 0; w<states[big].size() && !flag3; ++w)
+        for (uint z=0; z<states[small].size() && !flag3; ++z)
+          if (!seen(states[small][z], states[big][w]))
+            flag3 = true;
+
+      if (!flag3) {
+        copy(states[big].begin(), states[big].end(), back_inserter(states[small]));
+        states.erase(states.begin() + big);
+
+        for (uint j=small; j<states.size(); ++j)
+          for (vecUint::const_iterator k = states[j].begin(); k != states[j].end(); ++k)
+            state_of[*k] = j;
+      }
+
+    } else if (flag1 || flag2) {
+
+      uint bin_state = flag1 ? bin1_state : bin2_state;
+      uint member = flag1 ? pairs[i].first : pairs[i].second;
+      uint other = flag1 ? pairs[i].second : pairs[i].first;
+
+      bool failed = false;
+      for (vecUint::const_iterator p = states[bin_state].begin(); p != states[bin_state].end() && !failed; ++p)
+        if (*p != member && !seen(*p, other))
+          failed = true;
+
+      if (!failed) {
+        states[bin_state].push_back(other);
+        state_of[other] = bin_state;
+      }
+
+    } else {
+      vecUint newlist;
+      newlist.push_back(pairs[i].first);
+      newlist.push_back(pairs[i].second);
+      states.push_back(newlist);
+      state_of[pairs[i].first] = state_of[pairs[i].second] = states.size() - 1;
+    }
+  }
+
+  return(states);
+}
+
+
+
+void findOrphans(vvUint& states, const uint nbins) {
+  vector<bool> seen(nbins, false);
+  for (vvUint::const_iterator v = states.begin(); v != states.end(); ++v)
+    for (vecUint::const_iterator i = v->begin(); i != v->end(); ++i)
+      if (*i < nbins)
+        seen[*i] = true;
+
+  vecUint unseen;
+  for (uint i = 0; i<nbins; ++i)
+    if (!seen[i])
+      unseen.push_back(i);
+
+  if (! unseen.empty())
+    states.push_back(unseen);
+}
+
+
+
+vvUint hierarchicalStates(const vecUint& assignments) {
+  DoubleMatrix M = transitionRates(assignments);
+  vector<uPair> pairs = sortRates(M);
+  if (pairs.empty())
+    throw(LOOSError("No transitions between fiducial bins, so no rates to cluster by"));
+
+  vvUint states = clusterStates(pairs);
+
+  // Not all states will get clustered, so manually search for
+  // "orphaned" ones and add them in...
+  findOrphans(states, M.rows());
+
+  return(states);
+}
+
+
+
+void writeStates(ostream& os, const vvUint& M) {
+  os << M.size() << endl;
+  for (uint j=0; j<M.size(); ++j) {
+    os << M[j].size() << "\t";
+    copy(M[j].begin(), M[j].end(), ostream_iterator<uint>(os, "\t"));
+    os << endl;
+  }
+}
+
+
+
+// The population of each state is found for consecutive segments of
+// the trajectory.  For a segment of N independent samples, the
+// variance in a state's population p would be p(1-p)/N, so N is
+// estimated from the observed variance.
+vecDouble stateSampleSizes(const vecUint& assignments, const vvUint& states, const uint partition_size) {
+  uint nstates = states.size();
+  uint nparts = assignments.size() / partition_size;
+  if (nparts < 2)
+    throw(LOOSError("Need at least two segments to estimate the effective sample size"));
+
+  uint maxbin = 0;
+  for (vvUint::const_iterator j = states.begin(); j != states.end(); ++j)
+    for (vecUint::const_iterator i = j->begin(); i != j->end(); ++i)
+      if (*i > maxbin)
+        maxbin = *i;
+
+  vecUint binmap(maxbin + 1, 0);
+  for (uint j=0; j<nstates; ++j)
+    for (vecUint::const_iterator i = states[j].begin(); i != states[j].end(); ++i)
+      binmap[*i] = j;
+
+  DoubleMatrix M(nstates, nparts);
+  for (uint i=0; i<nparts; ++i) {
+    for (uint k=0; k<partition_size; ++k) {
+      uint bin = assignments[i*partition_size + k];
+      if (bin > maxbin)
+        throw(LOOSError("Frame is assigned to a bin that is not in any state"));
+      M(binmap[bin], i) += 1;
+    }
+    for (uint j=0; j<nstates; ++j)
+      M(j, i) /= partition_size;
+  }
+
+  vecDouble neffs(nstates);
+  for (uint j=0; j<nstates; ++j) {
+    double mean = 0.0;
+    for (uint i=0; i<nparts; ++i)
+      mean += M(j, i);
+    mean /= nparts;
+
+    double var = 0.0;
+    for (uint i=0; i<nparts; ++i) {
+      double d = M(j, i) - mean;
+      var += d*d;
+    }
+    var /= (nparts - 1);
+
+    neffs[j] = (1.0 - mean) * mean / var;
+  }
+
+  return(neffs);
+}
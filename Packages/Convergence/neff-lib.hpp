@@ -0,0 +1,78 @@
+/*
+  Effective sample size library
+*/
+
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2010, Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// @cond PACKAGES_INTERNAL
+
+#if !defined(LOOS_NEFFLIB_HPP)
+#define LOOS_NEFFLIB_HPP
+
+
+#include <loos.hpp>
+#include "fid-lib.hpp"
+
+
+// The effective sample size of Zhang, Batt & Zuckerman, JCTC (2010) 6:3048-57.
+// Frames are assigned to fiducial bins, the bins are clustered into states
+// by how quickly the trajectory moves between them, and the variance of the
+// state populations over segments of the trajectory gives the number of
+// independent samples in each segment.
+
+
+typedef std::pair<uint, uint>     uPair;
+typedef std::vector<vecUint>      vvUint;
+
+
+// Mean first passage rates between each pair of bins.  Only the upper
+// triangle is used, holding the average of the rates in each direction
+// (or 0 if either is undefined).
+loos::DoubleMatrix transitionRates(const vecUint& assignments);
+
+// Pairs of bins with a non-zero rate, fastest first
+std::vector<uPair> sortRates(const loos::DoubleMatrix& M);
+
+// Clusters bins into states, taking pairs in order of decreasing rate
+vvUint clusterStates(const std::vector<uPair>& pairs);
+
+// Adds any of the first nbins bins not in a state as one more state
+void findOrphans(vvUint& states, const uint nbins);
+
+// The full clustering done by hierarchy (rates, clustering, and orphans)
+vvUint hierarchicalStates(const vecUint& assignments);
+
+// Writes states in the format hierarchy uses (and neff reads)
+void writeStates(std::ostream& os, const vvUint& states);
+
+
+// Effective sample size of a segment of partition_size frames, estimated
+// from each state's population
+vecDouble stateSampleSizes(const vecUint& assignments, const vvUint& states, const uint partition_size);
+
+
+#endif
+
+
+// @endcond PACKAGES_INTERNAL
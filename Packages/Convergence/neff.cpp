@@ -40,17 +40,12 @@
 #include <boost/format.hpp>
 #include <limits>
 
+#include "neff-lib.hpp"
+
 using namespace loos;
 using namespace std;
 
 
-typedef vector<uint>             vUint;
-typedef vector<vUint>           vvUint;
-
-
-const double stddev_tol = 1e-6;
-
-
 vvUint readStates(const string& fname) {
   
   ifstream ifs(fname.c_str());
@@ -77,7 +72,7 @@ vvUint readStates(const string& fname) {
       cerr << boost::format("Error- bad number of bins (%d).\n") % m;
       exit(-10);
     }
-    vUint list;
+    vecUint list;
     while (m-- > 0) {
       uint s;
       ifs >> s;
@@ -102,50 +97,6 @@ vector<uint> readAssignments(const string& fname) {
 
 
 
-vUint mapStates(const vvUint& states) {
-  uint maxbin = 0;
-  for (vvUint::const_iterator j = states.begin(); j != states.end(); ++j)
-    for (vUint::const_iterator i = j->begin(); i != j->end(); ++i)
-      if (*i > maxbin)
-        maxbin = *i;
-
-  vUint binmap(maxbin, 0);
-  for (uint j=0; j<states.size(); ++j)
-    for (vUint::const_iterator i = states[j].begin(); i != states[j].end(); ++i)
-      binmap[*i] = j;
-
-  return(binmap);
-}
-
-
-vector<double> rowAvg(const DoubleMatrix& M) {
-  vector<double> avg(M.rows(), 0.0);
-
-  for (uint j=0; j<M.rows(); ++j) {
-    for (uint i=0; i<M.cols(); ++i)
-      avg[j] += M(j, i);
-    avg[j] /= M.cols();
-  }
-
-  return(avg);
-}
-
-
-vector<double> rowStd(const DoubleMatrix& M, const vector<double>& means) {
-  vector<double> dev(M.rows(), 0.0);
-
-  for (uint j=0; j<M.rows(); ++j) {
-    for (uint i=0; i<M.cols(); ++i) {
-      double d = M(j, i) - means[j];
-      dev[j] += d*d;
-    }
-    dev[j] = sqrt(dev[j] / (M.cols() - 1));
-  }
-
-  return(dev);
-}
-
-
 string fullHelpMessage(void) {
   string msg =
     "\n"
@@ -194,30 +145,12 @@ int main(int argc, char *argv[]) {
 
   uint partition_size = atoi(argv[k++]);
 
-  uint nparts = floor(assignments.size() / partition_size);
-  DoubleMatrix M(N, nparts);
-  vUint binmap = mapStates(states);
-
-  for (uint i=0; i<nparts; ++i) {
-    for (uint k=0; k<partition_size; ++k) {
-      uint col = i*partition_size + k;
-      uint bin = binmap[assignments[col]];
-      if (bin > N) {
-        cerr << "Error- internal error, bin=" << bin << ", N=" << N << endl;
-        exit(-20);
-      }
-      M(bin, i) += 1;
-    }
-    for (uint j=0; j<N; ++j)
-      M(j, i) /= partition_size;
-  }
-
-  vector<double> means = rowAvg(M);
-  vector<double> devs = rowStd(M, means);
+  uint nparts = assignments.size() / partition_size;
+  vecDouble neffs = stateSampleSizes(assignments, states, partition_size);
 
   double min_neff = numeric_limits<double>::max();
   for (uint j=0; j<N; ++j) {
-    double neff = (1.0 - means[j]) * means[j] / (devs[j] * devs[j]);
+    double neff = neffs[j];
     cout << boost::format("Estimated effective sample size from state %d = %f\n") % j % neff;
     if (neff < min_neff)
       min_neff = neff;
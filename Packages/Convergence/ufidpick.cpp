@@ -63,6 +63,10 @@ string fullHelpMessage(void) {
     "picked, stored in ufidpick.log, as well as a trajectory containing just the\n"
     "fiducial structures in zuckerman.dcd and the corresponding model file in zuckerman.pdb\n"
     "\n"
+    "NOTES\n"
+    "\tThe optional threads argument (which requires a seed) sets how many threads are\n"
+    "used to compare frames with each fiducial (0 means use all available processors).\n"
+    "\n"
     "SEE ALSO\n"
     "\tassign_frames, hierarchy, effsize.pl, neff\n";
 
@@ -73,8 +77,8 @@ string fullHelpMessage(void) {
 int main(int argc, char *argv[]) {
   string hdr = invocationHeader(argc, argv);
 
-  if (argc < 7 || argc > 8) {
-    cerr << "Usage - " << argv[0] << " model trajectory range|all selection output-name cutoff [seed]\n";
+  if (argc < 7 || argc > 9) {
+    cerr << "Usage - " << argv[0] << " model trajectory range|all selection output-name cutoff [seed [threads]]\n";
     cerr << fullHelpMessage();
     exit(-1);
   }
@@ -97,6 +101,10 @@ int main(int argc, char *argv[]) {
   } else
     seed = randomSeedRNG();
 
+  uint nthreads = 1;
+  if (opti < argc)
+    nthreads = strtoul(argv[opti++], 0, 10);
+
 
   cout << "# " << hdr << endl;
   cout << "# seed = " << seed << endl;
@@ -113,7 +121,7 @@ int main(int argc, char *argv[]) {
   if (frames.size() != source_frames.size())
     cout << "# WARNING- truncated last " << source_frames.size() - frames.size() << " frames\n";
 
-  boost::tuple<vecGroup, vecUint> result = pickFiducials(subset, traj, frames, cutoff);
+  boost::tuple<vecGroup, vecUint> result = pickFiducials(subset, traj, frames, cutoff, nthreads);
   cout << "# n\tref\n";
   vecGroup fiducials = boost::get<0>(result);
   vecUint id = boost::get<1>(result);
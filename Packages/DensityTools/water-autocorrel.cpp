@@ -31,7 +31,7 @@ int main(int argc, char *argv[]) {
   string hdr = invocationHeader(argc, argv);
 
   if (argc == 1) {
-    cerr << "Usage- " << argv[0] << " water_matrix [max-t] >output.asc\n";
+    cerr << "Usage- " << argv[0] << " water_matrix|water_bits [max-t] >output.asc\n";
     exit(-1);
   }
 
@@ -41,43 +41,34 @@ int main(int argc, char *argv[]) {
   if (k != argc)
     max_t = strtoul(argv[k++], 0, 10);
   
-  Math::Matrix<int> M;
+  // Each row of the ASCII matrix is a water, so read as series...
   cerr << "Reading matrix...\n";
-  readAsciiMatrix(matname, M);
-  uint m = M.rows();
-  uint n = M.cols();
+  BitMatrix M = readBitMatrix(matname, true);
+  uint m = M.series();
+  uint n = M.frames();
 
   if (max_t == 0)
     max_t = n/10;
 
   cerr << boost::format("Water matrix is %d x %d\n") % m % n;
   cerr << "Processing- ";
-  vector< TimeSeries<double> > waters;
+  // Each water's autocorrelation is one row, so the statistics for
+  // every lag time accumulate as the waters are processed
+  dMultiTimeSeries waters(max_t);
   for (uint j=0; j<m; ++j) {
     if (j % 250 == 0)
       cerr << '.';
 
-    vector<double> tmp(n, 0);
-    bool flag = false;
-    for (uint i=0; i<n; ++i) {
-      tmp[i] = M(j, i);
-      if (tmp[i])
-	flag = true;
-    }
-    if (flag) {
-      TimeSeries<double> wtmp(tmp);
-      waters.push_back(wtmp.correl(max_t));
-    }
+    if (M.any(j))
+      waters.push_back(M.autocorrelation(j, max_t));
   }
 
   uint nwaters = waters.size();
   cerr << boost::format(" done\nFound %d unique waters inside\n") % nwaters;
   cout << "# " << hdr << endl;
-  for (uint j=0; j<max_t; ++j) {
-    vector<double> tmp(nwaters, 0);
-    for (uint i=0; i<nwaters; ++i)
-      tmp[i] = waters[i][j];
-    dTimeSeries dtmp(tmp);
-    cout << j << '\t' << dtmp.average() << '\t' << dtmp.stdev() << '\t' << dtmp.sterr() << endl;
-  }
+  vector<double> avg = waters.average();
+  vector<double> dev = waters.stdev();
+  vector<double> err = waters.sterr();
+  for (uint j=0; j<max_t; ++j)
+    cout << j << '\t' << avg[j] << '\t' << dev[j] << '\t' << err[j] << endl;
 }
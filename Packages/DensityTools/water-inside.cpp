@@ -35,10 +35,10 @@ using namespace std;
 using namespace loos;
 using namespace loos::DensityTools;
 
+namespace opts = loos::OptionsFramework;
+namespace po = loos::OptionsFramework::po;
 
 
-typedef Math::Matrix<int, Math::ColMajor>    Matrix;
-
 
 string fullHelpMessage(void) {
   string msg =
@@ -65,6 +65,10 @@ string fullHelpMessage(void) {
     "(name == 'CA') are used.  The output prefix is set to 'water', so 'water.asc',\n"
     "'water.vol', and 'water.atoms' will be created containing the time-series matrix,\n"
     "the internal water region volume, and the atom mapping respectively.\n\n"
+    "\twater-inside --binary 1 --prefix water foo.pdb foo.dcd\n"
+    "As above, but the matrix is written in a compact binary form to 'water.bits'.\n"
+    "This is 1/32 the size of a matrix of ints and can be read by water-survival\n"
+    "and water-autocorrel in place of the ASCII matrix.\n\n"
     "\twater-inside --mode radius --radius 5 --prot 'resid == 65'\\\n"
     "\t  --prefix pocket foo.pdb foo.dcd\n"
     "This example will find water atoms (using the default selection) that are within\n"
@@ -82,7 +86,26 @@ string fullHelpMessage(void) {
 }
 
 
-    
+
+class ToolOptions : public opts::OptionsPackage {
+public:
+  ToolOptions() : binary(false) { }
+
+  void addGeneric(po::options_description& o) {
+    o.add_options()
+      ("binary", po::value<bool>(&binary)->default_value(binary), "Write the water matrix in binary (prefix.bits)");
+  }
+
+  string print() const {
+    ostringstream oss;
+    oss << boost::format("binary=%d") % binary;
+    return(oss.str());
+  }
+
+  bool binary;
+};
+
+
 
 void writeAtomIds(const string& fname, const AtomicGroup& grp, const string& hdr) {
   ofstream ofs(fname.c_str());
@@ -104,9 +127,10 @@ int main(int argc, char *argv[]) {
   opts::OutputPrefix* prefopts = new opts::OutputPrefix;
   opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices;
   opts::BasicWater* watopts = new opts::BasicWater;
+  ToolOptions* topts = new ToolOptions;
 
   opts::AggregateOptions options;
-  options.add(basopts).add(prefopts).add(tropts).add(watopts);
+  options.add(basopts).add(prefopts).add(tropts).add(watopts).add(topts);
   if (!options.parse(argc, argv))
     exit(-1);
 
@@ -121,7 +145,7 @@ int main(int argc, char *argv[]) {
 
   uint m = waters.size();
   uint n = traj->nframes();
-  Matrix M(m,n);
+  BitMatrix M(n, m);
   Math::Matrix<double> V(n, 1);
   cerr << boost::format("Water matrix is %d x %d.\n") % m % n;
 
@@ -142,14 +166,33 @@ int main(int argc, char *argv[]) {
     }
 
     for (uint j=0; j<m; ++j)
-      M(j,i) = mask[j];
+      if (mask[j])
+        M.set(i, j);
 
     V(i,0) = watopts->filter_func->volume();
     ++i;
   }
 
   cerr << " done\n";
-  writeAsciiMatrix(prefopts->prefix + ".asc", M, hdr);
+
+  // Each water's time-series is written as a row of the matrix
+  if (topts->binary) {
+    string fname = prefopts->prefix + ".bits";
+    ofstream ofs(fname.c_str(), ios::out | ios::binary);
+    if (!ofs) {
+      cerr << "Error- cannot open " << fname << " for writing\n";
+      exit(-1);
+    }
+    M.write(ofs, hdr);
+  } else {
+    string fname = prefopts->prefix + ".asc";
+    ofstream ofs(fname.c_str());
+    if (!ofs) {
+      cerr << "Error- cannot open " << fname << " for writing\n";
+      exit(-1);
+    }
+    M.writeAscii(ofs, hdr, true);
+  }
   writeAsciiMatrix(prefopts->prefix + ".vol", V, hdr);
   writeAtomIds(prefopts->prefix + ".atoms", waters, hdr);
 }
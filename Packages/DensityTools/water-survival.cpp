@@ -5,15 +5,13 @@
 using namespace loos;
 using namespace std;
 
-typedef Math::Matrix<int>   WaterClassMatrix;
-
 
 
 int main(int argc, char *argv[]) {
   string hdr = invocationHeader(argc, argv);
 
   if (argc == 1) {
-    cerr << "Usage- " << argv[0] << " water_matrix [max-t] >output.asc\n";
+    cerr << "Usage- " << argv[0] << " water_matrix|water_bits [max-t] >output.asc\n";
     exit(-1);
   }
 
@@ -23,11 +21,11 @@ int main(int argc, char *argv[]) {
   if (k != argc)
     max_t = strtoul(argv[k++], 0, 10);
   
-  Math::Matrix<int> M;
+  // Each row of the ASCII matrix is a water, so read as series...
   cerr << "Reading matrix...\n";
-  readAsciiMatrix(matname, M);
-  uint m = M.rows();
-  uint n = M.cols();
+  BitMatrix M = readBitMatrix(matname, true);
+  uint m = M.series();
+  uint n = M.frames();
 
   if (max_t == 0)
     max_t = n/10;
@@ -45,17 +43,11 @@ int main(int argc, char *argv[]) {
     if (tau % 100 == 0)
       cerr << '.';
     
+    // Only consider starting times where t + tau is in the trajectory
+    uint end = (tau + 1 < n) ? n - tau - 1 : 0;
     for (uint j=0; j<m; ++j) {
-      uint inside = 0;
-      uint pairs = 0;
-      
-      for (uint t=0; t<n-tau-1; ++t)
-	if (M(j, t))
-	{
-	  ++pairs;
-	  if (M(j, t+tau))
-	    ++inside;
-	}
+      ulong pairs = M.occupancy(j, 0, end);
+      ulong inside = pairs ? M.coincidence(j, tau, end) : 0;
       if (pairs)
 	survivals.push_back(static_cast<double>(inside) / (pairs));
     }
@@ -38,6 +38,11 @@ namespace ENM {
 
     void solve() {
 
+      if (isSparse()) {
+        solveSparse();
+        return;
+      }
+
       if (verbosity_ > 2)
         std::cerr << "Building hessian...\n";
       buildHessian();
@@ -67,8 +72,27 @@ namespace ENM {
 
 
     //! Return the inverted hessian matrix
+    /**
+     * When using the sparse solver, only the computed modes are
+     * available, so the pseudo-inverse is truncated to those modes.
+     */
     loos::DoubleMatrix inverseHessian() {
 
+      if (isSparse()) {
+        if (eigenvecs_.rows() == 0)
+          throw(std::logic_error("ANM::inverseHessian() called before ANM::solve()"));
+
+        loos::DoubleMatrix V = eigenvecs_.copy();
+        uint n = V.rows();
+        for (uint i=0; i<V.cols(); ++i) {
+          double s = (i < 6) ? 0.0 : 1.0 / eigenvals_[i];
+          for (uint j=0; j<n; ++j)
+            V(j, i) *= s;
+        }
+
+        return(loos::Math::MMMultiply(V, eigenvecs_, false, true));
+      }
+
       if (rsv_.rows() == 0)
         throw(std::logic_error("ANM::inverseHessian() called before ANM::solve()"));
 
@@ -85,6 +109,37 @@ namespace ENM {
 
 
   private:
+
+    // Only computes the lowest nmodes_ eigenpairs of a sparse hessian
+    void solveSparse() {
+      if (verbosity_ > 2)
+        std::cerr << "Building sparse hessian...\n";
+      buildSparseHessian();
+      if (debugging_)
+        loos::writeAsciiMatrix(prefix_ + "_H.asc", sparse_hessian_.dense(), meta_, false);
+
+      loos::Timer<> t;
+      if (verbosity_ > 1)
+        std::cerr << "Computing lowest " << nmodes_ << " modes of sparse hessian...\n";
+      t.start();
+
+      // Reuse the previous eigenvectors as a starting point if possible
+      loos::DoubleMatrix guess;
+      if (warm_start_ && eigenvecs_.rows() == sparse_hessian_.size())
+        guess = eigenvecs_;
+
+      boost::tuple<loos::DoubleMatrix, loos::DoubleMatrix> result = lowestEigenpairs(sparse_hessian_, nmodes_, guess, 1e-8, 2000, verbosity_);
+
+      t.stop();
+      if (verbosity_ > 1)
+        std::cerr << "Eigensolver took " << loos::timeAsString(t.elapsed()) << std::endl;
+
+      eigenvals_ = boost::get<0>(result);
+      eigenvecs_ = boost::get<1>(result);
+      rsv_.reset();
+    }
+
+
     loos::DoubleMatrix rsv_;
 
   };
@@ -83,6 +83,8 @@ bool debug;
 
 string spring_desc;
 string bound_spring_desc;
+uint nmodes;
+double cutoff;
 
 string fullHelpMessage() {
 
@@ -133,6 +135,16 @@ string fullHelpMessage() {
     "chosen with the --spring option.\n"
     "\n"
     "\n\n"
+    "* Large Systems *\n"
+    "The full hessian requires O(N^2) memory and its decomposition\n"
+    "O(N^3) time.  For large systems, the --modes option builds a sparse\n"
+    "hessian using only nodes within a cutoff of each other and computes\n"
+    "only the requested number of lowest modes (including the 6 zero\n"
+    "modes) with an iterative solver.  The cutoff defaults to the range\n"
+    "of the spring function (i.e. for --spring=distance), but must be\n"
+    "given with --cutoff for springs that never reach zero.  In this\n"
+    "case, the pseudo-inverse (foo_Hi.asc) is not written.\n"
+    "\n\n"
     "EXAMPLES\n\n"
     "anm --selection 'resid >= 10 && resid <= 50 && name == \"CA\"' foo.pdb foo\n"
     "\tCompute the ANM for residues #10 through #50 with a 15 Angstrom cutoff\n"
@@ -151,6 +163,10 @@ string fullHelpMessage() {
     "\tsprings with a constant stiffness of \"100\" and all other\n"
     "\tresidues are connected by springs that decay exponentially\n"
     "\twith distance\n"
+    "\n"
+    "anm --modes=26 foo.pdb foo\n"
+    "\tCompute only the 20 lowest non-zero modes using a sparse\n"
+    "\thessian (with the default 15 Angstrom cutoff)\n"
     "\n";
 
   return(s);
@@ -164,12 +180,14 @@ public:
     o.add_options()
       ("debug", po::value<bool>(&debug)->default_value(false), "Turn on debugging (output intermediate matrices)")
       ("spring,S", po::value<string>(&spring_desc)->default_value("distance"),"Spring function to use")
-      ("bound", po::value<string>(&bound_spring_desc), "Bound spring");
+      ("bound", po::value<string>(&bound_spring_desc), "Bound spring")
+      ("modes", po::value<uint>(&nmodes)->default_value(0), "Use sparse solver for this many of the lowest modes (0 = all, dense)")
+      ("cutoff", po::value<double>(&cutoff)->default_value(0.0), "Contact cutoff for sparse hessian (0 = use spring function)");
   }
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("debug=%d, spring='%s', bound='%s'") % debug % spring_desc % bound_spring_desc;
+    oss << boost::format("debug=%d, spring='%s', bound='%s', modes=%d, cutoff=%f") % debug % spring_desc % bound_spring_desc % nmodes % cutoff;
     return(oss.str());
   }
 };
@@ -254,6 +272,7 @@ int main(int argc, char *argv[]) {
   anm.prefix(prefix);
   anm.meta(header);
   anm.verbosity(verbosity);
+  anm.sparse(nmodes, cutoff);
 
   anm.solve();
 
@@ -262,7 +281,8 @@ int main(int argc, char *argv[]) {
   writeAsciiMatrix(prefix + "_U.asc", anm.eigenvectors(), header, false);
   writeAsciiMatrix(prefix + "_s.asc", anm.eigenvalues(), header, false);
 
-  writeAsciiMatrix(prefix + "_Hi.asc", anm.inverseHessian(), header, false);
+  if (!anm.isSparse())
+    writeAsciiMatrix(prefix + "_Hi.asc", anm.inverseHessian(), header, false);
 
   for (vector<SuperBlock*>::iterator i = blocks.begin(); i != blocks.end(); ++i)
     delete *i;
@@ -76,41 +76,90 @@ namespace ENM {
   }
 
 
+  // Build the diagonal of the mass matrix as a 3n x 1 vector
+  DoubleMatrix getMassVector(const AtomicGroup& grp) {
+    uint n = grp.size();
 
+    DoubleMatrix M(3*n, 1);
+    for (uint i=0, k=0; i<n; ++i, k += 3)
+      M[k] = M[k+1] = M[k+2] = grp[i]->mass();
 
+    return(M);
+  }
 
 
 
-  void ElasticNetworkModel::buildHessian() {
+
+
+
+
+  // Builds the hessian using only pairs of nodes from the given
+  // spring class (or all pairs if spring_class is negative)
+  loos::DoubleMatrix ElasticNetworkModel::hessianForClass(const int spring_class) {
     uint n = blocker_->size();
     loos::DoubleMatrix H(3*n,3*n);
+    std::vector<Block3x3> D(n);
 
+    // Blocks are computed a row at a time, with the diagonal
+    // accumulated along the way...
+    std::vector<NodePair> pairs;
+    std::vector<Block3x3> blocks;
     for (uint i=1; i<n; ++i) {
-      for (uint j=0; j<i; ++j) {
-        loos::DoubleMatrix B = blocker_->block(j, i);
+      pairs.clear();
+      for (uint j=0; j<i; ++j)
+        if (spring_class < 0 || blocker_->springClass(j, i) == static_cast<uint>(spring_class))
+          pairs.push_back(NodePair(j, i));
+      blocker_->blocks(pairs, blocks);
+
+      for (uint k=0; k<pairs.size(); ++k) {
+        uint j = pairs[k].first;
+        const Block3x3& B = blocks[k];
         for (uint x = 0; x<3; ++x)
           for (uint y = 0; y<3; ++y) {
             H(i*3 + y, j*3 + x) = -B(y, x);
             H(j*3 + x, i*3 + y) = -B(x ,y);
+            D[i](y, x) += B(y, x);
+            D[j](y, x) += B(y, x);
           }
       }
     }
 
     // Now handle the diagonal...
-    for (uint i=0; i<n; ++i) {
-      loos::DoubleMatrix B(3,3);
-      for (uint j=0; j<n; ++j) {
-        if (j == i)
-          continue;
-      
-        for (uint x=0; x<3; ++x)
-          for (uint y=0; y<3; ++y)
-            B(y,x) += H(j*3 + y, i*3 + x);
-      }
-
+    for (uint i=0; i<n; ++i)
       for (uint x=0; x<3; ++x)
         for (uint y=0; y<3; ++y)
-          H(i*3 + y, i*3 + x) = -B(y,x);
+          H(i*3 + y, i*3 + x) = D[i](y, x);
+
+    return(H);
+  }
+
+
+
+  void ElasticNetworkModel::buildHessian() {
+    if (!caching_) {
+      hessian_ = hessianForClass(-1);
+      return;
+    }
+
+    std::vector<SpringFunction*> springs;
+    blocker_->springFunctions(springs);
+    partial_hessians_.resize(springs.size());
+    dense_params_.resize(springs.size());
+
+    for (uint c=0; c<springs.size(); ++c)
+      if (partial_hessians_[c].rows() == 0 || staleClass(c, dense_params_)) {
+        if (verbosity_ > 2)
+          std::cerr << "Rebuilding hessian for " << springs[c]->name() << std::endl;
+        partial_hessians_[c] = hessianForClass(c);
+        dense_params_[c] = c < class_params_.size() ? class_params_[c] : SpringFunction::Params();
+      }
+
+    loos::DoubleMatrix H = partial_hessians_[0].copy();
+    for (uint c=1; c<partial_hessians_.size(); ++c) {
+      const double* p = partial_hessians_[c].get();
+      double* h = H.get();
+      for (ulong i=0; i<H.size(); ++i)
+        h[i] += p[i];
     }
 
     hessian_ = H;
@@ -118,4 +167,125 @@ namespace ENM {
 
 
 
+  void ElasticNetworkModel::fillSparseHessian(BlockSparseMatrix& H, const std::vector<NodePair>& pairs) {
+    std::vector<Block3x3> blocks;
+    blocker_->blocks(pairs, blocks);
+    for (uint k=0; k<pairs.size(); ++k) {
+      uint j = pairs[k].first;
+      uint i = pairs[k].second;
+      double* Hji = H.block(j, i);
+      double* Hij = H.block(i, j);
+      double* Di = H.block(i, i);
+      double* Dj = H.block(j, j);
+
+      const double* B = blocks[k].get();
+      for (uint l=0; l<9; ++l) {
+        Hji[l] = -B[l];
+        Hij[l] = -B[l];
+        Di[l] += B[l];
+        Dj[l] += B[l];
+      }
+    }
+  }
+
+
+
+  void ElasticNetworkModel::buildSparseHessian() {
+    uint n = blocker_->size();
+
+    double cutoff = cutoff_ > 0.0 ? cutoff_ : blocker_->cutoff();
+    if (cutoff <= 0.0)
+      throw(std::runtime_error("A cutoff must be given for a sparse hessian when the spring function has unlimited range"));
+
+    // The cached contributions can only be reused if the set of
+    // contacts is the same...
+    if (caching_ && (partial_sparse_.empty() || cutoff != cached_cutoff_)) {
+      partial_sparse_.clear();
+      sparse_params_.clear();
+      cached_cutoff_ = cutoff;
+    }
+
+    BlockSparseMatrix H;
+    if (caching_ && !partial_sparse_.empty() && partial_sparse_[0].blockRows() != 0) {
+      H = partial_sparse_[0];
+      H.zero();
+    } else {
+      std::vector<NodePair> pairs = contactPairs(blocker_->nodeList(), cutoff);
+      blocker_->boundPairs(pairs);
+      if (verbosity_ > 1)
+        std::cerr << boost::format("Sparse hessian has %d contacts for %d nodes\n") % pairs.size() % n;
+      H = BlockSparseMatrix(n, 3, pairs);
+    }
+
+    // Only visit each unique pair once...
+    std::vector<NodePair> pairs = H.pairs();
+
+    if (!caching_) {
+      fillSparseHessian(H, pairs);
+      sparse_hessian_ = H;
+      return;
+    }
+
+    std::vector<SpringFunction*> springs;
+    blocker_->springFunctions(springs);
+    partial_sparse_.resize(springs.size());
+    sparse_params_.resize(springs.size());
+
+    std::vector< std::vector<NodePair> > class_pairs(springs.size());
+    for (std::vector<NodePair>::const_iterator p = pairs.begin(); p != pairs.end(); ++p)
+      class_pairs[blocker_->springClass(p->first, p->second)].push_back(*p);
+
+    for (uint c=0; c<springs.size(); ++c)
+      if (partial_sparse_[c].blockRows() == 0 || staleClass(c, sparse_params_)) {
+        if (verbosity_ > 2)
+          std::cerr << "Rebuilding sparse hessian for " << springs[c]->name() << std::endl;
+        BlockSparseMatrix P(H);
+        fillSparseHessian(P, class_pairs[c]);
+        partial_sparse_[c] = P;
+        sparse_params_[c] = c < class_params_.size() ? class_params_[c] : SpringFunction::Params();
+      }
+
+    for (uint c=0; c<partial_sparse_.size(); ++c)
+      H += partial_sparse_[c];
+
+    sparse_hessian_ = H;
+  }
+
+
+
+  // Splits the parameters into those used by each spring function,
+  // following the same LIFO order as SuperBlock::setParams()
+  void ElasticNetworkModel::recordParams(const SpringFunction::Params& v) {
+    std::vector<SpringFunction*> springs;
+    blocker_->springFunctions(springs);
+    class_params_.resize(springs.size());
+
+    SpringFunction::Params q(v);
+    for (uint c=0; c<springs.size(); ++c) {
+      uint np = springs[c]->paramSize();
+      if (q.size() < np)
+        break;
+      class_params_[c].assign(q.end() - np, q.end());
+      q.resize(q.size() - np);
+    }
+  }
+
+
+  bool ElasticNetworkModel::staleClass(const uint c, const std::vector<SpringFunction::Params>& cached) const {
+    SpringFunction::Params current = c < class_params_.size() ? class_params_[c] : SpringFunction::Params();
+    return(cached[c] != current);
+  }
+
+
+  void ElasticNetworkModel::clearHessianCache() {
+    class_params_.clear();
+    dense_params_.clear();
+    sparse_params_.clear();
+    partial_hessians_.clear();
+    partial_sparse_.clear();
+    cached_cutoff_ = 0.0;
+  }
+
+
+
 };
@@ -31,6 +31,7 @@
 
 #include <loos.hpp>
 #include "hessian.hpp"
+#include "sparse-lib.hpp"
 
 //! Namespace to encapsulate Elastic Network Model routines
 namespace ENM {
@@ -54,6 +55,9 @@ namespace ENM {
   //! Build the 3n x 3n diagonal mass matrix for a group
   loos::DoubleMatrix getMasses(const loos::AtomicGroup& grp);
 
+  //! Build the diagonal of the mass matrix as a 3n x 1 vector
+  loos::DoubleMatrix getMassVector(const loos::AtomicGroup& grp);
+
 
   // -------------------------------------
 
@@ -72,11 +76,11 @@ namespace ENM {
      constructed, i.e. what nodes are used and how the spring function
      between them is calculated.
     */
-    ElasticNetworkModel(SuperBlock* blocker) : blocker_(blocker), name_("ENM"), prefix_(""), meta_(""), debugging_(false), verbosity_(0) { }
+    ElasticNetworkModel(SuperBlock* blocker) : blocker_(blocker), name_("ENM"), prefix_(""), meta_(""), debugging_(false), verbosity_(0), nmodes_(0), cutoff_(0.0), caching_(false), warm_start_(false), cached_cutoff_(0.0) { }
     virtual ~ElasticNetworkModel() { }
 
     // Should we allow this?
-    void setSuperBlockFunction(SuperBlock* p) { blocker_ = p; }
+    void setSuperBlockFunction(SuperBlock* p) { blocker_ = p; clearHessianCache(); }
 
     //! Computes the hessian and solves for the eigenpairs
     virtual void solve() =0;
@@ -97,9 +101,61 @@ namespace ENM {
     void verbosity(const int i) { verbosity_ = i; }
     int verbosity() const { return(verbosity_); }
 
+    //! Use a sparse hessian and only compute the lowest \a k modes
+    /**
+     * Only pairs of nodes within \a cutoff are included in the hessian.
+     * If the cutoff is 0, then the range of the SuperBlock's spring
+     * function is used.  Setting \a k to 0 reverts to the dense
+     * hessian and full eigendecomposition.
+     *
+     * Note that the number of modes includes the zero-frequency
+     * (rigid-body) modes.
+     */
+    void sparse(const uint k, const double cutoff = 0.0) {
+      nmodes_ = k;
+      cutoff_ = cutoff;
+    }
+
+    //! Number of modes to compute with the sparse solver (0 = dense)
+    uint sparseModes() const { return(nmodes_); }
+
+    //! True if the sparse hessian and eigensolver will be used
+    bool isSparse() const { return(nmodes_ > 0); }
+
+    //! Keep the hessian contribution from each spring function between solves
+    /**
+     * The hessian is the sum of the contributions from each spring
+     * function in the SuperBlock (see SuperBlock::springClass()).
+     * When caching is on, each contribution is kept and only those
+     * whose parameters have changed (via setParams()) are rebuilt the
+     * next time the model is solved.  This is intended for fitting
+     * spring constants, where many solves are done with the same
+     * nodes but different parameters.
+     *
+     * Note that parameters must be set through the ENM (not the
+     * SuperBlock) for changes to be noticed, and that there is one
+     * full-sized hessian stored per spring function.
+     */
+    void cacheHessian(const bool b) { caching_ = b; clearHessianCache(); }
+    bool cacheHessian() const { return(caching_); }
+
+    //! Discard any cached partial hessians (i.e. if the node coordinates have changed)
+    void clearHessianCache();
+
+    //! Start iterative solvers from the previous solution
+    /**
+     * When the parameters only change slightly between solves, the
+     * previous eigenvectors are a good starting point for the sparse
+     * eigensolver and convergence takes far fewer iterations.
+     */
+    void warmStart(const bool b) { warm_start_ = b; }
+    bool warmStart() const { return(warm_start_); }
+
     // -----------------------------------------------------
     //! Forwards to contained superblock
     SpringFunction::Params setParams(const SpringFunction::Params& v) {
+      if (caching_)
+        recordParams(v);
       return(blocker_->setParams(v));
     }
 
@@ -120,6 +176,9 @@ namespace ENM {
     //! Accessors for eigenpairs and hessian
     const loos::DoubleMatrix& hessian() const { return(hessian_); }
 
+    //! Accessor for the sparse hessian (only valid when isSparse())
+    const BlockSparseMatrix& sparseHessian() const { return(sparse_hessian_); }
+
 
 
   protected:
@@ -131,7 +190,22 @@ namespace ENM {
      * Uses the contained SuperBlock to build a hessian
      */
     void buildHessian();
-  
+
+    //! Construct a sparse hessian using the contained SuperBlock
+    /**
+     * Only pairs of nodes within the cutoff (see sparse()), plus any
+     * pairs the SuperBlock reports as bound, are evaluated.  The
+     * neighbors are found using a loos::CellList, so construction
+     * scales linearly with the number of nodes.
+     */
+    void buildSparseHessian();
+
+  private:
+    loos::DoubleMatrix hessianForClass(const int spring_class);
+    void fillSparseHessian(BlockSparseMatrix& H, const std::vector<NodePair>& pairs);
+    void recordParams(const SpringFunction::Params& v);
+    bool staleClass(const uint c, const std::vector<SpringFunction::Params>& cached) const;
+
 
   protected:
     // Arguably, some of the following should be private rather than
@@ -148,7 +222,17 @@ namespace ENM {
     loos::DoubleMatrix eigenvals_;
 
     loos::DoubleMatrix hessian_;
-  
+
+    uint nmodes_;
+    double cutoff_;
+    BlockSparseMatrix sparse_hessian_;
+
+    bool caching_, warm_start_;
+    std::vector<SpringFunction::Params> class_params_;
+    std::vector<SpringFunction::Params> dense_params_, sparse_params_;
+    std::vector<loos::DoubleMatrix> partial_hessians_;
+    std::vector<BlockSparseMatrix> partial_sparse_;
+    double cached_cutoff_;
   };
 
 
@@ -58,6 +58,8 @@
 #include <boost/format.hpp>
 #include <boost/program_options.hpp>
 
+#include "sparse-lib.hpp"
+
 using namespace std;
 using namespace loos;
 namespace po = boost::program_options;
@@ -71,6 +73,7 @@ string selection;
 string model_name;
 string prefix;
 double cutoff;
+uint nmodes;
 
 void fullHelp() {
   //string msg = 
@@ -94,6 +97,11 @@ void fullHelp() {
     "\tfoo_V.asc  - Right singular vectors\n"
     "\tfoo_Ki.asc - Pseudo-inverse of K\n"
     "\n"
+    "For large systems, the --modes option will build a sparse Kirchoff\n"
+    "matrix and only compute the lowest eigenpairs (including the zero\n"
+    "mode) with an iterative solver.  In this case, only foo_U.asc and\n"
+    "foo_s.asc are written.\n"
+    "\n"
     "Notes:\n"
     "- The default selection (if none is specified) is to pick CA's\n"
     "- The output is ASCII format suitable for use with Matlab/Octave/Gnuplot\n"
@@ -128,7 +136,8 @@ void parseOptions(int argc, char *argv[]) {
       ("help", "Produce this help message")
       ("fullhelp", "Get extended help")
       ("selection,s", po::value<string>(&selection)->default_value("name == 'CA'"), "Which atoms to use for the network")
-      ("cutoff,c", po::value<double>(&cutoff)->default_value(7.0), "Cutoff distance for node contact");
+      ("cutoff,c", po::value<double>(&cutoff)->default_value(7.0), "Cutoff distance for node contact")
+      ("modes", po::value<uint>(&nmodes)->default_value(0), "Use sparse solver for this many of the lowest modes (0 = all, dense)");
 
     po::options_description hidden("Hidden options");
     hidden.add_options()
@@ -192,6 +201,24 @@ Matrix kirchoff(AtomicGroup& group, const double cutoff) {
 
 
 
+// Sparse version of the Kirchoff matrix, only considering nodes
+// within the cutoff of each other
+ENM::BlockSparseMatrix sparseKirchoff(AtomicGroup& group, const double cutoff) {
+  std::vector<ENM::NodePair> pairs = ENM::contactPairs(group, cutoff);
+  ENM::BlockSparseMatrix K(group.size(), 1, pairs);
+
+  for (std::vector<ENM::NodePair>::const_iterator i = pairs.begin(); i != pairs.end(); ++i) {
+    *(K.block(i->first, i->second)) = -normalization;
+    *(K.block(i->second, i->first)) = -normalization;
+    *(K.block(i->first, i->first)) += normalization;
+    *(K.block(i->second, i->second)) += normalization;
+  }
+
+  return(K);
+}
+
+
+
 int main(int argc, char *argv[]) {
 
   string header = invocationHeader(argc, argv);
@@ -201,6 +228,20 @@ int main(int argc, char *argv[]) {
   AtomicGroup subset = selectAtoms(model, selection);
 
   cout << boost::format("Selected %d atoms from %s\n") % subset.size() % model_name;
+
+  if (nmodes > 0) {
+    Timer<WallTimer> timer;
+    cerr << "Computing sparse Kirchoff matrix and lowest modes - ";
+    timer.start();
+    ENM::BlockSparseMatrix K = sparseKirchoff(subset, cutoff);
+    boost::tuple<DoubleMatrix, DoubleMatrix> result = ENM::lowestEigenpairs(K, nmodes);
+    timer.stop();
+    cerr << "done.\n" << timer << endl;
+
+    writeAsciiMatrix(prefix + "_U.asc", boost::get<1>(result), header);
+    writeAsciiMatrix(prefix + "_s.asc", boost::get<0>(result), header);
+    exit(0);
+  }
   Timer<WallTimer> timer;
   cerr << "Computing Kirchoff matrix - ";
   timer.start();
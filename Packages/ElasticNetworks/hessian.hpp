@@ -82,13 +82,52 @@ namespace ENM {
 
     //! Forwards to the contained SpringFunction...
     virtual uint paramSize() const { return(springs->paramSize()); }
+
+    //! Forwards to the contained SpringFunction...
+    virtual double cutoff() const { return(springs->cutoff()); }
     // ------------------------------------------------------
 
+    //! The nodes used to build the hessian
+    const loos::AtomicGroup& nodeList() const { return(nodes); }
+
+    //! Appends pairs of nodes (j < i) that must be included regardless of distance
+    /**
+     * When building a sparse hessian, only pairs of nodes within a
+     * cutoff are considered.  Decorators that connect nodes
+     * independent of distance (i.e. bound springs) report those
+     * connections here.
+     */
+    virtual void boundPairs(std::vector< std::pair<uint, uint> >&) const { }
+
+    //! Appends the spring functions used, in the order setParams() consumes parameters
+    virtual void springFunctions(std::vector<SpringFunction*>& list) const { list.push_back(springs); }
+
+    //! Index (into springFunctions()) of the spring function used for a pair of nodes
+    /**
+     * Every pair of nodes is assigned to exactly one spring function
+     * (or spring "class"), so the hessian is the sum of the
+     * contributions from each class.  This lets an ENM rebuild only
+     * the parts of the hessian whose parameters have changed.
+     */
+    virtual uint springClass(const uint, const uint) const { return(0); }
+
     //! Returns a 3x3 matrix representing a superblock in the Hessian for the two nodes
-    virtual loos::DoubleMatrix block(const uint j, const uint i) {
+    virtual Block3x3 block(const uint j, const uint i) {
       return(blockImpl(j, i, springs));
     }
 
+    //! Computes the superblocks for a list of pairs of nodes
+    /**
+     * This is equivalent to calling block() for each pair, but the
+     * spring constants are evaluated in batches.  \a result is resized
+     * to match \a pairs.
+     */
+    virtual void blocks(const std::vector< std::pair<uint, uint> >& pairs, std::vector<Block3x3>& result) {
+      result.resize(pairs.size());
+      if (!pairs.empty())
+        blocksImpl(&pairs[0], pairs.size(), springs, &result[0]);
+    }
+
 
   protected:
 
@@ -98,7 +137,7 @@ namespace ENM {
      *In most cases, derived clases will probably want to use this but
      * with alternative spring functions...
      */
-    loos::DoubleMatrix blockImpl(const uint j, const uint i, SpringFunction* fptr) {
+    Block3x3 blockImpl(const uint j, const uint i, SpringFunction* fptr) {
       if (i >= size() || j >= size())
         throw(std::runtime_error("Invalid index in Hessian SuperBlock"));
 
@@ -109,16 +148,54 @@ namespace ENM {
       loos::GCoord v = nodes[i]->coords();
       loos::GCoord d = v - u;
     
-      loos::DoubleMatrix K = fptr->constant(u, v, d);
-      loos::DoubleMatrix B(3, 3);
-      for (uint y=0; y<3; ++y)
-        for (uint x=0; x<3; ++x)
-          B(x, y) = d[x]*d[y] * K(x,y);
+      Block3x3 B = fptr->constant(u, v, d);
+      scaleBlock(B, d);
 
       return(B);
     }
 
 
+    //! Batch implementation of the superblock calculation
+    /**
+     * Coordinates are gathered into fixed-size chunks on the stack
+     * and handed to the spring function all at once, so there are no
+     * allocations regardless of the number of pairs.
+     */
+    void blocksImpl(const std::pair<uint, uint>* pairs, const uint n, SpringFunction* fptr, Block3x3* result) {
+      if (fptr == 0)
+        throw(std::runtime_error("No spring function defined for hessian!"));
+
+      const uint chunk = 128;
+      loos::GCoord u[chunk], v[chunk], d[chunk];
+
+      for (uint start = 0; start < n; start += chunk) {
+        uint m = std::min(chunk, n - start);
+        for (uint k=0; k<m; ++k) {
+          uint j = pairs[start + k].first;
+          uint i = pairs[start + k].second;
+          if (i >= size() || j >= size())
+            throw(std::runtime_error("Invalid index in Hessian SuperBlock"));
+          u[k] = nodes[j]->coords();
+          v[k] = nodes[i]->coords();
+          d[k] = v[k] - u[k];
+        }
+
+        Block3x3* B = result + start;
+        fptr->constants(u, v, d, m, B);
+        for (uint k=0; k<m; ++k)
+          scaleBlock(B[k], d[k]);
+      }
+    }
+
+
+    //! Converts a block of spring constants into a superblock
+    static void scaleBlock(Block3x3& B, const loos::GCoord& d) {
+      for (uint y=0; y<3; ++y)
+        for (uint x=0; x<3; ++x)
+          B(x, y) *= d[x]*d[y];
+    }
+
+
     SpringFunction* springs;
     loos::AtomicGroup nodes;
   };
@@ -197,13 +274,45 @@ namespace ENM {
 
     // Block now checks to see if nodes i and j are connected and, if
     // so, uses our alternative spring function.
-    loos::DoubleMatrix block(const uint j, const uint i) {
+    Block3x3 block(const uint j, const uint i) {
       if (connectivity(j, i))
         return(blockImpl(j, i, bound_spring));
       else
         return(decorated->block(j, i));
     }
 
+    // Splits the pairs into connected ones (using our spring
+    // function) and the rest, which are passed to the decorated
+    // superblock as a single batch
+    void blocks(const std::vector< std::pair<uint, uint> >& pairs, std::vector<Block3x3>& result) {
+      std::vector< std::pair<uint, uint> > bound, unbound;
+      std::vector<uint> bound_idx, unbound_idx;
+
+      for (uint k=0; k<pairs.size(); ++k)
+        if (connectivity(pairs[k].first, pairs[k].second)) {
+          bound.push_back(pairs[k]);
+          bound_idx.push_back(k);
+        } else {
+          unbound.push_back(pairs[k]);
+          unbound_idx.push_back(k);
+        }
+
+      result.resize(pairs.size());
+      if (!bound.empty()) {
+        std::vector<Block3x3> B(bound.size());
+        blocksImpl(&bound[0], bound.size(), bound_spring, &B[0]);
+        for (uint k=0; k<B.size(); ++k)
+          result[bound_idx[k]] = B[k];
+      }
+
+      if (!unbound.empty()) {
+        std::vector<Block3x3> B;
+        decorated->blocks(unbound, B);
+        for (uint k=0; k<B.size(); ++k)
+          result[unbound_idx[k]] = B[k];
+      }
+    }
+
     //! Assign parameters and propagate to the decorated superblock
     SpringFunction::Params setParams(const SpringFunction::Params& v) {
       SpringFunction::Params u = bound_spring->setParams(v);
@@ -218,6 +327,30 @@ namespace ENM {
     //! Returns the aggregate parameter size
     uint paramSize() const { return(bound_spring->paramSize() + decorated->paramSize()); }
 
+    //! Bound springs are only used for connected nodes, so the cutoff is the decorated one
+    double cutoff() const { return(decorated->cutoff()); }
+
+    //! Adds all connected nodes, then any from the decorated superblock
+    void boundPairs(std::vector< std::pair<uint, uint> >& pairs) const {
+      for (uint i=1; i<connectivity.cols(); ++i)
+        for (uint j=0; j<i; ++j)
+          if (connectivity(j, i))
+            pairs.push_back(std::pair<uint, uint>(j, i));
+      decorated->boundPairs(pairs);
+    }
+
+    //! Our spring function comes first, followed by the decorated ones
+    void springFunctions(std::vector<SpringFunction*>& list) const {
+      list.push_back(bound_spring);
+      decorated->springFunctions(list);
+    }
+
+    uint springClass(const uint j, const uint i) const {
+      if (connectivity(j, i))
+        return(0);
+      return(1 + decorated->springClass(j, i));
+    }
+
   private:
     SpringFunction* bound_spring;
     loos::Math::Matrix<int> connectivity;
@@ -0,0 +1,560 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "sparse-lib.hpp"
+
+
+using namespace std;
+using namespace loos;
+
+
+namespace ENM {
+
+
+  BlockSparseMatrix::BlockSparseMatrix(const uint n, const uint bs, const vector<NodePair>& pairs) :
+    n_(n), bs_(bs)
+  {
+    vector<NodePair> unique_pairs;
+    unique_pairs.reserve(pairs.size());
+    for (vector<NodePair>::const_iterator i = pairs.begin(); i != pairs.end(); ++i) {
+      if (i->first >= n || i->second >= n)
+        throw(std::out_of_range("Node index out of range in BlockSparseMatrix"));
+      if (i->first == i->second)
+        continue;
+      unique_pairs.push_back(i->first < i->second ? *i : NodePair(i->second, i->first));
+    }
+    sort(unique_pairs.begin(), unique_pairs.end());
+    unique_pairs.erase(unique(unique_pairs.begin(), unique_pairs.end()), unique_pairs.end());
+
+    // Every row has a diagonal block plus one for each partner
+    row_start_.assign(n+1, 0);
+    for (uint i=0; i<n; ++i)
+      row_start_[i+1] = 1;
+    for (vector<NodePair>::const_iterator i = unique_pairs.begin(); i != unique_pairs.end(); ++i) {
+      ++row_start_[i->first + 1];
+      ++row_start_[i->second + 1];
+    }
+    for (uint i=0; i<n; ++i)
+      row_start_[i+1] += row_start_[i];
+
+    cols_.resize(row_start_[n]);
+    vector<ulong> fill(row_start_.begin(), row_start_.end() - 1);
+    for (uint i=0; i<n; ++i)
+      cols_[fill[i]++] = i;
+    for (vector<NodePair>::const_iterator i = unique_pairs.begin(); i != unique_pairs.end(); ++i) {
+      cols_[fill[i->first]++] = i->second;
+      cols_[fill[i->second]++] = i->first;
+    }
+
+    for (uint i=0; i<n; ++i)
+      sort(cols_.begin() + row_start_[i], cols_.begin() + row_start_[i+1]);
+
+    values_.assign(cols_.size() * bs * bs, 0.0);
+  }
+
+
+
+  const double* BlockSparseMatrix::block(const uint j, const uint i) const {
+    if (j >= n_ || i >= n_)
+      throw(std::out_of_range("Invalid block index in BlockSparseMatrix"));
+
+    vector<uint>::const_iterator beg = cols_.begin() + row_start_[j];
+    vector<uint>::const_iterator end = cols_.begin() + row_start_[j+1];
+    vector<uint>::const_iterator k = lower_bound(beg, end, i);
+    if (k == end || *k != i)
+      return(0);
+
+    return(&values_[(k - cols_.begin()) * bs_ * bs_]);
+  }
+
+
+  double* BlockSparseMatrix::block(const uint j, const uint i) {
+    return(const_cast<double*>(static_cast<const BlockSparseMatrix&>(*this).block(j, i)));
+  }
+
+
+  vector<NodePair> BlockSparseMatrix::pairs() const {
+    vector<NodePair> result;
+    result.reserve((cols_.size() - n_) / 2);
+    for (uint j=0; j<n_; ++j)
+      for (ulong k = row_start_[j]; k < row_start_[j+1]; ++k)
+        if (cols_[k] > j)
+          result.push_back(NodePair(j, cols_[k]));
+    return(result);
+  }
+
+
+  void BlockSparseMatrix::zero() {
+    fill(values_.begin(), values_.end(), 0.0);
+  }
+
+
+  BlockSparseMatrix& BlockSparseMatrix::operator+=(const BlockSparseMatrix& B) {
+    if (n_ != B.n_ || bs_ != B.bs_ || row_start_ != B.row_start_ || cols_ != B.cols_)
+      throw(std::logic_error("Cannot add BlockSparseMatrices with different sparsity patterns"));
+
+    for (ulong i=0; i<values_.size(); ++i)
+      values_[i] += B.values_[i];
+
+    return(*this);
+  }
+
+
+  void BlockSparseMatrix::multiply(const double* x, double* y, const uint ncols) const {
+    ulong n = size();
+    uint bs2 = bs_ * bs_;
+
+    if (ncols == 1) {
+      for (uint j=0; j<n_; ++j) {
+        double* v = y + j * bs_;
+        for (uint r=0; r<bs_; ++r)
+          v[r] = 0.0;
+        for (ulong k = row_start_[j]; k < row_start_[j+1]; ++k) {
+          const double* B = &values_[k * bs2];
+          const double* u = x + cols_[k] * bs_;
+          for (uint r=0; r<bs_; ++r)
+            for (uint i=0; i<bs_; ++i)
+              v[r] += B[r * bs_ + i] * u[i];
+        }
+      }
+      return;
+    }
+
+    // Columns are processed in small interleaved batches so each block
+    // is reused for several vectors while the batch still fits in
+    // cache...
+    const uint batch = 8;
+    vector<double> xt(n * batch);
+    vector<double> yt(n * batch);
+
+    for (uint first = 0; first < ncols; first += batch) {
+      uint nb = min(batch, ncols - first);
+      for (uint c=0; c<nb; ++c)
+        for (ulong i=0; i<n; ++i)
+          xt[i * nb + c] = x[(first + c) * n + i];
+      fill(yt.begin(), yt.end(), 0.0);
+
+      for (uint j=0; j<n_; ++j) {
+        double* v = &yt[j * bs_ * nb];
+        for (ulong k = row_start_[j]; k < row_start_[j+1]; ++k) {
+          const double* B = &values_[k * bs2];
+          const double* u = &xt[cols_[k] * bs_ * nb];
+          for (uint r=0; r<bs_; ++r) {
+            double* vr = v + r * nb;
+            for (uint i=0; i<bs_; ++i) {
+              double b = B[r * bs_ + i];
+              const double* ui = u + i * nb;
+              for (uint c=0; c<nb; ++c)
+                vr[c] += b * ui[c];
+            }
+          }
+        }
+      }
+
+      for (uint c=0; c<nb; ++c)
+        for (ulong i=0; i<n; ++i)
+          y[(first + c) * n + i] = yt[i * nb + c];
+    }
+  }
+
+
+  vector<double> BlockSparseMatrix::diagonal() const {
+    vector<double> d(size());
+    for (uint j=0; j<n_; ++j) {
+      const double* B = block(j, j);
+      for (uint r=0; r<bs_; ++r)
+        d[j * bs_ + r] = B[r * bs_ + r];
+    }
+    return(d);
+  }
+
+
+  BlockSparseMatrix BlockSparseMatrix::subMatrix(const uint begin, const uint end) const {
+    if (begin > end || end > n_)
+      throw(std::out_of_range("Invalid range for BlockSparseMatrix::subMatrix()"));
+
+    vector<NodePair> pairs;
+    for (uint j=begin; j<end; ++j)
+      for (ulong k = row_start_[j]; k < row_start_[j+1]; ++k)
+        if (cols_[k] > j && cols_[k] < end)
+          pairs.push_back(NodePair(j - begin, cols_[k] - begin));
+
+    BlockSparseMatrix S(end - begin, bs_, pairs);
+    uint bs2 = bs_ * bs_;
+    for (uint j=begin; j<end; ++j)
+      for (ulong k = row_start_[j]; k < row_start_[j+1]; ++k)
+        if (cols_[k] >= begin && cols_[k] < end) {
+          double* B = S.block(j - begin, cols_[k] - begin);
+          copy(values_.begin() + k * bs2, values_.begin() + (k+1) * bs2, B);
+        }
+
+    return(S);
+  }
+
+
+  DoubleMatrix BlockSparseMatrix::dense() const {
+    DoubleMatrix M(size(), size());
+    for (uint j=0; j<n_; ++j)
+      for (ulong k = row_start_[j]; k < row_start_[j+1]; ++k) {
+        const double* B = &values_[k * bs_ * bs_];
+        for (uint r=0; r<bs_; ++r)
+          for (uint c=0; c<bs_; ++c)
+            M(j * bs_ + r, cols_[k] * bs_ + c) = B[r * bs_ + c];
+      }
+
+    return(M);
+  }
+
+
+
+  vector<NodePair> contactPairs(const AtomicGroup& nodes, const double cutoff) {
+    vector<GCoord> coords(nodes.size());
+    for (uint i=0; i<nodes.size(); ++i)
+      coords[i] = nodes[i]->coords();
+
+    // ENMs ignore periodicity, so always use a non-periodic list
+    CellList cells(cutoff);
+    cells.update(coords);
+
+    return(cells.pairs());
+  }
+
+
+
+  // --------------------------------------------------------------------
+  // Support for the eigensolver...
+
+  namespace {
+
+    double dot(const double* a, const double* b, const uint n) {
+      double s = 0.0;
+      for (uint i=0; i<n; ++i)
+        s += a[i] * b[i];
+      return(s);
+    }
+
+
+    // Computes A*X for the columns [first, X.cols()) of X
+    DoubleMatrix applyMatrix(const BlockSparseMatrix& A, const DoubleMatrix& X, const uint first = 0) {
+      uint n = X.rows();
+      DoubleMatrix Y(n, X.cols() - first);
+      if (Y.cols() > 0)
+        A.multiply(X.get() + first * n, Y.get(), Y.cols());
+      return(Y);
+    }
+
+
+    // Columns [first, last) of A
+    DoubleMatrix columns(const DoubleMatrix& A, const uint first, const uint last) {
+      uint n = A.rows();
+      DoubleMatrix B(n, last - first);
+      copy(A.get() + first * n, A.get() + last * n, B.get());
+      return(B);
+    }
+
+
+    // Horizontally concatenates matrices with the same number of rows
+    DoubleMatrix concatenate(const vector<const DoubleMatrix*>& parts) {
+      uint n = parts[0]->rows();
+      uint m = 0;
+      for (uint i=0; i<parts.size(); ++i)
+        m += parts[i]->cols();
+
+      DoubleMatrix A(n, m);
+      double* p = A.get();
+      for (uint i=0; i<parts.size(); ++i) {
+        uint k = parts[i]->rows() * parts[i]->cols();
+        copy(parts[i]->get(), parts[i]->get() + k, p);
+        p += k;
+      }
+
+      return(A);
+    }
+
+
+    // Orthonormalizes the columns of N, dropping any that are
+    // numerically dependent.  Uses the SVQB method (Stathopoulos & Wu,
+    // SIAM J Sci Comput (2002) 23:2165-2182), so the work is in
+    // matrix-matrix products rather than vector operations.
+    DoubleMatrix svqb(const DoubleMatrix& N) {
+      uint c = N.cols();
+      if (c == 0)
+        return(N);
+
+      DoubleMatrix G = Math::MMMultiply(N, N, true, false);
+      vector<double> d(c);
+      for (uint i=0; i<c; ++i)
+        d[i] = G(i, i) > 0.0 ? 1.0 / sqrt(G(i, i)) : 0.0;
+      for (uint i=0; i<c; ++i)
+        for (uint j=0; j<c; ++j)
+          G(j, i) *= d[j] * d[i];
+
+      // G is overwritten with the eigenvectors...
+      DoubleMatrix lambda = Math::eigenDecomp(G);
+      double lmax = lambda[c-1];
+      uint first = 0;
+      while (first < c && lambda[first] <= 1e-12 * lmax)
+        ++first;
+      if (first == c)
+        return(DoubleMatrix(N.rows(), 0));
+
+      DoubleMatrix T(c, c - first);
+      for (uint k=first; k<c; ++k) {
+        double s = 1.0 / sqrt(lambda[k]);
+        for (uint j=0; j<c; ++j)
+          T(j, k - first) = d[j] * G(j, k) * s;
+      }
+
+      return(Math::MMMultiply(N, T));
+    }
+
+
+    // Orthonormalizes the columns of S, dropping any that are
+    // numerically dependent.  The first keep columns are assumed to
+    // already be orthonormal and are left untouched.
+    DoubleMatrix orthonormalize(const DoubleMatrix& S, const uint keep) {
+      DoubleMatrix Q = columns(S, 0, keep);
+      DoubleMatrix N = columns(S, keep, S.cols());
+
+      // Twice is enough (for stability)...
+      for (uint pass = 0; pass < 2 && N.cols() > 0; ++pass) {
+        if (keep > 0) {
+          DoubleMatrix C = Math::MMMultiply(Q, N, true, false);
+          N -= Math::MMMultiply(Q, C);
+        }
+        N = svqb(N);
+      }
+
+      if (keep == 0)
+        return(N);
+
+      vector<const DoubleMatrix*> parts;
+      parts.push_back(&Q);
+      if (N.cols() > 0)
+        parts.push_back(&N);
+      return(concatenate(parts));
+    }
+
+
+    // Projects A onto the basis S (with AS = A*S), returning the
+    // eigenvalues in ascending order.  C holds the eigenvectors of the
+    // projection on return.
+    DoubleMatrix rayleighRitz(const DoubleMatrix& S, const DoubleMatrix& AS, DoubleMatrix& C) {
+      C = Math::MMMultiply(S, AS, true, false);
+      for (uint i=0; i<C.cols(); ++i)
+        for (uint j=0; j<i; ++j)
+          C(j, i) = C(i, j) = 0.5 * (C(j, i) + C(i, j));
+
+      return(Math::eigenDecomp(C));
+    }
+
+  }
+
+
+
+  boost::tuple<DoubleMatrix, DoubleMatrix> lowestEigenpairs(const BlockSparseMatrix& A,
+                                                            const uint k,
+                                                            const double tol,
+                                                            const uint maxiter,
+                                                            const int verbosity) {
+    return(lowestEigenpairs(A, k, DoubleMatrix(), tol, maxiter, verbosity));
+  }
+
+
+
+  boost::tuple<DoubleMatrix, DoubleMatrix> lowestEigenpairs(const BlockSparseMatrix& A,
+                                                            const uint k,
+                                                            const DoubleMatrix& guess,
+                                                            const double tol,
+                                                            const uint maxiter,
+                                                            const int verbosity) {
+    uint n = A.size();
+    if (k == 0 || k > n)
+      throw(std::logic_error("Invalid number of eigenpairs requested"));
+
+    // Extra vectors in the block improve convergence of the last
+    // requested eigenpairs...
+    uint m = k + min(max(k / 4, 2u), n - k);
+
+    if (3 * m >= n) {
+      if (verbosity > 1)
+        cerr << "Problem is small, using dense eigendecomposition\n";
+      DoubleMatrix U = A.dense();
+      DoubleMatrix S = Math::eigenDecomp(U);
+      DoubleMatrix s(k, 1);
+      for (uint i=0; i<k; ++i)
+        s[i] = S[i];
+      boost::tuple<DoubleMatrix, DoubleMatrix> result(s, columns(U, 0, k));
+      return(result);
+    }
+
+    // Jacobi preconditioner
+    vector<double> diag = A.diagonal();
+    vector<double> prec(n);
+    double scale = 0.0;
+    for (uint i=0; i<n; ++i) {
+      prec[i] = diag[i] > 0.0 ? 1.0 / diag[i] : 1.0;
+      scale = max(scale, fabs(diag[i]));
+    }
+    if (scale == 0.0)
+      scale = 1.0;
+
+    // Use a private, fixed-seed generator so results are reproducible
+    // and the global LOOS generator is left untouched...
+    base_generator_type rng(42);
+    boost::uniform_real<> uni(-1.0, 1.0);
+    boost::variate_generator<base_generator_type&, boost::uniform_real<> > rnd(rng, uni);
+
+    DoubleMatrix X(n, m);
+    for (ulong i=0; i<X.size(); ++i)
+      X[i] = rnd();
+
+    if (guess.rows() != 0) {
+      if (guess.rows() != n)
+        throw(std::logic_error("Initial guess for eigenvectors has the wrong size"));
+      uint nguess = min(guess.cols(), m);
+      copy(guess.get(), guess.get() + static_cast<ulong>(n) * nguess, X.get());
+      if (verbosity > 1)
+        cerr << boost::format("Starting LOBPCG from %d guessed vectors\n") % nguess;
+    }
+    X = orthonormalize(X, 0);
+
+    DoubleMatrix AX = applyMatrix(A, X);
+    DoubleMatrix C;
+    DoubleMatrix lambda = rayleighRitz(X, AX, C);
+    X = Math::MMMultiply(X, C);
+    AX = Math::MMMultiply(AX, C);
+
+    DoubleMatrix P;
+    uint iter;
+    uint nconv = 0;
+    for (iter = 0; iter < maxiter; ++iter) {
+
+      // Residuals and convergence
+      DoubleMatrix W(n, m);
+      nconv = 0;
+      for (uint i=0; i<m; ++i) {
+        double* r = W.get() + i * n;
+        const double* x = X.get() + i * n;
+        const double* ax = AX.get() + i * n;
+        for (uint j=0; j<n; ++j)
+          r[j] = ax[j] - lambda[i] * x[j];
+
+        if (i < k && sqrt(dot(r, r, n)) <= tol * max(fabs(lambda[i]), scale))
+          ++nconv;
+
+        for (uint j=0; j<n; ++j)
+          r[j] *= prec[j];
+      }
+
+      if (verbosity > 2)
+        cerr << boost::format("LOBPCG iteration %d: %d of %d converged\n") % iter % nconv % k;
+      if (nconv == k)
+        break;
+
+      // Build the trial subspace [X W P] and project...
+      vector<const DoubleMatrix*> parts;
+      parts.push_back(&X);
+      parts.push_back(&W);
+      if (P.cols() > 0)
+        parts.push_back(&P);
+
+      DoubleMatrix S = orthonormalize(concatenate(parts), m);
+      DoubleMatrix ASr = applyMatrix(A, S, m);
+      parts.clear();
+      parts.push_back(&AX);
+      parts.push_back(&ASr);
+      DoubleMatrix AS = concatenate(parts);
+
+      lambda = rayleighRitz(S, AS, C);
+      DoubleMatrix Cm = Math::submatrix(C, Math::Range(0, C.rows()), Math::Range(0, m));
+
+      // The new search directions are the components of the Ritz
+      // vectors that lie outside the old X...
+      DoubleMatrix Sp = columns(S, m, S.cols());
+      DoubleMatrix Cp = Math::submatrix(Cm, Math::Range(m, Cm.rows()), Math::Range(0, m));
+      P = Math::MMMultiply(Sp, Cp);
+
+      X = Math::MMMultiply(S, Cm);
+      AX = Math::MMMultiply(AS, Cm);
+    }
+
+    if (nconv < k)
+      cerr << boost::format("Warning- LOBPCG only converged %d of %d eigenpairs after %d iterations\n") % nconv % k % iter;
+    else if (verbosity > 1)
+      cerr << boost::format("LOBPCG converged in %d iterations\n") % iter;
+
+    DoubleMatrix s(k, 1);
+    for (uint i=0; i<k; ++i)
+      s[i] = lambda[i];
+
+    boost::tuple<DoubleMatrix, DoubleMatrix> result(s, columns(X, 0, k));
+    return(result);
+  }
+
+
+
+  uint conjugateGradient(const BlockSparseMatrix& A, const double* b, double* x,
+                         const double tol, const uint maxiter) {
+    uint n = A.size();
+    vector<double> r(n), z(n), p(n), Ap(n);
+    vector<double> diag = A.diagonal();
+
+    double bnorm = sqrt(dot(b, b, n));
+    if (bnorm == 0.0) {
+      fill(x, x + n, 0.0);
+      return(0);
+    }
+
+    A.multiply(x, &Ap[0]);
+    for (uint i=0; i<n; ++i) {
+      r[i] = b[i] - Ap[i];
+      z[i] = diag[i] > 0.0 ? r[i] / diag[i] : r[i];
+    }
+    p = z;
+    double rz = dot(&r[0], &z[0], n);
+
+    for (uint iter = 0; iter < maxiter; ++iter) {
+      if (sqrt(dot(&r[0], &r[0], n)) <= tol * bnorm)
+        return(iter);
+
+      A.multiply(&p[0], &Ap[0]);
+      double alpha = rz / dot(&p[0], &Ap[0], n);
+      for (uint i=0; i<n; ++i) {
+        x[i] += alpha * p[i];
+        r[i] -= alpha * Ap[i];
+        z[i] = diag[i] > 0.0 ? r[i] / diag[i] : r[i];
+      }
+
+      double rz_new = dot(&r[0], &z[0], n);
+      double beta = rz_new / rz;
+      rz = rz_new;
+      for (uint i=0; i<n; ++i)
+        p[i] = z[i] + beta * p[i];
+    }
+
+    cerr << boost::format("Warning- conjugate gradient did not converge after %d iterations\n") % maxiter;
+    return(maxiter);
+  }
+
+};
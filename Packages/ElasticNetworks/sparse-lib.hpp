@@ -0,0 +1,163 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/** \addtogroup ENM
+ *@{
+ */
+
+#if !defined(LOOS_SPARSE_LIB_HPP)
+#define LOOS_SPARSE_LIB_HPP
+
+#include <loos.hpp>
+
+
+namespace ENM {
+
+  //! A pair of node indices
+  typedef std::pair<uint, uint>    NodePair;
+
+
+  //! Symmetric matrix stored as a sparse set of dense blocks
+  /**
+   * The matrix is made up of n x n blocks, each of which is a dense
+   * bs x bs matrix (bs=3 for an ANM hessian, bs=1 for a GNM Kirchoff
+   * matrix).  Only the blocks for connected pairs of nodes (plus the
+   * diagonal) are stored, in block compressed-row format.  Both the
+   * upper and lower triangles are stored so that a matrix-vector
+   * product is a single pass over the rows.
+   *
+   * Individual blocks are stored row-major.
+   */
+  class BlockSparseMatrix {
+  public:
+    BlockSparseMatrix() : n_(0), bs_(0) { }
+
+    //! Creates a zeroed matrix with blocks for the diagonal and each pair (and its transpose)
+    BlockSparseMatrix(const uint n, const uint bs, const std::vector<NodePair>& pairs);
+
+    //! Size of the full matrix (i.e. number of rows)
+    uint size() const { return(n_ * bs_); }
+
+    //! Number of block rows (i.e. nodes)
+    uint blockRows() const { return(n_); }
+
+    //! Size of each block
+    uint blockSize() const { return(bs_); }
+
+    //! Number of stored blocks
+    ulong nonzeroBlocks() const { return(cols_.size()); }
+
+    //! Pointer to the block for nodes (j, i), or 0 if the block is not stored
+    double* block(const uint j, const uint i);
+    const double* block(const uint j, const uint i) const;
+
+    //! Unique off-diagonal pairs of nodes (j < i) with stored blocks
+    std::vector<NodePair> pairs() const;
+
+    //! Zero all stored blocks
+    void zero();
+
+    //! Adds another matrix with exactly the same sparsity pattern
+    /**
+     * This is used to combine partial hessians that were built from
+     * the same set of contacts.  Throws if the patterns differ.
+     */
+    BlockSparseMatrix& operator+=(const BlockSparseMatrix& B);
+
+    //! Computes Y = A * X, where X and Y are column-major with \a ncols columns
+    /**
+     * Multiplying several vectors at once is much faster than one at a
+     * time since each block is only loaded from memory once.
+     */
+    void multiply(const double* x, double* y, const uint ncols = 1) const;
+
+    //! Returns the diagonal of the matrix
+    std::vector<double> diagonal() const;
+
+    //! Extract the blocks whose nodes both lie in [begin, end)
+    BlockSparseMatrix subMatrix(const uint begin, const uint end) const;
+
+    //! Convert to a dense matrix (for debugging and small problems)
+    loos::DoubleMatrix dense() const;
+
+  private:
+    uint n_, bs_;
+    std::vector<ulong> row_start_;
+    std::vector<uint> cols_;
+    std::vector<double> values_;
+  };
+
+
+  //! Finds all pairs of nodes (j < i) within the cutoff of each other
+  std::vector<NodePair> contactPairs(const loos::AtomicGroup& nodes, const double cutoff);
+
+
+  //! Finds the k lowest eigenpairs of a sparse symmetric matrix
+  /**
+   * Uses the locally optimal block preconditioned conjugate gradient
+   * method (LOBPCG, see Knyazev, SIAM J Sci Comput (2001) 23:517-541)
+   * with a Jacobi preconditioner.  Only sparse matrix-vector products
+   * and dense operations on n x 3k matrices are required, so the
+   * memory and time scale with the number of contacts rather than n^2.
+   *
+   * Small problems are simply solved densely.
+   *
+   * Returns a tuple of eigenvalues (k x 1, ascending) and eigenvectors
+   * (n x k).
+   */
+  boost::tuple<loos::DoubleMatrix, loos::DoubleMatrix> lowestEigenpairs(const BlockSparseMatrix& A,
+                                                                        const uint k,
+                                                                        const double tol = 1e-8,
+                                                                        const uint maxiter = 2000,
+                                                                        const int verbosity = 0);
+
+  //! Finds the k lowest eigenpairs, starting from a guess
+  /**
+   * The columns of \a guess (n x j, where j may be less than k) are
+   * used as the starting vectors for the iteration, e.g. the
+   * eigenvectors from a previous solve of a similar matrix.  Any
+   * remaining starting vectors are random.  An empty guess is the
+   * same as calling the function above.
+   */
+  boost::tuple<loos::DoubleMatrix, loos::DoubleMatrix> lowestEigenpairs(const BlockSparseMatrix& A,
+                                                                        const uint k,
+                                                                        const loos::DoubleMatrix& guess,
+                                                                        const double tol = 1e-8,
+                                                                        const uint maxiter = 2000,
+                                                                        const int verbosity = 0);
+
+
+  //! Solves A x = b for symmetric positive-definite A using conjugate gradients
+  /**
+   * Uses a Jacobi preconditioner.  On entry, \a x holds the initial
+   * guess.  Returns the number of iterations used.
+   */
+  uint conjugateGradient(const BlockSparseMatrix& A, const double* b, double* x,
+                         const double tol = 1e-10, const uint maxiter = 10000);
+
+};
+
+
+#endif
+
+/** @} */
@@ -53,17 +53,67 @@ namespace ENM {
 
 
 
+  //! Fixed-size 3x3 matrix for spring constants and hessian superblocks
+  /**
+   * A block is computed for every pair of nodes when building a
+   * hessian, so this lives on the stack rather than heap-allocating
+   * like a DoubleMatrix would.  Elements are stored row-major (the
+   * same layout used by BlockSparseMatrix), and the class is small
+   * enough to pass around by value.
+   */
+  class Block3x3 {
+  public:
+    //! A zeroed block
+    Block3x3() {
+      for (uint i=0; i<9; ++i)
+        data_[i] = 0.0;
+    }
+
+    //! A block with all elements set to \a k
+    explicit Block3x3(const double k) {
+      for (uint i=0; i<9; ++i)
+        data_[i] = k;
+    }
+
+    double& operator()(const uint y, const uint x) { return(data_[y*3 + x]); }
+    const double& operator()(const uint y, const uint x) const { return(data_[y*3 + x]); }
+
+    double& operator[](const uint i) { return(data_[i]); }
+    const double& operator[](const uint i) const { return(data_[i]); }
+
+    //! Raw (row-major) storage
+    double* get() { return(data_); }
+    const double* get() const { return(data_); }
+
+    //! Copy into a DoubleMatrix
+    loos::DoubleMatrix matrix() const {
+      loos::DoubleMatrix M(3, 3);
+      for (uint y=0; y<3; ++y)
+        for (uint x=0; x<3; ++x)
+          M(y, x) = data_[y*3 + x];
+      return(M);
+    }
+
+  private:
+    double data_[9];
+  };
+
+
+
   //! Interface for ENM spring functions
   /**
    *These classes define the various possible spring functions used in
    *creating the Hessian.  All derived from the SpringFunction base
-   *class.  This class returns a 3x3 DoubleMatrix containing the spring
+   *class.  This class returns a Block3x3 containing the spring
    *constants...
    *
    *The SpringFunction::constant() function takes the coords of the two
    *nodes plus their difference vector (since it'll almost always be
    *computed prior to calling SpringFunction, no sense in recomputing
-   *it).
+   *it).  The constants() function does the same for a batch of node
+   *pairs.  The spring functions below override it so that the
+   *per-pair calculation is a direct (inlinable) call rather than a
+   *virtual call per pair in the inner loop of hessian construction.
    *
    *
    * =Misc notes=
@@ -91,10 +141,29 @@ namespace ENM {
     //! How many internal constants there are
     virtual uint paramSize() const =0;
 
+    //! Distance beyond which the spring constant is zero (0 means unbounded)
+    /**
+     * Used when building a sparse hessian to decide which pairs of
+     * nodes need to be considered at all.
+     */
+    virtual double cutoff() const { return(0.0); }
+
 
   
     //! Actually compute the spring constant as a 3x3 matrix
-    virtual loos::DoubleMatrix constant(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d)  =0;
+    virtual Block3x3 constant(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d)  =0;
+
+    //! Compute the spring constants for \a n pairs of nodes at once
+    /**
+     * \a u, \a v, and \a d are arrays of the node coordinates and
+     * their differences (as in constant()) and the results are
+     * written to \a k.  The default just calls constant() for each
+     * pair.
+     */
+    virtual void constants(const loos::GCoord* u, const loos::GCoord* v, const loos::GCoord* d, const uint n, Block3x3* k) {
+      for (uint i=0; i<n; ++i)
+        k[i] = constant(u[i], v[i], d[i]);
+    }
 
   protected:
 
@@ -129,18 +198,32 @@ namespace ENM {
    *
    *Note: this means you override the constantImpl() implementation
    *function, NOT the public constant() function.
+   *
+   *Subclasses can also override constants() with
+   *uniformConstants<Subclass>() so a batch of pairs doesn't make a
+   *virtual call per pair.
    */
 
   class UniformSpringFunction : public SpringFunction {
   public:
 
-    loos::DoubleMatrix constant(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d) {
-      double k = checkConstant(constantImpl(u, v, d));
-      loos::DoubleMatrix B(3, 3);
-      for (uint i=0; i<9; ++i)
-        B[i] = k;
+    Block3x3 constant(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d) {
+      return(Block3x3(checkConstant(constantImpl(u, v, d))));
+    }
+
+    void constants(const loos::GCoord* u, const loos::GCoord* v, const loos::GCoord* d, const uint n, Block3x3* k) {
+      for (uint i=0; i<n; ++i)
+        k[i] = Block3x3(checkConstant(constantImpl(u[i], v[i], d[i])));
+    }
+
+  protected:
 
-      return(B);
+    //! constants() for the subclass Spring, calling its constantImpl() directly
+    template<class Spring>
+    void uniformConstants(const loos::GCoord* u, const loos::GCoord* v, const loos::GCoord* d, const uint n, Block3x3* k) {
+      Spring* spring = static_cast<Spring*>(this);
+      for (uint i=0; i<n; ++i)
+        k[i] = Block3x3(checkConstant(spring->Spring::constantImpl(u[i], v[i], d[i])));
     }
 
   private:
@@ -184,7 +267,13 @@ namespace ENM {
 
     uint paramSize() const { return(1); }
 
-    double constantImpl(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d) {
+    double cutoff() const { return(sqrt(radius)); }
+
+    void constants(const loos::GCoord* u, const loos::GCoord* v, const loos::GCoord* d, const uint n, Block3x3* k) {
+      uniformConstants<DistanceCutoff>(u, v, d, n, k);
+    }
+
+    double constantImpl(const loos::GCoord&, const loos::GCoord&, const loos::GCoord& d) {
       double s = d.length2();
       if (s <= radius)
         return(1./s);
@@ -221,7 +310,11 @@ namespace ENM {
     uint paramSize() const { return(1); }
 
 
-    double constantImpl(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d) {
+    void constants(const loos::GCoord* u, const loos::GCoord* v, const loos::GCoord* d, const uint n, Block3x3* k) {
+      uniformConstants<DistanceWeight>(u, v, d, n, k);
+    }
+
+    double constantImpl(const loos::GCoord&, const loos::GCoord&, const loos::GCoord& d) {
       double s = d.length();
       return(pow(s, power));
     }
@@ -256,7 +349,11 @@ namespace ENM {
     uint paramSize() const { return(1); }
 
 
-    double constantImpl(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d) {
+    void constants(const loos::GCoord* u, const loos::GCoord* v, const loos::GCoord* d, const uint n, Block3x3* k) {
+      uniformConstants<ExponentialDistance>(u, v, d, n, k);
+    }
+
+    double constantImpl(const loos::GCoord&, const loos::GCoord&, const loos::GCoord& d) {
       double s = d.length();
       return(exp(scale * s));
     }
@@ -320,7 +417,11 @@ namespace ENM {
     uint paramSize() const { return(5); }
 
 
-    double constantImpl(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d) {
+    void constants(const loos::GCoord* u, const loos::GCoord* v, const loos::GCoord* d, const uint n, Block3x3* k) {
+      uniformConstants<HCA>(u, v, d, n, k);
+    }
+
+    double constantImpl(const loos::GCoord&, const loos::GCoord&, const loos::GCoord& d) {
       double s = d.length();
       double k;
 
@@ -358,7 +459,11 @@ public:
 
   uint paramSize() const { return(1); }
 
-  double constantImpl(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d) {
+  void constants(const loos::GCoord* u, const loos::GCoord* v, const loos::GCoord* d, const uint n, Block3x3* k) {
+    uniformConstants<ConstBonded>(u, v, d, n, k);
+  }
+
+  double constantImpl(const loos::GCoord&, const loos::GCoord&, const loos::GCoord&) {
     //std::cerr << "In impl in constbonded :)\n";
     return(scale);
   }
@@ -143,6 +143,11 @@ namespace ENM {
 
   void VSA::solve() {
 
+    if (isSparse()) {
+      solveSparse();
+      return;
+    }
+
     if (verbosity_ > 1)
       std::cerr << "Building hessian...\n";
     buildHessian();
@@ -175,6 +180,130 @@ namespace ENM {
     if (debugging_)
       writeAsciiMatrix(prefix_ + "_Hssp.asc", Hssp_, meta_, false);
 
+    if (masses_.rows() != 0) {
+
+      // Build the effective mass matrix
+      DoubleMatrix Ms = submatrix(masses_, Math::Range(0, l), Math::Range(0, l));
+      DoubleMatrix Me = submatrix(masses_, Math::Range(l, n), Math::Range(l, n));
+
+      if (verbosity_ > 1)
+        std::cerr << "Computing effective mass matrix...\n";
+      Msp_ = Ms + Hse * Heei * Me * Heei * Hes;
+
+      if (debugging_) {
+        writeAsciiMatrix(prefix_ + "_Ms.asc", Ms, meta_, false);
+        writeAsciiMatrix(prefix_ + "_Me.asc", Me, meta_, false);
+        writeAsciiMatrix(prefix_ + "_Msp.asc", Msp_, meta_, false);
+      }
+    }
+
+    solveEffective();
+  }
+
+
+
+  // The environment hessian is never inverted.  Instead, Hee * Y = Hes
+  // is solved iteratively using the sparse environment hessian, one
+  // column of Hes at a time.  The effective hessian and mass matrices
+  // are only as large as the subsystem, so they are built densely.
+  void VSA::solveSparse() {
+
+    if (verbosity_ > 1)
+      std::cerr << "Building sparse hessian...\n";
+    buildSparseHessian();
+
+    uint nodes = sparse_hessian_.blockRows();
+    uint n = sparse_hessian_.size();
+    uint l = subset_size_ * 3;
+    uint e = n - l;
+
+    DoubleMatrix Hss = sparse_hessian_.subMatrix(0, subset_size_).dense();
+    BlockSparseMatrix Hee = sparse_hessian_.subMatrix(subset_size_, nodes);
+
+    // Only the subsystem-environment contacts contribute to Hes
+    DoubleMatrix Hes(e, l);
+    std::vector<NodePair> pairs = sparse_hessian_.pairs();
+    for (std::vector<NodePair>::const_iterator p = pairs.begin(); p != pairs.end(); ++p) {
+      if (p->first >= subset_size_ || p->second < subset_size_)
+        continue;
+      const double* B = sparse_hessian_.block(p->first, p->second);
+      for (uint r=0; r<3; ++r)
+        for (uint c=0; c<3; ++c)
+          Hes((p->second - subset_size_) * 3 + c, p->first * 3 + r) = B[r*3 + c];
+    }
+
+    if (debugging_) {
+      writeAsciiMatrix(prefix_ + "_Hss.asc", Hss, meta_, false);
+      writeAsciiMatrix(prefix_ + "_Hse.asc", Math::transpose(Hes), meta_, false);
+    }
+
+    if (verbosity_ > 1)
+      std::cerr << "Solving for environment response...\n";
+
+    // The previous response is a good initial guess when only the
+    // parameters have changed
+    DoubleMatrix Y(e, l);
+    if (warm_start_ && response_.rows() == e && response_.cols() == l)
+      Y = response_.copy();
+
+    for (uint i=0; i<l; ++i) {
+      const double* b = Hes.get() + i * e;
+      bool empty = true;
+      for (uint j=0; j<e && empty; ++j)
+        empty = (b[j] == 0.0);
+      if (!empty)
+        conjugateGradient(Hee, b, Y.get() + i * e);
+      else
+        std::fill(Y.get() + i * e, Y.get() + (i+1) * e, 0.0);
+    }
+    if (warm_start_)
+      response_ = Y;
+
+    if (verbosity_ > 1)
+      std::cerr << "Computing effective hessian...\n";
+    Hssp_ = Hss - Math::MMMultiply(Hes, Y, true, false);
+
+    if (debugging_)
+      writeAsciiMatrix(prefix_ + "_Hssp.asc", Hssp_, meta_, false);
+
+    if (masses_.rows() != 0) {
+
+      // Only the diagonal of the masses is used here, so they may be
+      // given as either a full matrix or a column vector
+      bool is_vector = (masses_.cols() == 1);
+      DoubleMatrix Ms(l, l);
+      for (uint i=0; i<l; ++i)
+        Ms(i, i) = is_vector ? masses_[i] : masses_(i, i);
+
+      DoubleMatrix MeY = Y.copy();
+      for (uint j=0; j<e; ++j) {
+        double m = is_vector ? masses_[j + l] : masses_(j + l, j + l);
+        for (uint i=0; i<l; ++i)
+          MeY(j, i) *= m;
+      }
+
+      if (verbosity_ > 1)
+        std::cerr << "Computing effective mass matrix...\n";
+      Msp_ = Ms + Math::MMMultiply(Y, MeY, true, false);
+
+      if (debugging_) {
+        writeAsciiMatrix(prefix_ + "_Ms.asc", Ms, meta_, false);
+        writeAsciiMatrix(prefix_ + "_Msp.asc", Msp_, meta_, false);
+      }
+    }
+
+    solveEffective();
+
+    // Only keep the requested number of modes...
+    uint k = std::min(nmodes_, eigenvals_.rows());
+    eigenvals_ = submatrix(eigenvals_, Math::Range(0, k), Math::Range(0, 1));
+    eigenvecs_ = submatrix(eigenvecs_, Math::Range(0, eigenvecs_.rows()), Math::Range(0, k));
+  }
+
+
+
+  void VSA::solveEffective() {
+
     // Shunt in the event of using unit masses...  We can use the SVD to
     // to get the eigenpairs from Hssp
     if (masses_.rows() == 0) {
@@ -200,20 +329,6 @@ namespace ENM {
     }
 
 
-    // Build the effective mass matrix
-    DoubleMatrix Ms = submatrix(masses_, Math::Range(0, l), Math::Range(0, l));
-    DoubleMatrix Me = submatrix(masses_, Math::Range(l, n), Math::Range(l, n));
-
-    if (verbosity_ > 1)
-      std::cerr << "Computing effective mass matrix...\n";
-    Msp_ = Ms + Hse * Heei * Me * Heei * Hes;
-
-    if (debugging_) {
-      writeAsciiMatrix(prefix_ + "_Ms.asc", Ms, meta_, false);
-      writeAsciiMatrix(prefix_ + "_Me.asc", Me, meta_, false);
-      writeAsciiMatrix(prefix_ + "_Msp.asc", Msp_, meta_, false);
-    }
-
     // Run the eigen-decomposition...
     boost::tuple<DoubleMatrix, DoubleMatrix> eigenpairs;
     Timer<> t;
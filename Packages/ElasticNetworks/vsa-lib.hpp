@@ -96,6 +96,10 @@ namespace ENM {
      \code
      vsa.setMasses(DoubleMatrix());
      \endcode
+     *
+     * When using the sparse solver, only the diagonal of the mass
+     * matrix is used, so it may be given as a 3N x 1 vector instead
+     * (see getMassVector()).
     */
     void setMasses(const loos::DoubleMatrix& M) {
       masses_ = M;
@@ -111,6 +115,8 @@ namespace ENM {
 
 
   private:
+    void solveSparse();
+    void solveEffective();
     boost::tuple<loos::DoubleMatrix, loos::DoubleMatrix> eigenDecomp(loos::DoubleMatrix& A, loos::DoubleMatrix& B);
     loos::DoubleMatrix massWeight(loos::DoubleMatrix& U, loos::DoubleMatrix& M);
 
@@ -121,6 +127,7 @@ namespace ENM {
 
     loos::DoubleMatrix Msp_;
     loos::DoubleMatrix Hssp_;
+    loos::DoubleMatrix response_;
   };
 
 
@@ -66,6 +66,8 @@ string psf_file;
 
 string spring_desc;
 bool nomass;
+uint nmodes;
+double cutoff;
 
 
 string fullHelpMessage() {
@@ -135,6 +137,16 @@ string fullHelpMessage() {
     "To disable masses (i.e. use unit masses for the subsystem and\n"
     "zero masses for the environment), use the \"--nomass 1\" option.\n"
     "\n\n"
+    "* Large Systems *\n\n"
+    "For large environments, the --modes option builds a sparse hessian\n"
+    "using only nodes within a cutoff of each other and solves for the\n"
+    "environment's response iteratively rather than inverting the\n"
+    "environment hessian.  Only the requested number of lowest modes\n"
+    "are written.  The cutoff defaults to the range of the spring\n"
+    "function, but must be given with --cutoff for springs that never\n"
+    "reach zero.  The full hessian matrices are not written when\n"
+    "debugging in this mode.\n"
+    "\n\n"
     "EXAMPLES \n\n"
     "\n"
     "vsa --occupancies 1 foo.pdb 'segid == \"TRAN\" && name == \"CA\"'\\\n"
@@ -172,17 +184,21 @@ public:
       ("debug", po::value<bool>(&debug)->default_value(false), "Turn on debugging (output intermediate matrices)")
       ("occupancies", po::value<bool>(&occupancies_are_masses)->default_value(false), "Atom masses are stored in the PDB occupancy field")
       ("nomass", po::value<bool>(&nomass)->default_value(false), "Disable mass as part of the VSA solution")
-      ("spring,S", po::value<string>(&spring_desc)->default_value("distance"), "Spring method and arguments");
+      ("spring,S", po::value<string>(&spring_desc)->default_value("distance"), "Spring method and arguments")
+      ("modes", po::value<uint>(&nmodes)->default_value(0), "Use sparse solver and keep this many of the lowest modes (0 = all, dense)")
+      ("cutoff", po::value<double>(&cutoff)->default_value(0.0), "Contact cutoff for sparse hessian (0 = use spring function)");
   }
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("psf='%s', debug=%d, occupancies=%d, nomass=%d, spring='%s'")
+    oss << boost::format("psf='%s', debug=%d, occupancies=%d, nomass=%d, spring='%s', modes=%d, cutoff=%f")
       % psf_file
       % debug
       % occupancies_are_masses
       % nomass
-      % spring_desc;
+      % spring_desc
+      % nmodes
+      % cutoff;
     return(oss.str());
   }
 
@@ -252,9 +268,10 @@ int main(int argc, char *argv[]) {
   vsa.meta(hdr);
   vsa.debugging(debug);
   vsa.verbosity(verbosity);
+  vsa.sparse(nmodes, cutoff);
 
   if (!nomass) {
-    DoubleMatrix M = getMasses(composite);
+    DoubleMatrix M = vsa.isSparse() ? getMassVector(composite) : getMasses(composite);
     vsa.setMasses(M);
   }
 
@@ -250,11 +250,11 @@ int main(int argc, char *argv[]) {
 
   SAGroup donors = SimpleAtom::processSelection(donor_selection, model, use_periodicity);
 
-  vector<SAGroup> acceptors;
+  vector<HBondFinder> acceptors;
   for (uint i=0; i<acceptor_selections.size(); ++i) {
     SAGroup acceptor = SimpleAtom::processSelection(acceptor_selections[i], model, use_periodicity);
     cout << boost::format("# Group %d size is %d\n") % i % acceptor.size();
-    acceptors.push_back(acceptor);
+    acceptors.push_back(HBondFinder(donors, acceptor));
   }
   
   acceptor_names.push_back("Unbound/Other");
@@ -288,12 +288,13 @@ int main(int argc, char *argv[]) {
       traj->readFrame(t);
       traj->updateGroupCoords(model);
 
-      for (uint i=0; i<donors.size(); ++i) {
-        for (uint j=0; j<acceptors.size(); ++j) {
-          AtomicGroup found = donors[i].findHydrogenBonds(acceptors[j], true);
-          if (! found.empty())
-            B(j, i) += 1;
-        }
+      // Only count each donor once per acceptor group (bonds are
+      // sorted by donor)
+      for (uint j=0; j<acceptors.size(); ++j) {
+        vector<HBondFinder::Bond> found = acceptors[j].findBonds();
+        for (uint l=0; l<found.size(); ++l)
+          if (l == 0 || found[l].first != found[l-1].first)
+            B(j, found[l].first) += 1;
       }
     }
 
@@ -210,6 +210,57 @@ BondMatrix SimpleAtom::findHydrogenBondsMatrix(const std::vector<SimpleAtom>& gr
 
 
 
+// The cell list only picks candidates for hydrogenBond()...
+
+std::vector<HBondFinder::Bond> HBondFinder::findBonds() const {
+  std::vector<Bond> bonds;
+  if (_donors.empty() || _acceptors.empty())
+    return(bonds);
+
+  std::vector<loos::GCoord> coords(_acceptors.size());
+  for (uint i=0; i<_acceptors.size(); ++i)
+    coords[i] = _acceptors[i].rawAtom()->coords();
+
+  loos::CellList cells(loos::CellList::paddedCutoff(SimpleAtom::outerRadius()));
+  if (_donors[0].periodic())
+    cells.update(coords, _donors[0].periodicBox());
+  else
+    cells.update(coords);
+
+  std::vector<uint> nearby;
+  for (uint i=0; i<_donors.size(); ++i) {
+    cells.neighbors(_donors[i].rawAtom()->coords(), nearby);
+    std::sort(nearby.begin(), nearby.end());
+    for (std::vector<uint>::const_iterator j = nearby.begin(); j != nearby.end(); ++j)
+      if (_donors[i].hydrogenBond(_acceptors[*j]))
+        bonds.push_back(Bond(i, *j));
+  }
+
+  return(bonds);
+}
+
+
+
+std::vector< std::vector<HBondFinder::Bond> > HBondFinder::findBonds(loos::pTraj& traj, loos::AtomicGroup& model, const uint maxt) const {
+
+  if (maxt > traj->nframes()) {
+    std::cerr << boost::format("Error- row clip (%d) exceeds trajectory size (%d)\n") % maxt % traj->nframes();
+    exit(-10);
+  }
+
+  std::vector< std::vector<Bond> > bonds(maxt);
+  for (uint t = 0; t < maxt; ++t) {
+    traj->readFrame(t);
+    traj->updateGroupCoords(model);
+    bonds[t] = findBonds();
+  }
+
+  return(bonds);
+}
+
+
+
+
 bool SimpleAtom::divineHydrogen(const std::string& name) {
   if (name[0] == 'H')
     return(true);
@@ -77,6 +77,9 @@ namespace loos {
 
       loos::pAtom rawAtom() const { return(atom); }
 
+      bool periodic() const { return(usePeriodicity); }
+      loos::GCoord periodicBox() const { return(sbox.box()); }
+
       double distance2(const SimpleAtom& s) const;
       double angle(const SimpleAtom& s) const;
 
@@ -164,6 +167,38 @@ namespace loos {
     typedef SimpleAtom    SAtom;
     typedef std::vector<SAtom> SAGroup;
 
+
+
+    // Finds all hydrogen bonds between a set of donors and a set of
+    // acceptors.  Rather than testing every donor against every
+    // acceptor, the acceptors are binned into a loos::CellList (sized
+    // by the SimpleAtom outer radius) each frame so only nearby pairs
+    // are tested.  This makes each frame linear in the number of atoms.
+    // The bond criteria are the same as SimpleAtom::hydrogenBond(), as
+    // is the periodicity (taken from the donors).
+
+    class HBondFinder {
+    public:
+      // A hydrogen bond given as (donor index, acceptor index)
+      typedef std::pair<uint, uint>      Bond;
+
+      HBondFinder(const SAGroup& donors, const SAGroup& acceptors) : _donors(donors), _acceptors(acceptors) { }
+
+      // All bonds for the current coordinates, sorted by donor and
+      // then acceptor
+      std::vector<Bond> findBonds() const;
+
+      // Bonds for each frame of the trajectory (up to maxt)
+      std::vector< std::vector<Bond> > findBonds(loos::pTraj& traj, loos::AtomicGroup& model, const uint maxt) const;
+      std::vector< std::vector<Bond> > findBonds(loos::pTraj& traj, loos::AtomicGroup& model) const {
+        return(findBonds(traj, model, traj->nframes()));
+      }
+
+    private:
+      SAGroup _donors, _acceptors;
+    };
+
+
   }
 }
 #endif
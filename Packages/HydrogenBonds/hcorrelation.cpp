@@ -58,7 +58,6 @@ string donor_selection, acceptor_selection;
 string model_name;
 vString traj_names;
 uint maxtime;
-uint skip;
 bool any_hydrogen;
 
 // ---------------
@@ -167,8 +166,7 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("skip=%d,stderr=%d,blow=%f,bhi=%f,angle=%f,periodic=%d,maxtime=%d,any=%d,acceptor=\"%s\",donor=\"%s\",model=\"%s\",trajs=\"%s\"")
-      % skip
+    oss << boost::format("stderr=%d,blow=%f,bhi=%f,angle=%f,periodic=%d,maxtime=%d,any=%d,acceptor=\"%s\",donor=\"%s\",model=\"%s\",trajs=\"%s\"")
       % use_stderr
       % length_low
       % length_high
@@ -285,50 +283,40 @@ int main(int argc, char *argv[]) {
     cerr << "Processing " << *ci << endl;
     pTraj traj = createTrajectory(*ci, model);
     
-    for (SAGroup::iterator j = donors.begin(); j != donors.end(); ++j) {
-      if (skip > 0)
-        traj->readFrame(skip-1);
-
-      BondMatrix bonds = j->findHydrogenBondsMatrix(acceptors, traj, model);
-      if (any_hydrogen) {
-        TimeSeries<double> ts;
-        for (uint j=0; j<bonds.rows(); ++j) {
-          double val = 0.0;
-          for (uint i=0; i<bonds.cols(); ++i)
-            if (bonds(j, i) != 0) {
-              val = 1.0;
-              break;
-            }
-          ts.push_back(val);
-        }
-        TimeSeries<double> tcorr = ts.correl(maxtime);
-        vecDouble vtmp;
-        copy(tcorr.begin(), tcorr.end(), back_inserter(vtmp));
-        correlations.push_back(vtmp);
-            
-      } else {
-        for (uint i=0; i<bonds.cols(); ++i) {
-          bool found = false;
-          for (uint j=0; j<bonds.rows(); ++j)
-            if (bonds(j, i) != 0) { 
-              found = true;
-              break;
-            }
-          
-          if (found) {
-            TimeSeries<double> ts;
-            for (uint j=0; j<bonds.rows(); ++j)
-              ts.push_back(bonds(j, i));
-            TimeSeries<double> tcorr = ts.correl(maxtime);
-            vecDouble vtmp;
-            copy(tcorr.begin(), tcorr.end(), back_inserter(vtmp));
-            correlations.push_back(vtmp);
-          }
-          
-        }
-        
-      }
-
+    // Find all bonds for all donors in a single pass through the
+    // trajectory, then pack the time series for each donor (or
+    // donor-acceptor pair) into a BitMatrix for correlating...
+    HBondFinder finder(donors, acceptors);
+    vector< vector<HBondFinder::Bond> > frames = finder.findBonds(traj, model);
+    uint nframes = frames.size();
+
+    if (any_hydrogen) {
+      BitMatrix bound(nframes, donors.size());
+      for (uint t=0; t<nframes; ++t)
+        for (uint l=0; l<frames[t].size(); ++l)
+          bound.set(t, frames[t][l].first);
+
+      for (uint j=0; j<donors.size(); ++j)
+        correlations.push_back(bound.autocorrelation(j, maxtime));
+
+    } else {
+      // Ordered by donor, then acceptor
+      map<HBondFinder::Bond, uint> pairs;
+      for (uint t=0; t<nframes; ++t)
+        for (uint l=0; l<frames[t].size(); ++l)
+          pairs.insert(pair<HBondFinder::Bond, uint>(frames[t][l], 0));
+
+      uint k = 0;
+      for (map<HBondFinder::Bond, uint>::iterator i = pairs.begin(); i != pairs.end(); ++i)
+        i->second = k++;
+
+      BitMatrix bound(nframes, pairs.size());
+      for (uint t=0; t<nframes; ++t)
+        for (uint l=0; l<frames[t].size(); ++l)
+          bound.set(t, pairs[frames[t][l]]);
+
+      for (uint j=0; j<bound.series(); ++j)
+        correlations.push_back(bound.autocorrelation(j, maxtime));
     }
 
   }
@@ -50,6 +50,7 @@ bool use_periodicity;
 string donor_selection, acceptor_selection;
 string model_name;
 string traj_name;
+string binary_name;
 
 uint currentTimeStep = 0;
 
@@ -88,6 +89,12 @@ string fullHelpMessage(void) {
     "to greater than or equal to 2.0 angstroms and less than or equal to 4.0 angstroms, with\n"
     "an angle of less than or equal to 25.0 degrees.\n"
     "\n"
+    "\thmatrix --binary hbonds.bits model.psf sim.dcd \\\n"
+    "\t  'segid == \"PE1\" && resid == 4 && name == \"HE1\"'\\\n"
+    "\t  'name == \"O1\" && resname == \"PALM\"'\n"
+    "This example writes the matrix in a compact binary form (one bit per frame\n"
+    "and acceptor) to hbonds.bits rather than as ASCII to stdout.\n"
+    "\n"
     "SEE ALSO\n"
     "\thbonds, hcorrelation\n";
 
@@ -104,7 +111,8 @@ public:
       ("blow", po::value<double>(&length_low)->default_value(1.5), "Low cutoff for bond length")
       ("bhi", po::value<double>(&length_high)->default_value(3.0), "High cutoff for bond length")
       ("angle", po::value<double>(&max_angle)->default_value(30.0), "Max bond angle deviation from linear")
-      ("periodic", po::value<bool>(&use_periodicity)->default_value(false), "Use periodic boundary");
+      ("periodic", po::value<bool>(&use_periodicity)->default_value(false), "Use periodic boundary")
+      ("binary", po::value<string>(&binary_name), "Write the matrix in binary to this file (rather than ASCII to stdout)");
   }
 
   void addHidden(po::options_description& o) {
@@ -126,11 +134,12 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("blow=%f,bhi=%f,angle=%f,periodic=%d,acceptor=\"%s\",donor=\"%s\"")
+    oss << boost::format("blow=%f,bhi=%f,angle=%f,periodic=%d,binary=\"%s\",acceptor=\"%s\",donor=\"%s\"")
       % length_low
       % length_high
       % max_angle
       % use_periodicity
+      % binary_name
       % acceptor_selection
       % donor_selection;
 
@@ -181,7 +190,24 @@ int main(int argc, char *argv[]) {
   }
 
   SAGroup acceptors = SimpleAtom::processSelection(acceptor_selection, model, use_periodicity);
-  BondMatrix bonds = donors[0].findHydrogenBondsMatrix(acceptors, traj, model);
-  writeAsciiMatrix(cout, bonds, hdr);
+
+  // Frames are rows, acceptors are columns
+  HBondFinder finder(donors, acceptors);
+  vector< vector<HBondFinder::Bond> > frames = finder.findBonds(traj, model);
+  BitMatrix bonds(frames.size(), acceptors.size());
+  for (uint t=0; t<frames.size(); ++t)
+    for (uint l=0; l<frames[t].size(); ++l)
+      bonds.set(t, frames[t][l].second);
+
+  if (binary_name.empty())
+    bonds.writeAscii(cout, hdr);
+  else {
+    ofstream ofs(binary_name.c_str(), ios::out | ios::binary);
+    if (!ofs) {
+      cerr << "Error- cannot open " << binary_name << " for writing\n";
+      exit(-1);
+    }
+    bonds.write(ofs, hdr);
+  }
 }
 
@@ -0,0 +1,100 @@
+/*
+  Checks that AtomicGroup's atomid lookups stay correct when the
+  atoms are changed behind the group's back.
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <loos.hpp>
+
+using namespace std;
+using namespace loos;
+
+
+int failures = 0;
+
+void check(const bool b, const string& what) {
+  if (!b) {
+    cerr << "FAILED: " << what << endl;
+    ++failures;
+  }
+}
+
+
+// Big enough that lookups go through the id index
+AtomicGroup makeGroup(const uint n) {
+  AtomicGroup grp;
+  for (uint i=0; i<n; ++i)
+    grp.append(pAtom(new Atom(2*i+1, "CA", GCoord(i, 0, 0))));
+  return(grp);
+}
+
+
+
+int main() {
+  const uint n = 100;
+
+  {
+    AtomicGroup grp = makeGroup(n);
+    check(grp.findById(5) == grp[2], "lookup before any changes");
+    check(!grp.findById(4), "miss before any changes");
+
+    grp[3]->id(4);
+    check(grp.findById(4) == grp[3], "lookup after changing an atomid");
+    check(!grp.findById(7), "miss after changing an atomid");
+
+    Atom other(1000, "CB", GCoord());
+    *grp[10] = other;
+    check(grp.findById(1000) == grp[10], "lookup after copying an atom over another");
+  }
+
+  {
+    AtomicGroup grp = makeGroup(n);
+    check(!grp.findById(1001), "miss before replacing an atom");
+
+    pAtom pa(new Atom(1001, "CB", GCoord()));
+    grp[20] = pa;
+    check(grp.findById(1001) == pa, "lookup after replacing an atom through operator[]");
+    check(!grp.findById(41), "replaced atom is gone");
+    check(grp.contains(pa), "contains() after replacing an atom");
+
+    AtomicGroup one;
+    one.append(pa);
+    check(grp.intersect(one).size() == 1, "intersect() after replacing an atom");
+  }
+
+  {
+    AtomicGroup grp = makeGroup(n);
+    grp.sort();
+    check(!grp.findById(1001), "miss on a sorted group");
+
+    pAtom pa(new Atom(1001, "CB", GCoord()));
+    *(grp.begin()) = pa;
+    check(grp.findById(1001) == pa, "lookup after replacing an atom through an iterator");
+    check(!grp.sorted(), "replacing an atom resets the sort status");
+  }
+
+  if (failures) {
+    cerr << failures << " check(s) failed\n";
+    exit(-1);
+  }
+
+  cout << "All checks passed\n";
+}
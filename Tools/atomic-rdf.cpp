@@ -37,6 +37,30 @@ namespace opts = loos::OptionsFramework;
 namespace po = loos::OptionsFramework::po;
 
 
+// @cond TOOLS_INTERNAL
+class ToolOptions : public opts::OptionsPackage
+{
+public:
+  ToolOptions() : nthreads(1) { }
+
+  void addGeneric(po::options_description& o)
+  {
+    o.add_options()
+      ("threads", po::value<uint>(&nthreads)->default_value(nthreads), "Number of threads to use (0=all available)");
+  }
+
+  string print() const
+  {
+    ostringstream oss;
+    oss << boost::format("threads=%d") % nthreads;
+    return(oss.str());
+  }
+
+  uint nthreads;
+};
+// @endcond
+
+
 
 void Usage()
     {
@@ -67,6 +91,11 @@ string fullHelpMessage(void)
     "    4: cumulative distribution function of selection-1 atoms around \n"
     "       selection-2 atoms\n"
     "\n"
+    "Only pairs closer than the histogram maximum are looked at in each frame,\n"
+    "so the time taken grows linearly with the number of atoms.  Each frame\n"
+    "can be split over several threads with the --threads option (0 will use\n"
+    "as many threads as are available).\n"
+    "\n"
     "EXAMPLE\n"
     "\n"
     "  atomic-rdf model traj 'name =~ \"OP[1-4]\"' 'name =~ \"OH2\" && \\\n"
@@ -90,6 +119,7 @@ int main (int argc, char *argv[])
 opts::BasicOptions* bopts = new opts::BasicOptions(fullHelpMessage());
 opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices;
 opts::RequiredArguments* ropts = new opts::RequiredArguments;
+ToolOptions* topts = new ToolOptions;
 
 // These are required command-line arguments (non-optional options)
 ropts->addArgument("selection1", "selection1");
@@ -99,7 +129,7 @@ ropts->addArgument("max", "max radius");
 ropts->addArgument("num_bins", "number of bins");
 
 opts::AggregateOptions options;
-options.add(bopts).add(tropts).add(ropts);
+options.add(bopts).add(tropts).add(ropts).add(topts);
 if (!options.parse(argc, argv))
   exit(-1);
 
@@ -144,19 +174,42 @@ if (group2.empty())
     exit(-1);
     }
 
-// Create the histogram and zero it out
-vector<double> hist;
-hist.reserve(num_bins);
-hist.insert(hist.begin(), num_bins, 0.0);
+// Find the "self" pairs, in case the two selections overlap.  Atoms
+// in both selections are given the same id, so the RDF skips them.
+map<Atom*, uint> group2_index;
+for (uint k = 0; k < group2.size(); k++)
+    {
+    group2_index[group2[k].get()] = k;
+    }
+
+vector<uint> ids1(group1.size()), ids2(group2.size());
+unsigned long unique_pairs = static_cast<unsigned long>(group1.size()) * group2.size();
+for (uint k = 0; k < group2.size(); k++)
+    {
+    ids2[k] = k;
+    }
+for (uint j = 0; j < group1.size(); j++)
+    {
+    map<Atom*, uint>::const_iterator self = group2_index.find(group1[j].get());
+    if (self != group2_index.end())
+        {
+        ids1[j] = self->second;
+        unique_pairs--;
+        }
+    else
+        {
+        ids1[j] = group2.size() + j;
+        }
+    }
 
-double min2 = hist_min*hist_min;
-double max2 = hist_max*hist_max;
+// The RDF only looks at pairs closer than hist_max
+RadialDistribution rdf(hist_min, hist_max, num_bins, RadialDistribution::SPATIAL, topts->nthreads);
+vector<GCoord> coords1(group1.size()), coords2(group2.size());
 
 // loop over the frames of the trajectory
 vector<uint> framelist = tropts->frameList();
 uint framecnt = framelist.size();
 double volume = 0.0;
-unsigned long unique_pairs=0;
 for (uint index = 0; index<framecnt; ++index)
     {
     traj->readFrame(framelist[index]);
@@ -166,34 +219,21 @@ for (uint index = 0; index<framecnt; ++index)
     GCoord box = system.periodicBox(); 
     volume += box.x() * box.y() * box.z();
 
-    unique_pairs = 0;
     // compute the distribution of g2 around g1 
     for (uint j = 0; j < group1.size(); j++)
         {
-        pAtom a1 = group1[j];
-        GCoord p1 = a1->coords();
-        for (uint k = 0; k < group2.size(); k++)
-            {
-            pAtom a2 = group2[k];
-            // skip "self" pairs 
-            if (a1 == a2)
-                {
-                continue;
-                }
-            unique_pairs++;
-            GCoord p2 = a2->coords();
-            // Compute the distance squared, taking periodicity into account
-            double d2 = p1.distance2(p2, box);
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist[bin]++;
-                }
-            }
+        coords1[j] = group1[j]->coords();
+        }
+    for (uint k = 0; k < group2.size(); k++)
+        {
+        coords2[k] = group2[k]->coords();
         }
+
+    rdf.accumulate(coords1, ids1, coords2, ids2, box);
     }
 
+const vector<double>& hist = rdf.histogram();
+
 volume /= framecnt;
 
 
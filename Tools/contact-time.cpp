@@ -103,12 +103,10 @@ string fullHelpMessage() {
     "\tTo get a correct fractional contact value, you will need to ensure that\n"
     "anything that can make a contact is included in the target list.  Alternatively,\n"
     "use the fcontacts tool.\n"
-    "\tBy default, contact-time uses a distance filter to eliminate\n"
-    "target atoms that are too far to be considered when looking\n"
-    "at each probe atom.  The padding for the radius used to\n"
-    "exclude target atoms can be adjusted with the '--fastpad' option.\n"
-    "In the unlikely event the filter causes problems, it can\n"
-    "be disabled with '--fast=0'.\n";
+    "\tAtoms are binned into a grid of cells each frame, so only target\n"
+    "atoms near a probe atom are ever examined.  This replaces the older\n"
+    "distance filter, so the '--fast' and '--fastpad' options are still\n"
+    "accepted but no longer have any effect.\n";
   
   return(s);
 }
@@ -139,8 +137,8 @@ public:
       ("outer", po::value<double>(&outer_cutoff)->default_value(outer_cutoff), "Outer cutoff (ignore atoms further away than this)")
       ("reimage", po::value<bool>(&symmetry)->default_value(symmetry), "Consider symmetry when computing distances")
       ("autoself", po::value<bool>(&auto_self)->default_value(auto_self), "Automatically include self-to-self")
-      ("fast", po::value<bool>(&fast_filter)->default_value(fast_filter), "Use the fast-filter method")
-      ("fastpad", po::value<double>(&fast_pad)->default_value(fast_pad), "Padding for the fast-filter method");
+      ("fast", po::value<bool>(&fast_filter)->default_value(fast_filter), "Use the fast-filter method (no longer used)")
+      ("fastpad", po::value<double>(&fast_pad)->default_value(fast_pad), "Padding for the fast-filter method (no longer used)");
   }
 
   void addHidden(po::options_description& o) {
@@ -199,77 +197,27 @@ public:
 
 
 
-uint contacts(const AtomicGroup& target, const AtomicGroup& probe, const double inner_radius, const double outer_radius, const bool symmetry) {
-  
-  double or2 = outer_radius * outer_radius;
-  double ir2 = inner_radius * inner_radius;
-
-  GCoord box = target.periodicBox();
-  uint contact = 0;
-
-  for (AtomicGroup::const_iterator j = probe.begin(); j != probe.end(); ++j) {
-    GCoord v = (*j)->coords();
-    
-    for (AtomicGroup::const_iterator i = target.begin(); i != target.end(); ++i) {
-      GCoord u = (*i)->coords();
-      double d = symmetry ? v.distance2(u, box) : v.distance2(u);
-      if (d >= ir2 && d <= or2)
-        ++contact;
-    }
-  }
-
-  return(contact);
-}
-
-
-AtomicGroup pickNearbyAtoms(const AtomicGroup& target, const AtomicGroup& probe, const double radius, const bool symmetry) {
+// The probe is split into molecules (rows), and the targets (followed
+// by the probe molecules themselves, for autoself) are the columns of
+// a ContactMap.  The number of contacts with a target is then the sum
+// of the atom pairs in its column, and the self contacts are the
+// unique pairs of distinct probe molecules.
+void frameContacts(ContactMap& map, const uint ntargets, const bool symmetry, const GCoord& box,
+                   vector<uint>& target_contacts, uint& self_contacts) {
+  if (symmetry)
+    map.update(box);
+  else
+    map.update();
 
-  GCoord c = probe.centroid();
-  GCoord box = probe.periodicBox();
-  double maxrad = probe.radius() + radius;
-  maxrad *= maxrad;
+  target_contacts.assign(ntargets, 0);
+  self_contacts = 0;
 
-  
-  AtomicGroup nearby;
-  nearby.periodicBox(probe.periodicBox());
-  for (AtomicGroup::const_iterator i = target.begin(); i != target.end(); ++i) {
-    double d = symmetry ? c.distance2((*i)->coords(), box) : c.distance2((*i)->coords());
-    if (d <= maxrad)
-      nearby.append(*i);
-  }
-
-  return(nearby);
-}
-
-
-uint fastContacts(const AtomicGroup& target, const vGroup& probes, const double inner, const double outer, const double fast_pad, const bool symmetry) {
-  uint total_contacts = 0;
-
-  
-  for (vGroup::const_iterator i = probes.begin(); i != probes.end(); ++i) {
-    AtomicGroup new_target = pickNearbyAtoms(target, *i, outer+fast_pad, symmetry);
-    uint c = contacts(new_target, *i, inner, outer, symmetry);
-    total_contacts += c;
-  }
-
-  return(total_contacts);
-}
-
-
-// Given a vector of groups, compute the number of contacts between
-// unique pairs of groups, excluding the self-to-self
-//
-// Note: this assumes that you want to compare the -ENTIRE- molecule
-uint autoSelfContacts(const vGroup& selves, const double inner_radius, const double outer_radius, const bool symmetry) {
-  
-  uint total_contact = 0;
-  uint n = selves.size();
-  for (uint j=0; j<n-1; ++j)
-    for (uint i=j+1; i<n; ++i) {
-      total_contact += contacts(selves[j], selves[i], inner_radius, outer_radius, symmetry);
-    }
-
-  return(total_contact);
+  const vector<ContactMap::Contact>& list = map.contacts();
+  for (vector<ContactMap::Contact>::const_iterator i = list.begin(); i != list.end(); ++i)
+    if (i->second < ntargets)
+      target_contacts[i->second] += i->pairs;
+    else if (i->second - ntargets > i->first)
+      self_contacts += i->pairs;
 }
 
 
@@ -357,14 +305,19 @@ int main(int argc, char *argv[]) {
   uint rows = indices.size();
   uint cols = targets.size() + 1;
 
-  // If comparing self, split apart molecules by unique segids
-  vGroup myselves;
-  if (topts->auto_self || topts->fast_filter) {
-    if (topts->auto_self)
-      ++cols;
-    myselves = probe.splitByUniqueSegid();
+  // Split apart molecules by unique segids (for comparing self)
+  vGroup myselves = probe.splitByUniqueSegid();
+  vGroup columns(targets);
+  if (topts->auto_self) {
+    ++cols;
+    columns.insert(columns.end(), myselves.begin(), myselves.end());
   }
 
+  ContactMap map(myselves, columns, topts->outer_cutoff);
+  map.innerCutoff(topts->inner_cutoff);
+  vector<uint> target_contacts;
+  uint self_contacts;
+
   uint t = 0;
   DoubleMatrix M(rows, cols);
 
@@ -386,18 +339,12 @@ int main(int argc, char *argv[]) {
     }
 
     M(t, 0) = t;
-    for (uint i=0; i<targets.size(); ++i) {
-      double d;
-      if (topts->fast_filter)
-        d = fastContacts(targets[i], myselves, topts->inner_cutoff, topts->outer_cutoff, topts->fast_pad, topts->symmetry);
-      else
-        d = contacts(targets[i], probe, topts->inner_cutoff, topts->outer_cutoff, topts->symmetry);
-
-      M(t, i+1) = d;
-    }
+    frameContacts(map, targets.size(), topts->symmetry, model.periodicBox(), target_contacts, self_contacts);
+    for (uint i=0; i<targets.size(); ++i)
+      M(t, i+1) = target_contacts[i];
 
     if (topts->auto_self)
-      M(t, cols-1) = autoSelfContacts(myselves, topts->inner_cutoff, topts->outer_cutoff, topts->symmetry);
+      M(t, cols-1) = self_contacts;
 
     ++t;
     if (bopts->verbosity)
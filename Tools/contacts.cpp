@@ -129,6 +129,17 @@ if (argc < 6)
 
 
 
+  // Self pairs (where the selections overlap) are excluded, so find
+  // them once up front
+  vector< vector<uint> > self_pairs(group1.size());
+  for (uint j=0; j<group1.size(); ++j)
+    for (uint k=0; k<group2.size(); ++k)
+      if (group1[j] == group2[k])
+        self_pairs[j].push_back(k);
+
+  PackedCoords centers;
+  vector<double> d2;
+
   cout << "#Frame\tPairs\tPerGroup1\tPerGroup2" << endl;
 
   // loop over the frames of the dcd file
@@ -138,29 +149,23 @@ if (argc < 6)
       // get the new coordinates
       traj->updateGroupCoords(model);
       int count = 0;
+      GCoord box = model.periodicBox();
 
       // compute the number of contacts between group1 center of mass 
       // and group2 center of mass
-      vector<AtomicGroup>::iterator first;
-      for (first=group1.begin(); first!=group1.end(); first++)
+      centers.assignCenters(group2);
+      for (uint j=0; j<group1.size(); ++j)
         {
-      GCoord com1 = first->centerOfMass();
+          GCoord com1 = group1[j].centerOfMass();
+          distance2(com1, centers, box, d2);
 
-      vector<AtomicGroup>::iterator second;
-      for (second=group2.begin(); second!=group2.end(); second++)
-            {
           // exclude self pairs 
-          if (*first == *second)
-                continue;
-
-          GCoord com2 = second->centerOfMass();
+          for (uint k=0; k<self_pairs[j].size(); ++k)
+            d2[self_pairs[j][k]] = -1.0;
 
-          double d2 = com1.distance2(com2, model.periodicBox());
-          if ( (d2 <= max2) )
-                {
-                count++;
-                }
-            }
+          for (uint k=0; k<d2.size(); ++k)
+            if (d2[k] >= 0.0 && d2[k] <= max2)
+              count++;
         }
     
       // Output the results
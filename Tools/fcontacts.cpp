@@ -190,90 +190,71 @@ typedef vector< vector<double> >      FContactsList;
 
 
 
-// Return a list of target atoms that are in contact with probe
-AtomicGroup contacts(const AtomicGroup& probe, const AtomicGroup& target, const double inner_radius, const double outer_radius, const bool symmetry) {
-  
-    double or2 = outer_radius * outer_radius;
-    double ir2 = inner_radius * inner_radius;
-
-    GCoord box = target.periodicBox();
-    AtomicGroup contacting_atoms;
-    
-
-    for (AtomicGroup::const_iterator j = probe.begin(); j != probe.end(); ++j) {
-        GCoord v = (*j)->coords();
-    
-        for (AtomicGroup::const_iterator i = target.begin(); i != target.end(); ++i) {
-            GCoord u = (*i)->coords();
-            double d = symmetry ? v.distance2(u, box) : v.distance2(u);
-            if (d >= ir2 && d <= or2)
-                contacting_atoms.append(*i);
-        }
-    }
-
-    return(contacting_atoms);
-}
-
-
-AtomicGroup pickNearbyAtoms(const AtomicGroup& probe, const AtomicGroup& target, const double radius, const bool symmetry) {
+// Counts the atoms around a probe atom that are within the shell,
+// skipping any that are excluded for the current probe.  Each contact
+// is also counted for every target the contacting atom belongs to.
+struct ShellCounter
+{
+    ShellCounter(const vector< vector<uint> >& membership_, const double inner_radius, vector<double>& counts_)
+        : membership(membership_), ir2(inner_radius * inner_radius), counts(counts_), excluded(0), total(0)
+        { }
 
-    GCoord c = probe.centroid();
-    GCoord box = probe.periodicBox();
-    double maxrad = probe.radius() + radius;
-    maxrad *= maxrad;
+    void operator()(const uint k, const double d2) {
+        if (d2 < ir2 || binary_search(excluded->begin(), excluded->end(), k))
+            return;
 
-  
-    AtomicGroup nearby;
-    nearby.periodicBox(probe.periodicBox());
-    for (AtomicGroup::const_iterator i = target.begin(); i != target.end(); ++i) {
-        double d = symmetry ? c.distance2((*i)->coords(), box) : c.distance2((*i)->coords());
-        if (d <= maxrad)
-            nearby.append(*i);
+        ++total;
+        for (vector<uint>::const_iterator i = membership[k].begin(); i != membership[k].end(); ++i)
+            counts[*i] += 1;
     }
 
-    return(nearby);
-}
-
-
-vector<double> fractionContactsToProbe(const AtomicGroup& probe,
-                                       const AtomicGroup& nearby,
-                                       const vGroup& targets,
-                                       const double inner_radius,
-                                       const double outer_radius,
-                                       const bool symmetry)
-{
+    const vector< vector<uint> >& membership;
+    double ir2;
+    vector<double>& counts;
+    const vector<uint>* excluded;
+    uint total;
+};
 
-    // First, find which nearby atoms are actually in contact...
-    AtomicGroup nearby_contacts = contacts(probe, nearby, inner_radius, outer_radius, symmetry);
 
-    vector<double> fracts(targets.size(), 0.0);
-    for (uint i=0; i<targets.size(); ++i) {
-        AtomicGroup target_nearby = nearby_contacts.intersect(targets[i], IdEquals());
-        if (nearby_contacts.empty())
-            fracts[i] = 0.0;
-        else 
-            fracts[i] = static_cast<double>(target_nearby.size()) / nearby_contacts.size();
-    }
-    return(fracts);
-}
 
-        
+// The system atoms are binned into a CellList, so only those near a
+// probe atom are ever looked at.  Excluded atoms and target
+// membership are given as indices into the system.
 FContactsList fractionContacts(const AtomicGroup& system,
                                const vGroup& probes,
-                               const vGroup& excludeds,
-                               const vGroup& targets,
+                               const vector< vector<uint> >& excluded,
+                               const vector< vector<uint> >& membership,
+                               const uint ntargets,
                                const double inner_radius,
                                const double outer_radius,
                                const bool symmetry) 
 {
+    vector<GCoord> coords(system.size());
+    for (uint i=0; i<system.size(); ++i)
+        coords[i] = system[i]->coords();
+
+    CellList cells(outer_radius);
+    if (symmetry)
+        cells.update(coords, system.periodicBox());
+    else
+        cells.update(coords);
 
     FContactsList fclist;
-    
+    vector<double> counts(ntargets);
+    ShellCounter counter(membership, inner_radius, counts);
+
     for (uint j=0; j<probes.size(); ++j) {
-        AtomicGroup nearby = pickNearbyAtoms(probes[j], excludeds[j], outer_radius, symmetry);
-        vector<double> v = fractionContactsToProbe(probes[j], nearby, targets,
-                                                   inner_radius, outer_radius, symmetry);
-        fclist.push_back(v);
+        counts.assign(ntargets, 0.0);
+        counter.excluded = &excluded[j];
+        counter.total = 0;
+        for (AtomicGroup::const_iterator i = probes[j].begin(); i != probes[j].end(); ++i)
+            cells.forEachNeighbor((*i)->coords(), counter);
+
+        vector<double> fracts(ntargets, 0.0);
+        if (counter.total != 0)
+            for (uint i=0; i<ntargets; ++i)
+                fracts[i] = counts[i] / counter.total;
+        fclist.push_back(fracts);
     }
 
     return(fclist);
@@ -281,6 +262,22 @@ FContactsList fractionContacts(const AtomicGroup& system,
 
 
 
+// Maps the atoms of a group to their indices in the system (by atomid)
+vector<uint> systemIndices(const map<int, uint>& index, const AtomicGroup& grp)
+{
+    vector<uint> indices;
+    for (AtomicGroup::const_iterator i = grp.begin(); i != grp.end(); ++i) {
+        map<int, uint>::const_iterator j = index.find((*i)->id());
+        if (j != index.end())
+            indices.push_back(j->second);
+    }
+    sort(indices.begin(), indices.end());
+    indices.erase(unique(indices.begin(), indices.end()), indices.end());
+    return(indices);
+}
+
+
+
 vector<double> average(const FContactsList& f) 
 {
     vector<double> avgs(f[0].size(), 0.0);
@@ -369,12 +366,21 @@ int main(int argc, char *argv[]) {
     } else
         excludes = myselves;
 
-    // This is system excluding requested probe atoms...
-    vGroup excludeds;
-    for (vGroup::iterator i = excludes.begin(); i != excludes.end(); ++i) {
-        AtomicGroup pruned = system;
-        pruned.remove(*i);
-        excludeds.push_back(pruned);
+    // Atoms of the system that are excluded for each probe, and which
+    // targets each atom of the system belongs to...
+    map<int, uint> system_index;
+    for (uint i=0; i<system.size(); ++i)
+        system_index.insert(pair<int, uint>(system[i]->id(), i));
+
+    vector< vector<uint> > excluded;
+    for (vGroup::iterator i = excludes.begin(); i != excludes.end(); ++i)
+        excluded.push_back(systemIndices(system_index, *i));
+
+    vector< vector<uint> > membership(system.size());
+    for (uint j=0; j<targets.size(); ++j) {
+        vector<uint> indices = systemIndices(system_index, targets[j]);
+        for (vector<uint>::const_iterator i = indices.begin(); i != indices.end(); ++i)
+            membership[*i].push_back(j);
     }
     
     
@@ -408,7 +414,7 @@ int main(int argc, char *argv[]) {
 
         M(t, 0) = *frame;
 
-        FContactsList fcl = fractionContacts(system, myselves, excludeds, targets, topts->inner_cutoff, topts->outer_cutoff, topts->symmetry);
+        FContactsList fcl = fractionContacts(system, myselves, excluded, membership, targets.size(), topts->inner_cutoff, topts->outer_cutoff, topts->symmetry);
         vector<double> avg = average(fcl);
         if (topts->report_stddev) {
             vector<double> stds = stddevs(fcl, avg);
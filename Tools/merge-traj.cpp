@@ -46,6 +46,15 @@ int downsample_rate;
 bool skip_first_frame=false;
 bool reimage_by_molecule=false;
 bool selection_split=false;
+uint nthreads;
+
+// set up in main() and shared by the recentering transforms
+bool full_recenter = false;
+bool xy_recenter = false;
+bool z_recenter = false;
+bool do_downsample = false;
+pTrajectoryWriter output_downsample;
+uint previous_frames = 0;
 
 
 // @cond TOOLS_INTERNAL
@@ -69,6 +78,7 @@ public:
       ("sort", po::value<bool>(&sort_flag)->default_value(false), "Sort (numerically) the input DCD files.")
       ("scanf", po::value<string>(&scanf_spec)->default_value(""), "Sort using a scanf-style format string")
       ("regex", po::value<string>(&regex_spec)->default_value("(\\d+)\\D*$"), "Sort using a regular expression")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use for recentering (0=all available)")
 
       ;
   }
@@ -93,12 +103,13 @@ public:
     {
     ostringstream oss;
 
-    oss << boost::format("downsample-dcd='%s', downsample-rate=%d, centering-selection='%s', skip-first-frame=%d, fix-imaging=%d")
+    oss << boost::format("downsample-dcd='%s', downsample-rate=%d, centering-selection='%s', skip-first-frame=%d, fix-imaging=%d, threads=%d")
       % output_traj_downsample
       % downsample_rate
       % center_selection
       % skip_first_frame
-      % reimage_by_molecule;
+      % reimage_by_molecule
+      % nthreads;
 
     return(oss.str());
     }
@@ -182,6 +193,11 @@ string fullHelpMessage(void)
 "                           for simulations in GROMACS.\n"
 "\n"
 "\n"
+"Recentering and reimaging can be done in parallel with the --threads\n"
+"option.  The default is 1 (non-parallel), and 0 will use as many threads\n"
+"as possible.  Frames are always written in order.\n"
+"\n"
+"\n"
 "In addition, for merging GROMACS XTC files there is an additional flag:\n"
 "\n"
 "--skip-first-frame         XTC files can contain the initial structure as\n"
@@ -326,6 +342,186 @@ vector<string> sortNamesByFormat(vector<string>& names, const FmtOp& op)
 
 
 
+// Per-frame recentering and reimaging.  Each pipeline thread gets its
+// own clone working on its own copy of the system.
+class MergeTransform : public FrameTransform
+{
+public:
+    MergeTransform(AtomicGroup& system) : system_(system)
+        {
+        if ( full_recenter )
+            {
+            center_ = selectAtoms(system_, center_selection);
+            }
+        else
+            {
+            if ( xy_recenter )
+                {
+                xy_center_ = selectAtoms(system_, xy_center_selection);
+                }
+            if ( z_recenter )
+                {
+                z_center_ = selectAtoms(system_, z_center_selection);
+                }
+            }
+
+        if ( full_recenter || xy_recenter || z_recenter || reimage_by_molecule )
+            {
+            if ( system_.hasBonds() )
+                {
+                molecules_ = ReimagingPlan(system_, system_.partitionByMoleculeById());
+                }
+            else
+                {
+                molecules_ = ReimagingPlan(system_, system_.partitionByUniqueSegid());
+                }
+            }
+        }
+
+    FrameTransform* clone(AtomicGroup& model) const
+        {
+        return(new MergeTransform(model));
+        }
+
+    AtomicGroup& transform(const uint frame);
+
+    // Frames arrive here in order, so the downsampled trajectory is
+    // written from here rather than from the worker threads
+    void written(const uint, const AtomicGroup& atoms)
+        {
+        if ( do_downsample && (previous_frames % downsample_rate == 0) )
+            {
+            output_downsample->writeFrame(atoms);
+            }
+        previous_frames++;
+        }
+
+private:
+    AtomicGroup system_;
+    AtomicGroup center_, xy_center_, z_center_;
+    ReimagingPlan molecules_;
+};
+
+
+
+AtomicGroup& MergeTransform::transform(const uint)
+{
+    // If molecules can be broken across image bondaries
+    // (eg GROMACS), then we may need 2 translations to 
+    // fix them -- first, translate the whole molecule such 
+    // that a single atom is at the origin, reimage the
+    // molecule, and put it back
+    if (reimage_by_molecule)
+        {
+        // This is relatively slow, so the plan skips the cases we
+        // know we won't need this -- 1 particle molecules and
+        // molecules that are within 1/2 of the smallest box
+        // dimension of their first atom.  Note that in certain
+        // perverse cases the centroid can be closer than 1/2 box to
+        // all atoms even when the molecule is split.
+        molecules_.fixImages(system_);
+        }
+
+
+    if ( full_recenter || xy_recenter || z_recenter)
+        {
+        // If the selection is split, then we effectively need to 
+        // do the centering twice.  First, we pick one atom from the
+        // centering selection, translate the entire system so it's
+        // at the origin, and reimage.  This will get the selection
+        // region to not be split on the image boundary.  At that 
+        // point, we can just do regular imaging.
+        if (selection_split)
+            {
+            GCoord centroid;
+            if (full_recenter)
+                {
+                centroid = center_[0]->coords();
+                }
+            else
+                {
+                if (xy_recenter)
+                    {
+                    centroid.x() = xy_center_[0]->coords().x();
+                    centroid.y() = xy_center_[0]->coords().y();
+                    }
+                if (z_recenter)
+                    {
+                    centroid.z() = z_center_[0]->coords().z();
+                    }
+                }
+
+            system_.translate(-centroid);
+
+            molecules_.reimage(system_);
+            }
+        // Now, do the regular imaging.  Put the system centroid 
+        // at the origin, and reimage by molecule
+        GCoord centroid;
+        if (full_recenter)
+            {
+            centroid = center_.centroid();
+            }
+        else
+            {
+            if (xy_recenter)
+                {
+                centroid = xy_center_.centroid();
+                centroid.z() = 0.0;
+                }
+            if (z_recenter)
+                {
+                centroid.z() = z_center_.centroid().z();
+                }
+            }
+        system_.translate(-centroid);
+
+        molecules_.reimage(system_);
+
+        // Sometimes if the box has drifted enough, reimaging by molecule
+        // will significantly alter the centroid of the selected system, so
+        // we need to center a second time, which perversely means we'll need
+        // to reimage again. In my tests, this second go around is 
+        // necessary and sufficient to fix everything, but I'm willing 
+        // to be proved wrong.
+
+        centroid.zero();
+        if (full_recenter)
+            {
+            centroid = center_.centroid();
+            }
+        else
+            {
+            if (xy_recenter)
+                {
+                centroid = xy_center_.centroid();
+                centroid.z() = 0.0;
+                }
+            if (z_recenter)
+                {
+                centroid.z() = z_center_.centroid().z();
+                }
+            }
+        system_.translate(-centroid);
+
+        molecules_.reimage(system_);
+#if DEBUG
+        cerr << "centroid after reimaging: " << centroid << endl;
+#endif
+
+        system_.translate(-centroid);
+
+#if DEBUG
+        centroid = center_.centroid();
+        cerr << "centroid after second reimaging: " << centroid << endl;
+#endif 
+        }
+
+    return(system_);
+}
+
+
+
 int main(int argc, char *argv[])
 {
     string hdr = invocationHeader(argc, argv);
@@ -363,9 +559,6 @@ int main(int argc, char *argv[])
     // We check for specifying both xy/z and full in the code
     // that processes the command line options, so we don't
     // have to do it here
-    bool full_recenter = false;
-    bool xy_recenter = false;
-    bool z_recenter = false;
     if ( center_selection.length() != 0 )
         {
         full_recenter = true;
@@ -380,45 +573,18 @@ int main(int argc, char *argv[])
         }
 
     pTrajectoryWriter output = createOutputTrajectory(output_traj, true);
+    output->bufferFrames(100);
 
-    pTrajectoryWriter output_downsample;
-    bool do_downsample = (output_traj_downsample.length() > 0);
+    do_downsample = (output_traj_downsample.length() > 0);
     if (do_downsample)
         {
         output_downsample = createOutputTrajectory(output_traj_downsample, true);
+        output_downsample->bufferFrames(100);
         }
 
     // Set up to do the recentering
-    vector<AtomicGroup> molecules;
-    AtomicGroup center, xy_center, z_center;
-    vector<AtomicGroup>::iterator m;
-    if ( full_recenter )
-        {
-        center = selectAtoms(system, center_selection);
-        }
-    else
-        {
-        if ( xy_recenter )
-            {
-            xy_center = selectAtoms(system, xy_center_selection);
-            }
-        if ( z_recenter )
-            {
-            z_center = selectAtoms(system, z_center_selection);
-            }
-        }
-
-    if ( full_recenter || xy_recenter || z_recenter || reimage_by_molecule )
-        {
-        if ( system.hasBonds() )
-            {
-            molecules = system.splitByMolecule();
-            }
-        else
-            {
-            molecules = system.splitByUniqueSegid();
-            }
-        }
+    MergeTransform transform(system);
+    TrajectoryPipeline pipeline(nthreads);
 
     uint original_num_frames = output->framesWritten();
     cout << "Target trajectory " 
@@ -428,7 +594,6 @@ int main(int argc, char *argv[])
          << " frames."
          << endl;
 
-    uint previous_frames = 0;
     vector<string>::iterator f;
     for (f=input_dcd_list.begin(); f!=input_dcd_list.end(); ++f)
         {
@@ -454,11 +619,7 @@ int main(int argc, char *argv[])
             // we need at least some of the data from this file
             {
             int frames_to_skip = original_num_frames - previous_frames;
-            if ( frames_to_skip > 0 )
-                {
-                traj->seekFrame(frames_to_skip-1);
-                }
-            else
+            if ( frames_to_skip < 0 )
                 {
                 frames_to_skip = 0;
                 }
@@ -466,9 +627,10 @@ int main(int argc, char *argv[])
             previous_frames += frames_to_skip;
 
             // if this is an xtc file, we need to skip 1 more frame
-            if (skip_first_frame)
+            vector<uint> frames;
+            for (uint i = frames_to_skip + (skip_first_frame ? 1 : 0); i < traj->nframes(); ++i)
                 {
-                traj->readFrame();
+                frames.push_back(i);
                 }
 
             cout << " ( " << previous_frames + nframes - frames_to_skip
@@ -477,158 +639,14 @@ int main(int argc, char *argv[])
                  << " frames."
                  << endl;
 
-            while ( traj->readFrame() )
+            try
                 {
-                traj->updateGroupCoords(system);
-
-                // Find the smallest box dimension
-                GCoord box = system.periodicBox();
-                double smallest=1e20;
-                for (int i=0; i<3; i++)
-                    {
-                    if (box[i] < smallest)
-                        {
-                        smallest = box[i];
-                        }
-                    }
-
-                smallest /=2.0;
-
-
-                // If molecules can be broken across image bondaries
-                // (eg GROMACS), then we may need 2 translations to 
-                // fix them -- first, translate the whole molecule such 
-                // that a single atom is at the origin, reimage the
-                // molecule, and put it back
-                if (reimage_by_molecule)
-                    {
-                    for (m=molecules.begin(); m != molecules.end(); ++m )
-                        {
-                        // This is relatively slow, so we'll skip the 
-                        // cases we know we won't need this -- 1 particle
-                        // molecules and molecules with small radii 
-                        // Note: radius(true) computes the max distance between atom 0
-                        //       and all other atoms in the group.  In certain perverse
-                        //       cases the centroid can be closer than 1/2 box to all atoms
-                        //       even when the molecule is split.
-                        if ( (m->size() > 1) && (m->radius(true) > smallest) )
-                            {
-                            m->mergeImage();
-                            m->reimage();
-                            }
-                        }
-                    }
-
-
-                if ( full_recenter || xy_recenter || z_recenter)
-                    {
-                    // If the selection is split, then we effectively need to 
-                    // do the centering twice.  First, we pick one atom from the
-                    // centering selection, translate the entire system so it's
-                    // at the origin, and reimage.  This will get the selection
-                    // region to not be split on the image boundary.  At that 
-                    // point, we can just do regular imaging.
-                    if (selection_split)
-                        {
-                        GCoord centroid;
-                        if (full_recenter)
-                            {
-                            centroid = center[0]->coords();
-                            }
-                        else
-                            {
-                            if (xy_recenter)
-                                {
-                                centroid.x() = xy_center[0]->coords().x();
-                                centroid.y() = xy_center[0]->coords().y();
-                                }
-                            if (z_recenter)
-                                {
-                                centroid.z() = z_center[0]->coords().z();
-                                }
-                            }
-
-                        system.translate(-centroid);
-
-                        for (m=molecules.begin(); m!=molecules.end(); m++)
-                            {
-                            m->reimage();
-                            }
-                        }
-                    // Now, do the regular imaging.  Put the system centroid 
-                    // at the origin, and reimage by molecule
-                    GCoord centroid;
-                    if (full_recenter)
-                        {
-                        centroid = center.centroid();
-                        }
-                    else
-                        {
-                        if (xy_recenter)
-                            {
-                            centroid = xy_center.centroid();
-                            centroid.z() = 0.0;
-                            }
-                        if (z_recenter)
-                            {
-                            centroid.z() = z_center.centroid().z();
-                            }
-                        }
-                    system.translate(-centroid);
-
-                    for (m=molecules.begin(); m != molecules.end(); ++m )
-                        {
-                        m->reimage();
-                        }
-
-                    // Sometimes if the box has drifted enough, reimaging by molecule
-                    // will significantly alter the centroid of the selected system, so
-                    // we need to center a second time, which perversely means we'll need
-                    // to reimage again. In my tests, this second go around is 
-                    // necessary and sufficient to fix everything, but I'm willing 
-                    // to be proved wrong.
-
-                    centroid.zero();
-                    if (full_recenter)
-                        {
-                        centroid = center.centroid();
-                        }
-                    else
-                        {
-                        if (xy_recenter)
-                            {
-                            centroid = xy_center.centroid();
-                            centroid.z() = 0.0;
-                            }
-                        if (z_recenter)
-                            {
-                            centroid.z() = z_center.centroid().z();
-                            }
-                        }
-                    system.translate(-centroid);
-
-                    for (m=molecules.begin(); m != molecules.end(); ++m )
-                        {
-                        m->reimage();
-                        }
-#if DEBUG
-                    cerr << "centroid after reimaging: " << centroid << endl;
-#endif
-
-                    system.translate(-centroid);
-
-#if DEBUG
-                    centroid = center.centroid();
-                    cerr << "centroid after second reimaging: " << centroid << endl;
-#endif 
-                    }
-
-                output->writeFrame(system);
-                if ( do_downsample && (previous_frames % downsample_rate == 0) )
-                    {
-                    output_downsample->writeFrame(system);
-                    }
-                previous_frames++;
+                pipeline.run(system, *traj, frames, transform, *output);
+                }
+            catch (LOOSError& e)
+                {
+                cerr << "Error- " << e.what() << endl;
+                exit(-1);
                 }
             }
 
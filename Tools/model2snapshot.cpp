@@ -0,0 +1,111 @@
+/*
+  model2snapshot
+
+  Writes any LOOS model as a binary system snapshot that can be
+  loaded without parsing
+
+*/
+
+
+
+
+/*
+
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <loos.hpp>
+
+using namespace std;
+using namespace loos;
+
+namespace opts = loos::OptionsFramework;
+namespace po = loos::OptionsFramework::po;
+
+
+// @cond TOOLS_INTERNAL
+
+
+
+string fullHelpMessage(void) {
+  string msg =
+    "\n"
+    "SYNOPSIS\n"
+    "\tConvert any LOOS model file to a binary snapshot\n"
+    "\n"
+    "DESCRIPTION\n"
+    "\n"
+    "\tReads in any LOOS model file and writes it out as a LOOS system\n"
+    "snapshot.  Snapshots hold all of the atom properties, connectivity, and\n"
+    "periodic box of the model in a binary form that loads much faster than\n"
+    "parsing the original file, which can help with very large systems.  Any\n"
+    "LOOS tool will read a snapshot in place of a model file so long as its\n"
+    "name ends in \".lsnap\".  Snapshots are not portable between machines\n"
+    "with different byte orders.\n"
+    "\n"
+    "\tAlternatively, if the LOOS_SNAPSHOT_CACHE environment variable is set\n"
+    "to a directory, snapshots of model files will automatically be made and\n"
+    "kept there, and used in place of the original model file until it\n"
+    "changes.\n"
+    "\n"
+    "EXAMPLES\n"
+    "\n"
+    "\tmodel2snapshot model.psf model.lsnap\n"
+    "Converts a PSF into a snapshot\n"
+    "\n"
+    "\tmodel2snapshot --coordinates model.pdb model.psf model.lsnap\n"
+    "Converts a PSF into a snapshot, taking coordinates from model.pdb\n"
+    "\n"
+    "\tmodel2snapshot --selection '!hydrogen' model.gro heavy.lsnap\n"
+    "Writes only the heavy atoms from a GROMACS .gro file\n"
+    "\n"
+    ;
+
+  return(msg);
+}
+
+
+// @endcond
+
+
+int main(int argc, char *argv[]) {
+  string hdr = invocationHeader(argc, argv);
+
+  opts::BasicOptions *bopts = new opts::BasicOptions(fullHelpMessage());
+  opts::BasicSelection* sopts = new opts::BasicSelection;
+  opts::ModelWithCoords* mwcopts = new opts::ModelWithCoords;
+  opts::RequiredArguments* ropts = new opts::RequiredArguments;
+  ropts->addArgument("output", "output-snapshot");
+
+  opts::AggregateOptions options;
+  options.add(bopts).add(sopts).add(mwcopts).add(ropts);
+  if (!options.parse(argc, argv))
+    exit(-1);
+
+  AtomicGroup subset = selectAtoms(mwcopts->model, sopts->selection);
+
+  try {
+    SystemSnapshot::write(ropts->value("output"), subset, hdr);
+  }
+  catch (exception& e) {
+    cerr << "Error- " << e.what() << endl;
+    exit(-1);
+  }
+}
@@ -219,7 +219,6 @@ AtomicGroup system = tropts->model;
 pTraj traj = tropts->trajectory;
 
 double cutoff = parseStringAs<double>(ropts->value("cut"));
-double cut2 = cutoff*cutoff;
 
 
 AtomicGroup sel = selectAtoms(system,  sopts->selection);
@@ -287,13 +286,10 @@ if (topts->use_periodicity && !system.isPeriodic())
     cerr << "but _will_ be used for the trajectory frames." << endl;
     }
 
-// Compute the centers of mass of the selections
+// Residues are compared by their centers of mass, using a ContactMap
+// so that only nearby pairs of residues are examined
 uint num_residues = residues.size();
-vector<GCoord> centers_of_mass(num_residues);
-for (uint i=0; i<num_residues; i++)
-    {
-    centers_of_mass[i] = residues[i].centerOfMass();
-    }
+ContactMap residue_map(residues, cutoff, ContactMap::CENTERS);
 
 vector<vector<uint> > contacts;
 vector<uint>total_contacts_per_residue(num_residues);
@@ -306,38 +302,48 @@ if (topts->exclude_consecutive)
     {
     step = 2;
     }
-// Find contacts within the threshold distance
-for (uint i=0; i<num_residues-step; i++)
+
+if (use_periodicity_for_reference)
+    {
+    residue_map.update(box);
+    }
+else
+    {
+    residue_map.update();
+    }
+
+// Find contacts within the threshold distance (the map is sorted
+// by residue, so these come out in the same order as a scan over
+// all pairs would give)
+const vector<ContactMap::Contact>& reference_contacts = residue_map.contacts();
+for (vector<ContactMap::Contact>::const_iterator c = reference_contacts.begin();
+     c != reference_contacts.end(); ++c)
     {
-    for (uint j=i+step; j< num_residues; j++)
+    uint i = c->first;
+    uint j = c->second;
+    if (j < i + step)
         {
-        GCoord diff = centers_of_mass[j] - centers_of_mass[i];
-        if (use_periodicity_for_reference)
-            {
-            diff.reimage(box);
-            }
-        if (diff.length2() <= cut2)
-            {
-            vector<uint> v(2);
-            v[0] = i;
-            v[1] = j;
-            contacts.push_back(v);
-            cout << "# " << (residues[i][0])->resid() << "\t"
-                         << (residues[j][0])->resid() << endl;
-            if (topts->do_output)
-                {
-                output << "# " << (residues[i][0])->resid() << "\t"
-                               << (residues[j][0])->resid() << endl;
+        continue;
+        }
 
-                }
+    vector<uint> v(2);
+    v[0] = i;
+    v[1] = j;
+    contacts.push_back(v);
+    cout << "# " << (residues[i][0])->resid() << "\t"
+                 << (residues[j][0])->resid() << endl;
+    if (topts->do_output)
+        {
+        output << "# " << (residues[i][0])->resid() << "\t"
+                       << (residues[j][0])->resid() << endl;
 
-            // Store the total number of contacts for each residue
-            if (topts->do_per_residue)
-                {
-                total_contacts_per_residue[i] += 1;
-                total_contacts_per_residue[j] += 1;
-                }
-            }
+        }
+
+    // Store the total number of contacts for each residue
+    if (topts->do_per_residue)
+        {
+        total_contacts_per_residue[i] += 1;
+        total_contacts_per_residue[j] += 1;
         }
     }
 
@@ -346,7 +352,7 @@ for (uint i=0; i<num_residues-step; i++)
 float num_native_contacts = (float) contacts.size();
 cout << "# Total native contacts: " << num_native_contacts << endl;
 
-bool is_periodic;
+bool is_periodic = false;
 if (topts->use_periodicity && traj->hasPeriodicBox())
     {
     is_periodic = true;
@@ -365,6 +371,14 @@ while (traj->readFrame())
     {
     traj->updateGroupCoords(system);
     box = system.periodicBox();
+    if (is_periodic)
+        {
+        residue_map.update(box);
+        }
+    else
+        {
+        residue_map.update();
+        }
 
     // Loop over contacts from the native structure
     int num_contacts = 0;
@@ -372,14 +386,7 @@ while (traj->readFrame())
         {
         uint r1 = p->at(0);
         uint r2 = p->at(1);
-        GCoord c1 = residues[r1].centerOfMass();
-        GCoord c2 = residues[r2].centerOfMass();
-        GCoord diff = c2 - c1;
-        if (is_periodic)
-            {
-            diff.reimage(box);
-            }
-        if (diff.length2() <= cut2)
+        if (residue_map.inContact(r1, r2))
             {
             num_contacts++;
             if (topts->do_output) output << "1\t";
@@ -669,11 +669,25 @@ if (block_average)
     }
 
 
+// All of the carbons are handled at once, so each block size takes a
+// single pass over the data
+fMultiTimeSeries series(values);
+vector<float> averages = series.average();
+vector<float> devs = series.stdev();
+
+vector<vector<float> > block_vars;
+if (block_average)
+    {
+    for (int j=2; j<ba_maxblocks; j++)
+        {
+        block_vars.push_back(series.block_var(j));
+        }
+    }
+
 for (unsigned int i = 0; i < selections.size(); i++)
     {
-    TimeSeries<float> t(values[i]);
-    double ave = t.average();
-    double dev = t.stdev();
+    double ave = averages[i];
+    double dev = devs[i];
     
     // get carbon number
     pAtom pa = selections[i].getAtom(0);
@@ -693,7 +707,7 @@ for (unsigned int i = 0; i < selections.size(); i++)
         {
         for (int j=2; j<ba_maxblocks; j++)
             {
-            float variance = t.block_var(j);
+            float variance = block_vars[j-2][i];
             float std_err = sqrt(variance/j);
 
             // The "plateau" region of many block averaging plots
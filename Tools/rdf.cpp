@@ -45,6 +45,7 @@ string split_by, split_by2;
 double hist_min, hist_max;
 int num_bins;
 int skip;
+uint nthreads;
 
 // @cond TOOLS_INTERNAL
 class ToolOptions : public opts::OptionsPackage
@@ -56,6 +57,7 @@ public:
     o.add_options()
       ("split-mode",po::value<string>(&split_by)->default_value("by-molecule"), "how to split the selections (by-residue, molecule, segment, none)")
       ("split-mode2",po::value<string>(&split_by2)->default_value("by-molecule"), "how to split the second selection (by-residue, molecule, segment, none)")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)")
       ;
   }
 
@@ -93,14 +95,15 @@ public:
   string print() const
   {
     ostringstream oss;
-    oss << boost::format("split-mode='%s', sel1='%s', sel2='%s', hist-min=%f, hist-max=%f, num-bins=%f, split-mode2='%'")
+    oss << boost::format("split-mode='%s', sel1='%s', sel2='%s', hist-min=%f, hist-max=%f, num-bins=%f, split-mode2='%', threads=%d")
       % split_by
       % selection1
       % selection2
       % hist_min
       % hist_max
       % num_bins
-      % split_by2;
+      % split_by2
+      % nthreads;
     return(oss.str());
   }
 };
@@ -142,6 +145,11 @@ string s =
     "which the radial distribution function is computed and the number of bins \n"
     "used.\n"
     "\n"
+    "Only pairs closer than histogram-max are looked at in each frame, so\n"
+    "the time taken grows linearly with the size of the system.  Each frame\n"
+    "can be split over several threads with the --threads option (0 will use\n"
+    "as many threads as are available).\n"
+    "\n"
     "EXAMPLE\n"
     "\n"
     "If the selection string looked like \n"
@@ -339,28 +347,29 @@ vector<uint> framelist = tropts->frameList();
 traj->readFrame(framelist[0]);
 traj->updateGroupCoords(system);
 
-// Create the histogram and zero it out
-vector<double> hist;
-hist.reserve(num_bins);
-hist.insert(hist.begin(), num_bins, 0.0);
-
-double min2 = hist_min*hist_min;
-double max2 = hist_max*hist_max;
-
 // Precompute the overlap between the two groups (this can be an
 // expensive operation, so it's better to have it outside the
-// while-loop)
+// while-loop).  Overlapping groups are given the same id, so the
+// RDF skips them as "self" pairs.
 
 unsigned long unique_pairs = 0;
-Math::Matrix<int, Math::RowMajor> group_overlap(g1_mols.size(), g2_mols.size());
+vector<uint> g1_ids(g1_mols.size()), g2_ids(g2_mols.size());
+for (uint i=0; i<g2_mols.size(); ++i)
+    {
+    g2_ids[i] = i;
+    }
 
 for (uint j=0; j<g1_mols.size(); ++j)
     {
+    g1_ids[j] = g2_mols.size() + j;
     for (uint i=0; i<g2_mols.size(); ++i)
       {
       bool b = (g1_mols[j] == g2_mols[i]);
-      group_overlap(j, i) = b;
-      if ( !b )
+      if ( b )
+        {
+          g1_ids[j] = i;
+        }
+      else
         {
           ++unique_pairs;
         }
@@ -368,6 +377,10 @@ for (uint j=0; j<g1_mols.size(); ++j)
     }
 
 
+// The RDF only looks at pairs closer than hist_max
+RadialDistribution rdf(hist_min, hist_max, num_bins, RadialDistribution::SPATIAL, nthreads);
+vector<GCoord> g1_centers(g1_mols.size()), g2_centers(g2_mols.size());
+
 // loop over the frames of the trajectory
 uint framecount = framelist.size();
 double volume = 0.0;
@@ -383,28 +396,18 @@ for (uint index = 0; index<framecount; ++index)
     // compute the distribution of g2 around g1 
     for (unsigned int j = 0; j < g1_mols.size(); j++)
         {
-        GCoord p1 = g1_mols[j].centerOfMass();
-        for (unsigned int k = 0; k < g2_mols.size(); k++)
-            {
-            // skip "self" pairs -- in case selection1 and selection2 overlap
-            if (group_overlap(j, k))
-                {
-                continue;
-                }
-            GCoord p2 = g2_mols[k].centerOfMass();
-            
-            // Compute the distance squared, taking periodicity into account
-            double d2 = p1.distance2(p2, box);
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist[bin]++;
-                }
-            }
+        g1_centers[j] = g1_mols[j].centerOfMass();
         }
+    for (unsigned int k = 0; k < g2_mols.size(); k++)
+        {
+        g2_centers[k] = g2_mols[k].centerOfMass();
+        }
+
+    rdf.accumulate(g1_centers, g1_ids, g2_centers, g2_ids, box);
     }
 
+const vector<double>& hist = rdf.histogram();
+
 volume /= framecount;
 
 
@@ -69,16 +69,94 @@ string fullHelpMessage(void)
 "and the selection string specifies a segment called PROT, presumably a \n"
 "protein molecule.  The \"A\" argument means that the selection\n"
 "is centered in all 3 dimensions.  \n"
+"\n"
+"recenter-trj model.psf traj.dcd 'segname == \"PROT\"' A output.dcd 4\n"
+"\n"
+"As above, but recenters frames using 4 threads.  The frames are still\n"
+"written in order.  The default is 1 thread, and 0 will use as many threads\n"
+"as possible.  Each thread works on its own copy of the model, so memory\n"
+"use will grow with the number of threads.\n"
     ;
     return(s);
     }
 
 string helpMessage()
     {
-    string s = string("Usage: recenter-trj model-file trajectory-file selection-string [Z|XY|A] dcd-name");
+    string s = string("Usage: recenter-trj model-file trajectory-file selection-string [Z|XY|A] dcd-name [threads]");
     return s;
     }
 
+
+// Recenters one frame.  Each pipeline thread gets its own clone
+// working on its own copy of the model.
+class RecenterTransform : public FrameTransform
+    {
+public:
+    RecenterTransform(AtomicGroup& model, const string& selection,
+                      const bool just_z, const bool just_xy) :
+        model_(model),
+        selection_(selection),
+        just_z_(just_z),
+        just_xy_(just_xy),
+        center_(selectAtoms(model_, selection_)),
+        molecules_(model_, model_.partitionByMoleculeById())
+        {
+        }
+
+    FrameTransform* clone(AtomicGroup& model) const
+        {
+        return(new RecenterTransform(model, selection_, just_z_, just_xy_));
+        }
+
+    AtomicGroup& transform(const uint frame);
+
+private:
+    // Zero the components we're not centering along
+    GCoord masked(GCoord centroid) const
+        {
+        if (just_z_)
+            {
+            centroid.x() = 0.0;
+            centroid.y() = 0.0;
+            }
+        else if (just_xy_)
+            {
+            centroid.z() = 0.0;
+            }
+        return(centroid);
+        }
+
+    AtomicGroup model_;
+    string selection_;
+    bool just_z_, just_xy_;
+    AtomicGroup center_;
+    ReimagingPlan molecules_;
+    };
+
+
+AtomicGroup& RecenterTransform::transform(const uint)
+    {
+    // Simple approach won't work if the centering selection is split
+    // across the periodic image.  In that case, the centroid may be near the 
+    // middle even if none of the atoms are near there.
+
+    // pick a single atom in the selection, and center based on it.
+    // This will make sure the selection is now _not_ split acrosst the 
+    // periodic image
+    GCoord centroid = masked(center_[0]->coords());
+    model_.translate(-centroid);
+    molecules_.reimage(model_);
+    
+    // now, center as we did in the original algorithm:
+    // Move the whole system such that selected region is at the origin and
+    // reimage
+    centroid = masked(center_.centroid());
+    model_.translate(-centroid);
+    molecules_.reimage(model_);
+
+    return(model_);
+    }
+
 int main(int argc, char *argv[])
 {
 
@@ -89,7 +167,7 @@ if ((argc > 1) && (string(argv[1]) == string("--fullhelp")))
     cerr << helpMessage() << endl;
     exit(-1);
     }
-else if (argc != 6)
+else if (argc != 6 && argc != 7)
     {
     cerr << helpMessage() << endl;
     exit(-1);
@@ -97,7 +175,6 @@ else if (argc != 6)
 
 AtomicGroup model = createSystem(argv[1]);
 pTraj traj = createTrajectory(argv[2], model);
-AtomicGroup center = selectAtoms(model, argv[3]);
 string flag = string(argv[4]);
 bool just_z = false;
 bool just_xy = false;
@@ -110,9 +187,16 @@ else if ( (flag == "XY") || (flag == "xy"))
     just_xy = true;
     }
 
+uint nthreads = 1;
+if (argc == 7)
+    {
+    nthreads = parseStringAs<uint>(argv[6]);
+    }
+
 
 pTrajectoryWriter traj_out = createOutputTrajectory(argv[5]);
 traj_out->setComments(invocationHeader(argc, argv));
+traj_out->bufferFrames(100);
 
 if (!model.hasBonds())
     {
@@ -124,58 +208,23 @@ if (!model.hasBonds())
     exit(-1);
     }
 
-vector<AtomicGroup> molecules= model.splitByMolecule();
-vector<AtomicGroup>::iterator m;
+RecenterTransform transform(model, argv[3], just_z, just_xy);
 
-while (traj->readFrame())
+vector<uint> frames;
+for (uint i=0; i<traj->nframes(); ++i)
     {
-    traj->updateGroupCoords(model); 
-
-    // Simple approach won't work if the centering selection is split
-    // across the periodic image.  In that case, the centroid may be near the 
-    // middle even if none of the atoms are near there.
-
-    // pick a single atom in the selection, and center based on it.
-    // This will make sure the selection is now _not_ split acrosst the 
-    // periodic image
-    GCoord centroid = center[0]->coords();
-    if (just_z)
-        {
-        centroid.x() = 0.0;
-        centroid.y() = 0.0;
-        }
-    else if (just_xy)
-        {
-        centroid.z() = 0.0;
-        }
-
-    model.translate(-centroid);
-    for (m=molecules.begin(); m!=molecules.end(); m++)
-        {
-        m->reimage();
-        }
-    
-    // now, center as we did in the original algorithm:
-    // Move the whole system such that selected region is at the origin and
-    // reimage
-    centroid = center.centroid();
-    if (just_z)
-        {
-        centroid.x() = 0.0;
-        centroid.y() = 0.0;
-        }
-    else if (just_xy)
-        {
-        centroid.z() = 0.0;
-        }
+    frames.push_back(i);
+    }
 
-    model.translate(-centroid);
-    for (m=molecules.begin(); m!=molecules.end(); m++)
-        {
-        m->reimage();
-        }
-    
-    traj_out->writeFrame(model);
+TrajectoryPipeline pipeline(nthreads);
+try
+    {
+    pipeline.run(model, *traj, frames, transform, *traj_out);
+    }
+catch (LOOSError& e)
+    {
+    cerr << "Error- " << e.what() << endl;
+    exit(-1);
     }
 
 }
@@ -157,18 +157,17 @@ int main(int argc, char *argv[])
   traj_out->setComments(hdr);
 
   // split the system by molecule
-  vector<AtomicGroup> molecules = model.splitByMolecule();
+  ReimagingPlan molecules(model, model.partitionByMoleculeById());
   cerr << "Found " << molecules.size() << " molecules.\n";
 
   // split the system by segid
-  vector<AtomicGroup> segments = model.splitByUniqueSegid();
+  ReimagingPlan segments(model, model.partitionByUniqueSegid());
   cerr << "Found " << segments.size() << " segments.\n";
 
   cerr << "Trajectory has " << traj->nframes() << " total frames.\n";
 
 
   // Loop over the frames of the dcd and reimage each molecule
-  vector<AtomicGroup>::iterator m;
   int frame_no = 0;
   cerr << "Frames processed - ";
   while (traj->readFrame())
@@ -183,14 +182,8 @@ int main(int argc, char *argv[])
       if (box_override)
         model.periodicBox(newbox);
 
-      for (m = segments.begin(); m != segments.end(); m++)
-        {
-          m->reimage();
-        }
-      for (m = molecules.begin(); m != molecules.end(); m++)
-        {
-          m->reimage();
-        }
+      segments.reimage(model);
+      molecules.reimage(model);
 
       traj_out->writeFrame(model);
     }
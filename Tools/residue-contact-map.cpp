@@ -108,43 +108,18 @@ public:
 
 
 
-void accumulateFrameUsingCenters(DoubleMatrix& M, const vGroup& residues, const double threshold) {
-  
-  for (uint j=1; j<residues.size(); ++j) {
-    GCoord v(residues[j].centerOfMass());
-
-    for (uint i=0; i<j; ++i)
-      if (v.distance2(residues[i].centerOfMass()) <= threshold) {
-        M(j, i) += 1;
-        M(i, j) += 1;
-      }
+// Residues are compared using a ContactMap, so only the pairs of atoms
+// (or centers) that are actually near each other are examined...
+void accumulateFrame(DoubleMatrix& M, ContactMap& contacts) {
+  contacts.update();
+
+  const vector<ContactMap::Contact>& list = contacts.contacts();
+  for (vector<ContactMap::Contact>::const_iterator i = list.begin(); i != list.end(); ++i) {
+    M(i->first, i->second) += 1;
+    M(i->second, i->first) += 1;
   }
 
-  for (uint i=0; i<residues.size(); ++i)
-    M(i, i) += 1;
-}
-
-
-void accumulateFrameUsingAllAtoms(DoubleMatrix& M, const vGroup& residues, const double threshold) {
-  
-  for (uint j=1; j<residues.size(); ++j) {
-    
-    for (uint i=0; i<j; ++i) {
-      bool flag = true;
-      for (AtomicGroup::const_iterator a = residues[j].begin(); a != residues[j].end() && flag; ++a)
-        for (AtomicGroup::const_iterator b = residues[i].begin(); b != residues[i].end(); ++b)
-          if ((*a)->coords().distance2((*b)->coords()) <= threshold) {
-            flag = false;
-            break;
-          }
-      if (!flag) {
-        M(j, i) += 1;
-        M(i, j) += 1;
-      }
-    }
-  }
-
-  for (uint i=0; i<residues.size(); ++i)
+  for (uint i=0; i<M.rows(); ++i)
     M(i, i) += 1;
 }
 
@@ -169,19 +144,17 @@ int main(int argc, char *argv[]) {
   vector<uint> indices = tropts->frameList();
 
   double thresh = parseStringAs<double>(ropts->value("threshold"));
-  thresh *= thresh;
 
   AtomicGroup subset = selectAtoms(model, sopts->selection);
   vGroup residues = subset.splitByResidue();
 
+  ContactMap contacts(residues, thresh, topts->use_centers ? ContactMap::CENTERS : ContactMap::MINIMUM);
+
   DoubleMatrix M(residues.size(), residues.size());
   for (vector<uint>::iterator i = indices.begin(); i != indices.end(); ++i) {
     traj->readFrame(*i);
     traj->updateGroupCoords(model);
-    if (topts->use_centers)
-      accumulateFrameUsingCenters(M, residues, thresh);
-    else
-      accumulateFrameUsingAllAtoms(M, residues, thresh);
+    accumulateFrame(M, contacts);
   }
 
   for (ulong i=0; i<residues.size() * residues.size(); ++i)
@@ -79,8 +79,6 @@ GCoord box;
 
 enum ReimageMode { NONE, NORMAL, AGGRESSIVE, ZEALOUS, EXTREME } reimage_mode;
 
-ulong extreme_iters = 0;
-double extreme_delta = 0.0;
 const uint extreme_max_iters = 250;
 const double extreme_threshold = 1e-1;
 
@@ -88,6 +86,8 @@ string center_selection;
 bool center_flag = false;
 string post_center_selection;
 
+uint nthreads = 1;
+
 
 
 // Code required for parsing trajectory filenames...
@@ -254,6 +254,9 @@ string fullHelpMessage(void) {
     "Writes out a DCD reimaging the system using the extreme method and centering\n"
     "(after reimaging) on the POPC membrane\n"
     "\n"
+    "\tsubsetter --threads=4 --reimage=aggressive --center='segid == \"PROT\"' out model.psf *.dcd\n"
+    "As above, but reimages using 4 threads.  Frames are still written in order.\n"
+    "\n"
     "NOTES\n"
     "\n"
     "\t* sorting *\n"
@@ -300,6 +303,13 @@ string fullHelpMessage(void) {
     "example above, to match the second set of digits, use a regular\n"
     "expression like \"run_\\d+_(\\d+).dcd\".\n"
     "\n"
+    "\t* threads *\n"
+    "\tCentering and reimaging can be done in parallel using the --threads\n"
+    "option.  The default is 1 (non-parallel).  Setting it to 0 will use as\n"
+    "many threads as possible.  Each thread works on its own copy of the\n"
+    "model, so memory use will grow with the number of threads.  Frames are\n"
+    "read and written in the same order as with a single thread.\n"
+    "\n"
     "SEE ALSO\n"
     "\tmerge-traj, reimage-by-molecule, recenter-trj\n"
     "\n";
@@ -317,6 +327,7 @@ public:
   void addGeneric(po::options_description& o) {
     o.add_options()
       ("updates", po::value<uint>(&verbose_updates)->default_value(100), "Frequency of verbose updates")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use for centering/reimaging (0=all available)")
       ("stride,i", po::value<uint>(&stride)->default_value(1), "Step through this number of frames in each trajectory")
       ("skip,k", po::value<uint>(&skip)->default_value(0), "Skip these frames at start of each trajectory")
       ("range,r", po::value<string>(&range_spec)->default_value(""), "Frames of the DCD to use (list of Octave-style ranges)")
@@ -401,8 +412,9 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("updates=%d, stride=%s, skip=%d, range='%s', box='%s', reimage='%s', center='%s', sort=%d, postcenter='%s'")
+    oss << boost::format("updates=%d, threads=%d, stride=%s, skip=%d, range='%s', box='%s', reimage='%s', center='%s', sort=%d, postcenter='%s'")
       % verbose_updates
+      % nthreads
       % stride
       % skip
       % range_spec
@@ -476,6 +488,185 @@ void showTrajectoryTable(MultiTrajectory& traj) {
 }
 
 
+typedef ProgressCounter<PercentTrigger, EstimatingCounter> Progress;
+
+
+// Handles the centering and reimaging for a frame.  Each pipeline
+// thread gets its own clone, working on its own copy of the model.
+// Clones fold their extreme reimaging stats back into the transform
+// they were cloned from when they are destroyed.
+
+class SubsetterTransform : public FrameTransform {
+public:
+  SubsetterTransform(AtomicGroup& model, const string& hdr, Progress* progress) :
+    model_(model), hdr_(hdr), progress_(progress), parent_(0), first_(true),
+    extreme_iters_(0), extreme_delta_(0.0)
+  {
+    select();
+  }
+
+  ~SubsetterTransform() {
+    if (parent_) {
+      parent_->extreme_iters_ += extreme_iters_;
+      parent_->extreme_delta_ += extreme_delta_;
+    }
+  }
+
+  FrameTransform* clone(AtomicGroup& model) const {
+    return(new SubsetterTransform(model, const_cast<SubsetterTransform*>(this)));
+  }
+
+  AtomicGroup& transform(const uint frame);
+  void written(const uint frame, const AtomicGroup& atoms);
+
+  const AtomicGroup& subset() const { return(subset_); }
+  const AtomicGroup& centered() const { return(centered_); }
+  const AtomicGroup& postcentered() const { return(postcentered_); }
+  uint molecules() const { return(molecules_.size()); }
+
+  ulong extremeIterations() const { return(extreme_iters_); }
+  double extremeDelta() const { return(extreme_delta_); }
+
+private:
+  SubsetterTransform(AtomicGroup& model, SubsetterTransform* parent) :
+    model_(model), hdr_(parent->hdr_), progress_(0), parent_(parent), first_(false),
+    extreme_iters_(0), extreme_delta_(0.0)
+  {
+    select();
+  }
+
+  void select() {
+    subset_ = selectAtoms(model_, selection);
+    if (!subset_.empty() && !center_selection.empty())
+      centered_ = selectAtoms(subset_, center_selection);
+    if (!subset_.empty() && !post_center_selection.empty())
+      postcentered_ = selectAtoms(subset_, post_center_selection);
+
+    if (reimage_mode != NONE) {
+      if (model_.hasBonds())
+        molecules_ = model_.splitByMolecule();
+      else
+        molecules_ = model_.splitByUniqueSegid();
+    }
+  }
+
+
+  AtomicGroup model_;
+  AtomicGroup subset_, centered_, postcentered_;
+  vGroup molecules_;
+  string hdr_;
+  Progress* progress_;
+  SubsetterTransform* parent_;
+  bool first_;
+  ulong extreme_iters_;
+  double extreme_delta_;
+};
+
+
+
+AtomicGroup& SubsetterTransform::transform(const uint) {
+
+  // Handle Periodic boundary conditions...
+  if (box_override)
+    model_.periodicBox(box);
+
+  // Handle centering...
+  if (center_flag) {
+    GCoord c = centered_.centroid();
+    model_.translate(-c);
+  }
+
+
+  if (reimage_mode != NONE) {
+    if (reimage_mode == AGGRESSIVE || reimage_mode == ZEALOUS) {
+      if (reimage_mode == ZEALOUS) {
+        for (vGroup::iterator mol = molecules_.begin(); mol != molecules_.end(); ++mol)
+          mol->mergeImage();
+      }
+      GCoord centroid = centered_[0]->coords();
+      model_.translate(-centroid);
+      for (vGroup::iterator mol = molecules_.begin(); mol != molecules_.end(); ++mol)
+        mol->reimage();
+
+      for (uint i=0; i<2; ++i) {
+        centroid = centered_.centroid();
+        model_.translate(-centroid);
+        for (vGroup::iterator mol = molecules_.begin(); mol != molecules_.end(); ++mol)
+          mol->reimage();
+      }
+
+    } else if (reimage_mode == EXTREME) {
+
+      for (vGroup::iterator mol = molecules_.begin(); mol != molecules_.end(); ++mol) {
+        uint midpoint = mol->size() / 2;
+        GCoord c = (*mol)[midpoint]->coords();
+        mol->translate(-c);
+        mol->reimageByAtom();
+        mol->translate(c);
+      }
+
+      GCoord last_c = centered_.centroid();
+      bool first = true;
+      uint si;
+      for (si = 0; si<extreme_max_iters; ++si) {
+        GCoord c = centered_.centroid();
+        if (!first) {
+          if (c.distance(last_c) < extreme_threshold)
+            break;
+        } else
+          first = false;
+        last_c = c;
+        model_.translate(-c);
+        for (vGroup::iterator mol = molecules_.begin(); mol != molecules_.end(); ++mol)
+          mol->reimage();
+      }
+
+      extreme_delta_ += (last_c.distance(centered_.centroid()));
+      GCoord c = centered_.centroid();
+      model_.translate(-c);
+      extreme_iters_ += si;
+
+    } else if (reimage_mode == NORMAL){
+      for (vGroup::iterator mol = molecules_.begin(); mol != molecules_.end(); ++mol)
+        mol->mergeImage();
+    } else {
+      throw(LOOSError("unknown reimage mode encountered"));
+    }
+
+    if (!post_center_selection.empty()) {
+      GCoord postcenter = postcentered_.centroid();
+      model_.translate(-postcenter);
+    }
+
+  }
+
+  return(subset_);
+}
+
+
+
+void SubsetterTransform::written(const uint, const AtomicGroup& atoms) {
+
+  // Pick off the first frame for the reference structure...
+  if (first_) {
+    PDB pdb = PDB::fromAtomicGroup(atoms.copy());
+    pdb.remarks().add(hdr_);
+
+    if (selection != "all")
+      pdb.pruneBonds();
+
+    string out_pdb_name = out_name + ".pdb";
+    ofstream ofs(out_pdb_name.c_str());
+    ofs << pdb;
+    ofs.close();
+    first_ = false;
+  }
+
+  if (progress_)
+    progress_->update();
+}
+
+
 // @endcond
 
 
@@ -505,30 +696,38 @@ int main(int argc, char *argv[]) {
 
   AtomicGroup model = createSystem(model_name);
   selection = sopts->selection;
-  AtomicGroup subset = selectAtoms(model, selection);
-  if (subset.empty()) {
+
+  // If reimaging, molecules are split out by each transform from the
+  // connectivity...
+  if (reimage_mode != NONE && !model.hasBonds()) {
+    cerr << "WARNING- the model has no connectivity.  Assigning bonds based on distance.\n";
+    model.findBonds();
+  }
+
+  // Setup for progress output...
+  PercentProgressWithTime watcher;
+  Progress slayer(PercentTrigger(0.25), EstimatingCounter(0));
+  slayer.attach(&watcher);
+
+  SubsetterTransform transform(model, hdr, verbose ? &slayer : 0);
+  if (transform.subset().empty()) {
     cerr << "Error- no atoms selected in subset\n";
     exit(-10);
   }
 
-  AtomicGroup centered;
-  if (!center_selection.empty()) {
-    centered = selectAtoms(subset, center_selection);
-    if (centered.empty()) {
-      cerr << "Error- no atoms selected for centering\n";
-      exit(-10);
-    }
+  if (!center_selection.empty() && transform.centered().empty()) {
+    cerr << "Error- no atoms selected for centering\n";
+    exit(-10);
   }
 
-  AtomicGroup postcentered;
-  if (!post_center_selection.empty()) {
-    postcentered = selectAtoms(subset, post_center_selection);
-    if (postcentered.empty()) {
-      cerr << "Error- no atoms selected for post-centering\n";
-      exit(-10);
-    }
+  if (!post_center_selection.empty() && transform.postcentered().empty()) {
+    cerr << "Error- no atoms selected for post-centering\n";
+    exit(-10);
   }
 
+  if (reimage_mode != NONE && verbose)
+    cout << boost::format("Reimaging %d molecules\n") % transform.molecules();
+
   MultiTrajectory mtraj(traj_names, model, skip, stride);
   if (verbose)
     showTrajectoryTable(mtraj);
@@ -537,149 +736,41 @@ int main(int argc, char *argv[]) {
   pTraj ptraj(&mtraj, boost::lambda::_1);
 
   indices = assignTrajectoryFrames(ptraj, topts->range_spec, 0, 1);
+  if (indices.empty())
+    exit(0);
 
   pTrajectoryWriter trajout = otopts->createTrajectory(out_name);
   if (trajout->hasComments())
     trajout->setComments(hdr);
+  trajout->bufferFrames(100);
 
-  bool first = true;  // Flag to pick off the first frame for a
-                      // reference structure
-
-  // If reimaging, break out the subsets to iterate over...
-  vector<AtomicGroup> molecules;
-  if (reimage_mode != NONE ) {
-    if (!model.hasBonds()) {
-      cerr << "WARNING- the model has no connectivity.  Assigning bonds based on distance.\n";
-      model.findBonds();
-    }
-
-    if (model.hasBonds())
-      molecules = model.splitByMolecule();
-    else
-      molecules = model.splitByUniqueSegid();
-
-    if (verbose)
-      cout << boost::format("Reimaging %d molecules\n") % molecules.size();
+  if (box_override) {
+    mtraj.readFrame(indices[0]);
+    mtraj.updateGroupCoords(model);
+    if (model.isPeriodic())
+      cerr << "WARNING - overriding existing periodic box.\n";
   }
 
-  // Setup for progress output...
-  PercentProgressWithTime watcher;
-  ProgressCounter<PercentTrigger, EstimatingCounter> slayer(PercentTrigger(0.25), EstimatingCounter(indices.size()));
-  slayer.attach(&watcher);
+  slayer.setExpected(indices.size());
   if (verbose)
     slayer.start();
 
   // Iterate over all requested global-frames...
-  for (vector<uint>::const_iterator vi = indices.begin(); vi != indices.end(); ++vi) {
-
-    mtraj.readFrame(*vi);
-    mtraj.updateGroupCoords(model);
-
-    // Handle Periodic boundary conditions...
-    if (box_override) {
-      if (first && subset.isPeriodic())
-        cerr << "WARNING - overriding existing periodic box.\n";
-      model.periodicBox(box);
-    }
-
-    // Handle centering...
-    if (center_flag) {
-      GCoord c = centered.centroid();
-      model.translate(-c);
-    }
-
-
-    if (reimage_mode != NONE) {
-      if (reimage_mode == AGGRESSIVE || reimage_mode == ZEALOUS) {
-        if (reimage_mode == ZEALOUS) {
-          for (vGroup::iterator mol = molecules.begin(); mol != molecules.end(); ++mol)
-            mol->mergeImage();
-        }
-        GCoord centroid = centered[0]->coords();
-        model.translate(-centroid);
-        for (vGroup::iterator mol = molecules.begin(); mol != molecules.end(); ++mol)
-          mol->reimage();
-
-        for (uint i=0; i<2; ++i) {
-          centroid = centered.centroid();
-          model.translate(-centroid);
-          for (vGroup::iterator mol = molecules.begin(); mol != molecules.end(); ++mol)
-            mol->reimage();
-        }
-
-      } else if (reimage_mode == EXTREME) {
-
-        for (vGroup::iterator mol = molecules.begin(); mol != molecules.end(); ++mol) {
-          uint midpoint = mol->size() / 2;
-          GCoord c = (*mol)[midpoint]->coords();
-          mol->translate(-c);
-          mol->reimageByAtom();
-          mol->translate(c);
-        }
-
-        GCoord last_c = centered.centroid();
-        bool first = true;
-        uint si;
-        for (si = 0; si<extreme_max_iters; ++si) {
-          GCoord c = centered.centroid();
-          if (!first) {
-            if (c.distance(last_c) < extreme_threshold)
-              break;
-          } else
-            first = false;
-          last_c = c;
-          model.translate(-c);
-          for (vGroup::iterator mol = molecules.begin(); mol != molecules.end(); ++mol)
-            mol->reimage();
-        }
-
-        extreme_delta += (last_c.distance(centered.centroid()));
-        GCoord c = centered.centroid();
-        model.translate(-c);
-        extreme_iters += si;
-
-      } else if (reimage_mode == NORMAL){
-        for (vGroup::iterator mol = molecules.begin(); mol != molecules.end(); ++mol)
-          mol->mergeImage();
-      } else {
-        cerr << "Error- unknown reimage mode (" << reimage_mode << ") encountered.\n";
-        exit(-10);
-      }
-
-      if (!post_center_selection.empty()) {
-        GCoord postcenter = postcentered.centroid();
-        model.translate(-postcenter);
-      }
-
-    }
-
-    trajout->writeFrame(subset);
-
-    // Pick off the first frame for the reference structure...
-    if (first) {
-      PDB pdb = PDB::fromAtomicGroup(subset.copy());
-      pdb.remarks().add(hdr);
-
-      if (selection != "all")
-        pdb.pruneBonds();
-
-      string out_pdb_name = out_name + ".pdb";
-      ofstream ofs(out_pdb_name.c_str());
-      ofs << pdb;
-      ofs.close();
-      first = false;
-    }
-
-    if (verbose)
-      slayer.update();
+  TrajectoryPipeline pipeline(nthreads);
+  try {
+    pipeline.run(model, mtraj, indices, transform, *trajout);
+  }
+  catch (LOOSError& e) {
+    cerr << "Error- " << e.what() << endl;
+    exit(-10);
   }
 
   if (verbose)
     slayer.finish();
 
   if (reimage_mode == EXTREME && verbose > 2) {
-    double avg = static_cast<double>(extreme_iters) / indices.size();
+    double avg = static_cast<double>(transform.extremeIterations()) / indices.size();
     cerr << boost::format("Average extreme reimage iters = %f\n") % avg;
-    cerr << boost::format("Average extreme reimage delta = %f\n") % (extreme_delta / indices.size());
+    cerr << boost::format("Average extreme reimage delta = %f\n") % (transform.extremeDelta() / indices.size());
   }
 }
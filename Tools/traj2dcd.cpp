@@ -6,7 +6,7 @@
 
   Usage:
 
-    traj2dcd model-file trajectory-file dcd-name
+    traj2dcd model-file trajectory-file dcd-name [threads]
 
 */
 
@@ -58,6 +58,11 @@ string fullHelpMessage(void) {
     "\ttraj2dcd model.gro simulation.xtc simulation.dcd\n"
     "Convert the GROMACS XTC trajectory into the DCD format.\n"
     "\n"
+    "\ttraj2dcd model.gro simulation.xtc simulation.dcd 2\n"
+    "As above, but decoding the XTC frames and writing the DCD frames in\n"
+    "separate threads.  The default is 1 (frames are read and then written\n"
+    "in turn), and 0 will use as many threads as possible.\n"
+    "\n"
     "SEE ALSO\n"
     "\tsubsetter, merge-traj, recenter-traj, reimage-by-molecule\n";
 
@@ -66,9 +71,26 @@ string fullHelpMessage(void) {
 
 
 
+// Frames are written unchanged, so this just tracks progress
+struct ConvertTransform : public FrameTransform {
+  ConvertTransform(AtomicGroup& model) : model_(model) { }
+
+  FrameTransform* clone(AtomicGroup& model) const { return(new ConvertTransform(model)); }
+  AtomicGroup& transform(const uint) { return(model_); }
+
+  void written(const uint frame, const AtomicGroup&) {
+    if (frame % 250 == 0)
+      cerr << '.';
+  }
+
+  AtomicGroup model_;
+};
+
+
+
 int main(int argc, char *argv[]) {
-  if (argc != 4) {
-    cerr << "Usage - traj2dcd model trajectory dcd\n";
+  if (argc != 4 && argc != 5) {
+    cerr << "Usage - traj2dcd model trajectory dcd [threads]\n";
     cerr << fullHelpMessage();
     exit(-1);
   }
@@ -76,25 +98,32 @@ int main(int argc, char *argv[]) {
   AtomicGroup model = createSystem(argv[1]);
   pTraj traj = createTrajectory(argv[2], model);
   uint n = traj->nframes();
+  uint nthreads = (argc == 5) ? parseStringAs<uint>(argv[4]) : 1;
 
   DCDWriter dcd(argv[3]);
   dcd.setHeader(model.size(), n, 1e-3, traj->hasPeriodicBox());
   dcd.setTitle(invocationHeader(argc, argv));
   dcd.writeHeader();
+  dcd.bufferFrames(100);
 
   cerr << boost::format("There are %d atoms and %d frames.\n") % model.size() % n;
 
   cerr << "Processing - ";
   cerr.flush();
 
-  for (uint i=0; i<n; ++i) {
-    if (i % 250 == 0)
-      cerr << '.';
-    traj->readFrame(i);
-    traj->updateGroupCoords(model);
-    dcd.writeFrame(model);
+  vector<uint> frames(n);
+  for (uint i=0; i<n; ++i)
+    frames[i] = i;
+
+  ConvertTransform transform(model);
+  TrajectoryPipeline pipeline(nthreads);
+  try {
+    pipeline.run(model, *traj, frames, transform, dcd);
   }
-  
+  catch (LOOSError& e) {
+    cerr << "Error- " << e.what() << endl;
+    exit(-1);
+  }
+
   cerr << " done\n";
 }
-
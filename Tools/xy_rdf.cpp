@@ -43,6 +43,7 @@ int timeseries_interval;
 string output_directory;
 bool sel1_spans, sel2_spans;
 bool reselect_leaflet = false;
+uint nthreads;
 
 
 // @cond TOOLS_INTERNAL
@@ -59,6 +60,7 @@ public:
       ("sel1-spans", "Selection 1 appears in both leaflets")
       ("sel2-spans", "Selection 2 appears in both leaflets")
       ("reselect", "Recompute leaflet location for each frame")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)")
        ;
 
   }
@@ -119,7 +121,7 @@ public:
   string print() const
   {
     ostringstream oss;
-    oss << boost::format("split-mode='%s', sel1='%s', sel2='%s', hist-min=%f, hist-max=%f, num-bins=%f, timeseries=%d, timeseries-directory='%s', sel1-spans=%d, sel2-spans=%d reselect=%d")
+    oss << boost::format("split-mode='%s', sel1='%s', sel2='%s', hist-min=%f, hist-max=%f, num-bins=%f, timeseries=%d, timeseries-directory='%s', sel1-spans=%d, sel2-spans=%d reselect=%d, threads=%d")
       % split_by
       % selection1
       % selection2
@@ -130,7 +132,8 @@ public:
       % output_directory
       % sel1_spans
       % sel2_spans
-      % reselect_leaflet;
+      % reselect_leaflet
+      % nthreads;
     return(oss.str());
   }
 
@@ -216,6 +219,11 @@ string s =
     "overhead, but is necessary if you're dealing with molecules that \n"
     "can flip from one leaflet to the other.\n"
     "\n"
+    "Only pairs closer than histogram-max are looked at in each frame, so\n"
+    "the time taken grows linearly with the size of the system.  Each frame\n"
+    "can be split over several threads with the --threads option (0 will use\n"
+    "as many threads as are available).\n"
+    "\n"
     "EXAMPLE\n"
     "\n"
     "To look at the distribution of PE lipid headgroups in a lipid\n"
@@ -252,18 +260,27 @@ string s =
     return (s);
     }
 
+// Each molecule carries an id along with it into its leaflet, so
+// "self" pairs can still be found after the leaflets are split
 void assign_leaflet(vector<AtomicGroup> &molecules,
+                    const vector<uint> &ids,
                     vector<AtomicGroup> &upper,
+                    vector<uint> &upper_ids,
                     vector<AtomicGroup> &lower,
+                    vector<uint> &lower_ids,
                     const bool spans
                     )
     {
     upper.clear();
     lower.clear();
+    upper_ids.clear();
+    lower_ids.clear();
     if (spans)
         {
         upper = molecules;
         lower = molecules;
+        upper_ids = ids;
+        lower_ids = ids;
         return;
         }
 
@@ -273,14 +290,26 @@ void assign_leaflet(vector<AtomicGroup> &molecules,
         if (c.z() >=0.0)
             {
             upper.push_back(molecules[i]);
+            upper_ids.push_back(ids[i]);
             }
         else
             {
             lower.push_back(molecules[i]);
+            lower_ids.push_back(ids[i]);
             }
         }
     }
 
+void centers_of_mass(const vector<AtomicGroup> &molecules,
+                     vector<GCoord> &centers)
+    {
+    centers.resize(molecules.size());
+    for (unsigned int i = 0; i < molecules.size(); i++)
+        {
+        centers[i] = molecules[i].centerOfMass();
+        }
+    }
+
 int main (int argc, char *argv[])
 {
 
@@ -347,6 +376,26 @@ else if (split == BY_SEGMENT)
     g2_mols = group2.splitByUniqueSegid();
     }
 
+// Molecules in both selections are given the same id, so the RDF
+// skips them as "self" pairs
+vector<uint> g1_ids(g1_mols.size()), g2_ids(g2_mols.size());
+for (unsigned int k = 0; k < g2_mols.size(); k++)
+    {
+    g2_ids[k] = k;
+    }
+for (unsigned int j = 0; j < g1_mols.size(); j++)
+    {
+    g1_ids[j] = g2_mols.size() + j;
+    for (unsigned int k = 0; k < g2_mols.size(); k++)
+        {
+        if (g1_mols[j] == g2_mols[k])
+            {
+            g1_ids[j] = k;
+            break;
+            }
+        }
+    }
+
 // read the initial coordinates into the system
 traj->updateGroupCoords(system);
 
@@ -355,27 +404,28 @@ traj->updateGroupCoords(system);
 // coordinates are properly centered and imaged.
 vector<AtomicGroup> g1_upper, g1_lower;
 vector<AtomicGroup> g2_upper, g2_lower;
+vector<uint> g1_upper_ids, g1_lower_ids;
+vector<uint> g2_upper_ids, g2_lower_ids;
 
-assign_leaflet(g1_mols, g1_upper, g1_lower, sel1_spans);
-assign_leaflet(g2_mols, g2_upper, g2_lower, sel2_spans);
+assign_leaflet(g1_mols, g1_ids, g1_upper, g1_upper_ids, g1_lower, g1_lower_ids, sel1_spans);
+assign_leaflet(g2_mols, g2_ids, g2_upper, g2_upper_ids, g2_lower, g2_lower_ids, sel2_spans);
 
 
-// Create 2 histograms -- one for top, one for bottom
+// Create 2 lateral RDFs -- one for top, one for bottom -- which
+// only look at pairs closer than hist_max
 // Also create 2 histograms to store the total
-vector<double> hist_lower, hist_upper;
+RadialDistribution rdf_lower(hist_min, hist_max, num_bins, RadialDistribution::LATERAL, nthreads);
+RadialDistribution rdf_upper(hist_min, hist_max, num_bins, RadialDistribution::LATERAL, nthreads);
+const vector<double>& hist_lower = rdf_lower.histogram();
+const vector<double>& hist_upper = rdf_upper.histogram();
 vector<double> hist_lower_total, hist_upper_total;
-hist_lower.reserve(num_bins);
-hist_upper.reserve(num_bins);
 hist_lower_total.reserve(num_bins);
 hist_upper_total.reserve(num_bins);
-hist_lower.insert(hist_lower.begin(), num_bins, 0.0);
-hist_upper.insert(hist_upper.begin(), num_bins, 0.0);
 hist_lower_total.insert(hist_lower_total.begin(), num_bins, 0.0);
 hist_upper_total.insert(hist_upper_total.begin(), num_bins, 0.0);
 
-
-double min2 = hist_min*hist_min;
-double max2 = hist_max*hist_max;
+// Centers of mass of the molecules in each leaflet
+vector<GCoord> g1_centers, g2_centers;
 
 // loop over the frames of the traj file
 double area = 0.0;
@@ -400,65 +450,25 @@ for (uint index = 0; index<framecnt; ++index)
 
     if (reselect_leaflet)
         {
-        assign_leaflet(g1_mols, g1_upper, g1_lower, sel1_spans);
-        assign_leaflet(g2_mols, g2_upper, g2_lower, sel2_spans);
+        assign_leaflet(g1_mols, g1_ids, g1_upper, g1_upper_ids, g1_lower, g1_lower_ids, sel1_spans);
+        assign_leaflet(g2_mols, g2_ids, g2_upper, g2_upper_ids, g2_lower, g2_lower_ids, sel2_spans);
         }
 
     // compute the distribution of g2 around g1 for the lower leaflet
-    for (unsigned int j = 0; j < g1_lower.size(); j++)
-        {
-        GCoord p1 = g1_lower[j].centerOfMass();
-        for (unsigned int k = 0; k < g2_lower.size(); k++)
-            {
-            // skip "self" pairs
-            if (g1_lower[j] == g2_lower[k])
-                {
-                continue;
-                }
-
-            cum_lower_pairs++;
-            interval_lower_pairs++;
-
-            GCoord p2 = g2_lower[k].centerOfMass();
-            GCoord displ = (p2 - p1);
-            displ.reimage(box);
-            double d2 = (displ.x() * displ.x()) + (displ.y() * displ.y());
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist_lower[bin]++;
-                }
-            }
-        }
+    centers_of_mass(g1_lower, g1_centers);
+    centers_of_mass(g2_lower, g2_centers);
+    uint lower_pairs = rdf_lower.accumulate(g1_centers, g1_lower_ids,
+                                            g2_centers, g2_lower_ids, box);
+    cum_lower_pairs += lower_pairs;
+    interval_lower_pairs += lower_pairs;
 
     // compute the distribution of g2 around g1 for the upper leaflet
-    for (unsigned int j = 0; j < g1_upper.size(); j++)
-        {
-        GCoord p1 = g1_upper[j].centerOfMass();
-        for (unsigned int k = 0; k < g2_upper.size(); k++)
-            {
-            // skip "self" pairs
-            if (g1_upper[j] == g2_upper[k])
-                {
-                continue;
-                }
-
-            cum_upper_pairs++;
-            interval_lower_pairs++;
-
-            GCoord p2 = g2_upper[k].centerOfMass();
-            GCoord displ = (p2 - p1);
-            displ.reimage(box);
-            double d2 = (displ.x() * displ.x()) + (displ.y() * displ.y());
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist_upper[bin]++;
-                }
-            }
-        }
+    centers_of_mass(g1_upper, g1_centers);
+    centers_of_mass(g2_upper, g2_centers);
+    uint upper_pairs = rdf_upper.accumulate(g1_centers, g1_upper_ids,
+                                            g2_centers, g2_upper_ids, box);
+    cum_upper_pairs += upper_pairs;
+    interval_upper_pairs += upper_pairs;
 
 
     // if requested, write out timeseries as well
@@ -523,8 +533,8 @@ for (uint index = 0; index<framecnt; ++index)
             }
 
         // rezero the histograms
-        hist_upper.assign(num_bins, 0.0);
-        hist_lower.assign(num_bins, 0.0);
+        rdf_upper.clear();
+        rdf_lower.clear();
 
         // zero out the area
         interval_area = 0.0;
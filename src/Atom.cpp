@@ -22,12 +22,29 @@
 #include <Atom.hpp>
 #include <algorithm>
 #include <boost/format.hpp>
+#include <boost/atomic.hpp>
 
 namespace loos {
 
+  namespace {
+    boost::atomic<unsigned long> id_stamp(0);
+  }
+
   int Atom::id(void) const { return(_id); }
   void Atom::id(const int i) { _id = i; }
 
+  unsigned long Atom::idStamp(void) { return(id_stamp.load(boost::memory_order_acquire)); }
+
+  // Assigning the same id (as when copying an atom over a copy of
+  // itself) doesn't need to disturb anyone's cached lookups
+  Atom::StampedId& Atom::StampedId::operator=(const int i) {
+    if (i != _value) {
+      _value = i;
+      id_stamp.fetch_add(1, boost::memory_order_acq_rel);
+    }
+    return(*this);
+  }
+
   uint Atom::index(void) const 
   {
     return(_index);
@@ -50,26 +67,26 @@ namespace loos {
     setPropertyBit(anumbit);
   }
 
-  std::string Atom::name(void) const { return(_name); }
-  void Atom::name(const std::string s) { _name = s; }
+  const std::string& Atom::name(void) const { return(_name.str()); }
+  void Atom::name(const std::string s) { _name = InternedString(s); }
 
-  std::string Atom::altLoc(void) const { return(_altloc); }
-  void Atom::altLoc(const std::string s) { _altloc = s; }
+  const std::string& Atom::altLoc(void) const { return(_altloc.str()); }
+  void Atom::altLoc(const std::string s) { _altloc = InternedString(s); }
 
-  std::string Atom::chainId(void) const { return(_chainid); }
-  void Atom::chainId(const std::string s) { _chainid = s; }
+  const std::string& Atom::chainId(void) const { return(_chainid.str()); }
+  void Atom::chainId(const std::string s) { _chainid = InternedString(s); }
 
-  std::string Atom::resname(void) const { return(_resname); }
-  void Atom::resname(const std::string s) { _resname = s; }
+  const std::string& Atom::resname(void) const { return(_resname.str()); }
+  void Atom::resname(const std::string s) { _resname = InternedString(s); }
 
-  std::string Atom::segid(void) const { return(_segid); }
-  void Atom::segid(const std::string s) { _segid = s; }
+  const std::string& Atom::segid(void) const { return(_segid.str()); }
+  void Atom::segid(const std::string s) { _segid = InternedString(s); }
 
-  std::string Atom::iCode(void) const { return(_icode); }
-  void Atom::iCode(const std::string s) { _icode = s; }
+  const std::string& Atom::iCode(void) const { return(_icode.str()); }
+  void Atom::iCode(const std::string s) { _icode = InternedString(s); }
 
-  std::string Atom::PDBelement(void) const { return(_pdbelement); }
-  void Atom::PDBelement(const std::string s) { _pdbelement = s; }
+  const std::string& Atom::PDBelement(void) const { return(_pdbelement.str()); }
+  void Atom::PDBelement(const std::string s) { _pdbelement = InternedString(s); }
 
   const GCoord& Atom::coords(void) const { return(_coords); }
   GCoord& Atom::coords(void) { setPropertyBit(coordsbit); return(_coords); }
@@ -102,8 +119,8 @@ namespace loos {
     //! Recordname imported from the PDB for this Atom
     //! This is mainly for atoms that come from a PDB, i.e. whether or
     //! not they were an ATOM or a HETATM
-  std::string Atom::recordName(void) const { return(_record); }
-  void Atom::recordName(const std::string s) { _record = s; }
+  const std::string& Atom::recordName(void) const { return(_record.str()); }
+  void Atom::recordName(const std::string s) { _record = InternedString(s); }
 
     //! Clear all stored bonds
   void Atom::clearBonds(void) { bonds.clear(); clearPropertyBit(bondsbit); }
@@ -187,7 +204,7 @@ namespace loos {
 
 
   void Atom::init() {
-    _id = 1;
+    _id.init(1);
     _index = 0;
     _resid = 1;
     _atomic_number = -1;
@@ -195,13 +212,17 @@ namespace loos {
     _q = 1.0;
     _charge = 0.0;
     _mass = 1.0;
-    _name = "    ";
-    _altloc = " ";
-    _resname = "   ";
-    _chainid = " ";
-    _segid = "    ";
-    _pdbelement = "";
-    _record = "ATOM";
+
+    // Look the defaults up only once...
+    static const InternedString blank1(" "), blank3("   "), blank4("    "), record("ATOM");
+
+    _name = blank4;
+    _altloc = blank1;
+    _resname = blank3;
+    _chainid = blank1;
+    _segid = blank4;
+    _pdbelement = InternedString();
+    _record = record;
     _atom_type = -1;
     mask = nullbit;   // Nullbit means nothing was set...
   }
@@ -233,19 +254,19 @@ namespace loos {
 
 
   bool AtomEquals::operator()(const pAtom& a, const pAtom& b) const {
-    return(a->name() == b->name()
+    return(a->internedName() == b->internedName()
            && a->id() == b->id()
-           && a->resname() == b->resname()
+           && a->internedResname() == b->internedResname()
            && a->resid() == b->resid()
-           && a->segid() == b->segid());
+           && a->internedSegid() == b->internedSegid());
   }
 
   bool AtomCoordsEquals::operator()(const pAtom& a, const pAtom& b) const {
-    bool bb = (a->name() == b->name()
+    bool bb = (a->internedName() == b->internedName()
                && a->id() == b->id()
-               && a->resname() == b->resname()
+               && a->internedResname() == b->internedResname()
                && a->resid() == b->resid()
-               && a->segid() == b->segid());
+               && a->internedSegid() == b->internedSegid());
     if (!bb)
       return(false);
 
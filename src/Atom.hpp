@@ -32,6 +32,7 @@
 #include <loos_defs.hpp>
 #include <exceptions.hpp>
 #include <Coord.hpp>
+#include <InternedString.hpp>
 
 namespace loos {
 
@@ -90,8 +91,8 @@ namespace loos {
     Atom(const int i, const std::string s, const GCoord& c) {
       init();
       _index = 0;
-      _id = i;
-      _name = s;
+      _id.init(i);
+      _name = InternedString(s);
       _coords = c;
     }
 
@@ -102,6 +103,15 @@ namespace loos {
     int id(void) const;
     void id(const int);
 
+    //! Counts changes to the atomid of any atom
+    /**
+     * This changes whenever some atom's atomid is changed (including
+     * by copying one Atom over another), so a cached lookup by atomid
+     * that was checked at one stamp is still good while the stamp
+     * stays the same.
+     */
+    static unsigned long idStamp(void);
+
     uint index(void) const;
     void index(const uint i);
   
@@ -111,27 +121,59 @@ namespace loos {
     int atomic_number(void) const;
     void atomic_number(const int);
 
-    std::string name(void) const;
+    const std::string& name(void) const;
     void name(const std::string);
 
-    std::string altLoc(void) const;
+    const std::string& altLoc(void) const;
     void altLoc(const std::string);
 
-    std::string chainId(void) const;
+    const std::string& chainId(void) const;
     void chainId(const std::string);
 
-    std::string resname(void) const;
+    const std::string& resname(void) const;
     void resname(const std::string);
 
-    std::string segid(void) const;
+    const std::string& segid(void) const;
     void segid(const std::string);
 
-    std::string iCode(void) const;
+    const std::string& iCode(void) const;
     void iCode(const std::string);
 
-    std::string PDBelement(void) const;
+    const std::string& PDBelement(void) const;
     void PDBelement(const std::string);
 
+#if !defined(SWIG)
+    //! Interned versions of the string properties
+    /**
+     * These can be compared for equality much faster than the strings
+     * themselves (see InternedString), and setting them avoids looking
+     * the string up in the pool again.
+     */
+    InternedString internedName(void) const { return(_name); }
+    void name(const InternedString& s) { _name = s; }
+
+    InternedString internedResname(void) const { return(_resname); }
+    void resname(const InternedString& s) { _resname = s; }
+
+    InternedString internedSegid(void) const { return(_segid); }
+    void segid(const InternedString& s) { _segid = s; }
+
+    InternedString internedAltLoc(void) const { return(_altloc); }
+    void altLoc(const InternedString& s) { _altloc = s; }
+
+    InternedString internedChainId(void) const { return(_chainid); }
+    void chainId(const InternedString& s) { _chainid = s; }
+
+    InternedString internedICode(void) const { return(_icode); }
+    void iCode(const InternedString& s) { _icode = s; }
+
+    InternedString internedPDBelement(void) const { return(_pdbelement); }
+    void PDBelement(const InternedString& s) { _pdbelement = s; }
+
+    InternedString internedRecordName(void) const { return(_record); }
+    void recordName(const InternedString& s) { _record = s; }
+#endif // !defined(SWIG)
+
 
 #if !defined(SWIG)
     //! Returns a const ref to internally stored coordinates.
@@ -188,7 +230,7 @@ namespace loos {
     //! Recordname imported from the PDB for this Atom
     //! This is mainly for atoms that come from a PDB, i.e. whether or
     //! not they were an ATOM or a HETATM
-    std::string recordName(void) const;
+    const std::string& recordName(void) const;
     void recordName(const std::string);
 
     //! Clear all stored bonds
@@ -262,15 +304,30 @@ namespace loos {
 
     void checkUserBits(const bits bitmask);
 
+    // An atomid that advances idStamp() whenever it's changed by
+    // assignment.  A new atom is in no group yet, so constructing one
+    // doesn't count.
+    class StampedId {
+    public:
+      StampedId() : _value(1) { }
+      StampedId(const StampedId& s) : _value(s._value) { }
+      StampedId& operator=(const StampedId& s) { return(*this = s._value); }
+      StampedId& operator=(const int i);
+      void init(const int i) { _value = i; }
+      operator int() const { return(_value); }
+    private:
+      int _value;
+    };
+
   private:
-    int _id;
+    StampedId _id;
     uint _index;
-    std::string _record, _name, _altloc, _resname, _chainid;
+    InternedString _record, _name, _altloc, _resname, _chainid;
     int _resid;
     int _atomic_number;
-    std::string _icode;
+    InternedString _icode;
     double _b, _q, _charge, _mass;
-    std::string _segid, _pdbelement;
+    InternedString _segid, _pdbelement;
     int _atom_type;
     GCoord _coords;
     GCoord _velocities;
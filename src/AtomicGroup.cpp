@@ -86,9 +86,10 @@ namespace loos {
     return(atoms[j]);
   }
 
-  // Should these invalidate sort status?
+  // The returned pAtom may be replaced, so this resets the sort status
   pAtom& AtomicGroup::operator[](const int i) {
     int j = rangeCheck(i);
+    exposeAtoms();
     return(atoms[j]);
   }
   
@@ -108,6 +109,45 @@ namespace loos {
 
     atoms.erase(iter);
     _sorted = false;
+    _id_index.reset();
+  }
+
+
+  // Internal: removes the first occurrence of each of the atoms in
+  // [first, last) (by the address of the shared pointer) in one pass.
+  // Nothing is removed if any of them are missing.
+  template<class Iter>
+  void AtomicGroup::deleteAtoms(Iter first, Iter last) {
+    typedef boost::unordered_map<const Atom*, uint> Counts;
+    Counts counts;
+    for (Iter i = first; i != last; ++i)
+      ++counts[i->get()];
+
+    uint nfound = 0;
+    std::vector<bool> drop(atoms.size(), false);
+    for (uint k=0; k<atoms.size(); ++k) {
+      Counts::iterator c = counts.find(atoms[k].get());
+      if (c != counts.end() && c->second > 0) {
+        --c->second;
+        drop[k] = true;
+        ++nfound;
+      }
+    }
+
+    if (nfound != static_cast<uint>(std::distance(first, last))) {
+      for (Iter i = first; i != last; ++i)
+        if (counts[i->get()] > 0)
+          throw(LOOSError(**i, "Attempting to delete an atom that is not in the passed AtomicGroup"));
+    }
+
+    uint j = 0;
+    for (uint k=0; k<atoms.size(); ++k)
+      if (!drop[k])
+        atoms[j++] = atoms[k];
+    atoms.resize(j);
+
+    _sorted = false;
+    _id_index.reset();
   }
 
 
@@ -119,6 +159,7 @@ namespace loos {
       atoms.push_back(*i);
 
     _sorted = false;
+    _id_index.reset();
     return(*this);
   }
 
@@ -137,12 +178,7 @@ namespace loos {
 
   // Remove all atoms in the passed vector
   AtomicGroup& AtomicGroup::remove(std::vector<pAtom> pas) {
-    std::vector<pAtom>::iterator i;
-
-    for (i=pas.begin(); i != pas.end(); i++)
-      deleteAtom(*i);
-
-    _sorted = false;
+    deleteAtoms(pas.begin(), pas.end());
     return(*this);
   }
 
@@ -151,15 +187,11 @@ namespace loos {
   AtomicGroup& AtomicGroup::remove(const AtomicGroup& grp) {
 
 
-    if (&grp == this)
+    if (&grp == this) {
       atoms.clear();      // Assume caller meant to clean out AtomicGroup
-    else {
-      std::vector<pAtom>::const_iterator i;
-
-      for (i=grp.atoms.begin(); i != grp.atoms.end(); i++)
-        deleteAtom(*i);
-      
-      _sorted = false;
+      _id_index.reset();
+    } else {
+      deleteAtoms(grp.atoms.begin(), grp.atoms.end());
       return(*this);
     }
 
@@ -174,8 +206,7 @@ namespace loos {
   }
 
   AtomicGroup& AtomicGroup::operator+=(const pAtom& rhs) {
-    atoms.push_back(rhs);
-    _sorted = false;
+    addAtom(rhs);
     return(*this);
   }
 
@@ -241,8 +272,10 @@ namespace loos {
   void AtomicGroup::sort(void) {
     CmpById comp;
 
-    if (! _sorted)
+    if (! _sorted) {
       std::sort(atoms.begin(), atoms.end(), comp);
+      _id_index.reset();
+    }
 
     _sorted = true;
   }
@@ -293,6 +326,7 @@ namespace loos {
     atoms.erase(boost::get<0>(iters), boost::get<1>(iters));
 
     _sorted = false;
+    _id_index.reset();
 
     res.box = box;
     return(res);
@@ -316,140 +350,166 @@ namespace loos {
 
   // Split up a group into a vector of groups based on unique segids...
   std::vector<AtomicGroup> AtomicGroup::splitByUniqueSegid(void) const {
-    const_iterator i;
-    std::list<std::string> segids;
-
-    for (i = atoms.begin(); i != atoms.end(); i++)
-      if (find(segids.begin(), segids.end(), (*i)->segid()) == segids.end())
-        segids.push_front((*i)->segid());
-
-    // Reverse the order so that the chunks are in the same order they appear
-    // in the file...
-    uint n = segids.size();
-    std::vector<AtomicGroup> results(n);
-    uint j = n-1;
-    for (std::list<std::string>::const_iterator i = segids.begin(); i != segids.end(); ++i) {
-      SegidSelector segid(*i);
-      results[j--] = select(segid);
-    }
+    return(split(partitionByUniqueSegid()));
+  }
+
 
-    std::vector<AtomicGroup>::iterator g;
-    for (g=results.begin(); g!=results.end(); g++) {
-      g->box = box;
+  AtomicGroupPartition AtomicGroup::partitionByUniqueSegid(void) const {
+    std::map<InternedString, uint> segids;
+    std::vector<uint> labels(atoms.size());
+
+    // Parts are numbered in the order their segids first appear
+    for (uint k=0; k<atoms.size(); ++k) {
+      std::map<InternedString, uint>::iterator j = segids.find(atoms[k]->internedSegid());
+      if (j == segids.end())
+        j = segids.insert(std::make_pair(atoms[k]->internedSegid(), static_cast<uint>(segids.size()))).first;
+      labels[k] = j->second;
     }
 
-    return(results);
+    return(AtomicGroupPartition::fromLabels(labels, segids.size()));
   }
 
+
   std::map<std::string, AtomicGroup> AtomicGroup::splitByName(void) const {
     const_iterator i;
     std::map<std::string, AtomicGroup> groups;
 
     // Loop over atoms, adding them to groups based on their name, creating the 
-    // map entry for each new name as we find it
-    std::map<std::string, AtomicGroup>::iterator g;
+    // map entry for each new name as we find it.  Names are matched by
+    // their interned handle, so the strings are only compared once per
+    // group.
+    std::map<InternedString, AtomicGroup*> handles;
+    std::map<InternedString, AtomicGroup*>::iterator g;
     for (i = atoms.begin(); i != atoms.end(); ++i) {
-        g = groups.find((*i)->name());
-        if (g == groups.end()) { // not found, need to create a new AG
-            AtomicGroup ag;
-            ag.append(*i);
+        g = handles.find((*i)->internedName());
+        if (g == handles.end()) { // not found, need to create a new AG
+            AtomicGroup& ag = groups[(*i)->name()];
             ag.box = box; // copy the current groups periodic box
-            groups[(*i)->name()] = ag;
-        }  else {              // found group for that atom name, 
-                               // so add the atom to it
-            g->second.append(*i);
+            g = handles.insert(std::make_pair((*i)->internedName(), &ag)).first;
         }
-
+        g->second->append(*i);
     }
 
     return(groups);
   }
 
-  /** The idea is that we iterate over the list of contained atoms.  For
-   * each atom, we recurse through the list of bonded atoms.  Each time
-   * we visit an atom, we mark it as having been seen via the hash_set.
-   * In the recursive function, every time we find a new unseen atom, we
-   * append it to the current group and mark it as seen, then recurse
-   * through all of its bonded atoms.
-   *
-   * Since splitByMolecule() recurses through the connectivity list,
-   * the ordering of the atoms returned will not necessarily be the
-   * same as the input group.  We therefore sort each group returned
-   * to hopefully maintain correct relative ordering.
-   *
-   * If we find a bond that goes to an atom that does not exist in the
-   * current group, a std::runtime_error is thrown.
-   *
-   * Note that for efficiency of atom lookup, the group gets sorted.
-   * This is why the public function splitByMolecule() makes a copy of
-   * itself and calls sortingSplitByMolecule() on that...
-   */
+  // Union-find for grouping atoms into molecules
+  namespace {
+    uint findRoot(std::vector<uint>& parent, uint k) {
+      while (parent[k] != k) {
+        parent[k] = parent[parent[k]];
+        k = parent[k];
+      }
+      return(k);
+    }
+  }
 
-  std::vector<AtomicGroup> AtomicGroup::sortingSplitByMolecule(void) {
-    std::vector<AtomicGroup> molecules;
 
-    // If no connectivity, just return the entire group...
-    if (!hasBonds()) {
-      sort();
-      molecules.push_back(*this);
-    } else {
-      HashInt seen;                      // Track what atoms we've already processed
-      AtomicGroup current;               // The molecule we're currently building...
-      AtomicGroup working(*this);        // Copy, so we can sort without mucking up original order
-      working.sort();
-
-      int n = size();
-      for (int i=0; i<n; i++) {
-        HashInt::iterator it = seen.find(working.atoms[i]->id());
-        if (it != seen.end())
+  /**
+   * Atoms are joined into molecules by walking the bond list of each
+   * atom once (with a union-find), so this is linear in the number of
+   * atoms and bonds.  Bonds to atoms that are not in the group are
+   * ignored.  If there is no connectivity at all, the whole group is
+   * returned as a single part.
+   *
+   * Parts are in the order of their first atom in the group, and
+   * atoms keep their order within each part.
+   */
+  AtomicGroupPartition AtomicGroup::partitionByMolecule(void) const {
+    uint n = atoms.size();
+    std::vector<uint> labels(n, 0);
+
+    if (!hasBonds())
+      return(AtomicGroupPartition::fromLabels(labels, 1));
+
+    boost::unordered_map<int, uint> index_of;
+    index_of.rehash(n);
+    for (uint k=0; k<n; ++k)
+      index_of.insert(std::make_pair(atoms[k]->id(), k));
+
+    std::vector<uint> parent(n);
+    for (uint k=0; k<n; ++k)
+      parent[k] = k;
+
+    for (uint k=0; k<n; ++k) {
+      if (!atoms[k]->hasBonds())
+        continue;
+      std::vector<int> bonds = atoms[k]->getBonds();
+      for (std::vector<int>::const_iterator b = bonds.begin(); b != bonds.end(); ++b) {
+        boost::unordered_map<int, uint>::const_iterator j = index_of.find(*b);
+        if (j == index_of.end())
           continue;
-      
-        walkBonds(current, seen, working, working.atoms[i]);
-        if (current.size() != 0) {       // Just in case...
-          current.sort();
-          molecules.push_back(current);
-          current = AtomicGroup();
-        }
-      
+        uint ra = findRoot(parent, k);
+        uint rb = findRoot(parent, j->second);
+        if (ra != rb)
+          parent[ra > rb ? ra : rb] = ra < rb ? ra : rb;
       }
     }
 
-    // copy the box over
-    std::vector<AtomicGroup>::iterator m;
-    for (m=molecules.begin(); m!=molecules.end(); m++) {
-      m->box = box;
+    // Number the molecules by their first atom
+    const uint unlabeled = static_cast<uint>(-1);
+    std::vector<uint> mol_of_root(n, unlabeled);
+    uint nmols = 0;
+    for (uint k=0; k<n; ++k) {
+      uint r = findRoot(parent, k);
+      if (mol_of_root[r] == unlabeled)
+        mol_of_root[r] = nmols++;
+      labels[k] = mol_of_root[r];
     }
-    return(molecules);
+
+    return(AtomicGroupPartition::fromLabels(labels, nmols));
   }
 
 
-  void AtomicGroup::walkBonds(AtomicGroup& current, HashInt& seen, AtomicGroup& working, pAtom& moi) {
-    int myid = moi->id();
-    HashInt::iterator it = seen.find(myid);
+  namespace {
+    // Orders indices into a list of atoms by atomid
+    struct CmpIndexById {
+      CmpIndexById(const std::vector<pAtom>& a) : atoms(a) { }
+      bool operator()(const uint i, const uint j) const { return(atoms[i]->id() < atoms[j]->id()); }
+      const std::vector<pAtom>& atoms;
+    };
+  }
 
-    // If we've touched this atom before, stop recursing and return.
-    if (it != seen.end())
-      return;
 
-    // This is a novel atom, so append it into the group we're currently building.
-    seen.insert(myid);
-    current.addAtom(moi);
+  /**
+   * This partitions a copy of the group sorted by atomid (as
+   * splitByMolecule() does) and maps the indices back onto this group.
+   */
+  AtomicGroupPartition AtomicGroup::partitionByMoleculeById(void) const {
+    if (_sorted)
+      return(partitionByMolecule());
+
+    std::vector<uint> order(atoms.size());
+    for (uint k=0; k<order.size(); ++k)
+      order[k] = k;
+    std::sort(order.begin(), order.end(), CmpIndexById(atoms));
+
+    AtomicGroup sortable;
+    sortable.atoms.reserve(atoms.size());
+    for (uint k=0; k<order.size(); ++k)
+      sortable.atoms.push_back(atoms[order[k]]);
+    AtomicGroupPartition sorted_parts = sortable.partitionByMolecule();
+
+    AtomicGroupPartition parts;
+    parts.reserve(sorted_parts.size(), sorted_parts.atoms());
+    for (uint i=0; i<sorted_parts.size(); ++i) {
+      parts.newPart();
+      for (AtomicGroupPartition::const_iterator j = sorted_parts.begin(i); j != sorted_parts.end(i); ++j)
+        parts.add(order[*j]);
+    }
 
-    // Just in case it's a solo-atom...  This probably should indicate
-    // some kind of error...?
-    if (!(moi->hasBonds()))
-      return;
+    return(parts);
+  }
 
-    // Now find atoms that are bound to the current atom and recurse
-    // through them...
 
-    std::vector<int> bonds = moi->getBonds();
-    std::vector<int>::const_iterator citer;
-    for (citer = bonds.begin(); citer != bonds.end(); citer++) {
-      pAtom toi = working.findById(*citer);
-      if (toi != 0)
-        walkBonds(current, seen, working, toi);
-    }
+  /**
+   * The group is sorted by atomid before splitting, so each molecule
+   * is sorted and the molecules are in order of their lowest atomid.
+   */
+  std::vector<AtomicGroup> AtomicGroup::splitByMolecule(void) const {
+    AtomicGroup sortable = *this;
+    sortable.sort();
+    return(sortable.split(sortable.partitionByMolecule()));
   }
 
 
@@ -459,32 +519,53 @@ namespace loos {
    * segid.
    */
   std::vector<AtomicGroup> AtomicGroup::splitByResidue(void) const {
-    std::vector<AtomicGroup> residues;
+    return(split(partitionByResidue()));
+  }
+
+
+  AtomicGroupPartition AtomicGroup::partitionByResidue(void) const {
+    AtomicGroupPartition residues;
+    if (atoms.empty())
+      return(residues);
 
+    residues.reserve(numberOfResidues(), atoms.size());
     int curr_resid = atoms[0]->resid();
-    std::string curr_segid = atoms[0]->segid();
-    
-    AtomicGroup residue;
-    AtomicGroup::const_iterator ci;
-    for (ci = atoms.begin(); ci != atoms.end(); ++ci) {
-      if (curr_resid != (*ci)->resid() || (*ci)->segid() != curr_segid) {
-        residues.push_back(residue);
-        residue = AtomicGroup();
-        curr_resid = (*ci)->resid();
-        curr_segid = (*ci)->segid();
-      } 
-      residue.append(*ci);
+    InternedString curr_segid = atoms[0]->internedSegid();
+    residues.newPart();
+
+    for (uint k=0; k<atoms.size(); ++k) {
+      if (curr_resid != atoms[k]->resid() || atoms[k]->internedSegid() != curr_segid) {
+        residues.newPart();
+        curr_resid = atoms[k]->resid();
+        curr_segid = atoms[k]->internedSegid();
+      }
+      residues.add(k);
     }
 
-    if (residue.size() != 0)
-      residues.push_back(residue);
+    return(residues);
+  }
 
 
-    // Copy the box information
-    for (std::vector<AtomicGroup>::iterator i = residues.begin(); i != residues.end(); ++i)
-      i->box = box;
-    
-    return(residues);
+  // Parts keep the order of the atoms in this group, so if it is
+  // sorted, so are they
+  AtomicGroup AtomicGroup::subgroup(const AtomicGroupPartition& parts, const uint i) const {
+    AtomicGroup result;
+    result.atoms.reserve(parts.size(i));
+    for (AtomicGroupPartition::const_iterator k = parts.begin(i); k != parts.end(i); ++k)
+      result.atoms.push_back(atoms[*k]);
+
+    result._sorted = _sorted;
+    result.box = box;
+    return(result);
+  }
+
+
+  std::vector<AtomicGroup> AtomicGroup::split(const AtomicGroupPartition& parts) const {
+    std::vector<AtomicGroup> results(parts.size());
+    for (uint i=0; i<parts.size(); ++i)
+      results[i] = subgroup(parts, i);
+
+    return(results);
   }
 
 
@@ -517,11 +598,94 @@ namespace loos {
   }
   
 
+  boost::shared_ptr<const AtomicGroup::IdIndex> AtomicGroup::buildIdIndex() const {
+    boost::shared_ptr<IdIndex> index(new IdIndex);
+    index->verified = Atom::idStamp();
+    index->positions.rehash(atoms.size());
+    index->ids.resize(atoms.size());
+    for (uint k=0; k<atoms.size(); ++k) {
+      int id = atoms[k]->id();
+      index->positions.insert(std::make_pair(id, k));
+      index->ids[k] = id;
+    }
+
+    return(index);
+  }
+
+
+  // A const group may be shared between threads, so the cached index
+  // pointer is only read and written atomically.  Two threads may both
+  // build an index, but they'll build the same one.
+  boost::shared_ptr<const AtomicGroup::IdIndex> AtomicGroup::idIndex() const {
+    boost::shared_ptr<const IdIndex> index = boost::atomic_load(&_id_index);
+    if (!index) {
+      index = buildIdIndex();
+      boost::atomic_store(&_id_index, index);
+    }
+
+    return(index);
+  }
+
+
+  // Returns the id index, rebuilding it first if any atom's atomid (or
+  // the order of the atoms) has changed since it was built.  Comparing
+  // the ids is O(N), so it's skipped when no atomid anywhere has
+  // changed since the index was last found to be current.
+  boost::shared_ptr<const AtomicGroup::IdIndex> AtomicGroup::checkedIdIndex() const {
+    boost::shared_ptr<const IdIndex> index = idIndex();
+    unsigned long stamp = Atom::idStamp();
+    if (index->verified == stamp)
+      return(index);
+
+    bool current = (index->ids.size() == atoms.size());
+    for (uint k=0; current && k<atoms.size(); ++k)
+      current = (atoms[k]->id() == index->ids[k]);
+    if (current) {
+      index->verified = stamp;
+      return(index);
+    }
+
+    index = buildIdIndex();
+    boost::atomic_store(&_id_index, index);
+    return(index);
+  }
+
+
+  // The first atom the index lists with the given id, ignoring any
+  // entries that no longer have that id
+  pAtom AtomicGroup::indexedFind(const IdIndex& index, const int id) const {
+    std::pair<IdIndex::Positions::const_iterator, IdIndex::Positions::const_iterator> range = index.positions.equal_range(id);
+
+    uint k = atoms.size();
+    for (IdIndex::Positions::const_iterator i = range.first; i != range.second; ++i)
+      if (i->second < k && atoms[i->second]->id() == id)
+        k = i->second;
+
+    if (k == atoms.size())
+      return(pAtom());
+    return(atoms[k]);
+  }
+
+
   pAtom AtomicGroup::findById(const int id) const {
+    if (atoms.size() < min_indexed_size) {
+      if (sorted())
+        return(findById_binarySearch(id));
+      return(findById_linearSearch(id));
+    }
+
+    boost::shared_ptr<const IdIndex> index = idIndex();
+    pAtom pa = indexedFind(*index, id);
+    if (pa)
+      return(pa);
     if (sorted())
       return(findById_binarySearch(id));
 
-    return(findById_linearSearch(id));
+    // The atomids may have been changed behind our back...
+    boost::shared_ptr<const IdIndex> current = checkedIdIndex();
+    if (current == index)
+      return(pAtom());
+    return(indexedFind(*current, id));
   }
 
 
@@ -564,7 +728,7 @@ namespace loos {
     iterator j = i;
 
     while (j >= atoms.begin()) {
-      if ((*j)->resid() == res->resid() && (*j)->segid() == res->segid())
+      if ((*j)->resid() == res->resid() && (*j)->internedSegid() == res->internedSegid())
         result.addAtom(*j);
       else
         break;
@@ -573,7 +737,7 @@ namespace loos {
 
     j = i+1;
     while (j < atoms.end()) {
-      if ((*j)->resid() == res->resid() && (*j)->segid() == res->segid())
+      if ((*j)->resid() == res->resid() && (*j)->internedSegid() == res->internedSegid())
         result.addAtom(*j);
       else
         break;
@@ -626,6 +790,8 @@ namespace loos {
       renumberWithBonds(*this, start, stride);
     else
       renumberWithoutBonds(*this, start, stride);
+
+    _id_index.reset();
   }
 
   // Get the min and max atomid's...
@@ -696,14 +862,14 @@ namespace loos {
     const_iterator i;
     int n = 1;
     int curr_resid = atoms[0]->resid();
-    std::string curr_segid = atoms[0]->segid();
+    InternedString curr_segid = atoms[0]->internedSegid();
 
     for (i=atoms.begin()+1; i !=atoms.end(); i++)
       if (((*i)->resid() != curr_resid) || 
-          ((*i)->segid() != curr_segid)) {
+          ((*i)->internedSegid() != curr_segid)) {
         ++n;
         curr_resid = (*i)->resid();
-        curr_segid = (*i)->segid();
+        curr_segid = (*i)->internedSegid();
       }
 
     return(n);
@@ -717,12 +883,12 @@ namespace loos {
 
     const_iterator i;
     int n = 1;
-    std::string curr_segid = atoms[0]->segid();
+    InternedString curr_segid = atoms[0]->internedSegid();
 
     for (i=atoms.begin()+1; i !=atoms.end(); i++)
-      if ((*i)->segid() != curr_segid) {
+      if ((*i)->internedSegid() != curr_segid) {
         ++n;
-        curr_segid = (*i)->segid();
+        curr_segid = (*i)->internedSegid();
       }
 
     return(n);
@@ -805,7 +971,7 @@ namespace loos {
       throw(LOOSError("trying to reimage a non-periodic group"));
     GCoord com = centroid();
     GCoord reimaged = com;
-    reimaged.reimage(periodicBox());
+    periodicCell().reimage(reimaged);
     GCoord trans = reimaged - com;
     const_iterator a;
     for (a=atoms.begin(); a!=atoms.end(); a++) {
@@ -817,9 +983,9 @@ namespace loos {
     if (!(isPeriodic()))
       throw(LOOSError("trying to reimage a non-periodic group"));
     const_iterator a;
-    GCoord box = periodicBox();
+    TriclinicBox cell = periodicCell();
     for (a=atoms.begin(); a!=atoms.end(); a++) {
-      (*a)->coords().reimage(box);
+      cell.reimage((*a)->coords());
     }
   }
     
@@ -867,7 +1033,7 @@ namespace loos {
 
   void AtomicGroup::pruneBonds() {
     
-    for (AtomicGroup::iterator j = begin(); j != end(); ++j)
+    for (AtomicGroup::iterator j = atoms.begin(); j != atoms.end(); ++j)
       if ((*j)->hasBonds()) {
         std::vector<int> bonds = (*j)->getBonds();
         std::vector<int> pruned_bonds;
@@ -905,7 +1071,7 @@ namespace loos {
   uint AtomicGroup::deduceAtomicNumberFromMass(const double tol) {
     uint n = 0;
 
-    for (AtomicGroup::iterator i = begin(); i != end(); ++i)
+    for (AtomicGroup::iterator i = atoms.begin(); i != atoms.end(); ++i)
       if ((*i)->checkProperty(Atom::massbit)) {
         uint an = loos::deduceAtomicNumberFromMass((*i)->mass(), tol);
         if (an) {
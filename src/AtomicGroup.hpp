@@ -34,12 +34,15 @@
 #include <algorithm>
 
 #include <boost/unordered_set.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/atomic.hpp>
 
 
 #include <loos_defs.hpp>
 
 
 #include <Atom.hpp>
+#include <AtomicGroupPartition.hpp>
 #include <XForm.hpp>
 #include <PeriodicBox.hpp>
 #include <utils.hpp>
@@ -66,6 +69,22 @@ namespace loos {
   typedef boost::shared_ptr<AtomicGroup> pAtomicGroup;
 
 
+  //! Flags atom-equality policies that can only match atoms with the same atomid
+  /**
+   * AtomicGroup uses this to decide whether it can look atoms up by
+   * their atomid (via a hash) when checking containment, intersecting,
+   * or merging groups, rather than comparing every pair of atoms.  If
+   * you write your own policy that also requires the atomids to be
+   * equal, you can specialize this for it to get the same speedup.
+   */
+  template<class EqualsOp> struct EqualsRequiresSameId { static const bool value = false; };
+
+#if !defined(SWIG)
+  template<> struct EqualsRequiresSameId<AtomEquals> { static const bool value = true; };
+  template<> struct EqualsRequiresSameId<AtomCoordsEquals> { static const bool value = true; };
+#endif
+
+
   //! Class for handling groups of Atoms (pAtoms, actually)
   /** This class contains a collection of shared pointers to Atoms
    * (i.e. pAtoms).  Copying an AtomicGroup is a light-copy.  You can,
@@ -111,12 +130,26 @@ namespace loos {
     }
 
     //! Copy constructor (atoms and box shared)
+    /**
+     * The atomid hash (see findById()) is not shared, so replacing
+     * atoms in the copy cannot leave the original with a stale hash
+     * (or vice versa).
+     */
     AtomicGroup(const AtomicGroup& g) :
       _sorted(g._sorted),
       atoms(g.atoms),
       box(g.box)
       { }
 
+    //! Assignment (atoms and box shared, atomid hash discarded)
+    AtomicGroup& operator=(const AtomicGroup& g) {
+      _sorted = g._sorted;
+      _id_index.reset();
+      atoms = g.atoms;
+      box = g.box;
+      return(*this);
+    }
+
 
     virtual ~AtomicGroup() { }
 
@@ -152,7 +185,7 @@ namespace loos {
 #endif
 
     //! Append the atom onto the group
-    AtomicGroup& append(pAtom pa) { atoms.push_back(pa); _sorted = false; return(*this); }
+    AtomicGroup& append(pAtom pa) { addAtom(pa); return(*this); }
     //! Append a vector of atoms
     AtomicGroup& append(std::vector<pAtom> pas);
     //! Append an entire AtomicGroup onto this one (concatenation)
@@ -237,8 +270,8 @@ namespace loos {
      */
 
     template<class EqualsOp> bool contains(const pAtom& p, const EqualsOp& op) const {
-      const_iterator ci = std::find_if(begin(), end(), bind2nd(op, p));
-      return(ci != end());
+      IdLookup lookup = matchIndex<EqualsOp>();
+      return(hasMatch(p, op, lookup));
     }
 
     //! Determines if a pAtom is contained in this group using the AtomEquals policy (ie the default comparison policy)
@@ -247,8 +280,9 @@ namespace loos {
 
     //! Determines if the passed group is a subset of the current group using the EqualsOp atom-equality policy
     template<class EqualsOp> bool contains(const AtomicGroup& g, const EqualsOp& op) const {
+      IdLookup lookup = matchIndex<EqualsOp>();
       for (const_iterator cj = g.begin(); cj != g.end(); ++cj)
-        if (std::find_if(begin(), end(), bind2nd(op, *cj)) == end())
+        if (!hasMatch(*cj, op, lookup))
           return(false);
       return(true);
     }
@@ -260,8 +294,9 @@ namespace loos {
       //! Determines if a group contains any atom
       template<class EqualsOp> bool containsAny(const AtomicGroup& g, const EqualsOp& op) const
           {
+              IdLookup lookup = matchIndex<EqualsOp>();
               for (const_iterator cj = g.begin(); cj != g.end(); ++cj)
-                  if (std::find_if(begin(), end(), bind2nd(op, *cj)) != end())
+                  if (hasMatch(*cj, op, lookup))
                       return(true);
               return(false);
           }
@@ -277,8 +312,9 @@ namespace loos {
     template<class EqualsOp> AtomicGroup intersect(const AtomicGroup& g, const EqualsOp& op) {
       AtomicGroup result;
 
+      IdLookup lookup = g.matchIndex<EqualsOp>();
       for (const_iterator cj = begin(); cj != end(); ++ cj)
-        if (std::find_if(g.begin(), g.end(), bind2nd(op, *cj)) != g.end())
+        if (g.hasMatch(*cj, op, lookup))
           result.addAtom(*cj);
 
       result.box = box;
@@ -295,8 +331,9 @@ namespace loos {
     template<class EqualsOp> AtomicGroup merge(const AtomicGroup& g, const EqualsOp& op) {
       AtomicGroup result = copy();
 
+      IdLookup lookup = matchIndex<EqualsOp>();
       for (const_iterator ci = g.begin(); ci != g.end(); ++ci)
-        if (std::find_if(begin(), end(), bind2nd(op, *ci)) == end())
+        if (!hasMatch(*ci, op, lookup))
           result.addAtom(*ci);
 
       return(result);
@@ -318,14 +355,39 @@ namespace loos {
     std::vector<AtomicGroup> splitByUniqueSegid(void) const;
 
     //! Returns a vector of AtomicGroups split based on bond connectivity
-    std::vector<AtomicGroup> splitByMolecule(void) const {
-      AtomicGroup sortable = *this;
-      return(sortable.sortingSplitByMolecule());
-    }
+    std::vector<AtomicGroup> splitByMolecule(void) const;
 
     //! Returns a vector of AtomicGroups, each comprising a single residue
     std::vector<AtomicGroup> splitByResidue(void) const;
 
+    //! Partitions the group by segid without building new groups (see splitByUniqueSegid())
+    AtomicGroupPartition partitionByUniqueSegid(void) const;
+
+    //! Partitions the group by bond connectivity without building new groups
+    /**
+     * Unlike splitByMolecule(), the group is not sorted first, so the
+     * atoms in each part are in the same order as in this group.
+     */
+    AtomicGroupPartition partitionByMolecule(void) const;
+
+    //! Partitions the group by bond connectivity, with each part in atomid order
+    /**
+     * The parts hold the same atoms in the same order as the groups
+     * returned by splitByMolecule(), so anything that depends on the
+     * first atom of a molecule (i.e. mergeImage()) gives the same
+     * result.
+     */
+    AtomicGroupPartition partitionByMoleculeById(void) const;
+
+    //! Partitions the group by residue without building new groups (see splitByResidue())
+    AtomicGroupPartition partitionByResidue(void) const;
+
+    //! Returns the \a i'th part of a partition of this group as an AtomicGroup
+    AtomicGroup subgroup(const AtomicGroupPartition& parts, const uint i) const;
+
+    //! Returns all parts of a partition of this group as AtomicGroups
+    std::vector<AtomicGroup> split(const AtomicGroupPartition& parts) const;
+
     //! Returns a vector of AtomicGroups, each containing atoms with the same name
     std::map<std::string, AtomicGroup> splitByName(void) const;
 
@@ -345,17 +407,27 @@ namespace loos {
 
     //! Find a contained atom by its atomid
     /**
-     * The default behavior is to assume that the atoms in the
-     * AtomicGroup are not in order of increasing atomid and to
-     * therefore use a linear search.  If the atoms are sorted
-     * (AtomicGroup::sort()), then the more efficient binary search
-     * will be used.
+     * Small groups are searched directly (using a binary search if the
+     * atoms are sorted by atomid, see AtomicGroup::sort()).  For larger
+     * groups, a hash of atomids is built the first time it's needed
+     * and kept until atoms are added to or removed from the group.
+     * The hash is also used by contains(), intersect(), and merge().
+     *
+     * If more than one atom has the same atomid, the first one is
+     * returned.  Atoms are shared between groups, so their atomids
+     * (or order) can change without this group knowing.  The hash is
+     * therefore only trusted when it finds a match; when it doesn't,
+     * it is checked against the atoms in the group (and rebuilt if
+     * they have changed) before giving up.
      */
     pAtom findById(const int id) const;
 
     //! Create a new group from a vector of atomids
     AtomicGroup groupFromID(const std::vector<int> &id_list) const;
 
+    //! Discards the cached atomid hash (see findById())
+    void clearIdIndex() { _id_index.reset(); }
+
     //! Given an Atom, return a group of all the atoms contained by its
     //! containing residue
     AtomicGroup getResidue(pAtom res);
@@ -427,6 +499,21 @@ namespace loos {
       box.box(GCoord(x,y,z));
     }
 
+    //! Test whether or not the periodic box is triclinic
+    bool isTriclinic(void) const { return(box.isTriclinic()); }
+
+    //! Fetch the periodic cell (box vectors)
+    /**
+     * If the box is orthorhombic, this is a cell made from periodicBox()
+     */
+    TriclinicBox periodicCell(void) const { return(box.cell()); }
+
+    //! Set a (possibly triclinic) periodic cell
+    /**
+     * periodicBox() will return the diagonal of the box matrix
+     */
+    void periodicCell(const TriclinicBox& c) { box.cell(c); }
+
     //! Provide access to the underlying shared periodic box...
     loos::SharedPeriodicBox sharedPeriodicBox() const { return(box); }
 
@@ -457,6 +544,12 @@ namespace loos {
       return(within_private(dist, grp, op));
     }
 
+    //! Find atoms in \a grp that are within \a dist angstroms of atoms in the current group in a triclinic cell
+    AtomicGroup within(const double dist, AtomicGroup& grp, const TriclinicBox& cell) const {
+      Distance2InCell op(cell);
+      return(within_private(dist, grp, op));
+    }
+
 
     //! Returns true if any atom of current group is within \a dist angstroms of \a grp
     /**
@@ -478,6 +571,12 @@ namespace loos {
       return(contactwith_private(dist, grp, min, op));
     }
 
+    //! Returns true if any atom of current group is within \a dist angstroms of \a grp in a triclinic cell
+    bool contactWith(const double dist, const AtomicGroup& grp, const TriclinicBox& cell, const uint min=1) const {
+      Distance2InCell op(cell);
+      return(contactwith_private(dist, grp, min, op));
+    }
+
 
     //! Distance-based search for bonds
     /** Searches for bonds within an AtomicGroup based on distance.
@@ -487,6 +586,7 @@ namespace loos {
      */
 	// Larger distances cause problems with hydrogens...
 	void findBonds(const double dist, const GCoord& box) { findBondsImpl(dist, Distance2WithPeriodicity(box)); }
+	void findBonds(const double dist, const TriclinicBox& cell) { findBondsImpl(dist, Distance2InCell(cell)); }
 	void findBonds(const double dist) { findBondsImpl(dist, Distance2WithoutPeriodicity()); }
 	void findBonds(const GCoord& box) { findBondsImpl(1.65, Distance2WithPeriodicity(box)); }
 	void findBonds() { findBondsImpl(1.65, Distance2WithoutPeriodicity()); }
@@ -551,9 +651,10 @@ namespace loos {
     };
 
     // STL-iterator access
-    // Should these reset sort status?
-    iterator begin(void) { return(atoms.begin()); }
-    iterator end(void) { return(atoms.end()); }
+    // The mutable iterators let the atoms be replaced or reordered, so
+    // they reset the sort status (see exposeAtoms())
+    iterator begin(void) { exposeAtoms(); return(atoms.begin()); }
+    iterator end(void) { exposeAtoms(); return(atoms.end()); }
 
 #if !defined(SWIG)
     const_iterator begin(void) const { return(atoms.begin()); }
@@ -800,6 +901,16 @@ namespace loos {
       GCoord _box;
     };
 
+    struct Distance2InCell {
+      Distance2InCell(const TriclinicBox& cell) : _cell(cell) { }
+
+      double operator()(const GCoord& a, const GCoord& b) const {
+        return(_cell.distance2(a, b));
+      }
+
+      TriclinicBox _cell;
+    };
+
 
 
     // Find all atoms in the current group that are within dist
@@ -863,11 +974,11 @@ namespace loos {
 		  double dist2 = dist * dist;
 		  double current_dist2;
 
-		  for (ij = begin(); ij != end() - 1; ++ij) {
+		  for (ij = atoms.begin(); ij != atoms.end() - 1; ++ij) {
 			  iterator ii;
 			  GCoord u = (*ij)->coords();
 
-			  for (ii = ij + 1; ii != end(); ++ii) {
+			  for (ii = ij + 1; ii != atoms.end(); ++ii) {
 				  current_dist2 = distance_function(u, (*ii)->coords());
 				  if (current_dist2 < dist2) {
 					  (*ij)->addBond(*ii);
@@ -880,8 +991,6 @@ namespace loos {
 
 
 
-    std::vector<AtomicGroup> sortingSplitByMolecule();
-
     // *** Internal routines ***  See the .cpp file for details...
     void sorted(bool b) { _sorted = b; }
 
@@ -890,8 +999,9 @@ namespace loos {
 
     int rangeCheck(int) const;
 
-    void addAtom(pAtom pa) { atoms.push_back(pa); _sorted = false; }
+    void addAtom(pAtom pa) { atoms.push_back(pa); _sorted = false; _id_index.reset(); }
     void deleteAtom(pAtom pa);
+    template<class Iter> void deleteAtoms(Iter first, Iter last);
 
     boost::tuple<iterator, iterator> calcSubsetIterators(const int offset, const int len = 0);
 
@@ -910,15 +1020,96 @@ namespace loos {
       int id;
     };
 
-    typedef boost::unordered_set<int> HashInt;
-
-    void walkBonds(AtomicGroup& mygroup, HashInt& seen, AtomicGroup& working, pAtom& moi);
-
 
     double *coordsAsArray(void) const;
     double *transformedCoordsAsArray(const XForm&) const;
 
+    // Groups smaller than this are just searched directly
+    static const uint min_indexed_size = 32;
+
+    // Maps atomids to their indices in the group, along with the
+    // atomid of each atom when the map was built and the last
+    // Atom::idStamp() it was known to match the atoms at (see
+    // checkedIdIndex())
+    struct IdIndex {
+      typedef boost::unordered_multimap<int, uint> Positions;
+      Positions positions;
+      std::vector<int> ids;
+      mutable boost::atomic<unsigned long> verified;
+    };
+
+    // An id index for a series of lookups, remembering whether it has
+    // been checked against the atoms yet
+    struct IdLookup {
+      IdLookup() : checked(false) { }
+      explicit IdLookup(const boost::shared_ptr<const IdIndex>& p) : index(p), checked(false) { }
+
+      boost::shared_ptr<const IdIndex> index;
+      bool checked;
+    };
+
+    // Never a real Atom::idStamp(), so an index marked with it is
+    // always checked against the atoms before a miss is believed
+    static const unsigned long unverified_stamp = ~0UL;
+
+    // Called when a caller gets a mutable handle on the pAtoms, since
+    // it may replace or reorder them without changing any atomid (so
+    // Atom::idStamp() won't see it).  The id index is only marked for
+    // checking rather than dropped, so a loop over end() doesn't
+    // rebuild it every time.
+    void exposeAtoms() {
+      _sorted = false;
+      if (_id_index)
+        _id_index->verified = unverified_stamp;
+    }
+
+    boost::shared_ptr<const IdIndex> buildIdIndex() const;
+    boost::shared_ptr<const IdIndex> idIndex() const;
+    boost::shared_ptr<const IdIndex> checkedIdIndex() const;
+    pAtom indexedFind(const IdIndex& index, const int id) const;
+
+    // The id index to use with EqualsOp (or none if it can't be used)
+    template<class EqualsOp>
+    IdLookup matchIndex() const {
+      if (EqualsRequiresSameId<EqualsOp>::value && atoms.size() >= min_indexed_size)
+        return(IdLookup(idIndex()));
+      return(IdLookup());
+    }
+
+    template<class EqualsOp>
+    bool indexedMatch(const pAtom& p, const EqualsOp& op, const IdIndex& index) const {
+      std::pair<IdIndex::Positions::const_iterator, IdIndex::Positions::const_iterator> range = index.positions.equal_range(p->id());
+      for (IdIndex::Positions::const_iterator i = range.first; i != range.second; ++i)
+        if (i->second < atoms.size() && op(atoms[i->second], p))
+          return(true);
+      return(false);
+    }
+
+    // True if op(a, p) for some atom a in this group.  A match found
+    // through the index is always real, but a miss may just mean the
+    // index is stale, so the first miss checks the index (and rebuilds
+    // it if needed) before it is believed.  A run of lookups (as in
+    // intersect()) pays for at most one check.
+    template<class EqualsOp>
+    bool hasMatch(const pAtom& p, const EqualsOp& op, IdLookup& lookup) const {
+      if (!lookup.index)
+        return(std::find_if(begin(), end(), bind2nd(op, p)) != end());
+
+      if (indexedMatch(p, op, *lookup.index))
+        return(true);
+      if (lookup.checked)
+        return(false);
+
+      lookup.checked = true;
+      boost::shared_ptr<const IdIndex> current = checkedIdIndex();
+      if (current == lookup.index)
+        return(false);
+      lookup.index = current;
+      return(indexedMatch(p, op, *lookup.index));
+    }
+
     bool _sorted;
+    mutable boost::shared_ptr<const IdIndex> _id_index;
 
 
   protected:
@@ -0,0 +1,112 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_ATOMICGROUP_PARTITION_HPP)
+#define LOOS_ATOMICGROUP_PARTITION_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+
+
+namespace loos {
+
+  //! A split of an AtomicGroup stored as indices into the group
+  /**
+   * Rather than building a new AtomicGroup for each residue, molecule,
+   * etc, a partition just records which atoms (by their index into the
+   * group that was split) belong to each part.  Building one is a
+   * single pass over the group.  The parts can be turned into real
+   * AtomicGroups later with AtomicGroup::subgroup() or
+   * AtomicGroup::split(), but only if needed.
+   *
+   * A partition does not hold on to the group it came from, so it is
+   * only meaningful for that group (and its copies) as long as atoms
+   * are not added, removed, or reordered.
+   */
+  class AtomicGroupPartition {
+  public:
+    typedef std::vector<uint>::const_iterator const_iterator;
+
+    AtomicGroupPartition() : _offsets(1, 0) { }
+
+    //! Number of parts
+    uint size() const { return(_offsets.size() - 1); }
+    bool empty() const { return(size() == 0); }
+
+    //! Number of atoms in the \a i'th part
+    uint size(const uint i) const { return(_offsets[i+1] - _offsets[i]); }
+
+    //! Atom indices for the \a i'th part
+    const_iterator begin(const uint i) const { return(_indices.begin() + _offsets[i]); }
+    const_iterator end(const uint i) const { return(_indices.begin() + _offsets[i+1]); }
+
+    //! Index of the \a j'th atom in the \a i'th part
+    uint operator()(const uint i, const uint j) const { return(_indices[_offsets[i] + j]); }
+
+    //! Total number of atoms in all parts
+    uint atoms() const { return(_indices.size()); }
+
+
+    //! Add a new (empty) part
+    void newPart() { _offsets.push_back(_indices.size()); }
+
+    //! Add the atom with index \a k to the last part
+    void add(const uint k) { _indices.push_back(k); ++_offsets.back(); }
+
+    void reserve(const uint nparts, const uint natoms) {
+      _offsets.reserve(nparts + 1);
+      _indices.reserve(natoms);
+    }
+
+
+    //! Build a partition from the part number of each atom
+    /**
+     * \a labels[k] is the part that atom k belongs to (parts are
+     * numbered from zero and must all be used).  Atoms keep their
+     * relative order within each part.
+     */
+    static AtomicGroupPartition fromLabels(const std::vector<uint>& labels, const uint nparts) {
+      AtomicGroupPartition p;
+      p._offsets.assign(nparts + 1, 0);
+      for (std::vector<uint>::const_iterator i = labels.begin(); i != labels.end(); ++i)
+        ++p._offsets[*i + 1];
+      for (uint i=0; i<nparts; ++i)
+        p._offsets[i+1] += p._offsets[i];
+
+      std::vector<uint> next(p._offsets.begin(), p._offsets.end() - 1);
+      p._indices.resize(labels.size());
+      for (uint k=0; k<labels.size(); ++k)
+        p._indices[next[labels[k]]++] = k;
+
+      return(p);
+    }
+
+  private:
+    std::vector<uint> _indices;
+    std::vector<uint> _offsets;
+  };
+
+}
+
+
+#endif
@@ -0,0 +1,344 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <BitMatrix.hpp>
+#include <exceptions.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+
+#include <boost/format.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    const char bitmatrix_magic[] = "LOOSBITS";
+    const boost::uint32_t bitmatrix_endian = 0x01020304;
+
+
+    inline uint popcount(const BitMatrix::Word w) {
+#if defined(__GNUC__)
+      return(__builtin_popcountll(w));
+#else
+      BitMatrix::Word v = w - ((w >> 1) & 0x5555555555555555ULL);
+      v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+      v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+      return(static_cast<uint>((v * 0x0101010101010101ULL) >> 56));
+#endif
+    }
+
+
+    // Mask for the low n bits (n <= 64)
+    inline BitMatrix::Word lowMask(const uint n) {
+      return(n >= 64 ? ~static_cast<BitMatrix::Word>(0) : ((static_cast<BitMatrix::Word>(1) << n) - 1));
+    }
+
+
+    // Sum of the set bits in [begin, end) for a row of words
+    ulong countRange(const BitMatrix::Word* row, const uint begin, const uint end) {
+      if (begin >= end)
+        return(0);
+
+      uint wa = begin / 64;
+      uint wb = (end - 1) / 64;
+      BitMatrix::Word first = row[wa] & ~lowMask(begin % 64);
+
+      if (wa == wb)
+        return(popcount(first & lowMask(end - wa * 64)));
+
+      ulong sum = popcount(first);
+      for (uint w = wa + 1; w < wb; ++w)
+        sum += popcount(row[w]);
+      sum += popcount(row[wb] & lowMask(end - wb * 64));
+      return(sum);
+    }
+
+
+    void writeUInt(std::ostream& os, const boost::uint32_t u) {
+      os.write(reinterpret_cast<const char*>(&u), sizeof(u));
+    }
+
+    boost::uint32_t readUInt(std::istream& is) {
+      boost::uint32_t u;
+      if (!is.read(reinterpret_cast<char*>(&u), sizeof(u)))
+        throw(FileReadError("stream", "Unexpected end of BitMatrix data"));
+      return(u);
+    }
+
+  }
+
+
+
+  BitMatrix::BitMatrix(const uint nframes, const uint nseries) :
+    nframes_(nframes),
+    nseries_(nseries),
+    nwords_((nframes + 63) / 64),
+    data_(static_cast<ulong>(nwords_) * nseries, 0)
+  { }
+
+
+
+  BitMatrix::Word BitMatrix::bitsFrom(const Word* row, const ulong p) const {
+    ulong w = p / 64;
+    uint shift = p % 64;
+    Word lo = w < nwords_ ? row[w] : 0;
+    if (shift == 0)
+      return(lo);
+    Word hi = w + 1 < nwords_ ? row[w + 1] : 0;
+    return((lo >> shift) | (hi << (64 - shift)));
+  }
+
+
+
+  ulong BitMatrix::occupancy(const uint s, const uint begin, const uint end) const {
+    if (end > nframes_)
+      throw(std::out_of_range("Invalid frame range in BitMatrix::occupancy()"));
+    return(countRange(&data_[index(s, 0)], begin, end));
+  }
+
+
+
+  ulong BitMatrix::coincidence(const uint s, const uint tau, const uint end) const {
+    if (static_cast<ulong>(end) + tau > nframes_)
+      throw(std::out_of_range("Invalid lag in BitMatrix::coincidence()"));
+
+    const Word* row = &data_[index(s, 0)];
+    ulong sum = 0;
+    uint nw = (end + 63) / 64;
+    for (uint w = 0; w < nw; ++w) {
+      Word both = row[w] & bitsFrom(row, static_cast<ulong>(w) * 64 + tau);
+      if (w == nw - 1)
+        both &= lowMask(end - w * 64);
+      sum += popcount(both);
+    }
+
+    return(sum);
+  }
+
+
+
+  bool BitMatrix::any(const uint s) const {
+    const Word* row = &data_[index(s, 0)];
+    for (uint w = 0; w < nwords_; ++w)
+      if (row[w])
+        return(true);
+    return(false);
+  }
+
+
+
+  // For a normalized series y = (x - mu) / sigma,
+  //   sum_t y(t) y(t+tau) = [C - mu (A + B) + mu^2 (n - tau)] / sigma^2
+  // where C is the coincidence count and A, B are the occupancies of
+  // the leading and trailing windows...
+  std::vector<double> BitMatrix::autocorrelation(const uint s, const uint max_time, const double tol) const {
+    if (max_time > nframes_)
+      throw(std::runtime_error("Can't take correlation time longer than time series"));
+
+    std::vector<double> c(max_time, 0.0);
+    double n = nframes_;
+    double mu = occupancy(s) / n;
+    double var = mu - mu * mu;
+    if (var < 0.0 || sqrt(var) < tol) {
+      c.assign(max_time, 1.0);
+      return(c);
+    }
+
+    for (uint tau = 0; tau < max_time; ++tau) {
+      uint len = nframes_ - tau;
+      double C = coincidence(s, tau, len);
+      double A = occupancy(s, 0, len);
+      double B = occupancy(s, tau, nframes_);
+      c[tau] = (C - mu * (A + B) + mu * mu * len) / (var * len);
+    }
+
+    return(c);
+  }
+
+
+
+  std::vector<uint> BitMatrix::lifetimes(const uint s) const {
+    const Word* row = &data_[index(s, 0)];
+    std::vector<uint> runs;
+    uint run = 0;
+
+    for (uint w = 0; w < nwords_; ++w) {
+      Word bits = row[w];
+      uint nbits = (w == nwords_ - 1) ? nframes_ - w * 64 : 64;
+
+      // Whole words of 0's or 1's are common, so skip them quickly
+      if (bits == 0) {
+        if (run) {
+          runs.push_back(run);
+          run = 0;
+        }
+        continue;
+      }
+      if (nbits == 64 && bits == ~static_cast<Word>(0)) {
+        run += 64;
+        continue;
+      }
+
+      for (uint b = 0; b < nbits; ++b)
+        if ((bits >> b) & 1u)
+          ++run;
+        else if (run) {
+          runs.push_back(run);
+          run = 0;
+        }
+    }
+
+    if (run)
+      runs.push_back(run);
+
+    return(runs);
+  }
+
+
+
+  std::vector<double> BitMatrix::seriesAsVector(const uint s) const {
+    std::vector<double> v(nframes_);
+    for (uint t = 0; t < nframes_; ++t)
+      v[t] = (*this)(t, s);
+    return(v);
+  }
+
+
+
+  void BitMatrix::writeAscii(std::ostream& os, const std::string& meta, const bool series_as_rows) const {
+    os << "# " << meta << std::endl;
+    if (series_as_rows) {
+      os << boost::format("# %d %d (%d)\n") % nseries_ % nframes_ % 0;
+      for (uint s = 0; s < nseries_; ++s) {
+        for (uint t = 0; t < nframes_; ++t)
+          os << ((*this)(t, s) ? "1 " : "0 ");
+        os << std::endl;
+      }
+    } else {
+      os << boost::format("# %d %d (%d)\n") % nframes_ % nseries_ % 0;
+      for (uint t = 0; t < nframes_; ++t) {
+        for (uint s = 0; s < nseries_; ++s)
+          os << ((*this)(t, s) ? "1 " : "0 ");
+        os << std::endl;
+      }
+    }
+  }
+
+
+
+  void BitMatrix::readAscii(std::istream& is, const bool series_as_rows) {
+    std::string inbuf;
+    int m = 0, n = 0;
+
+    while (getline(is, inbuf).good())
+      if (sscanf(inbuf.c_str(), "# %d %d", &m, &n) == 2)
+        break;
+    if (m <= 0 || n <= 0)
+      throw(FileReadError("stream", "Could not find a valid size marker in matrix file"));
+
+    if (series_as_rows)
+      *this = BitMatrix(n, m);
+    else
+      *this = BitMatrix(m, n);
+
+    for (int j=0; j<m; ++j)
+      for (int i=0; i<n; ++i) {
+        double datum;
+        if (!(is >> datum)) {
+          std::ostringstream oss;
+          oss << "Read error in matrix file at (" << j << "," << i << ")";
+          throw(FileReadError("stream", oss.str()));
+        }
+        if (datum != 0.0) {
+          if (series_as_rows)
+            set(i, j);
+          else
+            set(j, i);
+        }
+      }
+  }
+
+
+
+  // Binary format is the magic string, an endian marker, the frame
+  // and series counts, the metadata, and then the raw words...
+  void BitMatrix::write(std::ostream& os, const std::string& meta) const {
+    os.write(bitmatrix_magic, strlen(bitmatrix_magic));
+    writeUInt(os, bitmatrix_endian);
+    writeUInt(os, nframes_);
+    writeUInt(os, nseries_);
+    writeUInt(os, meta.size());
+    os.write(meta.data(), meta.size());
+    if (!data_.empty())
+      os.write(reinterpret_cast<const char*>(&data_[0]), data_.size() * sizeof(Word));
+    if (!os.good())
+      throw(FileWriteError("stream", "Could not write BitMatrix"));
+  }
+
+
+
+  std::string BitMatrix::read(std::istream& is) {
+    char magic[sizeof(bitmatrix_magic)];
+    uint nmagic = strlen(bitmatrix_magic);
+    if (!is.read(magic, nmagic) || strncmp(magic, bitmatrix_magic, nmagic) != 0)
+      throw(FileReadError("stream", "Not a LOOS BitMatrix file"));
+    if (readUInt(is) != bitmatrix_endian)
+      throw(FileReadError("stream", "BitMatrix file was written on a machine with a different byte order"));
+
+    uint nframes = readUInt(is);
+    uint nseries = readUInt(is);
+    std::string meta(readUInt(is), ' ');
+    if (!meta.empty() && !is.read(&meta[0], meta.size()))
+      throw(FileReadError("stream", "Unexpected end of BitMatrix data"));
+
+    *this = BitMatrix(nframes, nseries);
+    if (!data_.empty() && !is.read(reinterpret_cast<char*>(&data_[0]), data_.size() * sizeof(Word)))
+      throw(FileReadError("stream", "Unexpected end of BitMatrix data"));
+
+    return(meta);
+  }
+
+
+
+  BitMatrix readBitMatrix(const std::string& fname, const bool series_as_rows) {
+    BitMatrix M;
+    bool binary = fname.size() > 5 && fname.substr(fname.size() - 5) == ".bits";
+
+    std::ifstream ifs(fname.c_str(), binary ? std::ios::in | std::ios::binary : std::ios::in);
+    if (!ifs)
+      throw(FileOpenError(fname));
+
+    if (binary)
+      M.read(ifs);
+    else
+      M.readAscii(ifs, series_as_rows);
+
+    return(M);
+  }
+
+}
@@ -0,0 +1,146 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(LOOS_BITMATRIX_HPP)
+#define LOOS_BITMATRIX_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <loos_defs.hpp>
+
+
+namespace loos {
+
+  //! Compact storage for boolean time series (i.e. contacts or hydrogen bonds)
+  /**
+   * A BitMatrix is a frames x series matrix of flags, such as whether
+   * a pair of atoms is in contact or hydrogen bonded in each frame of
+   * a trajectory.  Each series is packed into 64-bit words that are
+   * contiguous in time, so it takes 1/32 of the space of a matrix of
+   * ints and the common analyses (occupancy, lagged coincidence for
+   * survival and autocorrelation functions, and lifetimes) are done
+   * with word-parallel bit operations.
+   *
+   * A BitMatrix can be written out as ASCII (in the same format as
+   * writeAsciiMatrix(), with either frames or series as the rows) or
+   * in a compact binary format.
+   */
+  class BitMatrix {
+  public:
+    typedef boost::uint64_t    Word;
+
+    BitMatrix() : nframes_(0), nseries_(0), nwords_(0) { }
+
+    //! Create a matrix with all flags cleared
+    BitMatrix(const uint nframes, const uint nseries);
+
+    uint frames() const { return(nframes_); }
+    uint series() const { return(nseries_); }
+
+    //! Is the flag set for series \a s at frame \a t?
+    bool operator()(const uint t, const uint s) const {
+      return((data_[index(s, t)] >> (t % 64)) & 1u);
+    }
+
+    void set(const uint t, const uint s, const bool b = true) {
+      Word mask = static_cast<Word>(1) << (t % 64);
+      if (b)
+        data_[index(s, t)] |= mask;
+      else
+        data_[index(s, t)] &= ~mask;
+    }
+
+    //! Number of frames the flag is set for a series
+    ulong occupancy(const uint s) const { return(occupancy(s, 0, nframes_)); }
+
+    //! Number of frames in [begin, end) the flag is set for a series
+    ulong occupancy(const uint s, const uint begin, const uint end) const;
+
+    //! Number of frames t in [0, end) where both t and t + tau are set
+    ulong coincidence(const uint s, const uint tau, const uint end) const;
+
+    //! Number of frames t where both t and t + tau are set
+    ulong coincidence(const uint s, const uint tau) const {
+      return(tau >= nframes_ ? 0 : coincidence(s, tau, nframes_ - tau));
+    }
+
+    //! True if the flag is ever set for a series
+    bool any(const uint s) const;
+
+    //! Autocorrelation of a series, as with TimeSeries::correl(max_time)
+    /**
+     * The series is normalized (mean subtracted and scaled by the
+     * standard deviation) and the lagged products are computed from
+     * the occupancies and coincidences, so this is O(frames * max_time
+     * / 64) rather than O(frames * max_time).
+     */
+    std::vector<double> autocorrelation(const uint s, const uint max_time, const double tol = 1e-8) const;
+
+    //! Lengths of each run of consecutive set flags in a series
+    std::vector<uint> lifetimes(const uint s) const;
+
+    //! Extract a series as 0/1 values
+    std::vector<double> seriesAsVector(const uint s) const;
+
+    //! Write as an ASCII matrix (compatible with readAsciiMatrix())
+    /**
+     * If \a series_as_rows is true, then each series is written as a
+     * row (i.e. the transpose of the frames x series matrix).
+     */
+    void writeAscii(std::ostream& os, const std::string& meta, const bool series_as_rows = false) const;
+
+    //! Read an ASCII matrix of 0/1 (non-zero) values
+    void readAscii(std::istream& is, const bool series_as_rows = false);
+
+    //! Write in the compact binary format
+    void write(std::ostream& os, const std::string& meta = "") const;
+
+    //! Read the compact binary format, returning the stored metadata
+    std::string read(std::istream& is);
+
+
+  private:
+    ulong index(const uint s, const uint t) const { return(static_cast<ulong>(s) * nwords_ + t / 64); }
+
+    // Word holding bits [p, p+64) of a series, zero-filled past the end
+    Word bitsFrom(const Word* row, const ulong p) const;
+
+    uint nframes_, nseries_, nwords_;
+    std::vector<Word> data_;
+  };
+
+
+  //! Read a BitMatrix from a file
+  /**
+   * Files ending in ".bits" are read as binary, anything else as an
+   * ASCII matrix (where \a series_as_rows has the same meaning as for
+   * BitMatrix::readAscii()).
+   */
+  BitMatrix readBitMatrix(const std::string& fname, const bool series_as_rows = false);
+
+}
+
+
+#endif
@@ -0,0 +1,87 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <BlockAverager.hpp>
+
+#include <cmath>
+
+
+namespace loos {
+
+
+  // Each completed pair is passed up a level, so a value touches
+  // two levels on average...
+  void BlockAverager::add(uint k, double x) {
+    while (true) {
+      if (k >= _levels.size())
+        _levels.push_back(Level());
+      Level& level = _levels[k];
+
+      ++level.n;
+      double d = x - level.mean;
+      level.mean += d / level.n;
+      level.m2 += d * (x - level.mean);
+
+      if (!level.has_pending) {
+        level.pending = x;
+        level.has_pending = true;
+        return;
+      }
+
+      x = (level.pending + x) / 2.0;
+      level.has_pending = false;
+      ++k;
+    }
+  }
+
+
+  uint BlockAverager::levels() const {
+    uint k = 0;
+    while (k < _levels.size() && _levels[k].n >= 2)
+      ++k;
+    return(k);
+  }
+
+
+  double BlockAverager::variance(const uint k) const {
+    if (blocks(k) < 2)
+      return(0.0);
+    return(_levels[k].m2 / (_levels[k].n - 1));
+  }
+
+
+  double BlockAverager::standardError(const uint k) const {
+    if (blocks(k) < 2)
+      return(0.0);
+    return(sqrt(variance(k) / _levels[k].n));
+  }
+
+
+  // For Gaussian block averages, the relative error in the standard
+  // error is 1/sqrt(2(n-1))...
+  double BlockAverager::standardErrorError(const uint k) const {
+    if (blocks(k) < 2)
+      return(0.0);
+    return(standardError(k) / sqrt(2.0 * (_levels[k].n - 1)));
+  }
+
+}
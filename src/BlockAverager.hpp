@@ -0,0 +1,102 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(LOOS_BLOCKAVERAGER_HPP)
+#define LOOS_BLOCKAVERAGER_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+
+
+namespace loos {
+
+  //! Streaming Flyvbjerg-Petersen block averaging
+  /**
+   * Values are added one at a time, as a trajectory is read.  Each
+   * level k holds the averages of consecutive blocks of 2^k values:
+   * whenever two blocks at a level are complete, their average is
+   * passed up to the next level (the "blocking transformation" of
+   * Flyvbjerg & Petersen, J. Chem. Phys. (1989) 91:461-466).  The
+   * mean and variance of the block averages at each level are
+   * accumulated with Welford's algorithm.
+   *
+   * Every block size is handled in the same pass, the total work is
+   * O(N), and only a few numbers are kept per level, so memory is
+   * O(log N).  The series itself is never stored.
+   *
+   * As with TimeSeries::block_var(), a partial block at the end of
+   * the data is not used.
+   */
+  class BlockAverager {
+  public:
+    BlockAverager() : _n(0) { }
+
+    //! Add the next value of the series
+    void push_back(const double x) {
+      ++_n;
+      add(0, x);
+    }
+
+    //! Number of values added
+    ulong size() const { return(_n); }
+
+    //! Average of all values added
+    double average() const { return(_levels.empty() ? 0.0 : _levels[0].mean); }
+
+    //! Number of levels with at least two blocks (i.e. a defined variance)
+    uint levels() const;
+
+    //! Number of values in each block at level \a k
+    ulong blockSize(const uint k) const { return(1ul << k); }
+
+    //! Number of complete blocks at level \a k
+    ulong blocks(const uint k) const { return(k < _levels.size() ? _levels[k].n : 0); }
+
+    //! Variance of the block averages at level \a k (using N-1)
+    double variance(const uint k) const;
+
+    //! Standard error of the mean estimated from the blocks at level \a k
+    double standardError(const uint k) const;
+
+    //! Uncertainty in standardError(k), from the number of blocks
+    double standardErrorError(const uint k) const;
+
+  private:
+    struct Level {
+      Level() : n(0), mean(0.0), m2(0.0), pending(0.0), has_pending(false) { }
+
+      ulong n;
+      double mean, m2;
+      double pending;        // First block of a pair still waiting for its partner
+      bool has_pending;
+    };
+
+    void add(const uint k, const double x);
+
+    ulong _n;
+    std::vector<Level> _levels;
+  };
+
+}
+
+
+#endif
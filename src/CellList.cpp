@@ -0,0 +1,305 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <CellList.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace loos {
+
+
+  namespace {
+
+    // Collects indices for CellList::neighbors()
+    struct IndexCollector {
+      IndexCollector(std::vector<uint>& v) : list(v) { }
+      void operator()(const uint i, const double) { list.push_back(i); }
+      std::vector<uint>& list;
+    };
+
+    // Collects pairs for CellList::pairs()
+    struct PairCollector {
+      PairCollector(std::vector<CellList::Pair>& v) : list(v) { }
+      void operator()(const uint i, const uint j, const double) { list.push_back(CellList::Pair(i, j)); }
+      std::vector<CellList::Pair>& list;
+    };
+
+  }
+
+
+  const double CellList::cutoff_padding = 1e-6;
+
+
+  CellList::CellList(const double cutoff) :
+    cutoff_(cutoff),
+    cutoff2_(cutoff * cutoff),
+    periodic_(false),
+    triclinic_(false),
+    nx_(0), ny_(0), nz_(0)
+  {
+    if (cutoff <= 0.0)
+      throw(std::logic_error("CellList cutoff must be positive"));
+  }
+
+
+  void CellList::update(const std::vector<GCoord>& coords) {
+    periodic_ = false;
+    triclinic_ = false;
+    coords_ = coords;
+
+    if (coords_.empty()) {
+      nx_ = ny_ = nz_ = 0;
+      cell_start_.clear();
+      cell_atoms_.clear();
+      return;
+    }
+
+    GCoord lo = coords_[0];
+    GCoord hi = coords_[0];
+    for (std::vector<GCoord>::const_iterator i = coords_.begin(); i != coords_.end(); ++i)
+      for (uint k=0; k<3; ++k) {
+        if ((*i)[k] < lo[k])
+          lo[k] = (*i)[k];
+        if ((*i)[k] > hi[k])
+          hi[k] = (*i)[k];
+      }
+
+    origin_ = lo;
+    GCoord extent = hi - lo;
+    int n[3];
+    for (uint k=0; k<3; ++k)
+      n[k] = std::max(1, static_cast<int>(floor(extent[k] / cutoff_)));
+
+    // Sparse systems (i.e. a few nodes spread over a large volume)
+    // would otherwise generate far more cells than points...
+    double limit = std::max(27.0, 8.0 * coords_.size());
+    while (static_cast<double>(n[0]) * n[1] * n[2] > limit)
+      for (uint k=0; k<3; ++k)
+        n[k] = std::max(1, static_cast<int>(n[k] * 0.8));
+
+    nx_ = n[0];
+    ny_ = n[1];
+    nz_ = n[2];
+    for (uint k=0; k<3; ++k) {
+      width_[k] = extent[k] / n[k];
+      if (width_[k] < cutoff_)
+        width_[k] = cutoff_;
+      offsets_[k].clear();
+      offsets_[k].push_back(-1);
+      offsets_[k].push_back(0);
+      offsets_[k].push_back(1);
+    }
+
+    bin();
+  }
+
+
+  void CellList::update(const std::vector<GCoord>& coords, const GCoord& box) {
+    periodic_ = true;
+    triclinic_ = false;
+    box_ = box;
+    origin_ = GCoord(0,0,0);
+
+    coords_.resize(coords.size());
+    for (uint i=0; i<coords.size(); ++i) {
+      GCoord c = coords[i];
+      for (uint k=0; k<3; ++k)
+        c[k] -= floor(c[k] / box[k]) * box[k];
+      coords_[i] = c;
+    }
+
+    int n[3];
+    for (uint k=0; k<3; ++k) {
+      if (box[k] <= 0.0)
+        throw(std::logic_error("CellList requires a non-zero periodic box"));
+      n[k] = std::max(1, static_cast<int>(floor(box[k] / cutoff_)));
+      width_[k] = box[k] / n[k];
+
+      // With fewer than three cells along a dimension, the neighboring
+      // cells alias each other, so only visit the unique ones...
+      offsets_[k].clear();
+      if (n[k] >= 3)
+        offsets_[k].push_back(-1);
+      offsets_[k].push_back(0);
+      if (n[k] >= 2)
+        offsets_[k].push_back(1);
+    }
+
+    nx_ = n[0];
+    ny_ = n[1];
+    nz_ = n[2];
+
+    bin();
+  }
+
+
+  // Cells are counted along each box vector in fractional
+  // coordinates.  Points within the cutoff differ in fractional
+  // coordinate k by at most cutoff / height[k], so making the cells at
+  // least that wide means only neighboring cells need be searched.
+  void CellList::update(const std::vector<GCoord>& coords, const TriclinicBox& cell) {
+    if (cell.isOrthorhombic()) {
+      update(coords, cell.lengths());
+      return;
+    }
+
+    periodic_ = true;
+    triclinic_ = true;
+    cell_ = cell;
+    box_ = cell.lengths();
+    origin_ = GCoord(0,0,0);
+
+    coords_.resize(coords.size());
+    for (uint i=0; i<coords.size(); ++i) {
+      GCoord s = cell.toFractional(coords[i]);
+      for (uint k=0; k<3; ++k)
+        s[k] -= floor(s[k]);
+      coords_[i] = cell.fromFractional(s);
+    }
+
+    GCoord heights = cell.heights();
+    int n[3];
+    for (uint k=0; k<3; ++k) {
+      if (heights[k] <= 0.0)
+        throw(std::logic_error("CellList requires a non-zero periodic box"));
+      n[k] = std::max(1, static_cast<int>(floor(heights[k] / cutoff_)));
+      width_[k] = 1.0 / n[k];
+
+      offsets_[k].clear();
+      if (n[k] >= 3)
+        offsets_[k].push_back(-1);
+      offsets_[k].push_back(0);
+      if (n[k] >= 2)
+        offsets_[k].push_back(1);
+    }
+
+    nx_ = n[0];
+    ny_ = n[1];
+    nz_ = n[2];
+
+    bin();
+  }
+
+
+  void CellList::update(const AtomicGroup& grp) {
+    std::vector<GCoord> coords(grp.size());
+    for (uint i=0; i<grp.size(); ++i)
+      coords[i] = grp[i]->coords();
+
+    if (grp.isTriclinic())
+      update(coords, grp.periodicCell());
+    else if (grp.isPeriodic())
+      update(coords, grp.periodicBox());
+    else
+      update(coords);
+  }
+
+
+  void CellList::cellCoords(const GCoord& c, int& x, int& y, int& z) const {
+    int idx[3];
+    int n[3] = { nx_, ny_, nz_ };
+
+    if (triclinic_) {
+      GCoord s = cell_.toFractional(c);
+      for (uint k=0; k<3; ++k) {
+        double u = s[k] - floor(s[k]);
+        idx[k] = std::min(n[k] - 1, static_cast<int>(floor(u / width_[k])));
+      }
+
+      x = idx[0];
+      y = idx[1];
+      z = idx[2];
+      return;
+    }
+
+    for (uint k=0; k<3; ++k) {
+      double u = c[k];
+      if (periodic_)
+        u -= floor(u / box_[k]) * box_[k];
+      double f = floor((u - origin_[k]) / width_[k]);
+
+      // Clamp to one cell beyond the grid so points far outside a
+      // non-periodic grid still map onto (empty) border cells
+      if (f < -1.0)
+        f = -1.0;
+      else if (f > n[k])
+        f = n[k];
+      idx[k] = static_cast<int>(f);
+      if (periodic_ && idx[k] >= n[k])
+        idx[k] = n[k] - 1;
+      else if (!periodic_ && idx[k] == n[k] && u - origin_[k] <= n[k] * width_[k])
+        idx[k] = n[k] - 1;
+    }
+
+    x = idx[0];
+    y = idx[1];
+    z = idx[2];
+  }
+
+
+  // Counting sort of points into cells.  The binned points all lie
+  // within the grid, but round-off can put a point on the upper edge
+  // one cell past the end, so the cell indices are clamped.
+  void CellList::bin() {
+    uint ncells = nx_ * ny_ * nz_;
+    std::vector<uint> cell_of(coords_.size());
+
+    cell_start_.assign(ncells + 1, 0);
+    for (uint i=0; i<coords_.size(); ++i) {
+      int x, y, z;
+      cellCoords(coords_[i], x, y, z);
+      x = std::max(0, std::min(x, nx_ - 1));
+      y = std::max(0, std::min(y, ny_ - 1));
+      z = std::max(0, std::min(z, nz_ - 1));
+      uint cell = (z * ny_ + y) * nx_ + x;
+      cell_of[i] = cell;
+      ++cell_start_[cell+1];
+    }
+
+    for (uint i=0; i<ncells; ++i)
+      cell_start_[i+1] += cell_start_[i];
+
+    std::vector<uint> fill(cell_start_.begin(), cell_start_.end() - 1);
+    cell_atoms_.resize(coords_.size());
+    for (uint i=0; i<coords_.size(); ++i)
+      cell_atoms_[fill[cell_of[i]]++] = i;
+  }
+
+
+  void CellList::neighbors(const GCoord& c, std::vector<uint>& result) const {
+    result.clear();
+    IndexCollector collector(result);
+    forEachNeighbor(c, collector);
+  }
+
+
+  std::vector<CellList::Pair> CellList::pairs() const {
+    std::vector<Pair> result;
+    PairCollector collector(result);
+    forEachPair(collector);
+    return(result);
+  }
+
+}
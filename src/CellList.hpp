@@ -0,0 +1,223 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(LOOS_CELLLIST_HPP)
+#define LOOS_CELLLIST_HPP
+
+#include <vector>
+#include <utility>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+#include <TriclinicBox.hpp>
+#include <AtomicGroup.hpp>
+
+
+namespace loos {
+
+  //! Spatial hashing of coordinates for cutoff-limited neighbor searches
+  /**
+   * The CellList bins a set of coordinates into cubic-ish cells that
+   * are at least as wide as the cutoff, so that all points within the
+   * cutoff of a given location are found by scanning only the 27
+   * surrounding cells.  Building the list is O(N) and finding all
+   * pairs within the cutoff is O(N) for a system of uniform density,
+   * as opposed to the O(N^2) all-to-all scan.
+   *
+   * If a periodic box is given (or the AtomicGroup passed to update()
+   * is periodic), then the cells tile the box and neighbor distances
+   * use the minimum image convention.  Otherwise, the cells cover the
+   * bounding box of the coordinates.  Note that in the periodic case,
+   * the cutoff should be no more than half of the smallest box length.
+   *
+   * Triclinic cells are binned in fractional coordinates, with the
+   * number of cells along each box vector set by the distance
+   * between opposite faces of the cell (see TriclinicBox::heights()),
+   * so the same 27 cells still cover the cutoff.
+   *
+   * The indices reported by the CellList refer to the order of the
+   * coordinates passed to update().
+   *
+   \code
+   CellList cells(8.0);
+   cells.update(group);
+   std::vector< std::pair<uint, uint> > contacts = cells.pairs();
+   \endcode
+   */
+  class CellList {
+  public:
+    typedef std::pair<uint, uint>     Pair;
+
+    explicit CellList(const double cutoff);
+
+    //! A cutoff slightly larger than \a d, for when the CellList only picks candidates
+    /**
+     * Neighbor distances are computed from the wrapped (or binned)
+     * coordinates, so they can differ by round-off from the same
+     * distance computed some other way.  When the candidates found by
+     * the CellList are checked again with some other distance test,
+     * building the CellList with paddedCutoff(d) makes sure round-off
+     * never drops a pair that the test would accept.
+     */
+    static double paddedCutoff(const double d) { return(d * (1.0 + cutoff_padding)); }
+
+    //! Bin a set of coordinates (non-periodic)
+    void update(const std::vector<GCoord>& coords);
+
+    //! Bin a set of coordinates in the given periodic box
+    void update(const std::vector<GCoord>& coords, const GCoord& box);
+
+    //! Bin a set of coordinates in the given (possibly triclinic) periodic cell
+    void update(const std::vector<GCoord>& coords, const TriclinicBox& cell);
+
+    //! Bin the atoms in a group, using the group's box if it is periodic
+    void update(const AtomicGroup& grp);
+
+    double cutoff() const { return(cutoff_); }
+    bool isPeriodic() const { return(periodic_); }
+    bool isTriclinic() const { return(triclinic_); }
+
+    //! Number of points binned by the last update()
+    uint size() const { return(coords_.size()); }
+
+    //! The (possibly wrapped) coordinate for the ith point
+    const GCoord& coords(const uint i) const { return(coords_[i]); }
+
+    //! Squared distance between a location and the ith point (minimum image, if periodic)
+    double distance2(const GCoord& c, const uint i) const {
+      GCoord d = coords_[i] - c;
+      if (triclinic_)
+        return(cell_.minimumImage(d).length2());
+      if (periodic_)
+        d.reimage(box_);
+      return(d.length2());
+    }
+
+    //! Indices of the binned points within the cutoff of \a c
+    void neighbors(const GCoord& c, std::vector<uint>& result) const;
+
+    //! Indices of the binned points within the cutoff of \a c
+    std::vector<uint> neighbors(const GCoord& c) const {
+      std::vector<uint> result;
+      neighbors(c, result);
+      return(result);
+    }
+
+    //! All unique pairs of points (i < j) within the cutoff
+    std::vector<Pair> pairs() const;
+
+
+    //! Calls f(i, d2) for every binned point i within the cutoff of \a c
+    template<class Functor>
+    void forEachNeighbor(const GCoord& c, Functor& f) const {
+      if (coords_.empty())
+        return;
+
+      int cx, cy, cz;
+      cellCoords(c, cx, cy, cz);
+
+      for (uint k=0; k<offsets_[2].size(); ++k) {
+        int z = cz + offsets_[2][k];
+        if (!wrapIndex(z, nz_))
+          continue;
+        for (uint j=0; j<offsets_[1].size(); ++j) {
+          int y = cy + offsets_[1][j];
+          if (!wrapIndex(y, ny_))
+            continue;
+          for (uint i=0; i<offsets_[0].size(); ++i) {
+            int x = cx + offsets_[0][i];
+            if (!wrapIndex(x, nx_))
+              continue;
+
+            uint cell = (z * ny_ + y) * nx_ + x;
+            for (uint a = cell_start_[cell]; a < cell_start_[cell+1]; ++a) {
+              uint idx = cell_atoms_[a];
+              double d2 = distance2(c, idx);
+              if (d2 <= cutoff2_)
+                f(idx, d2);
+            }
+          }
+        }
+      }
+    }
+
+
+    //! Calls f(i, j, d2) once for every unique pair of points (i < j) within the cutoff
+    template<class Functor>
+    void forEachPair(Functor& f) const {
+      PairForwarder<Functor> fwd(f);
+      for (uint i=0; i<coords_.size(); ++i) {
+        fwd.i = i;
+        forEachNeighbor(coords_[i], fwd);
+      }
+    }
+
+
+  private:
+
+    // Relative padding used by paddedCutoff()
+    static const double cutoff_padding;
+
+    // Adapts a pair functor to the neighbor interface, filtering so
+    // each pair is only visited once...
+    template<class Functor>
+    struct PairForwarder {
+      PairForwarder(Functor& f) : func(f), i(0) { }
+      void operator()(const uint j, const double d2) {
+        if (j > i)
+          func(i, j, d2);
+      }
+
+      Functor& func;
+      uint i;
+    };
+
+    void bin();
+    void cellCoords(const GCoord& c, int& x, int& y, int& z) const;
+
+    // Maps a cell index into the grid, wrapping if periodic.  Returns
+    // false if the index falls outside a non-periodic grid
+    bool wrapIndex(int& i, const int n) const {
+      if (i < 0 || i >= n) {
+        if (!periodic_)
+          return(false);
+        i = (i % n + n) % n;
+      }
+      return(true);
+    }
+
+
+    double cutoff_, cutoff2_;
+    bool periodic_, triclinic_;
+    GCoord box_, origin_, width_;
+    TriclinicBox cell_;
+    int nx_, ny_, nz_;
+
+    std::vector<int> offsets_[3];
+    std::vector<GCoord> coords_;
+    std::vector<uint> cell_start_;
+    std::vector<uint> cell_atoms_;
+  };
+
+}
+
+
+#endif
@@ -0,0 +1,228 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <ContactMap.hpp>
+
+#include <algorithm>
+#include <limits>
+
+
+namespace loos {
+
+
+  namespace {
+
+    // Tracks the closest approach and number of atom pairs between
+    // the current row group and each column group it touches
+    struct Accumulator {
+      Accumulator(const std::vector<uint>& owner_, const double inner2_,
+                  std::vector<double>& best_, std::vector<uint>& count_, std::vector<uint>& touched_) :
+        owner(owner_), inner2(inner2_), best(best_), count(count_), touched(touched_), first_col(0) { }
+
+      void operator()(const uint i, const double d2) {
+        uint c = owner[i];
+        if (c < first_col || d2 < inner2)
+          return;
+
+        if (count[c] == 0)
+          touched.push_back(c);
+        ++count[c];
+        if (d2 < best[c])
+          best[c] = d2;
+      }
+
+      const std::vector<uint>& owner;
+      double inner2;
+      std::vector<double>& best;
+      std::vector<uint>& count;
+      std::vector<uint>& touched;
+      uint first_col;
+    };
+
+
+    // Flattens groups into a list of atoms (in order), recording
+    // where each group starts
+    void flatten(const std::vector<AtomicGroup>& groups, std::vector<pAtom>& atoms, std::vector<uint>& start) {
+      start.resize(groups.size() + 1);
+      start[0] = 0;
+      for (uint j=0; j<groups.size(); ++j) {
+        std::copy(groups[j].begin(), groups[j].end(), std::back_inserter(atoms));
+        start[j+1] = atoms.size();
+      }
+    }
+
+
+    bool contactLess(const ContactMap::Contact& c, const uint j) {
+      return(c.second < j);
+    }
+
+  }
+
+
+  ContactMap::ContactMap(const std::vector<AtomicGroup>& groups, const double cutoff, const Measure measure) :
+    symmetric_(true),
+    centers_(measure == CENTERS),
+    inner2_(0.0),
+    cells_(cutoff),
+    rows_(groups),
+    cols_(groups)
+  {
+    initialize();
+  }
+
+
+  ContactMap::ContactMap(const std::vector<AtomicGroup>& rows, const std::vector<AtomicGroup>& cols, const double cutoff, const Measure measure) :
+    symmetric_(false),
+    centers_(measure == CENTERS),
+    inner2_(0.0),
+    cells_(cutoff),
+    rows_(rows),
+    cols_(cols)
+  {
+    initialize();
+  }
+
+
+  // With CENTERS, each group is a single point, so the "atom" lists
+  // are just the groups themselves
+  void ContactMap::initialize() {
+    if (centers_) {
+      row_start_.resize(rows_.size() + 1);
+      for (uint j=0; j<=rows_.size(); ++j)
+        row_start_[j] = j;
+      col_owner_.resize(cols_.size());
+      for (uint j=0; j<cols_.size(); ++j)
+        col_owner_[j] = j;
+      return;
+    }
+
+    std::vector<uint> col_start;
+    flatten(cols_, col_atoms_, col_start);
+    col_owner_.resize(col_atoms_.size());
+    for (uint j=0; j<cols_.size(); ++j)
+      for (uint i=col_start[j]; i<col_start[j+1]; ++i)
+        col_owner_[i] = j;
+
+    if (symmetric_)
+      row_start_ = col_start;
+    else
+      flatten(rows_, row_atoms_, row_start_);
+  }
+
+
+  void ContactMap::gather(const std::vector<AtomicGroup>& groups, const std::vector<pAtom>& atoms, std::vector<GCoord>& coords) const {
+    if (centers_) {
+      coords.resize(groups.size());
+      for (uint j=0; j<groups.size(); ++j)
+        coords[j] = groups[j].centerOfMass();
+      return;
+    }
+
+    coords.resize(atoms.size());
+    for (uint i=0; i<atoms.size(); ++i)
+      coords[i] = atoms[i]->coords();
+  }
+
+
+  void ContactMap::update() {
+    gather(cols_, col_atoms_, col_coords_);
+    cells_.update(col_coords_);
+    search();
+  }
+
+
+  void ContactMap::update(const GCoord& box) {
+    gather(cols_, col_atoms_, col_coords_);
+    cells_.update(col_coords_, box);
+    search();
+  }
+
+
+  void ContactMap::update(const TriclinicBox& cell) {
+    gather(cols_, col_atoms_, col_coords_);
+    cells_.update(col_coords_, cell);
+    search();
+  }
+
+
+  // The atoms of each row group are looked up in the cell list in
+  // turn, so the contacts come out grouped by row.  Within a row, the
+  // columns are sorted (there are usually only a few of them).
+  void ContactMap::search() {
+    if (!symmetric_)
+      gather(rows_, row_atoms_, row_coords_);
+    const std::vector<GCoord>& coords = symmetric_ ? col_coords_ : row_coords_;
+
+    uint ncols = cols_.size();
+    std::vector<double> best(ncols, std::numeric_limits<double>::max());
+    std::vector<uint> count(ncols, 0);
+    std::vector<uint> touched;
+    Accumulator acc(col_owner_, inner2_, best, count, touched);
+
+    contacts_.clear();
+    contact_start_.resize(rows_.size() + 1);
+    contact_start_[0] = 0;
+
+    for (uint j=0; j<rows_.size(); ++j) {
+      acc.first_col = symmetric_ ? j+1 : 0;
+      for (uint i=row_start_[j]; i<row_start_[j+1]; ++i)
+        cells_.forEachNeighbor(coords[i], acc);
+
+      std::sort(touched.begin(), touched.end());
+      for (std::vector<uint>::const_iterator c = touched.begin(); c != touched.end(); ++c) {
+        contacts_.push_back(Contact(j, *c, best[*c], count[*c]));
+        best[*c] = std::numeric_limits<double>::max();
+        count[*c] = 0;
+      }
+      touched.clear();
+      contact_start_[j+1] = contacts_.size();
+    }
+  }
+
+
+  const ContactMap::Contact* ContactMap::find(const uint i, const uint j) const {
+    uint a = i;
+    uint b = j;
+    if (symmetric_ && b < a)
+      std::swap(a, b);
+    if (a >= rows_.size() || contact_start_.size() <= a+1)
+      return(0);
+
+    std::vector<Contact>::const_iterator end = contacts_.begin() + contact_start_[a+1];
+    std::vector<Contact>::const_iterator k = std::lower_bound(contacts_.begin() + contact_start_[a], end, b, contactLess);
+    if (k == end || k->second != b)
+      return(0);
+    return(&(*k));
+  }
+
+
+  std::vector<ContactMap::Contact> ContactMap::within(const double d) const {
+    double d2 = d * d;
+    std::vector<Contact> result;
+    for (std::vector<Contact>::const_iterator i = contacts_.begin(); i != contacts_.end(); ++i)
+      if (i->distance2 <= d2)
+        result.push_back(*i);
+
+    return(result);
+  }
+
+}
@@ -0,0 +1,159 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(LOOS_CONTACTMAP_HPP)
+#define LOOS_CONTACTMAP_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+#include <TriclinicBox.hpp>
+#include <AtomicGroup.hpp>
+#include <CellList.hpp>
+
+
+namespace loos {
+
+  //! Sparse map of which groups of atoms are within a cutoff of each other
+  /**
+   * Contact tools usually ask, for every pair of residues, whether
+   * any of their atoms (or their centers of mass) are within some
+   * distance.  Checking every pair of groups, and every pair of atoms
+   * between them, is O(N^2) per frame.  The ContactMap instead bins
+   * the atoms into a CellList and only visits the atom pairs that are
+   * within the cutoff, so building the map is linear in the number of
+   * atoms.
+   *
+   * For each pair of groups with at least one pair of atoms within
+   * the cutoff, the map holds the smallest squared distance between
+   * them and the number of atom pairs within the cutoff.  With
+   * CENTERS, each group is represented by its center of mass instead.
+   * Pairs of groups that are not in the map are farther apart than
+   * the cutoff, so any smaller threshold can be applied afterwards
+   * (see within()).
+   *
+   * A map is either built within a single list of groups, in which
+   * case only pairs with first < second are stored, or between a list
+   * of row groups and a list of column groups.  Atoms that are in
+   * more than one group are counted for each of them.
+   *
+   \code
+   std::vector<AtomicGroup> residues = subset.splitByResidue();
+   ContactMap map(residues, 4.0);
+   while (traj->readFrame()) {
+     traj->updateGroupCoords(model);
+     map.update();
+     for (std::vector<ContactMap::Contact>::const_iterator i = map.contacts().begin(); i != map.contacts().end(); ++i)
+       ...
+   }
+   \endcode
+   */
+  class ContactMap {
+  public:
+
+    //! How the distance between two groups is measured
+    enum Measure { MINIMUM, CENTERS };
+
+    //! A pair of groups within the cutoff
+    struct Contact {
+      Contact() : first(0), second(0), distance2(0.0), pairs(0) { }
+      Contact(const uint i, const uint j, const double d2, const uint n) : first(i), second(j), distance2(d2), pairs(n) { }
+
+      uint first, second;
+      double distance2;        //!< Smallest squared distance (or between centers)
+      uint pairs;              //!< Number of atom pairs within the cutoff
+    };
+
+
+    //! Map between all pairs of groups in a single list
+    ContactMap(const std::vector<AtomicGroup>& groups, const double cutoff, const Measure measure = MINIMUM);
+
+    //! Map between each of the \a rows groups and each of the \a cols groups
+    ContactMap(const std::vector<AtomicGroup>& rows, const std::vector<AtomicGroup>& cols, const double cutoff, const Measure measure = MINIMUM);
+
+    //! Ignore atom pairs that are closer than \a d (i.e. only consider a shell)
+    void innerCutoff(const double d) { inner2_ = d * d; }
+
+    //! Find the contacts for the current coordinates (non-periodic)
+    void update();
+
+    //! Find the contacts using the given periodic box
+    void update(const GCoord& box);
+
+    //! Find the contacts using the given (possibly triclinic) periodic cell
+    void update(const TriclinicBox& cell);
+
+
+    double cutoff() const { return(cells_.cutoff()); }
+    bool isSymmetric() const { return(symmetric_); }
+
+    uint rows() const { return(rows_.size()); }
+    uint cols() const { return(cols_.size()); }
+
+    //! Number of pairs of groups within the cutoff
+    uint size() const { return(contacts_.size()); }
+
+    //! All pairs of groups within the cutoff, sorted by row and then column
+    const std::vector<Contact>& contacts() const { return(contacts_); }
+
+    //! The contact between groups \a i and \a j, or null if they are not within the cutoff
+    const Contact* find(const uint i, const uint j) const;
+
+    //! True if groups \a i and \a j are within the cutoff
+    bool inContact(const uint i, const uint j) const { return(find(i, j) != 0); }
+
+    //! True if groups \a i and \a j are within \a d (which should be no more than the cutoff)
+    bool inContact(const uint i, const uint j, const double d) const {
+      const Contact* c = find(i, j);
+      return(c != 0 && c->distance2 <= d * d);
+    }
+
+    //! The contacts that are within \a d (which should be no more than the cutoff)
+    std::vector<Contact> within(const double d) const;
+
+  private:
+    void initialize();
+    void gather(const std::vector<AtomicGroup>& groups, const std::vector<pAtom>& atoms, std::vector<GCoord>& coords) const;
+    void search();
+
+
+    bool symmetric_;
+    bool centers_;
+    double inner2_;
+    CellList cells_;
+
+    std::vector<AtomicGroup> rows_, cols_;
+
+    // Atoms of each group, one group after another, and the group
+    // each (column) atom belongs to
+    std::vector<pAtom> row_atoms_, col_atoms_;
+    std::vector<uint> row_start_, col_owner_;
+    std::vector<GCoord> row_coords_, col_coords_;
+
+    std::vector<Contact> contacts_;
+    std::vector<uint> contact_start_;
+  };
+
+}
+
+
+#endif
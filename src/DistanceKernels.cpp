@@ -0,0 +1,189 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <DistanceKernels.hpp>
+
+#include <cmath>
+
+
+namespace loos {
+
+
+  namespace {
+
+    // This is Coord::reimage() for a single component, but taking the
+    // sign with copysign() rather than a branch so that loops calling
+    // it can be vectorized.
+    inline double reimage(const double d, const double box) {
+      double n = static_cast<int>(fabs(d) / box + 0.5);
+      return(d - copysign(n * box, d));
+    }
+
+  }
+
+
+  void PackedCoords::assign(const std::vector<GCoord>& coords) {
+    resize(coords.size());
+    for (uint i=0; i<coords.size(); ++i)
+      set(i, coords[i]);
+  }
+
+
+  void PackedCoords::assignCenters(const std::vector<AtomicGroup>& groups) {
+    resize(groups.size());
+    for (uint i=0; i<groups.size(); ++i)
+      set(i, groups[i].centerOfMass());
+  }
+
+
+
+  void distance2(const GCoord& c, const PackedCoords& p, std::vector<double>& d2) {
+    uint n = p.size();
+    d2.resize(n);
+    if (n == 0)
+      return;
+
+    const greal* x = p.x();
+    const greal* y = p.y();
+    const greal* z = p.z();
+    double cx = c[0], cy = c[1], cz = c[2];
+    double* out = &d2[0];
+
+    for (uint i=0; i<n; ++i) {
+      double dx = x[i] - cx;
+      double dy = y[i] - cy;
+      double dz = z[i] - cz;
+      out[i] = dx*dx + dy*dy + dz*dz;
+    }
+  }
+
+
+  void distance2(const GCoord& c, const PackedCoords& p, const GCoord& box, std::vector<double>& d2) {
+    uint n = p.size();
+    d2.resize(n);
+    if (n == 0)
+      return;
+
+    const greal* x = p.x();
+    const greal* y = p.y();
+    const greal* z = p.z();
+    double cx = c[0], cy = c[1], cz = c[2];
+    double bx = box[0], by = box[1], bz = box[2];
+    double* out = &d2[0];
+
+    for (uint i=0; i<n; ++i) {
+      double dx = reimage(x[i] - cx, bx);
+      double dy = reimage(y[i] - cy, by);
+      double dz = reimage(z[i] - cz, bz);
+      out[i] = dx*dx + dy*dy + dz*dz;
+    }
+  }
+
+
+  void lateralDistance2(const GCoord& c, const PackedCoords& p, const GCoord& box, std::vector<double>& d2) {
+    uint n = p.size();
+    d2.resize(n);
+    if (n == 0)
+      return;
+
+    const greal* x = p.x();
+    const greal* y = p.y();
+    double cx = c[0], cy = c[1];
+    double bx = box[0], by = box[1];
+    double* out = &d2[0];
+
+    for (uint i=0; i<n; ++i) {
+      double dx = reimage(x[i] - cx, bx);
+      double dy = reimage(y[i] - cy, by);
+      out[i] = dx*dx + dy*dy;
+    }
+  }
+
+
+  void distance2(const PackedCoords& a, const PackedCoords& b, const GCoord& box, std::vector<double>& d2) {
+    uint m = a.size();
+    uint n = b.size();
+    d2.resize(m * n);
+    if (m == 0 || n == 0)
+      return;
+
+    const greal* x = b.x();
+    const greal* y = b.y();
+    const greal* z = b.z();
+    double bx = box[0], by = box[1], bz = box[2];
+
+    for (uint j=0; j<m; ++j) {
+      double cx = a.x()[j], cy = a.y()[j], cz = a.z()[j];
+      double* out = &d2[j * n];
+      for (uint i=0; i<n; ++i) {
+        double dx = reimage(x[i] - cx, bx);
+        double dy = reimage(y[i] - cy, by);
+        double dz = reimage(z[i] - cz, bz);
+        out[i] = dx*dx + dy*dy + dz*dz;
+      }
+    }
+  }
+
+
+  void minimumImage(const GCoord& c, const PackedCoords& p, const GCoord& box, PackedCoords& displacements) {
+    uint n = p.size();
+    displacements.resize(n);
+    if (n == 0)
+      return;
+
+    const greal* x = p.x();
+    const greal* y = p.y();
+    const greal* z = p.z();
+    greal* ox = displacements.x();
+    greal* oy = displacements.y();
+    greal* oz = displacements.z();
+    double cx = c[0], cy = c[1], cz = c[2];
+    double bx = box[0], by = box[1], bz = box[2];
+
+    for (uint i=0; i<n; ++i) {
+      ox[i] = reimage(x[i] - cx, bx);
+      oy[i] = reimage(y[i] - cy, by);
+      oz[i] = reimage(z[i] - cz, bz);
+    }
+  }
+
+
+  // Only the distances that are in range need a square root, so
+  // these are picked out first...
+  uint histogramDistances(const std::vector<double>& d2, const double min, const double max, std::vector<double>& hist) {
+    double min2 = min * min;
+    double max2 = max * max;
+    double width = (max - min) / hist.size();
+    uint binned = 0;
+
+    for (uint i=0; i<d2.size(); ++i)
+      if (d2[i] < max2 && d2[i] > min2) {
+        double d = sqrt(d2[i]);
+        int bin = static_cast<int>((d - min) / width);
+        hist[bin]++;
+        ++binned;
+      }
+
+    return(binned);
+  }
+
+}
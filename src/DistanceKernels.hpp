@@ -0,0 +1,123 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(LOOS_DISTANCEKERNELS_HPP)
+#define LOOS_DISTANCEKERNELS_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+#include <AtomicGroup.hpp>
+
+
+namespace loos {
+
+  //! A set of coordinates stored as separate x, y, and z arrays
+  /**
+   * Tools that compare one point against many (or many against many)
+   * spend most of their time in Coord::distance2(), which copies a
+   * Coord, reimages it component by component, and returns one
+   * distance at a time.  Storing the coordinates as separate x, y,
+   * and z arrays (a "structure of arrays") lets the batch kernels
+   * below handle a whole array in one tight, branch-free loop that
+   * the compiler can vectorize.
+   *
+   * The batch kernels use the same arithmetic as Coord::reimage() and
+   * Coord::length2(), so they give exactly the same distances as the
+   * one-at-a-time methods.
+   */
+  class PackedCoords {
+  public:
+    PackedCoords() { }
+    explicit PackedCoords(const uint n) : x_(n), y_(n), z_(n) { }
+
+    uint size() const { return(x_.size()); }
+    bool empty() const { return(x_.empty()); }
+
+    void resize(const uint n) {
+      x_.resize(n);
+      y_.resize(n);
+      z_.resize(n);
+    }
+
+    void set(const uint i, const GCoord& c) {
+      x_[i] = c[0];
+      y_[i] = c[1];
+      z_[i] = c[2];
+    }
+
+    GCoord get(const uint i) const { return(GCoord(x_[i], y_[i], z_[i])); }
+
+    //! Packs a list of coordinates
+    void assign(const std::vector<GCoord>& coords);
+
+    //! Packs the center of mass of each group
+    void assignCenters(const std::vector<AtomicGroup>& groups);
+
+    const greal* x() const { return(&x_[0]); }
+    const greal* y() const { return(&y_[0]); }
+    const greal* z() const { return(&z_[0]); }
+
+    greal* x() { return(&x_[0]); }
+    greal* y() { return(&y_[0]); }
+    greal* z() { return(&z_[0]); }
+
+  private:
+    std::vector<greal> x_, y_, z_;
+  };
+
+
+
+  //! Squared distance from \a c to each point in \a p
+  void distance2(const GCoord& c, const PackedCoords& p, std::vector<double>& d2);
+
+  //! Squared distance from \a c to each point in \a p, using the minimum image in \a box
+  void distance2(const GCoord& c, const PackedCoords& p, const GCoord& box, std::vector<double>& d2);
+
+  //! Squared distance in the xy-plane from \a c to each point in \a p, using the minimum image in \a box
+  void lateralDistance2(const GCoord& c, const PackedCoords& p, const GCoord& box, std::vector<double>& d2);
+
+  //! Squared distances between every point in \a a and every point in \a b (minimum image)
+  /**
+   * The result is stored by rows, so the distance between a[i] and
+   * b[j] is d2[i * b.size() + j].
+   */
+  void distance2(const PackedCoords& a, const PackedCoords& b, const GCoord& box, std::vector<double>& d2);
+
+  //! Minimum image displacement from \a c to each point in \a p (i.e. p[i] - c, reimaged)
+  void minimumImage(const GCoord& c, const PackedCoords& p, const GCoord& box, PackedCoords& displacements);
+
+
+  //! Histograms distances given as squared distances
+  /**
+   * Each distance strictly between \a min and \a max is added to the
+   * histogram \a hist (which sets the number of bins), as the RDF
+   * tools do.  Distances to be skipped (e.g. self-pairs) can be given
+   * as a negative squared distance.  Returns the number of distances
+   * that were binned.
+   */
+  uint histogramDistances(const std::vector<double>& d2, const double min, const double max, std::vector<double>& hist);
+
+}
+
+
+#endif
@@ -20,6 +20,10 @@
 */    
 
 #include <HBondDetector.hpp>
+#include <exceptions.hpp>
+
+#include <algorithm>
+#include <cmath>
 
 namespace loos {
     HBondDetector::HBondDetector(const double distance, const double angle, 
@@ -74,4 +78,44 @@ namespace loos {
         return (cosine > cutoff_cos);
         }
 
+    std::vector<HBondDetector::Bond> HBondDetector::findHBonds(const AtomicGroup& donors,
+                                                               const AtomicGroup& hydrogens,
+                                                               const AtomicGroup& acceptors) {
+        if (donors.size() != hydrogens.size()) {
+            throw(LOOSError("Donors and hydrogens must be the same size in HBondDetector::findHBonds()"));
+        }
+
+        std::vector<Bond> bonds;
+        if (hydrogens.empty() || acceptors.empty()) {
+            return bonds;
+        }
+
+        std::vector<GCoord> coords(acceptors.size());
+        for (uint i=0; i<acceptors.size(); ++i) {
+            coords[i] = acceptors[i]->coords();
+        }
+
+        // The cell list only picks candidates for hBonded()
+        CellList cells(CellList::paddedCutoff(sqrt(cutoff_dist2)));
+        if (box.isPeriodic()) {
+            cells.update(coords, box.box());
+        }
+        else {
+            cells.update(coords);
+        }
+
+        std::vector<uint> nearby;
+        for (uint i=0; i<hydrogens.size(); ++i) {
+            cells.neighbors(hydrogens[i]->coords(), nearby);
+            std::sort(nearby.begin(), nearby.end());
+            for (std::vector<uint>::const_iterator j = nearby.begin(); j != nearby.end(); ++j) {
+                if (hBonded(donors[i], hydrogens[i], acceptors[*j])) {
+                    bonds.push_back(Bond(i, *j));
+                }
+            }
+        }
+
+        return bonds;
+    }
+
 }
@@ -26,6 +26,10 @@
 #include <Coord.hpp>
 #include <AtomicGroup.hpp>
 #include <PeriodicBox.hpp>
+#include <CellList.hpp>
+
+#include <vector>
+#include <utility>
 
 namespace loos {
 
@@ -46,6 +50,9 @@ namespace loos {
      */
     class HBondDetector {
     public:
+        //! A hydrogen bond, given as (index of donor/hydrogen, index of acceptor)
+        typedef std::pair<uint, uint>    Bond;
+
 
         HBondDetector(const double distance, const double angle, 
                       const AtomicGroup &group);
@@ -67,6 +74,21 @@ namespace loos {
         bool hBonded(const pAtom donor, const pAtom hydrogen, 
                      const pAtom acceptor);
 
+        //! Finds all h-bonds between a set of donors and acceptors
+        /**
+         *  The ith donor is the heavy atom that the ith hydrogen is 
+         *  bound to, so \a donors and \a hydrogens must be the same size.
+         *  Rather than testing every hydrogen against every acceptor, 
+         *  the acceptors are binned into a CellList, so the search is 
+         *  linear in the number of atoms.  The criteria are the same as 
+         *  for hBonded().
+         *
+         *  Returns the bonds sorted by hydrogen and then acceptor index.
+         */
+        std::vector<Bond> findHBonds(const AtomicGroup& donors,
+                                     const AtomicGroup& hydrogens,
+                                     const AtomicGroup& acceptors);
+
     private:
         SharedPeriodicBox box;
         double cutoff_dist2;
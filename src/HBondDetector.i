@@ -4,7 +4,12 @@
 #include <Coord.hpp>
 #include <AtomicGroup.hpp>
 #include <PeriodicBox.hpp>
+#include <CellList.hpp>
 #include <HBondDetector.hpp>
 %}
 
+%include <std_pair.i>
+%template(HBond)         std::pair<uint, uint>;
+%template(HBondVector)   std::vector< std::pair<uint, uint> >;
+
 %include "HBondDetector.hpp"
@@ -0,0 +1,82 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <InternedString.hpp>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_set.hpp>
+#include <boost/functional/hash.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    // The pool is split into shards, each with its own lock, so that
+    // model files parsed by several threads don't all wait on one
+    // mutex.  Elements of an unordered_set never move, so pointers to
+    // them stay valid.
+    const unsigned int nshards = 16;
+
+    struct Shard {
+      boost::mutex mtx;
+      boost::unordered_set<std::string> strings;
+    };
+
+
+    Shard* shards() {
+      static Shard pool[nshards];
+      return(pool);
+    }
+
+  }
+
+
+
+  const std::string* InternedString::intern(const std::string& s) {
+    std::size_t h = boost::hash<std::string>()(s);
+    Shard& shard = shards()[h % nshards];
+
+    boost::mutex::scoped_lock lock(shard.mtx);
+    return(&(*(shard.strings.insert(s).first)));
+  }
+
+
+  const std::string* InternedString::emptyString() {
+    static const std::string* p = intern(std::string());
+    return(p);
+  }
+
+
+  unsigned long InternedString::poolSize() {
+    unsigned long n = 0;
+    Shard* pool = shards();
+
+    for (unsigned int i=0; i<nshards; ++i) {
+      boost::mutex::scoped_lock lock(pool[i].mtx);
+      n += pool[i].strings.size();
+    }
+
+    return(n);
+  }
+
+}
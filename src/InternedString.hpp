@@ -0,0 +1,82 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_INTERNED_STRING_HPP)
+#define LOOS_INTERNED_STRING_HPP
+
+#include <iostream>
+#include <string>
+
+
+namespace loos {
+
+  //! A handle to a string stored once in a global pool
+  /**
+   * Atoms have many string properties (names, residue names, segids,
+   * etc) but there are usually only a few hundred distinct values in a
+   * system.  An InternedString is just a pointer to the single shared
+   * copy of its string, so it is small, cheap to copy, and two
+   * InternedStrings can be compared for equality without looking at the
+   * characters.
+   *
+   * Interned strings are never freed.  The pool is safe to use from
+   * multiple threads.
+   *
+   * Note that operator<() orders by handle, not alphabetically.  It is
+   * only meant for using InternedStrings as keys in a map or set.
+   */
+  class InternedString {
+  public:
+    //! The empty string
+    InternedString() : _str(emptyString()) { }
+
+    //! Finds (or adds) \a s in the pool
+    explicit InternedString(const std::string& s) : _str(intern(s)) { }
+
+    const std::string& str() const { return(*_str); }
+    operator const std::string&() const { return(*_str); }
+
+    bool empty() const { return(_str->empty()); }
+
+    bool operator==(const InternedString& s) const { return(_str == s._str); }
+    bool operator!=(const InternedString& s) const { return(_str != s._str); }
+    bool operator<(const InternedString& s) const { return(_str < s._str); }
+
+    //! Number of distinct strings in the pool
+    static unsigned long poolSize();
+
+  private:
+    static const std::string* intern(const std::string& s);
+    static const std::string* emptyString();
+
+    const std::string* _str;
+  };
+
+
+  inline std::ostream& operator<<(std::ostream& os, const InternedString& s) {
+    return(os << s.str());
+  }
+
+}
+
+
+#endif
@@ -0,0 +1,420 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_MULTITIMESERIES_HPP)
+#define LOOS_MULTITIMESERIES_HPP
+
+#include <vector>
+#include <stdexcept>
+#include <cmath>
+
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
+#include <loos_defs.hpp>
+#include <TimeSeries.hpp>
+
+namespace loos {
+
+  //! Many time series of the same length, handled together
+  /*!
+   *  This holds a set of time series (e.g. one per residue or per
+   *  contact) as a table with one row per time point and one column
+   *  per series.  The statistics that TimeSeries provides are computed
+   *  for every series at once, with the series divided between
+   *  threads.  The inner loops run across a row, i.e. across series,
+   *  so they vectorize.
+   *
+   *  Rows may be added one at a time as frames are processed.  The mean
+   *  and variance of each series are accumulated as rows arrive (using
+   *  Welford's algorithm), so average(), variance(), stdev() and
+   *  sterr() never need another pass over the data.
+   *
+   *  The results match those of TimeSeries for each series, except that
+   *  the variance is computed with less round-off.
+   */
+
+template<class T>
+class MultiTimeSeries {
+public:
+
+  MultiTimeSeries() : _nseries(0), _nthreads(1) { }
+
+  //! An empty set of \a nseries series, using \a nthreads threads (0 = all available)
+  explicit MultiTimeSeries(const uint nseries, const uint nthreads = 1) :
+    _nseries(nseries), _mean(nseries, 0.0), _m2(nseries, 0.0)
+  {
+    threads(nthreads);
+  }
+
+  //! Each vector is one series (all must be the same length)
+  MultiTimeSeries(const std::vector< std::vector<T> >& series, const uint nthreads = 1) :
+    _nseries(series.size()), _mean(series.size(), 0.0), _m2(series.size(), 0.0)
+  {
+    threads(nthreads);
+    uint n = series.empty() ? 0 : series[0].size();
+    for (uint s=0; s<_nseries; ++s)
+      if (series[s].size() != n)
+        throw(std::runtime_error("mismatched timeseries sizes in MultiTimeSeries"));
+
+    std::vector<T> row(_nseries);
+    for (uint t=0; t<n; ++t) {
+      for (uint s=0; s<_nseries; ++s)
+        row[s] = series[s][t];
+      push_back(row);
+    }
+  }
+
+  //! Collects a set of TimeSeries (all must be the same length)
+  MultiTimeSeries(const std::vector< TimeSeries<T> >& series, const uint nthreads = 1) :
+    _nseries(series.size()), _mean(series.size(), 0.0), _m2(series.size(), 0.0)
+  {
+    threads(nthreads);
+    uint n = series.empty() ? 0 : series[0].size();
+    for (uint s=0; s<_nseries; ++s)
+      if (series[s].size() != n)
+        throw(std::runtime_error("mismatched timeseries sizes in MultiTimeSeries"));
+
+    std::vector<T> row(_nseries);
+    for (uint t=0; t<n; ++t) {
+      for (uint s=0; s<_nseries; ++s)
+        row[s] = series[s][t];
+      push_back(row);
+    }
+  }
+
+
+  //! Number of series
+  uint series() const { return(_nseries); }
+
+  //! Number of time points
+  uint size() const { return(_nseries ? _data.size() / _nseries : 0); }
+
+  uint threads() const { return(_nthreads); }
+  void threads(const uint n) {
+    _nthreads = n;
+    if (_nthreads == 0) {
+      _nthreads = boost::thread::hardware_concurrency();
+      if (_nthreads == 0)
+        _nthreads = 1;
+    }
+  }
+
+
+  //! Appends one time point (a value for each series)
+  void push_back(const T* values) {
+    _data.insert(_data.end(), values, values + _nseries);
+
+    double n = size();
+    for (uint s=0; s<_nseries; ++s) {
+      double d = values[s] - _mean[s];
+      _mean[s] += d / n;
+      _m2[s] += d * (values[s] - _mean[s]);
+    }
+  }
+
+  void push_back(const std::vector<T>& values) {
+    if (values.size() != _nseries)
+      throw(std::runtime_error("wrong number of values for MultiTimeSeries::push_back"));
+    if (_nseries)
+      push_back(&values[0]);
+  }
+
+
+#if !defined(SWIG)
+  //! Value of series \a s at time \a t
+  const T& operator()(const uint t, const uint s) const {
+    return(_data.at(t * _nseries + s));
+  }
+#endif
+
+  //! Copies out a single series
+  TimeSeries<T> column(const uint s) const {
+    if (s >= _nseries)
+      throw(std::out_of_range("Series index out of range in MultiTimeSeries"));
+
+    uint n = size();
+    TimeSeries<T> result(n);
+    for (uint t=0; t<n; ++t)
+      result[t] = _data[t * _nseries + s];
+    return(result);
+  }
+
+
+  //! Remove num_points from the front of every series
+  void set_skip(const uint num_points) {
+    if (num_points >= size())
+      throw(std::out_of_range("num_points has invalid value in set_skip"));
+
+    std::vector<T> data(_data.begin() + num_points * _nseries, _data.end());
+    _data.clear();
+    _mean.assign(_nseries, 0.0);
+    _m2.assign(_nseries, 0.0);
+    for (uint t=0; t<data.size(); t += _nseries)
+      push_back(&data[t]);
+  }
+
+
+  //! Average of each series
+  std::vector<T> average() const {
+    return(std::vector<T>(_mean.begin(), _mean.end()));
+  }
+
+  //! Variance of each series (normalized by N, as with TimeSeries)
+  std::vector<T> variance() const {
+    std::vector<T> var(_nseries);
+    double n = size();
+    for (uint s=0; s<_nseries; ++s)
+      var[s] = _m2[s] / n;
+    return(var);
+  }
+
+  //! Standard deviation of each series
+  std::vector<T> stdev() const {
+    std::vector<T> dev = variance();
+    for (uint s=0; s<_nseries; ++s)
+      dev[s] = sqrt(dev[s]);
+    return(dev);
+  }
+
+  //! Standard error of each series, assuming all points are independent
+  std::vector<T> sterr() const {
+    std::vector<T> err = stdev();
+    double root_n = sqrt(static_cast<double>(size()));
+    for (uint s=0; s<_nseries; ++s)
+      err[s] /= root_n;
+    return(err);
+  }
+
+
+  //! Variance of the block averages of each series (see TimeSeries::block_var())
+  std::vector<T> block_var(const uint num_blocks) const {
+    if (num_blocks < 2 || num_blocks > size())
+      throw(std::out_of_range("Invalid number of blocks in block_var"));
+
+    std::vector<T> result(_nseries);
+    BlockVariance op(*this, num_blocks, result);
+    parallel(op);
+    return(result);
+  }
+
+
+  //! Windowed average of each series (see TimeSeries::windowed_average())
+  MultiTimeSeries<T> windowed_average(const uint window) const {
+    if (window > size() || window == 0)
+      throw(std::out_of_range("Error in windowed_average: window too large"));
+
+    MultiTimeSeries<T> result(_nseries, _nthreads);
+    result._data.resize((size() - window) * _nseries);
+    WindowedAverage op(*this, window, result._data);
+    parallel(op);
+    result.accumulate();
+    return(result);
+  }
+
+
+  //! Autocorrelation of each series (see TimeSeries::correl())
+  /*!
+   * Each row of the result is one lag time.
+   */
+  MultiTimeSeries<T> correl(const int max_time,
+                            const int interval = 1,
+                            const bool normalize = true,
+                            const T tol = 1.0e-8) const {
+    uint n = abs(max_time);
+    if (n > size())
+      throw(std::runtime_error("Can't take correlation time longer than time series"));
+
+    MultiTimeSeries<T> result(_nseries, _nthreads);
+    result._data.resize((n / interval) * _nseries);
+    Correlation op(*this, max_time, interval, normalize, tol, result._data);
+    parallel(op);
+    result.accumulate();
+    return(result);
+  }
+
+
+private:
+
+  // Calls op(begin, end) for a range of series in each thread
+  template<class Op>
+  void parallel(Op& op) const {
+    uint nthreads = _nthreads < _nseries ? _nthreads : _nseries;
+    if (nthreads <= 1) {
+      op(0, _nseries);
+      return;
+    }
+
+    boost::thread_group threads;
+    uint chunk = (_nseries + nthreads - 1) / nthreads;
+    for (uint begin = 0; begin < _nseries; begin += chunk) {
+      uint end = begin + chunk < _nseries ? begin + chunk : _nseries;
+      threads.create_thread(boost::bind<void>(boost::ref(op), begin, end));
+    }
+    threads.join_all();
+  }
+
+  // Rebuilds the running statistics after the data were filled in directly
+  void accumulate() {
+    if (!_nseries)
+      return;
+    std::vector<T> data;
+    data.swap(_data);
+    _data.reserve(data.size());
+    for (uint t=0; t<data.size(); t += _nseries)
+      push_back(&data[t]);
+  }
+
+
+  struct BlockVariance {
+    BlockVariance(const MultiTimeSeries<T>& ts_, const uint num_blocks_, std::vector<T>& result_) :
+      ts(ts_), num_blocks(num_blocks_), result(result_) { }
+
+    void operator()(const uint begin, const uint end) {
+      uint m = end - begin;
+      uint points_per_block = ts.size() / num_blocks;
+      std::vector<T> block_sum(m), block_ave(m, 0.0), block_ave2(m, 0.0);
+
+      for (uint i=0; i<num_blocks; ++i) {
+        block_sum.assign(m, 0.0);
+        for (uint j=0; j<points_per_block; ++j) {
+          const T* row = &ts._data[(i * points_per_block + j) * ts._nseries + begin];
+          for (uint s=0; s<m; ++s)
+            block_sum[s] += row[s];
+        }
+        for (uint s=0; s<m; ++s) {
+          T ave = block_sum[s] / points_per_block;
+          block_ave[s] += ave;
+          block_ave2[s] += ave * ave;
+        }
+      }
+
+      T ratio = num_blocks / (num_blocks - 1.0);
+      for (uint s=0; s<m; ++s) {
+        T ave = block_ave[s] / num_blocks;
+        T ave2 = block_ave2[s] / num_blocks;
+        result[begin + s] = (ave2 - ave * ave) * ratio;
+      }
+    }
+
+    const MultiTimeSeries<T>& ts;
+    uint num_blocks;
+    std::vector<T>& result;
+  };
+
+
+  struct WindowedAverage {
+    WindowedAverage(const MultiTimeSeries<T>& ts_, const uint window_, std::vector<T>& result_) :
+      ts(ts_), window(window_), result(result_) { }
+
+    void operator()(const uint begin, const uint end) {
+      uint m = end - begin;
+      uint ns = ts._nseries;
+      uint n = ts.size() - window;
+      std::vector<T> sum(m, 0.0);
+
+      for (uint i=0; i<window; ++i) {
+        const T* row = &ts._data[i * ns + begin];
+        for (uint s=0; s<m; ++s)
+          sum[s] += row[s];
+      }
+      for (uint s=0; s<m && n > 0; ++s)
+        result[begin + s] = sum[s] / window;
+
+      for (uint i=1; i<n; ++i) {
+        const T* old_row = &ts._data[(i - 1) * ns + begin];
+        const T* new_row = &ts._data[(i + window - 1) * ns + begin];
+        T* out = &result[i * ns + begin];
+        for (uint s=0; s<m; ++s) {
+          sum[s] = sum[s] - old_row[s] + new_row[s];
+          out[s] = sum[s] / window;
+        }
+      }
+    }
+
+    const MultiTimeSeries<T>& ts;
+    uint window;
+    std::vector<T>& result;
+  };
+
+
+  // Each series is copied out so the lag loops run over contiguous memory
+  struct Correlation {
+    Correlation(const MultiTimeSeries<T>& ts_, const int max_time_, const int interval_,
+                const bool normalize_, const T tol_, std::vector<T>& result_) :
+      ts(ts_), max_time(max_time_), interval(interval_), normalize(normalize_), tol(tol_), result(result_) { }
+
+    void operator()(const uint begin, const uint end) {
+      uint ns = ts._nseries;
+      uint npts = ts.size();
+      uint n = abs(max_time) / interval;
+      std::vector<T> data(npts);
+
+      for (uint s=begin; s<end; ++s) {
+        for (uint t=0; t<npts; ++t)
+          data[t] = ts._data[t * ns + s];
+
+        if (normalize) {
+          T ave = ts._mean[s];
+          T dev = sqrt(ts._m2[s] / npts);
+          if (dev < tol) {
+            for (uint i=0; i<n; ++i)
+              result[i * ns + s] = 1.0;
+            continue;
+          }
+          for (uint t=0; t<npts; ++t)
+            data[t] = (data[t] - ave) / dev;
+        }
+
+        for (uint i=0; i < n * interval; i += interval) {
+          T c = 0.0;
+          for (uint j=0; j<npts - i; ++j)
+            c += data[j] * data[j+i];
+          result[(i / interval) * ns + s] = c / (npts - i);
+        }
+      }
+    }
+
+    const MultiTimeSeries<T>& ts;
+    int max_time, interval;
+    bool normalize;
+    T tol;
+    std::vector<T>& result;
+  };
+
+
+  uint _nseries, _nthreads;
+  std::vector<T> _data;              // One row per time point
+  std::vector<double> _mean, _m2;    // Running mean and sum of squared deviations
+};
+
+
+
+typedef MultiTimeSeries<double> dMultiTimeSeries;
+typedef MultiTimeSeries<float> fMultiTimeSeries;
+
+
+
+}
+
+#endif
@@ -127,6 +127,12 @@ namespace loos {
 			return(_trajectories[i]->periodicBox());
 		}
 
+		//! The periodic cell of the current sub-trajectory
+		virtual TriclinicBox periodicCell() const {
+			uint i = eof() ? _trajectories.size()-1 : _curtraj;
+			return(_trajectories[i]->periodicCell());
+		}
+
 		//! Whether or not the current sub-trajectory has a periodic box
 		virtual bool hasVelocities() const {
 			uint i = eof() ? _trajectories.size()-1 : _curtraj;
@@ -31,6 +31,7 @@
 #include <boost/shared_ptr.hpp>
 
 #include <loos_defs.hpp>
+#include <TriclinicBox.hpp>
 
 
 
@@ -40,18 +41,21 @@ namespace loos {
   /** This is the fundamental object that gets shared amongst related
    *  groups.  It contains the GCoord representing the box size and a
    *  flag that indicates whether or not the box has actually been set.
+   *  A triclinic cell may be set instead (see TriclinicBox), in which
+   *  case box() returns the diagonal of the box matrix.
    *  The client will not interact with this class/object directly, but
    *  will use the SharedPeriodicBox instead.
    */
 
   class PeriodicBox {
   public:
-    PeriodicBox() : thebox(99999,99999,99999), box_set(false) { }
-    explicit PeriodicBox(const GCoord& c) : thebox(c), box_set(true) { }
+    PeriodicBox() : thebox(99999,99999,99999), thecell(thebox), box_set(false) { }
+    explicit PeriodicBox(const GCoord& c) : thebox(c), thecell(c), box_set(true) { }
 
     GCoord box(void) const { return(thebox); }
     void box(const GCoord& c) {
       thebox = c;
+      thecell = TriclinicBox(c);
 
       // Because of the way boxes are handled elsewhere, setting an
       // unset box in AtomicGroup can leave PeriodicBox thinking it
@@ -61,11 +65,20 @@ namespace loos {
       box_set = (c.x() != 99999 || c.y() != 99999 || c.z() != 99999);
     }
 
+    TriclinicBox cell(void) const { return(thecell); }
+    void cell(const TriclinicBox& c) {
+      box(c.lengths());
+      thecell = c;
+    }
+
     bool isPeriodic(void) const { return(box_set); }
     void setPeriodic(const bool b) { box_set = b; }
 
+    bool isTriclinic(void) const { return(!thecell.isOrthorhombic()); }
+
   private:
     GCoord thebox;
+    TriclinicBox thecell;
     bool box_set;
   };
 
@@ -83,14 +96,17 @@ namespace loos {
     SharedPeriodicBox() : pbox(new PeriodicBox) { }
     GCoord box(void) const { return(pbox->box()); }
     void box(const GCoord& c) { pbox->box(c); }
+    TriclinicBox cell(void) const { return(pbox->cell()); }
+    void cell(const TriclinicBox& c) { pbox->cell(c); }
     bool isPeriodic(void) const { return(pbox->isPeriodic()); }
+    bool isTriclinic(void) const { return(pbox->isTriclinic()); }
 
 
     SharedPeriodicBox copy(void) const {
       SharedPeriodicBox thecopy;
 
       if (isPeriodic())
-        thecopy.box(box());
+        thecopy.cell(cell());
     
       return(thecopy);
     }
@@ -0,0 +1,241 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <RadialDistribution.hpp>
+#include <exceptions.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
+
+namespace loos {
+
+  // Threads are only used when each would have at least this many
+  // pairs of points to look at
+  static const double min_pairs_per_thread = 100000.0;
+
+
+  // Bins the distances from each point in from_ to its neighbors (or
+  // to every point, if the cell list can't be used) with the batch
+  // distance kernels.  These use the same arithmetic as the rdf tools
+  // always have, so the histograms match theirs.
+  struct RadialDistribution::Worker {
+    Worker(const RadialDistribution& rdf, const bool cells,
+           const std::vector<GCoord>& from, const std::vector<uint>* from_ids,
+           const std::vector<GCoord>& to, const std::vector<uint>* to_ids,
+           const PackedCoords& packed, const GCoord& box) :
+      cells_(rdf.cells_), use_cells_(cells), lateral_(rdf.mode_ == LATERAL),
+      min_(rdf.min_), max_(rdf.max_),
+      from_(from), from_ids_(from_ids), to_(to), to_ids_(to_ids), packed_(packed), box_(box)
+    { }
+
+    // Bins all pairs for the points in from [first, last).  Each
+    // thread gets its own copy of the worker (and its scratch space).
+    void operator()(const uint first, const uint last, std::vector<double>* hist) {
+      for (uint j = first; j < last; ++j) {
+        if (!use_cells_) {
+          bin(j, packed_, 0, *hist);
+          continue;
+        }
+
+        if (lateral_)
+          cells_.neighbors(GCoord(from_[j].x(), from_[j].y(), 0.0), nearby_);
+        else
+          cells_.neighbors(from_[j], nearby_);
+
+        near_.resize(nearby_.size());
+        for (uint i=0; i<nearby_.size(); ++i)
+          near_.set(i, to_[nearby_[i]]);
+        bin(j, near_, &nearby_, *hist);
+      }
+    }
+
+    // index maps the points onto to_ (or null if they're all of to_)
+    void bin(const uint j, const PackedCoords& points, const std::vector<uint>* index, std::vector<double>& hist) {
+      if (lateral_)
+        lateralDistance2(from_[j], points, box_, d2_);
+      else
+        distance2(from_[j], points, box_, d2_);
+
+      if (from_ids_) {
+        uint id = (*from_ids_)[j];
+        for (uint i=0; i<d2_.size(); ++i)
+          if ((*to_ids_)[index ? (*index)[i] : i] == id)
+            d2_[i] = -1.0;
+      }
+
+      histogramDistances(d2_, min_, max_, hist);
+    }
+
+
+    const CellList& cells_;
+    bool use_cells_, lateral_;
+    double min_, max_;
+    const std::vector<GCoord>& from_;
+    const std::vector<uint>* from_ids_;
+    const std::vector<GCoord>& to_;
+    const std::vector<uint>* to_ids_;
+    const PackedCoords& packed_;
+    GCoord box_;
+
+    std::vector<uint> nearby_;
+    PackedCoords near_;
+    std::vector<double> d2_;
+  };
+
+
+
+  RadialDistribution::RadialDistribution(const double min, const double max, const uint nbins, const Mode mode, const uint nthreads) :
+    min_(min),
+    max_(max),
+    width_(0.0),
+    mode_(mode),
+    nthreads_(1),
+    cells_(max > 0.0 ? CellList::paddedCutoff(max) : 1.0),
+    hist_(nbins, 0.0)
+  {
+    if (nbins == 0)
+      throw(LOOSError("RadialDistribution requires at least one bin"));
+    if (max <= min)
+      throw(LOOSError("RadialDistribution requires min < max"));
+
+    width_ = (max_ - min_) / nbins;
+    threads(nthreads);
+  }
+
+
+  void RadialDistribution::threads(const uint n) {
+    nthreads_ = n;
+    if (nthreads_ == 0) {
+      nthreads_ = boost::thread::hardware_concurrency();
+      if (nthreads_ == 0)
+        nthreads_ = 1;
+    }
+  }
+
+
+  // The cell list only finds the nearest image, so it can only be
+  // used when no pair can be within the cutoff in two images
+  bool RadialDistribution::useCells(const GCoord& box) const {
+    uint ndims = (mode_ == LATERAL) ? 2 : 3;
+    for (uint k=0; k<ndims; ++k)
+      if (2.0 * cells_.cutoff() > box[k])
+        return(false);
+    return(true);
+  }
+
+
+  ulong RadialDistribution::selfPairs(const std::vector<uint>& from_ids, const std::vector<uint>& to_ids) const {
+    std::vector<uint> sorted(to_ids);
+    std::sort(sorted.begin(), sorted.end());
+
+    ulong n = 0;
+    for (std::vector<uint>::const_iterator i = from_ids.begin(); i != from_ids.end(); ++i) {
+      std::pair<std::vector<uint>::const_iterator, std::vector<uint>::const_iterator> range = std::equal_range(sorted.begin(), sorted.end(), *i);
+      n += range.second - range.first;
+    }
+
+    return(n);
+  }
+
+
+  ulong RadialDistribution::accumulate(const std::vector<GCoord>& from, const std::vector<GCoord>& to, const GCoord& box) {
+    std::vector<uint> none;
+    return(accumulate(from, none, to, none, box));
+  }
+
+
+  ulong RadialDistribution::accumulate(const std::vector<GCoord>& from, const std::vector<uint>& from_ids,
+                                       const std::vector<GCoord>& to, const std::vector<uint>& to_ids,
+                                       const GCoord& box) {
+    bool use_ids = !(from_ids.empty() && to_ids.empty());
+    if (use_ids && (from_ids.size() != from.size() || to_ids.size() != to.size()))
+      throw(LOOSError("RadialDistribution ids do not match the number of points"));
+
+    ulong pairs = static_cast<ulong>(from.size()) * to.size();
+    if (use_ids)
+      pairs -= selfPairs(from_ids, to_ids);
+    if (from.empty() || to.empty())
+      return(pairs);
+
+    // The cell list only finds candidates, which are then checked
+    // with the batch kernels, so its cutoff is padded (see
+    // CellList::paddedCutoff())
+    bool cells = useCells(box);
+    if (cells) {
+      if (mode_ == LATERAL) {
+        projected_.resize(to.size());
+        for (uint i=0; i<to.size(); ++i)
+          projected_[i] = GCoord(to[i].x(), to[i].y(), 0.0);
+        cells_.update(projected_, GCoord(box.x(), box.y(), cells_.cutoff()));
+      } else
+        cells_.update(to, box);
+    } else
+      packed_.assign(to);
+
+    Worker worker(*this, cells, from, use_ids ? &from_ids : 0, to, use_ids ? &to_ids : 0, packed_, box);
+
+    // The work is split over the first set of points, but the cost of
+    // each one depends on how many points of the second set it is
+    // compared to.  With the cell list, that is the fraction of the
+    // box covered by the cells around it.
+    double neighbors = to.size();
+    if (cells) {
+      double reach = 3.0 * cells_.cutoff();
+      double fraction = (reach / box.x()) * (reach / box.y());
+      if (mode_ != LATERAL)
+        fraction *= reach / box.z();
+      if (fraction < 1.0)
+        neighbors *= fraction;
+    }
+
+    double work = from.size() * neighbors;
+    uint nchunks = nthreads_;
+    if (nchunks > work / min_pairs_per_thread)
+      nchunks = static_cast<uint>(work / min_pairs_per_thread);
+    if (nchunks > from.size())
+      nchunks = from.size();
+    if (nchunks <= 1) {
+      worker(0, from.size(), &hist_);
+      return(pairs);
+    }
+
+    std::vector< std::vector<double> > partial(nchunks, std::vector<double>(hist_.size(), 0.0));
+    boost::thread_group threads;
+    for (uint i=0; i<nchunks; ++i) {
+      uint first = static_cast<ulong>(from.size()) * i / nchunks;
+      uint last = static_cast<ulong>(from.size()) * (i+1) / nchunks;
+      threads.create_thread(boost::bind<void>(worker, first, last, &partial[i]));
+    }
+    threads.join_all();
+
+    for (uint i=0; i<nchunks; ++i)
+      for (uint k=0; k<hist_.size(); ++k)
+        hist_[k] += partial[i][k];
+
+    return(pairs);
+  }
+
+}
@@ -0,0 +1,130 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(LOOS_RADIALDISTRIBUTION_HPP)
+#define LOOS_RADIALDISTRIBUTION_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+#include <CellList.hpp>
+#include <DistanceKernels.hpp>
+
+
+namespace loos {
+
+  //! Histograms the distances between two sets of points for radial distribution functions
+  /**
+   * The rdf tools bin the minimum image distance between every pair
+   * of points in two selections, which is O(N^2) per frame even
+   * though only the pairs closer than the histogram maximum matter.
+   * The RadialDistribution instead bins the second set of points into
+   * a CellList with the histogram maximum as the cutoff, so each frame
+   * takes time linear in the number of points.  Distances are
+   * binned exactly as the tools always have, so the histograms are the
+   * same as with the all-pairs loop.
+   *
+   * With LATERAL, only the x and y components of the distance are
+   * used (i.e. for lateral RDFs in membranes).
+   *
+   * If the histogram maximum is more than half of the box (so a pair
+   * might be within the maximum in more than one image), the cell list
+   * cannot be used and every pair is checked instead.
+   *
+   * Points can be given ids so that "self" pairs (e.g. where the two
+   * selections overlap) are skipped: any pair of points with the same
+   * id is not binned.
+   *
+   * Each frame can be split over several threads, each working on a
+   * part of the first set of points with its own histogram.  Since
+   * the first set is often small (e.g. lipids around a large number
+   * of waters), the number of threads used depends on the number of
+   * pairs to look at rather than on the number of points in the first
+   * set.
+   *
+   \code
+   RadialDistribution rdf(0.0, 15.0, 150);
+   while (traj->readFrame()) {
+     traj->updateGroupCoords(model);
+     ... get the centers of mass of each molecule into from and to ...
+     pairs += rdf.accumulate(from, to, model.periodicBox());
+   }
+   \endcode
+   */
+  class RadialDistribution {
+  public:
+
+    //! Which components of the distance are used
+    enum Mode { SPATIAL, LATERAL };
+
+    //! Histogram distances in (\a min, \a max) into \a nbins bins, using \a nthreads threads (0 = all available)
+    RadialDistribution(const double min, const double max, const uint nbins, const Mode mode = SPATIAL, const uint nthreads = 1);
+
+    uint threads() const { return(nthreads_); }
+    void threads(const uint n);
+
+    double minimum() const { return(min_); }
+    double maximum() const { return(max_); }
+    double binWidth() const { return(width_); }
+    uint bins() const { return(hist_.size()); }
+    Mode mode() const { return(mode_); }
+
+    //! Adds the distances from each point in \a from to each point in \a to
+    /**
+     * Returns the number of pairs considered (i.e. the size of \a from
+     * times the size of \a to, less any self pairs), whether or not
+     * their distance fell within the histogram.
+     */
+    ulong accumulate(const std::vector<GCoord>& from, const std::vector<GCoord>& to, const GCoord& box);
+
+    //! Adds the distances from each point in \a from to each point in \a to, skipping pairs with the same id
+    ulong accumulate(const std::vector<GCoord>& from, const std::vector<uint>& from_ids,
+                     const std::vector<GCoord>& to, const std::vector<uint>& to_ids,
+                     const GCoord& box);
+
+    //! Counts for each bin accumulated so far
+    const std::vector<double>& histogram() const { return(hist_); }
+
+    //! Zeroes the histogram
+    void clear() { hist_.assign(hist_.size(), 0.0); }
+
+  private:
+    struct Worker;
+
+    bool useCells(const GCoord& box) const;
+    ulong selfPairs(const std::vector<uint>& from_ids, const std::vector<uint>& to_ids) const;
+
+
+    double min_, max_, width_;
+    Mode mode_;
+    uint nthreads_;
+    CellList cells_;
+
+    std::vector<double> hist_;
+    std::vector<GCoord> projected_;
+    PackedCoords packed_;
+  };
+
+}
+
+
+#endif
@@ -0,0 +1,191 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <ReimagingPlan.hpp>
+#include <exceptions.hpp>
+
+#include <cmath>
+
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
+
+namespace loos {
+
+  // Threads are only used when each would have at least this many atoms
+  static const uint min_atoms_per_thread = 20000;
+
+
+  // Reimages the parts [first, last) of a model.  The arithmetic is
+  // kept the same as in AtomicGroup::centroid(), reimage(), and
+  // mergeImage() so the results match exactly.
+  struct ReimagingPlan::Worker {
+    Worker(const AtomicGroupPartition& parts, AtomicGroup& model, const bool merge) :
+      parts_(parts), atoms_(model.begin()), cell_(model.periodicCell()), merge_(merge)
+    {
+      GCoord heights = cell_.heights();
+      half_ = heights[0];
+      for (uint i=1; i<3; ++i)
+        if (heights[i] < half_)
+          half_ = heights[i];
+      half_ /= 2.0;
+    }
+
+    void operator()(const uint first, const uint last) const {
+      for (uint i=first; i<last; ++i) {
+        AtomicGroupPartition::const_iterator begin = parts_.begin(i);
+        AtomicGroupPartition::const_iterator end = parts_.end(i);
+        if (begin == end)
+          continue;
+
+        if (merge_ && !mergePart(begin, end))
+          continue;
+
+        reimagePart(begin, end);
+      }
+    }
+
+
+    bool mergePart(AtomicGroupPartition::const_iterator begin, AtomicGroupPartition::const_iterator end) const {
+      if (end - begin < 2)
+        return(false);
+
+      GCoord ref = atoms_[*begin]->coords();
+      greal radius = 0.0;
+      for (AtomicGroupPartition::const_iterator k = begin; k != end; ++k) {
+        greal d = ref.distance2(atoms_[*k]->coords());
+        if (d > radius)
+          radius = d;
+      }
+      if (sqrt(radius) <= half_)
+        return(false);
+
+      GCoord shift = -ref;
+      for (AtomicGroupPartition::const_iterator k = begin; k != end; ++k) {
+        GCoord& c = atoms_[*k]->coords();
+        c += shift;
+        cell_.reimage(c);
+        c += ref;
+      }
+
+      return(true);
+    }
+
+
+    void reimagePart(AtomicGroupPartition::const_iterator begin, AtomicGroupPartition::const_iterator end) const {
+      GCoord com(0,0,0);
+      if (end - begin == 1)
+        com = atoms_[*begin]->coords();
+      else {
+        for (AtomicGroupPartition::const_iterator k = begin; k != end; ++k)
+          com += atoms_[*k]->coords();
+        com /= (end - begin);
+      }
+
+      GCoord reimaged = com;
+      cell_.reimage(reimaged);
+      GCoord trans = reimaged - com;
+      for (AtomicGroupPartition::const_iterator k = begin; k != end; ++k)
+        atoms_[*k]->coords() += trans;
+    }
+
+
+    const AtomicGroupPartition& parts_;
+    AtomicGroup::iterator atoms_;
+    TriclinicBox cell_;
+    greal half_;
+    bool merge_;
+  };
+
+
+
+  ReimagingPlan::ReimagingPlan(const AtomicGroup& model, const AtomicGroupPartition& parts, const uint nthreads) :
+    _parts(parts), _natoms(model.size())
+  {
+    for (uint i=0; i<_parts.size(); ++i)
+      for (AtomicGroupPartition::const_iterator k = _parts.begin(i); k != _parts.end(i); ++k)
+        if (*k >= _natoms)
+          throw(LOOSError("ReimagingPlan given a partition that does not match the model"));
+
+    threads(nthreads);
+  }
+
+
+  // Parts are divided between threads so each gets about the same
+  // number of atoms
+  void ReimagingPlan::threads(const uint n) {
+    _nthreads = n;
+    if (_nthreads == 0) {
+      _nthreads = boost::thread::hardware_concurrency();
+      if (_nthreads == 0)
+        _nthreads = 1;
+    }
+
+    uint nchunks = _nthreads;
+    if (nchunks > _parts.atoms() / min_atoms_per_thread)
+      nchunks = _parts.atoms() / min_atoms_per_thread;
+    if (nchunks < 1)
+      nchunks = 1;
+
+    _chunks.clear();
+    _chunks.push_back(0);
+    ulong total = 0;
+    for (uint i=0; i<_parts.size(); ++i) {
+      total += _parts.size(i);
+      if (total * nchunks >= static_cast<ulong>(_chunks.size()) * _parts.atoms() && _chunks.size() < nchunks)
+        _chunks.push_back(i+1);
+    }
+    if (_chunks.back() != _parts.size())
+      _chunks.push_back(_parts.size());
+  }
+
+
+  void ReimagingPlan::reimage(AtomicGroup& model) const {
+    run(model, false);
+  }
+
+
+  void ReimagingPlan::fixImages(AtomicGroup& model) const {
+    run(model, true);
+  }
+
+
+  void ReimagingPlan::run(AtomicGroup& model, const bool merge) const {
+    if (!model.isPeriodic())
+      throw(LOOSError("trying to reimage a non-periodic group"));
+    if (model.size() != _natoms)
+      throw(LOOSError("ReimagingPlan applied to a model with a different number of atoms"));
+
+    Worker worker(_parts, model, merge);
+
+    if (_chunks.size() <= 2) {
+      worker(0, _parts.size());
+      return;
+    }
+
+    boost::thread_group threads;
+    for (uint i=1; i<_chunks.size(); ++i)
+      threads.create_thread(boost::bind<void>(boost::cref(worker), _chunks[i-1], _chunks[i]));
+    threads.join_all();
+  }
+
+}
@@ -0,0 +1,101 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_REIMAGING_PLAN_HPP)
+#define LOOS_REIMAGING_PLAN_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <AtomicGroup.hpp>
+#include <AtomicGroupPartition.hpp>
+
+
+namespace loos {
+
+  //! Reimages a model by molecule (or segment, etc) every frame
+  /**
+   * The usual way to reimage by molecule is to split the model with
+   * splitByMolecule() and call AtomicGroup::reimage() on each
+   * molecule for every frame.  A ReimagingPlan does the same thing,
+   * but works directly from a partition of the model (see
+   * AtomicGroupPartition) that is made once, and can spread the
+   * molecules over several threads.  The results are identical to
+   * reimaging each molecule in turn.
+   *
+   * A plan can be applied to the model it was made from, or to any
+   * copy of it (i.e. the per-thread models in a TrajectoryPipeline),
+   * so long as the atoms are in the same order.
+   *
+   *\code
+   * ReimagingPlan plan(model, model.partitionByMolecule());
+   * while (traj->readFrame()) {
+   *   traj->updateGroupCoords(model);
+   *   plan.reimage(model);
+   * }
+   *\endcode
+   */
+  class ReimagingPlan {
+  public:
+    ReimagingPlan() : _natoms(0), _nthreads(1) { }
+
+    //! Reimage the parts of \a model given by \a parts, using \a nthreads threads (0 = all available)
+    ReimagingPlan(const AtomicGroup& model, const AtomicGroupPartition& parts, const uint nthreads = 1);
+
+    //! Number of parts (i.e. molecules) in the plan
+    uint size() const { return(_parts.size()); }
+
+    uint threads() const { return(_nthreads); }
+    void threads(const uint n);
+
+    //! Translate each part so its centroid is in the primary image
+    /**
+     * This is the same as calling AtomicGroup::reimage() on each
+     * part.
+     */
+    void reimage(AtomicGroup& model) const;
+
+    //! Puts parts that are split across the periodic boundary back together
+    /**
+     * Any part with more than one atom that extends more than half
+     * of the smallest box height (see TriclinicBox::heights()) from
+     * its first atom is merged around that atom (see
+     * AtomicGroup::mergeImage()) and then reimaged by its centroid.
+     * Other parts are not touched.
+     */
+    void fixImages(AtomicGroup& model) const;
+
+  private:
+    struct Worker;
+
+    void run(AtomicGroup& model, const bool merge) const;
+
+    AtomicGroupPartition _parts;
+    uint _natoms;
+    uint _nthreads;
+    std::vector<uint> _chunks;    // First part for each thread (and one past the end)
+  };
+
+}
+
+
+#endif
@@ -0,0 +1,327 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <TextBuffer.hpp>
+#include <exceptions.hpp>
+
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+
+namespace loos {
+
+  namespace {
+
+    uint model_parser_threads = 0;
+
+    // Fields longer than this are left to parseStringAs()
+    const uint max_field_size = 64;
+
+
+    // Copies a fixed-width field into buf, returning false if it's
+    // missing or too big (in which case the caller should fall back
+    // to parseStringAs)
+    bool copyField(const TextBuffer::Line& line, const uint pos, const uint nelem, char* buf) {
+      if (pos >= line.size)
+        return(false);
+
+      uint n = !nelem ? line.size - pos : nelem;
+      if (pos + n > line.size)
+        n = line.size - pos;
+      if (n >= max_field_size)
+        return(false);
+
+      memcpy(buf, line.text + pos, n);
+      buf[n] = '\0';
+      return(true);
+    }
+
+
+    bool isNumberChar(const char c) {
+      return(isdigit(c) || c == '+' || c == '-' || c == '.' || c == 'e' || c == 'E');
+    }
+
+
+    // Only plain decimal numbers are converted directly.  Anything
+    // else (hex, inf, nan, a dangling exponent, etc) goes through a
+    // stream so we get exactly what operator>>() would give.
+    bool isPlainNumber(const char* begin, const char* end) {
+      if (begin >= end || isNumberChar(*end))
+        return(false);
+
+      for (const char* p = begin; p != end; ++p)
+        if (!isNumberChar(*p))
+          return(false);
+
+      return(true);
+    }
+
+
+    const char* skipSpace(const char* p) {
+      while (isspace(*p))
+        ++p;
+      return(p);
+    }
+
+
+    bool convert(const char* buf, float& val, const char** end) {
+      errno = 0;
+      val = strtof(buf, const_cast<char**>(end));
+      return(errno == 0 && isPlainNumber(skipSpace(buf), *end));
+    }
+
+    bool convert(const char* buf, double& val, const char** end) {
+      errno = 0;
+      val = strtod(buf, const_cast<char**>(end));
+      return(errno == 0 && isPlainNumber(skipSpace(buf), *end));
+    }
+
+    bool convert(const char* buf, long& val, const char** end) {
+      errno = 0;
+      val = strtol(buf, const_cast<char**>(end), 10);
+      return(errno == 0 && isPlainNumber(skipSpace(buf), *end));
+    }
+
+    bool convert(const char* buf, int& val, const char** end) {
+      long l;
+      if (!convert(buf, l, end) || l < INT_MIN || l > INT_MAX)
+        return(false);
+      val = l;
+      return(true);
+    }
+
+
+    template<typename T>
+    T parseNumericField(const TextBuffer::Line& line, const uint pos, const uint nelem) {
+      char buf[max_field_size];
+      if (copyField(line, pos, nelem, buf)) {
+        T val;
+        const char* end;
+        if (convert(buf, val, &end))
+          return(val);
+      }
+
+      return(parseStringAs<T>(line.str(), pos, nelem));
+    }
+
+  }
+
+
+
+  bool TextBuffer::Line::startsWith(const char* prefix) const {
+    uint n = strlen(prefix);
+    return(n <= size && strncmp(text, prefix, n) == 0);
+  }
+
+
+
+  TextBuffer::TextBuffer(const std::string& fname) {
+    std::ifstream ifs(fname.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs)
+      throw(FileOpenError(fname));
+    read(ifs);
+  }
+
+
+
+  void TextBuffer::read(std::istream& is) {
+    ulong from = data_.size();
+    const ulong chunk = 1 << 20;
+
+    while (is) {
+      ulong n = data_.size();
+      data_.resize(n + chunk);
+      is.read(&data_[n], chunk);
+      data_.resize(n + is.gcount());
+    }
+
+    indexLines(from);
+  }
+
+
+
+  uint TextBuffer::readLines(std::istream& is, const uint n) {
+    std::string s;
+    uint i;
+
+    for (i=0; i<n && getline(is, s); ++i)
+      appendLine(s);
+
+    return(i);
+  }
+
+
+
+  void TextBuffer::readUntil(std::istream& is, const std::string& prefix) {
+    std::string s;
+
+    while (getline(is, s)) {
+      appendLine(s);
+      if (s.compare(0, prefix.size(), prefix) == 0)
+        break;
+    }
+  }
+
+
+
+  void TextBuffer::appendLine(const std::string& s) {
+    lines_.push_back(std::pair<ulong, uint>(data_.size(), s.size()));
+    data_.insert(data_.end(), s.begin(), s.end());
+    data_.push_back('\n');
+  }
+
+
+
+  // A trailing newline does not start a new (empty) line, just as
+  // with getline()
+  void TextBuffer::indexLines(const ulong from) {
+    ulong n = data_.size();
+    ulong begin = from;
+
+    while (begin < n) {
+      const char* p = static_cast<const char*>(memchr(&data_[begin], '\n', n - begin));
+      ulong end = p ? static_cast<ulong>(p - &data_[0]) : n;
+      lines_.push_back(std::pair<ulong, uint>(begin, end - begin));
+      begin = end + 1;
+    }
+  }
+
+
+
+  template<>
+  float parseFieldAs<float>(const TextBuffer::Line& line, const uint pos, const uint nelem) {
+    return(parseNumericField<float>(line, pos, nelem));
+  }
+
+  template<>
+  double parseFieldAs<double>(const TextBuffer::Line& line, const uint pos, const uint nelem) {
+    return(parseNumericField<double>(line, pos, nelem));
+  }
+
+  template<>
+  int parseFieldAs<int>(const TextBuffer::Line& line, const uint pos, const uint nelem) {
+    return(parseNumericField<int>(line, pos, nelem));
+  }
+
+
+  template<>
+  std::string parseFieldAs<std::string>(const TextBuffer::Line& line, const uint pos, const uint nelem) {
+    std::string val;
+
+    if (pos > line.size)
+      return(val);
+    uint n = !nelem ? line.size - pos : nelem;
+    if (pos + n > line.size)
+      return(val);
+
+    val.reserve(n);
+    for (uint i=pos; i<pos+n; ++i)
+      if (line.text[i] != ' ')
+        val += line.text[i];
+
+    return(val);
+  }
+
+
+  int parseFieldAsHybrid36(const TextBuffer::Line& line, const uint pos, const uint nelem) {
+    uint n = !nelem ? line.size - pos : nelem;
+    if (pos + n > line.size)
+      return(0);
+
+    return(parseHybrid36(line.text + pos, n));
+  }
+
+
+
+  bool LineScanner::skipSpace() {
+    while (p_ != end_ && isspace(*p_))
+      ++p_;
+    return(p_ != end_);
+  }
+
+
+  bool LineScanner::next(std::string& s) {
+    if (!skipSpace())
+      return(false);
+
+    const char* begin = p_;
+    while (p_ != end_ && !isspace(*p_))
+      ++p_;
+    s.assign(begin, p_);
+    return(true);
+  }
+
+
+  template<typename T>
+  bool LineScanner::extract(T& val) {
+    if (!skipSpace())
+      return(false);
+
+    char buf[max_field_size];
+    uint n = 0;
+    while (p_ + n != end_ && n < max_field_size - 1 && !isspace(p_[n])) {
+      buf[n] = p_[n];
+      ++n;
+    }
+    buf[n] = '\0';
+
+    const char* end;
+    if (convert(buf, val, &end) && (end != buf + n || p_ + n == end_ || isspace(p_[n]))) {
+      p_ += end - buf;
+      return(true);
+    }
+
+    // Let a stream sort out anything unusual...
+    std::istringstream iss(std::string(p_, end_));
+    if (!(iss >> val))
+      return(false);
+    std::streampos used = iss.tellg();
+    p_ = (used < 0) ? end_ : p_ + static_cast<long>(used);
+    return(true);
+  }
+
+
+  bool LineScanner::next(int& i) { return(extract(i)); }
+  bool LineScanner::next(long& i) { return(extract(i)); }
+  bool LineScanner::next(double& d) { return(extract(d)); }
+
+
+
+  uint modelParserThreads() {
+    if (model_parser_threads)
+      return(model_parser_threads);
+
+    uint n = boost::thread::hardware_concurrency();
+    return(n ? n : 1);
+  }
+
+
+  void modelParserThreads(const uint n) {
+    model_parser_threads = n;
+  }
+
+}
@@ -0,0 +1,187 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_TEXT_BUFFER_HPP)
+#define LOOS_TEXT_BUFFER_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
+#include <loos_defs.hpp>
+#include <utils.hpp>
+
+
+namespace loos {
+
+
+  //! A text file held in memory and indexed by line
+  /**
+   * Model files are read in one go and split into lines so that
+   * their records can be parsed (in parallel for large files) without
+   * creating a std::string for each line.  Lines are split the same
+   * way std::getline() would split them, so any trailing '\\r' is
+   * kept.
+   */
+  class TextBuffer {
+  public:
+
+    //! A single line in the buffer (not null-terminated)
+    struct Line {
+      Line() : text(0), size(0) { }
+      Line(const char* t, const uint n) : text(t), size(n) { }
+
+      bool startsWith(const char* prefix) const;
+      std::string str() const { return(std::string(text, size)); }
+
+      const char* text;
+      uint size;
+    };
+
+
+    TextBuffer() { }
+
+    //! Read the entire file \a fname
+    explicit TextBuffer(const std::string& fname);
+
+    //! Read everything remaining in \a is
+    explicit TextBuffer(std::istream& is) { read(is); }
+
+    //! Append everything remaining in \a is
+    void read(std::istream& is);
+
+    //! Append up to \a n lines from \a is, returning the number read
+    uint readLines(std::istream& is, const uint n);
+
+    //! Append lines from \a is up to and including the first one beginning with \a prefix
+    void readUntil(std::istream& is, const std::string& prefix);
+
+    uint size() const { return(lines_.size()); }
+    bool empty() const { return(lines_.empty()); }
+
+    //! Returns the i'th line (or an empty line if past the end)
+    Line operator[](const uint i) const {
+      if (i >= lines_.size())
+        return(Line());
+      return(Line(&data_[lines_[i].first], lines_[i].second));
+    }
+
+  private:
+    void appendLine(const std::string& s);
+    void indexLines(const ulong from);
+
+    std::vector<char> data_;
+    std::vector< std::pair<ulong, uint> > lines_;
+  };
+
+
+
+  //! Extracts a field from a line (see parseStringAs())
+  /**
+   * Numeric fields are converted in place without any allocation.
+   * Anything that is not a plain decimal number is handed off to
+   * parseStringAs() so the results (and errors) are always the same.
+   */
+  template<typename T>
+  T parseFieldAs(const TextBuffer::Line& line, const uint pos =0, const uint nelem =0) {
+    return(parseStringAs<T>(line.str(), pos, nelem));
+  }
+
+  template<> float parseFieldAs<float>(const TextBuffer::Line& line, const uint pos, const uint nelem);
+  template<> double parseFieldAs<double>(const TextBuffer::Line& line, const uint pos, const uint nelem);
+  template<> int parseFieldAs<int>(const TextBuffer::Line& line, const uint pos, const uint nelem);
+  template<> std::string parseFieldAs<std::string>(const TextBuffer::Line& line, const uint pos, const uint nelem);
+
+  //! Extracts a hybrid-36 encoded field from a line (see parseStringAsHybrid36())
+  int parseFieldAsHybrid36(const TextBuffer::Line& line, const uint pos =0, const uint nelem =0);
+
+
+
+  //! Reads whitespace separated values from a line as operator>>() would
+  class LineScanner {
+  public:
+    explicit LineScanner(const TextBuffer::Line& line) : p_(line.text), end_(line.text + line.size) { }
+
+    bool next(std::string& s);
+    bool next(int& i);
+    bool next(long& i);
+    bool next(double& d);
+
+    //! True if there is nothing left on the line (i.e. the stream would be at EOF)
+    bool atEnd() const { return(p_ == end_); }
+
+    //! Next character on the line, or '\\0' if at the end
+    char peek() const { return(p_ == end_ ? '\0' : *p_); }
+
+  private:
+    bool skipSpace();
+    template<typename T> bool extract(T& val);
+
+    const char* p_;
+    const char* end_;
+  };
+
+
+
+  //! Number of threads used for parsing large model files
+  uint modelParserThreads();
+
+  //! Set the number of threads used for parsing large model files (0 = all available)
+  void modelParserThreads(const uint n);
+
+
+  //! Calls op(begin, end) over the range [0, n), split across threads
+  /**
+   * Small ranges are handled by the calling thread.  The functor is
+   * shared between threads, so it must only touch the elements in the
+   * range it is given.
+   */
+  template<class Op>
+  void parseInParallel(const uint n, Op& op) {
+    const uint min_records = 10000;   // Per thread
+
+    uint nthreads = modelParserThreads();
+    if (nthreads > n / min_records)
+      nthreads = n / min_records;
+
+    if (nthreads <= 1) {
+      op(0, n);
+      return;
+    }
+
+    boost::thread_group threads;
+    uint chunk = (n + nthreads - 1) / nthreads;
+    for (uint begin = 0; begin < n; begin += chunk) {
+      uint end = begin + chunk < n ? begin + chunk : n;
+      threads.create_thread(boost::bind<void>(boost::ref(op), begin, end));
+    }
+    threads.join_all();
+  }
+
+}
+
+
+#endif
@@ -129,6 +129,12 @@ namespace loos {
 		//! Returns the periodic box for the current frame/trajectory
 		virtual GCoord periodicBox(void) const =0;
 
+		//! Returns the (possibly triclinic) periodic cell for the current frame/trajectory
+		/** Formats that only store box lengths return an orthorhombic
+		 * cell made from periodicBox().
+		 */
+		virtual TriclinicBox periodicCell(void) const { return(TriclinicBox(periodicBox())); }
+
 		//! Returns the current frames coordinates as a vector of GCoords
 		/** Some formats, notably DCDs, do not interleave their
 		 * coordinates.  This means that this could be a potentially
@@ -0,0 +1,212 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <TrajectoryPipeline.hpp>
+#include <exceptions.hpp>
+
+#include <sstream>
+
+#include <boost/bind.hpp>
+
+
+namespace loos {
+
+
+  void TrajectoryPipeline::threads(const uint n) {
+    nthreads_ = n ? n : boost::thread::hardware_concurrency();
+    if (nthreads_ == 0)
+      nthreads_ = 1;
+  }
+
+
+  namespace {
+    void readFrameInto(Trajectory& traj, const uint frame, AtomicGroup& model) {
+      if (!traj.readFrame(frame)) {
+        std::ostringstream oss;
+        oss << "Cannot read frame " << frame << " from trajectory " << traj.filename();
+        throw(LOOSError(oss.str()));
+      }
+      traj.updateGroupCoords(model);
+    }
+  }
+
+
+  // Without threads, the model and transform passed in are used
+  // directly (i.e. this is the same as the usual read/write loop)
+  uint TrajectoryPipeline::runSerial(const AtomicGroup& model, Trajectory& traj, const std::vector<uint>& frames,
+                                     FrameTransform& transform, TrajectoryWriter& writer) {
+    AtomicGroup frame_model(model);
+
+    for (std::vector<uint>::const_iterator i = frames.begin(); i != frames.end(); ++i) {
+      readFrameInto(traj, *i, frame_model);
+      AtomicGroup& output = transform.transform(*i);
+      writer.writeFrame(output);
+      transform.written(*i, output);
+    }
+
+    return(frames.size());
+  }
+
+
+
+  uint TrajectoryPipeline::run(const AtomicGroup& model, Trajectory& traj, const std::vector<uint>& frames,
+                               FrameTransform& transform, TrajectoryWriter& writer) {
+    if (frames.empty())
+      return(0);
+    if (nthreads_ == 1)
+      return(runSerial(model, traj, frames, transform, writer));
+
+    // Each slot gets its own model and transform to work with...
+    uint nslots = nthreads_ + 2;
+    slots_ = std::vector<Slot>(nslots);
+    for (uint i=0; i<nslots; ++i) {
+      slots_[i].model = model.copy();
+      slots_[i].transform = transform.clone(slots_[i].model);
+    }
+    head_ = next_ = tail_ = 0;
+    finished_ = failed_ = false;
+    error_.clear();
+
+    boost::thread_group workers;
+    for (uint i=0; i<nthreads_; ++i)
+      workers.create_thread(boost::bind(&TrajectoryPipeline::transformFrames, this));
+    workers.create_thread(boost::bind(&TrajectoryPipeline::writeFrames, this, &transform, &writer));
+
+    try {
+      for (std::vector<uint>::const_iterator i = frames.begin(); i != frames.end(); ++i) {
+        boost::unique_lock<boost::mutex> lock(mtx_);
+        while (!failed_ && tail_ - head_ >= nslots)
+          read_cond_.wait(lock);
+        if (failed_)
+          break;
+
+        // Slot is not visible to the workers until tail_ is bumped
+        Slot& slot = slots_[tail_ % nslots];
+        lock.unlock();
+
+        readFrameInto(traj, *i, slot.model);
+        slot.frame = *i;
+        slot.done = false;
+
+        lock.lock();
+        ++tail_;
+        work_cond_.notify_one();
+      }
+    }
+    catch (std::exception& e) {
+      fail(e.what());
+    }
+
+    {
+      boost::lock_guard<boost::mutex> lock(mtx_);
+      finished_ = true;
+      work_cond_.notify_all();
+      write_cond_.notify_all();
+    }
+    workers.join_all();
+
+    for (uint i=0; i<nslots; ++i)
+      delete slots_[i].transform;
+    slots_.clear();
+
+    if (failed_)
+      throw(LOOSError(error_));
+
+    return(frames.size());
+  }
+
+
+
+  void TrajectoryPipeline::transformFrames() {
+    boost::unique_lock<boost::mutex> lock(mtx_);
+
+    while (true) {
+      while (!failed_ && !finished_ && next_ == tail_)
+        work_cond_.wait(lock);
+      if (failed_ || next_ == tail_)
+        break;
+
+      Slot& slot = slots_[next_ % slots_.size()];
+      ++next_;
+      lock.unlock();
+
+      try {
+        slot.output = &(slot.transform->transform(slot.frame));
+      }
+      catch (std::exception& e) {
+        fail(e.what());
+        return;
+      }
+
+      lock.lock();
+      slot.done = true;
+      write_cond_.notify_one();
+    }
+  }
+
+
+
+  // Frames are written strictly in the order they were read
+  void TrajectoryPipeline::writeFrames(FrameTransform* transform, TrajectoryWriter* writer) {
+    boost::unique_lock<boost::mutex> lock(mtx_);
+
+    while (true) {
+      while (!failed_
+             && !(head_ < tail_ && slots_[head_ % slots_.size()].done)
+             && !(finished_ && head_ == tail_))
+        write_cond_.wait(lock);
+      if (failed_ || head_ == tail_)
+        break;
+
+      Slot& slot = slots_[head_ % slots_.size()];
+      lock.unlock();
+
+      try {
+        writer->writeFrame(*slot.output);
+        transform->written(slot.frame, *slot.output);
+      }
+      catch (std::exception& e) {
+        fail(e.what());
+        return;
+      }
+
+      lock.lock();
+      slot.done = false;
+      ++head_;
+      read_cond_.notify_one();
+    }
+  }
+
+
+
+  void TrajectoryPipeline::fail(const std::string& msg) {
+    boost::lock_guard<boost::mutex> lock(mtx_);
+    if (!failed_) {
+      failed_ = true;
+      error_ = msg;
+    }
+    read_cond_.notify_all();
+    work_cond_.notify_all();
+    write_cond_.notify_all();
+  }
+
+}
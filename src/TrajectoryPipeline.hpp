@@ -0,0 +1,148 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(LOOS_TRAJECTORY_PIPELINE_HPP)
+#define LOOS_TRAJECTORY_PIPELINE_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <loos_defs.hpp>
+#include <AtomicGroup.hpp>
+#include <Trajectory.hpp>
+#include <trajwriter.hpp>
+#include <utils.hpp>
+
+
+namespace loos {
+
+  //! Per-frame processing for a TrajectoryPipeline
+  /**
+   * A FrameTransform modifies the coordinates of the model for a frame
+   * (i.e. centering or reimaging) and decides which atoms get written
+   * out.  Since frames are transformed in parallel, each worker in the
+   * pipeline works with its own copy of the model and its own
+   * FrameTransform, made by calling clone() on the transform passed to
+   * TrajectoryPipeline::run().  Any selections or molecules the
+   * transform needs should be built from the model passed to clone().
+   */
+  class FrameTransform {
+  public:
+    virtual ~FrameTransform() { }
+
+    //! Create a new transform that operates on \a model
+    virtual FrameTransform* clone(AtomicGroup& model) const =0;
+
+    //! Transform the current frame, returning the atoms to write
+    /**
+     * \a frame is the index of the frame in the trajectory.  The
+     * returned group must remain valid until the next call.
+     */
+    virtual AtomicGroup& transform(const uint frame) =0;
+
+    //! Called on the original transform after each frame is written
+    /**
+     * This is called from a single thread and in the same order as
+     * the frames were read, so it can be used for progress updates or
+     * writing out a reference structure.
+     */
+    virtual void written(const uint, const AtomicGroup&) { }
+  };
+
+
+  //! A FrameTransform that writes a subset of the model unchanged
+  class SubsetTransform : public FrameTransform {
+  public:
+    SubsetTransform(AtomicGroup& model, const std::string& selection) :
+      selection_(selection), subset_(selectAtoms(model, selection)) { }
+
+    FrameTransform* clone(AtomicGroup& model) const { return(new SubsetTransform(model, selection_)); }
+    AtomicGroup& transform(const uint) { return(subset_); }
+
+  private:
+    std::string selection_;
+    AtomicGroup subset_;
+  };
+
+
+  //! Reads, transforms, and writes trajectory frames in parallel
+  /**
+   * Frames are read from a trajectory by the calling thread, handed
+   * off to worker threads that each apply their own copy of a
+   * FrameTransform, and then written out in the original order by a
+   * separate writer thread.  At most threads() + 2 frames are in
+   * flight at once, each with its own copy of the model.
+   *
+   * With only one thread, frames are simply read, transformed, and
+   * written in turn using a single copy of the model.
+   */
+  class TrajectoryPipeline {
+  public:
+    //! Use \a nthreads transform threads (0 = all available)
+    explicit TrajectoryPipeline(const uint nthreads = 1) { threads(nthreads); }
+
+    uint threads() const { return(nthreads_); }
+    void threads(const uint n);
+
+    //! Process the requested \a frames from \a traj
+    /**
+     * The frames are read into copies of \a model, transformed by
+     * clones of \a transform, and the returned atoms written to
+     * \a writer.  Returns the number of frames written.
+     */
+    uint run(const AtomicGroup& model, Trajectory& traj, const std::vector<uint>& frames,
+             FrameTransform& transform, TrajectoryWriter& writer);
+
+  private:
+    struct Slot {
+      Slot() : transform(0), output(0), frame(0), done(false) { }
+
+      AtomicGroup model;
+      FrameTransform* transform;
+      AtomicGroup* output;
+      uint frame;
+      bool done;
+    };
+
+    uint runSerial(const AtomicGroup& model, Trajectory& traj, const std::vector<uint>& frames,
+                   FrameTransform& transform, TrajectoryWriter& writer);
+    void transformFrames();
+    void writeFrames(FrameTransform* transform, TrajectoryWriter* writer);
+    void fail(const std::string& msg);
+
+    uint nthreads_;
+
+    std::vector<Slot> slots_;
+    unsigned long head_, next_, tail_;
+    bool finished_, failed_;
+    std::string error_;
+    boost::mutex mtx_;
+    boost::condition_variable read_cond_, work_cond_, write_cond_;
+  };
+
+}
+
+
+#endif
@@ -0,0 +1,145 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <TriclinicBox.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    const double degrees = 180.0 / M_PI;
+
+    // Cosines smaller than this are taken to be from right angles
+    const double right_angle_tolerance = 1e-6;
+
+    double cosine(const double angle) {
+      double c = cos(angle / degrees);
+      return(fabs(c) < right_angle_tolerance ? 0.0 : c);
+    }
+
+    double angleBetween(const GCoord& u, const GCoord& v) {
+      double c = (u * v) / (u.length() * v.length());
+      if (c > 1.0)
+        c = 1.0;
+      else if (c < -1.0)
+        c = -1.0;
+      return(acos(c) * degrees);
+    }
+
+  }
+
+
+  TriclinicBox::TriclinicBox(const GCoord& a, const GCoord& b, const GCoord& c) :
+    _a(a), _b(b), _c(c), _lengths(a.x(), b.y(), c.z())
+  {
+    if (a.y() != 0.0 || a.z() != 0.0 || b.z() != 0.0)
+      throw(LOOSError("Triclinic box vectors must form a lower-triangular matrix"));
+
+    _orthorhombic = (b.x() == 0.0 && c.x() == 0.0 && c.y() == 0.0);
+  }
+
+
+  TriclinicBox TriclinicBox::fromLengthsAndAngles(const GCoord& lengths, const GCoord& angles) {
+    double cos_alpha = cosine(angles[0]);
+    double cos_beta = cosine(angles[1]);
+    double cos_gamma = cosine(angles[2]);
+
+    if (cos_alpha == 0.0 && cos_beta == 0.0 && cos_gamma == 0.0)
+      return(TriclinicBox(lengths));
+
+    double sin_gamma = sin(angles[2] / degrees);
+    GCoord a(lengths[0], 0, 0);
+    GCoord b(lengths[1] * cos_gamma, lengths[1] * sin_gamma, 0);
+
+    double cx = lengths[2] * cos_beta;
+    double cy = lengths[2] * (cos_alpha - cos_beta * cos_gamma) / sin_gamma;
+    double cz2 = lengths[2] * lengths[2] - cx * cx - cy * cy;
+    if (cz2 <= 0.0)
+      throw(LOOSError("Invalid unit cell angles"));
+
+    return(TriclinicBox(a, b, GCoord(cx, cy, sqrt(cz2))));
+  }
+
+
+  GCoord TriclinicBox::edgeLengths() const {
+    if (_orthorhombic)
+      return(_lengths);
+    return(GCoord(_a.length(), _b.length(), _c.length()));
+  }
+
+
+  GCoord TriclinicBox::angles() const {
+    if (_orthorhombic)
+      return(GCoord(90.0, 90.0, 90.0));
+    return(GCoord(angleBetween(_b, _c), angleBetween(_a, _c), angleBetween(_a, _b)));
+  }
+
+
+  GCoord TriclinicBox::heights() const {
+    if (_orthorhombic)
+      return(_lengths);
+
+    double v = volume();
+    return(GCoord(v / (_b ^ _c).length(), v / (_a ^ _c).length(), v / (_a ^ _b).length()));
+  }
+
+
+  // The brick reimaging gets the displacement to within a box vector
+  // or so of the shortest image, so the neighboring images are
+  // searched until none of them are any closer...
+  GCoord TriclinicBox::closestImage(const GCoord& d) const {
+    GCoord best = d;
+    double best_d2 = d.length2();
+
+    bool improved = true;
+    while (improved) {
+      improved = false;
+      GCoord center = best;
+      for (int k=-1; k<=1; ++k) {
+        GCoord dk = center + _c * k;
+        for (int j=-1; j<=1; ++j) {
+          GCoord dj = dk + _b * j;
+          for (int i=-1; i<=1; ++i) {
+            GCoord r = dj + _a * i;
+            double d2 = r.length2();
+            if (d2 < best_d2) {
+              best_d2 = d2;
+              best = r;
+              improved = true;
+            }
+          }
+        }
+      }
+    }
+
+    return(best);
+  }
+
+
+  std::ostream& operator<<(std::ostream& os, const TriclinicBox& box) {
+    os << box._a << " " << box._b << " " << box._c;
+    return(os);
+  }
+
+}
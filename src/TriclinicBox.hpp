@@ -0,0 +1,189 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_TRICLINIC_BOX_HPP)
+#define LOOS_TRICLINIC_BOX_HPP
+
+#include <cmath>
+#include <iostream>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+
+
+namespace loos {
+
+  //! A periodic cell described by its three box vectors
+  /**
+   * The cell is stored the same way GROMACS stores it: the first
+   * vector lies along x, the second lies in the xy-plane, and the
+   * third has a positive z-component (i.e. the box matrix is
+   * lower-triangular).  Any triclinic cell, including the truncated
+   * octahedron and rhombic dodecahedron, can be written this way.
+   *
+   * reimage() places a coordinate in the brick centered on the origin
+   * whose sides are the diagonal of the box matrix (see lengths()),
+   * the same region that Coord::reimage() uses for an orthorhombic
+   * box.  When the cell is orthorhombic, everything defers to the
+   * regular Coord functions, so the results (and cost) are the same
+   * as using a GCoord box.
+   */
+  class TriclinicBox {
+  public:
+    TriclinicBox() : _a(0,0,0), _b(0,0,0), _c(0,0,0), _lengths(0,0,0), _orthorhombic(true) { }
+
+    //! An orthorhombic cell with sides \a lengths
+    explicit TriclinicBox(const GCoord& lengths) :
+      _a(lengths.x(), 0, 0), _b(0, lengths.y(), 0), _c(0, 0, lengths.z()),
+      _lengths(lengths), _orthorhombic(true) { }
+
+    //! A cell from its box vectors (the box matrix must be lower-triangular)
+    TriclinicBox(const GCoord& a, const GCoord& b, const GCoord& c);
+
+    //! A cell from its edge lengths and the angles (in degrees) alpha, beta, and gamma
+    /**
+     * Alpha is the angle between b and c, beta between a and c, and
+     * gamma between a and b.  Cells where all three angles are
+     * (within round-off of) 90 degrees are orthorhombic.
+     */
+    static TriclinicBox fromLengthsAndAngles(const GCoord& lengths, const GCoord& angles);
+
+    //! A cell from a row-major 3x3 box matrix (as stored in GROMACS files), scaled by \a scale
+    /**
+     * Matrices that are not lower-triangular are taken to be
+     * orthorhombic, using only the diagonal.
+     */
+    template<typename T>
+    static TriclinicBox fromBoxMatrix(const T* m, const double scale = 1.0) {
+      GCoord a(m[0], m[1], m[2]), b(m[3], m[4], m[5]), c(m[6], m[7], m[8]);
+      a *= scale;
+      b *= scale;
+      c *= scale;
+      if (a.y() != 0.0 || a.z() != 0.0 || b.z() != 0.0)
+        return(TriclinicBox(GCoord(a.x(), b.y(), c.z())));
+      return(TriclinicBox(a, b, c));
+    }
+
+    const GCoord& a() const { return(_a); }
+    const GCoord& b() const { return(_b); }
+    const GCoord& c() const { return(_c); }
+
+    //! Diagonal of the box matrix (the box used by code that only knows about orthorhombic boxes)
+    const GCoord& lengths() const { return(_lengths); }
+
+    //! Lengths of the box vectors
+    GCoord edgeLengths() const;
+
+    //! Angles alpha, beta, and gamma (in degrees)
+    GCoord angles() const;
+
+    //! Distances between opposite faces of the cell
+    /**
+     * A cutoff must be no more than half of the smallest of these for
+     * the minimum image to be unique.
+     */
+    GCoord heights() const;
+
+    double volume() const { return(_a.x() * _b.y() * _c.z()); }
+
+    bool isOrthorhombic() const { return(_orthorhombic); }
+
+
+    //! Translate \a v by box vectors into the brick centered on the origin
+    void reimage(GCoord& v) const {
+      if (_orthorhombic) {
+        v.reimage(_lengths);
+        return;
+      }
+
+      shift(v, _c, 2);
+      shift(v, _b, 1);
+      shift(v, _a, 0);
+    }
+
+    //! The shortest periodic image of the displacement \a d
+    GCoord minimumImage(const GCoord& d) const {
+      GCoord r = d;
+      reimage(r);
+      if (!_orthorhombic)
+        r = closestImage(r);
+      return(r);
+    }
+
+    //! Squared minimum-image distance between \a u and \a v
+    /**
+     * For an orthorhombic cell this is the same as u.distance2(v, lengths())
+     */
+    double distance2(const GCoord& u, const GCoord& v) const {
+      GCoord d = v - u;
+      if (_orthorhombic) {
+        d.reimage(_lengths);
+        return(d.length2());
+      }
+      return(minimumImage(d).length2());
+    }
+
+    //! Converts a cartesian coordinate into fractional (cell) coordinates
+    GCoord toFractional(const GCoord& v) const {
+      double sz = v.z() / _c.z();
+      double sy = (v.y() - sz * _c.y()) / _b.y();
+      double sx = (v.x() - sz * _c.x() - sy * _b.x()) / _a.x();
+      return(GCoord(sx, sy, sz));
+    }
+
+    //! Converts fractional (cell) coordinates into a cartesian coordinate
+    GCoord fromFractional(const GCoord& s) const {
+      return(_a * s.x() + _b * s.y() + _c * s.z());
+    }
+
+    bool operator==(const TriclinicBox& rhs) const {
+      return(_a == rhs._a && _b == rhs._b && _c == rhs._c);
+    }
+
+    bool operator!=(const TriclinicBox& rhs) const { return(!(*this == rhs)); }
+
+    friend std::ostream& operator<<(std::ostream& os, const TriclinicBox& box);
+
+  private:
+
+    // Same rounding as Coord::reimage(), but moving along a box vector
+    static void shift(GCoord& v, const GCoord& vec, const uint k) {
+      int n = (int)(fabs(v[k]) / vec[k] + 0.5);
+      if (n == 0)
+        return;
+      if (v[k] >= 0)
+        v -= vec * n;
+      else
+        v += vec * n;
+    }
+
+    GCoord closestImage(const GCoord& d) const;
+
+    GCoord _a, _b, _c;
+    GCoord _lengths;
+    bool _orthorhombic;
+  };
+
+}
+
+
+#endif
@@ -25,6 +25,7 @@
    ***WARNING******WARNING******WARNING******WARNING******WARNING******WARNING***
 
    THIS CLASS IS NOW DEPRECATED AND WILL BE REMOVED IN A FUTURE RELEASE OF LOOS
+   (see InternedString for a faster replacement)
 
    ***WARNING******WARNING******WARNING******WARNING******WARNING******WARNING***
 */
@@ -29,6 +29,8 @@
 #include <stdexcept>
 #include <vector>
 
+#include <cmath>
+
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
@@ -44,6 +46,27 @@ namespace loos {
   GCoord DCD::periodicBox(void) const { return(GCoord(qcrys[0], qcrys[1], qcrys[2])); }
 
 
+  // NAMD (2.5 and later) stores the cosines of the unit cell angles
+  // rather than the angles themselves.  Crystal data that doesn't make
+  // a valid cell is treated as an orthorhombic box, as it always has
+  // been...
+  namespace {
+    double unitCellAngle(const double v) {
+      return(fabs(v) <= 1.0 ? acos(v) * 180.0 / M_PI : v);
+    }
+  }
+
+  TriclinicBox DCD::periodicCell(void) const {
+    GCoord angles(unitCellAngle(qcrys[5]), unitCellAngle(qcrys[4]), unitCellAngle(qcrys[3]));
+    try {
+      return(TriclinicBox::fromLengthsAndAngles(periodicBox(), angles));
+    }
+    catch (LOOSError& e) {
+      return(TriclinicBox(periodicBox()));
+    }
+  }
+
+
   bool DCD::suppress_warnings = false;
   
   
@@ -420,7 +443,7 @@ namespace loos {
 
     // Handle periodic boundary conditions (if present)
     if (hasPeriodicBox()) {
-      g.periodicBox(periodicBox());
+      g.periodicCell(periodicCell());
     }
   }
 
@@ -102,6 +102,7 @@ namespace loos {
         virtual uint natoms(void) const;
         virtual bool hasPeriodicBox(void) const;
         virtual GCoord periodicBox(void) const;
+        virtual TriclinicBox periodicCell(void) const;
 
         virtual bool hasVelocities() const { return(false); }
 		virtual double velocityConversionFactor() const { return(20.45482706); }
@@ -24,11 +24,14 @@
 
 #include <dcdwriter.hpp>
 
+#include <cstring>
+
 
 namespace loos {
 
   namespace {
     const double default_unit_cell_angle = 90.0;   // This should make VMD happy...
+    const unsigned long max_buffer_bytes = 64 * 1024 * 1024;
   };
 
 
@@ -97,11 +100,53 @@ namespace loos {
 
 
 
-  void DCDWriter::writeBox(const GCoord& box) {
-    double xtal[6] = { box[0], default_unit_cell_angle, box[1],
-                       default_unit_cell_angle, default_unit_cell_angle, box[2] };
+  void DCDWriter::bufferF77Line(const char* const data, const unsigned int len) {
+    DataOverlay d;
+    d.ui = len;
 
-    writeF77Line((char *)xtal, 6*sizeof(double));
+    unsigned long n = _buffer.size();
+    _buffer.resize(n + len + 2 * sizeof(d));
+    char* p = &_buffer[n];
+    memcpy(p, &d, sizeof(d));
+    memcpy(p + sizeof(d), data, len);
+    memcpy(p + sizeof(d) + len, &d, sizeof(d));
+  }
+
+
+  // Writes the k'th coordinate of all atoms as a record directly into
+  // the buffer (rather than through a temporary array)
+  void DCDWriter::bufferCoords(const AtomicGroup& grp, const uint k) {
+    DataOverlay d;
+    d.ui = _natoms * sizeof(float);
+
+    unsigned long n = _buffer.size();
+    _buffer.resize(n + d.ui + 2 * sizeof(d));
+    char* p = &_buffer[n];
+    memcpy(p, &d, sizeof(d));
+    p += sizeof(d);
+    for (uint i=0; i<_natoms; ++i) {
+      float f = grp[i]->coords()[k];
+      memcpy(p, &f, sizeof(f));
+      p += sizeof(f);
+    }
+    memcpy(p, &d, sizeof(d));
+  }
+
+
+  // Triclinic cells are written as edge lengths and angles (in
+  // degrees), in CHARMM order (a, gamma, b, beta, alpha, c)
+  void DCDWriter::bufferBox(const TriclinicBox& cell) {
+    GCoord box = cell.lengths();
+    GCoord angles(default_unit_cell_angle, default_unit_cell_angle, default_unit_cell_angle);
+    if (!cell.isOrthorhombic()) {
+      box = cell.edgeLengths();
+      angles = cell.angles();
+    }
+
+    double xtal[6] = { box[0], angles[2], box[1],
+                       angles[1], angles[0], box[2] };
+
+    bufferF77Line((char *)xtal, 6*sizeof(double));
   }
 
 
@@ -122,35 +167,50 @@ namespace loos {
 
     }
 
+    // The header is only rewritten when the buffer is flushed
     if (_current >= _nsteps) {
-      stream_->seekp(0);
       ++_nsteps;
-      writeHeader();
-      stream_->seekp(0, std::ios_base::end);
-      if (stream_->fail())
-        throw(FileWriteError(_filename, "Error while re-writing DCD header"));
+      _header_dirty = true;
     }
 
     if (_has_box)
-      writeBox(grp.periodicBox());
+      bufferBox(grp.periodicCell());
 
-    float *data = new float[_natoms];
-    for (uint i=0; i<_natoms; i++)
-      data[i] = grp[i]->coords().x();
-    writeF77Line((char *)data, _natoms * sizeof(float));
+    bufferCoords(grp, 0);
+    bufferCoords(grp, 1);
+    bufferCoords(grp, 2);
 
-    for (uint i=0; i<_natoms; i++)
-      data[i] = grp[i]->coords().y();
-    writeF77Line((char *)data, _natoms * sizeof(float));
+    ++_current;
+    if (++_buffered >= _max_buffered || _buffer.size() >= max_buffer_bytes)
+      flush();
+  }
 
-    for (uint i=0; i<_natoms; i++)
-      data[i] = grp[i]->coords().z();
-    writeF77Line((char *)data, _natoms * sizeof(float));
 
-    delete[] data;
+  void DCDWriter::flush() {
+    if (_header_dirty) {
+      stream_->seekp(0);
+      writeHeader();
+      stream_->seekp(0, std::ios_base::end);
+      if (stream_->fail())
+        throw(FileWriteError(_filename, "Error while re-writing DCD header"));
+      _header_dirty = false;
+    }
+
+    if (!_buffer.empty()) {
+      stream_->write(&_buffer[0], _buffer.size());
+      if (stream_->fail())
+        throw(FileWriteError(_filename, "Error while writing DCD frames"));
+      _buffer.clear();    // Keeps the allocated space for the next frames...
+    }
+    _buffered = 0;
 
     stream_->flush();
-    ++_current;
+  }
+
+
+  void DCDWriter::bufferFrames(const uint n) {
+    flush();
+    _max_buffered = (n == 0) ? 1 : n;
   }
 
 
@@ -72,7 +72,9 @@ namespace loos {
       _natoms(0), _nsteps(0),
       _timestep(0.001), _current(0),
       _has_box(false),
-      _header_written(false)
+      _header_written(false),
+      _header_dirty(false),
+      _max_buffered(1), _buffered(0)
     {
       if (appending_)
 	prepareToAppend();
@@ -84,7 +86,9 @@ namespace loos {
     explicit DCDWriter(std::iostream& fs, const bool append = false) : 
       TrajectoryWriter(&fs, append),
       _natoms(0), _nsteps(0), _timestep(0.001), _current(0),
-      _has_box(false), _header_written(false)
+      _has_box(false), _header_written(false),
+      _header_dirty(false),
+      _max_buffered(1), _buffered(0)
     {
       if (appending_)
 	prepareToAppend();
@@ -100,7 +104,9 @@ namespace loos {
       _timestep(1e-3),
       _current(0),
       _has_box(grps[0].isPeriodic()),
-      _header_written(false)
+      _header_written(false),
+      _header_dirty(false),
+      _max_buffered(1), _buffered(0)
     {
       if (appending_)
 	prepareToAppend();
@@ -119,7 +125,9 @@ namespace loos {
       _timestep(1e-3),
       _current(0),
       _has_box(grps[0].isPeriodic()),
-      _header_written(false)
+      _header_written(false),
+      _header_dirty(false),
+      _max_buffered(1), _buffered(0)
     {
       if (appending_)
 	prepareToAppend();
@@ -138,7 +146,9 @@ namespace loos {
       _timestep(1e-3),
       _current(0),
       _has_box(grps[0].isPeriodic()),
-      _header_written(false)
+      _header_written(false),
+      _header_dirty(false),
+      _max_buffered(1), _buffered(0)
     {
       _titles = comments;
 
@@ -147,6 +157,12 @@ namespace loos {
     }
 
     ~DCDWriter() {
+      try {
+        flush();
+      }
+      catch (std::exception& e) {
+        std::cerr << "Warning- " << e.what() << std::endl;
+      }
     }
 
 
@@ -208,10 +224,33 @@ namespace loos {
 
     uint framesWritten(void) const { return(_current); }
 
+    //! Hold up to \a n frames in memory before writing them
+    /**
+     * By default (n = 1), each frame is written as soon as it is
+     * passed to writeFrame() and the header is updated to match, so
+     * the DCD is always complete.  When buffering, frames are written
+     * out as a single block once \a n frames (or about 64MB) have
+     * accumulated, and the frame count in the header is only updated
+     * when the buffer is flushed.  This avoids seeking back to the
+     * header for every frame, which can be very slow on network
+     * filesystems.
+     */
+    void bufferFrames(const uint n);
+
+    //! Number of frames held in memory before writing
+    uint bufferFrames() const { return(_max_buffered); }
+
+    //! Writes out any buffered frames and updates the header
+    void flush();
+
   private:
     void writeF77Line(const char* const data, const unsigned int len); 
     std::string fixStringSize(const std::string& s, const unsigned int size);
-    void writeBox(const GCoord& box);
+
+    // These append records for a frame to the buffer...
+    void bufferF77Line(const char* const data, const unsigned int len);
+    void bufferCoords(const AtomicGroup& grp, const uint k);
+    void bufferBox(const TriclinicBox& cell);
 
     void prepareToAppend();
 
@@ -222,7 +261,10 @@ namespace loos {
     uint _current;
     bool _has_box;
     bool _header_written;
+    bool _header_dirty;
+    uint _max_buffered, _buffered;
     std::vector<std::string> _titles;
+    std::vector<char> _buffer;
   };
 
 }
@@ -24,6 +24,7 @@
 #include <gro.hpp>
 #include <utils.hpp>
 #include <Fmt.hpp>
+#include <exceptions.hpp>
 
 extern std::string revision_label;
 
@@ -31,54 +32,110 @@ extern std::string revision_label;
 
 namespace loos {
 
+  // Parses a range of atom lines, saving any errors so they are
+  // thrown in the order they appear in the file...
+  struct Gromacs::AtomRecordParser {
+    AtomRecordParser(const Gromacs& gro, const TextBuffer& text, const uint first, const uint n) :
+      gro_(gro), text_(text), first_(first), atoms(n), errors(n)
+    { }
+
+    void operator()(const uint begin, const uint end) {
+      for (uint i=begin; i<end; ++i) {
+        try {
+          atoms[i] = gro_.parseAtomRecord(text_[first_ + i]);
+        }
+        catch(std::exception& e) {
+          errors[i] = e.what();
+        }
+      }
+    }
+
+    const Gromacs& gro_;
+    const TextBuffer& text_;
+    uint first_;
+    std::vector<pAtom> atoms;
+    std::vector<std::string> errors;
+  };
+
+
+  pAtom Gromacs::parseAtomRecord(const TextBuffer::Line& buf) const {
+	int resid = parseFieldAs<int>(buf, 0, 5);
+	std::string resname = parseFieldAs<std::string>(buf, 5, 5);
+	std::string name = parseFieldAs<std::string>(buf, 10, 5);
+	int atomid = parseFieldAs<int>(buf, 15, 5);
+	float x = parseFieldAs<float>(buf, 20, 8) * 10.0;
+	float y = parseFieldAs<float>(buf, 28, 8) * 10.0;
+	float z = parseFieldAs<float>(buf, 36, 8) * 10.0;
+
+	pAtom pa(new Atom);
+	pa->resid(resid);
+	pa->id(atomid);
+	pa->resname(resname);
+	pa->name(name);
+	pa->coords(GCoord(x,y,z));
+
+	if (buf.size > 44) {
+	  float vx = parseFieldAs<float>(buf, 44, 8) * 10.0;
+	  float vy = parseFieldAs<float>(buf, 52, 8) * 10.0;
+	  float vz = parseFieldAs<float>(buf, 60, 8) * 10.0;
+	  pa->velocities(GCoord(vx, vy, vz));
+	}
+
+	return(pa);
+  }
+
+
+  // Only read as much of the stream as the model needs...
   void Gromacs::read(std::istream& ifs) {
-	std::string buf;
+	TextBuffer text;
 
-	getline(ifs, title_);
+	text.readLines(ifs, 2);
+	int natoms = parseFieldAs<int>(text[1]);
+	if (natoms > 0)
+	  text.readLines(ifs, natoms);
+	text.readLines(ifs, 1);
 
-	// Get the # of atoms;;;
-	getline(ifs, buf);
-	int natoms = parseStringAs<int>(buf);
-	while (natoms-- > 0) {
-	  getline(ifs, buf);
+	read(text);
+  }
 
-	  int resid = parseStringAs<int>(buf, 0, 5);
-	  std::string resname = parseStringAs<std::string>(buf, 5, 5);
-	  std::string name = parseStringAs<std::string>(buf, 10, 5);
-	  int atomid = parseStringAs<int>(buf, 15, 5);
-	  float x = parseStringAs<float>(buf, 20, 8) * 10.0;
-	  float y = parseStringAs<float>(buf, 28, 8) * 10.0;
-	  float z = parseStringAs<float>(buf, 36, 8) * 10.0;
 
+  void Gromacs::read(const TextBuffer& text) {
+	title_ = text[0].str();
 
+	// Get the # of atoms;;;
+	int natoms = parseFieldAs<int>(text[1]);
+	if (natoms < 0)
+	  natoms = 0;
 
-	  pAtom pa(new Atom);
-	  pa->index(_max_index++);
-	  pa->resid(resid);
-	  pa->id(atomid);
-	  pa->resname(resname);
-	  pa->name(name);
-	  pa->coords(GCoord(x,y,z));
-
-    if (buf.length() > 44) {
-			_has_velocities = true;
-      float vx = parseStringAs<float>(buf, 44, 8) * 10.0;
-      float vy = parseStringAs<float>(buf, 52, 8) * 10.0;
-      float vz = parseStringAs<float>(buf, 60, 8) * 10.0;
-      pa->velocities(GCoord(vx, vy, vz));
-    }
+	AtomRecordParser parser(*this, text, 2, natoms);
+	parseInParallel(natoms, parser);
 
+	for (int i=0; i<natoms; ++i) {
+	  pAtom pa = parser.atoms[i];
+	  if (!pa)
+	    throw(ParseError(parser.errors[i]));
+
+	  pa->index(_max_index++);
+	  if (text[i+2].size > 44)
+	    _has_velocities = true;
 
 	  append(pa);
 	}
 
 	// Now process box...
-	getline(ifs, buf);
+	std::string buf = text[natoms+2].str();
 	std::istringstream iss(buf);
 	GCoord box;
 	if (!(iss >> box[0] >> box[1] >> box[2]))
 	  throw(FileReadError(_filename, "Cannot parse box '" + buf + "'"));
-	periodicBox(box * 10.0);
+
+	// Triclinic boxes have 6 more values, the off-diagonal elements
+	// v1(y) v1(z) v2(x) v2(z) v3(x) v3(y)
+	double m[9] = { box[0], 0.0, 0.0, 0.0, box[1], 0.0, 0.0, 0.0, box[2] };
+	if (iss >> m[1] >> m[2] >> m[3] >> m[5] >> m[6] >> m[7])
+	  periodicCell(TriclinicBox::fromBoxMatrix(m, 10.0));
+	else
+	  periodicBox(box * 10.0);
 
 	// Since the atomic field in .gro files is only 5-chars wide, it can
 	// overflow.  if there are enough atoms to cause an overflow, manually
@@ -149,7 +206,14 @@ namespace loos {
 
 	  GCoord box = g.periodicBox();
 	  box /= 10.0;
-	  os << box.x() << "  " << box.y() << "  " << box.z() << std::endl;
+	  os << box.x() << "  " << box.y() << "  " << box.z();
+	  if (g.isTriclinic()) {
+	    TriclinicBox cell = g.periodicCell();
+	    os << "  " << cell.a().y() / 10.0 << "  " << cell.a().z() / 10.0
+	       << "  " << cell.b().x() / 10.0 << "  " << cell.b().z() / 10.0
+	       << "  " << cell.c().x() / 10.0 << "  " << cell.c().y() / 10.0;
+	  }
+	  os << std::endl;
 
 
 	  return(os);
@@ -32,6 +32,7 @@
 
 #include <loos_defs.hpp>
 #include <AtomicGroup.hpp>
+#include <TextBuffer.hpp>
 
 namespace loos {
 
@@ -77,7 +78,11 @@ namespace loos {
 
   private:
 
+    struct AtomRecordParser;
+
     void read(std::istream& ifs);
+    void read(const TextBuffer& text);
+    pAtom parseAtomRecord(const TextBuffer::Line& line) const;
 
     // Convert an Atom to a string representation in PDB format...
     std::string atomAsString(const pAtom p) const;
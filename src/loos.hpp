@@ -52,6 +52,7 @@
 #include <loos_defs.hpp>
 #include <exceptions.hpp>
 #include <utils.hpp>
+#include <TextBuffer.hpp>
 #include <utils_random.hpp>
 #include <utils_structural.hpp>
 
@@ -80,6 +81,7 @@
 #include <trajwriter.hpp>
 #include <dcdwriter.hpp>
 #include <xtcwriter.hpp>
+#include <TrajectoryPipeline.hpp>
 
 #include <amber_traj.hpp>
 
@@ -94,12 +96,21 @@
 #include <xtc.hpp>
 #include <gro.hpp>
 #include <trr.hpp>
+#include <snapshot.hpp>
 
 
 
 #include <Geometry.hpp>
+#include <CellList.hpp>
+#include <ContactMap.hpp>
+#include <DistanceKernels.hpp>
+#include <RadialDistribution.hpp>
+#include <ReimagingPlan.hpp>
 #include <ensembles.hpp>
 #include <TimeSeries.hpp>
+#include <MultiTimeSeries.hpp>
+#include <BlockAverager.hpp>
+#include <BitMatrix.hpp>
 
 #include <Fmt.hpp>
 
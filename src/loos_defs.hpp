@@ -65,6 +65,8 @@ extern "C" {
   void dgemm_(const char* const, const char* const, const int* const, const int* const, const int* const,
               const double* const, const double* const, const int* const, const double* const,
               const int* const, const double* const, double* consnt, const int* const);
+  void dsyrk_(const char* const, const char* const, const int* const, const int* const, const double* const,
+              const double* const, const int* const, const double* const, double* const, const int* const);
   void dggev_(char*, char*, int*, double*, int*, double*, int*, double*, double*, double*, double*, int*, double*, int*, double*, int*, int*);
 
   void sgesvd_(char*, char*, int*, int*, float*, int*, float*, float*, int*, float*, int*, float*, int*, int*);
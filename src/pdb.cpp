@@ -60,39 +60,38 @@ namespace loos {
 
 
   // Parse an ATOM or HETATM record...
-  // Note: ParseErrors can come from parseStringAs
+  // Note: ParseErrors can come from parseFieldAs.  This does not
+  // modify the PDB, so it can be called from multiple threads...
 
-  void PDB::parseAtomRecord(const std::string& s) {
+  pAtom PDB::parseAtomRecord(const TextBuffer::Line& s) const {
     greal r;
     gint i;
     std::string t;
     GCoord c;
     pAtom pa(new Atom);
 
-    pa->index(_max_index++);
-
-    t = parseStringAs<std::string>(s, 0, 6);
+    t = parseFieldAs<std::string>(s, 0, 6);
     pa->recordName(t);
 
-    i = parseStringAsHybrid36(s, 6, 5);
+    i = parseFieldAsHybrid36(s, 6, 5);
     pa->id(i);
 
-    t = parseStringAs<std::string>(s, 12, 4);
+    t = parseFieldAs<std::string>(s, 12, 4);
     pa->name(t);
 
-    t = parseStringAs<std::string>(s, 16, 1);
+    t = parseFieldAs<std::string>(s, 16, 1);
     pa->altLoc(t);
 
-    t = parseStringAs<std::string>(s, 17, 4);
+    t = parseFieldAs<std::string>(s, 17, 4);
     pa->resname(t);
 
-    t = parseStringAs<std::string>(s, 21, 1);
+    t = parseFieldAs<std::string>(s, 21, 1);
     pa->chainId(t);
 
-    i = parseStringAsHybrid36(s, 22, 4);
+    i = parseFieldAsHybrid36(s, 22, 4);
     pa->resid(i);
 
-    t = parseStringAs<std::string>(s, 26, 1);
+    t = parseFieldAs<std::string>(s, 26, 1);
 
     // Special handling of resid field since it may be frame-shifted by
     // 1 col in some cases...
@@ -106,7 +105,7 @@ namespace loos {
 
       // Assume that if we see this variant, then we're not using hybrid-36
       if (c != ' ' && isdigit(c)) {
-        i = parseStringAs<int>(s, 22, 5);
+        i = parseFieldAs<int>(s, 22, 5);
         pa->resid(i);
         t = " ";
       }
@@ -114,39 +113,50 @@ namespace loos {
     }
     pa->iCode(t);
 
-    c[0] = parseStringAs<float>(s, 30, 8);
-    c[1] = parseStringAs<float>(s, 38, 8);
-    c[2] = parseStringAs<float>(s, 46, 8);
+    c[0] = parseFieldAs<float>(s, 30, 8);
+    c[1] = parseFieldAs<float>(s, 38, 8);
+    c[2] = parseFieldAs<float>(s, 46, 8);
     pa->coords(c);
 
-    if (s.size() > 54) {
-      r = parseStringAs<float>(s, 54, 6);
+    if (s.size > 54) {
+      r = parseFieldAs<float>(s, 54, 6);
       pa->occupancy(r);
 
-      if (s.size() > 60) {
-	r = parseStringAs<float>(s, 60, 6);
+      if (s.size > 60) {
+	r = parseFieldAs<float>(s, 60, 6);
 	pa->bfactor(r);
 
-	if (s.size() > 72) {
-	  t = parseStringAs<std::string>(s, 72, 4);
+	if (s.size > 72) {
+	  t = parseFieldAs<std::string>(s, 72, 4);
 	  pa->segid(t);
 
-	  if (s.size() > 76) {
-	    t = parseStringAs<std::string>(s, 76, 2);
+	  if (s.size > 76) {
+	    t = parseFieldAs<std::string>(s, 76, 2);
 	    pa->PDBelement(t);
 
 	    // Charge is not currently handled...
-	    // t = parseStringAs<std::string>(s, 78, 2);
+	    // t = parseFieldAs<std::string>(s, 78, 2);
 	  }
-	} else { // segid
-	  _missing_segid = true;
 	}
-      } else { // b-factor
-	_missing_b = _missing_segid = true;
       }
-    } else { // occupancies
-      _missing_q = _missing_b = _missing_segid = true;
     }
+
+    return(pa);
+  }
+
+
+  // Adds a parsed ATOM record to the PDB, noting any missing fields
+
+  void PDB::addAtomRecord(pAtom pa, const TextBuffer::Line& s) {
+    pa->index(_max_index++);
+
+    if (s.size <= 54)
+      _missing_q = _missing_b = _missing_segid = true;
+    else if (s.size <= 60)
+      _missing_b = _missing_segid = true;
+    else if (s.size <= 72)
+      _missing_segid = true;
+
     append(pa);
 
     // Record which pAtom belongs to this atomid.
@@ -156,6 +166,37 @@ namespace loos {
 
 
 
+  // Parses a range of ATOM records.  Any errors are saved so they can
+  // be thrown when the record is reached in the file, in order...
+
+  struct PDB::AtomRecordParser {
+    AtomRecordParser(const PDB& pdb, const TextBuffer& text, const std::vector<uint>& lines) :
+      pdb_(pdb), text_(text), lines_(lines), atoms(lines.size()), errors(lines.size())
+    { }
+
+    void operator()(const uint begin, const uint end) {
+      for (uint i=begin; i<end; ++i) {
+        try {
+          atoms[i] = pdb_.parseAtomRecord(text_[lines_[i]]);
+        }
+        catch(LOOSError& e) {
+          errors[i] = e.what();
+        }
+        catch(...) {
+          errors[i] = "Unknown exception";
+        }
+      }
+    }
+
+    const PDB& pdb_;
+    const TextBuffer& text_;
+    const std::vector<uint>& lines_;
+    std::vector<pAtom> atoms;
+    std::vector<std::string> errors;
+  };
+
+
+
   // Convert an Atom to a string with a PDB format...
 
   std::string PDB::atomAsString(const pAtom p) const {
@@ -330,30 +371,59 @@ namespace loos {
    * Will transform any caught exceptions into a FileReadError
    */
   void PDB::read(std::istream& is) {
-    std::string input;
+    TextBuffer text;
+    text.readUntil(is, "END");
+    read(text);
+  }
+
+
+  void PDB::read(const TextBuffer& text) {
     bool has_cryst = false;
     bool has_bonds = false;
     boost::unordered_set<std::string> seen;
 
-    while (getline(is, input)) {
+    // Pick out the ATOM records so they can be parsed up front...
+    std::vector<uint> atom_lines;
+    for (uint i=0; i<text.size(); ++i) {
+      TextBuffer::Line line = text[i];
+      if (line.startsWith("ATOM") || line.startsWith("HETATM"))
+        atom_lines.push_back(i);
+      else if (line.startsWith("END"))
+        break;
+    }
+
+    AtomRecordParser parser(*this, text, atom_lines);
+    parseInParallel(atom_lines.size(), parser);
+
+    uint next_atom = 0;
+    for (uint i=0; i<text.size(); ++i) {
+      TextBuffer::Line input = text[i];
+
+      if (input.startsWith("ATOM") || input.startsWith("HETATM")) {
+        uint j = next_atom++;
+        if (!parser.atoms[j])
+          throw(FileReadError(_fname, parser.errors[j]));
+        addAtomRecord(parser.atoms[j], input);
+        continue;
+      }
+
       try {
-	if (input.substr(0, 4) == "ATOM" || input.substr(0,6) == "HETATM")
-	  parseAtomRecord(input);
-	else if (input.substr(0, 6) == "REMARK")
-	  parseRemark(input);
-	else if (input.substr(0,6) == "CONECT") {
+	if (input.startsWith("REMARK"))
+	  parseRemark(input.str());
+	else if (input.startsWith("CONECT")) {
 	  has_bonds = true;
-	  parseConectRecord(input);
-	} else if (input.substr(0, 6) == "CRYST1") {
-	  parseCryst1Record(input);
+	  parseConectRecord(input.str());
+	} else if (input.startsWith("CRYST1")) {
+	  parseCryst1Record(input.str());
 	  has_cryst = true;
-	} else if (input.substr(0,3) == "TER")
+	} else if (input.startsWith("TER"))
 	  ;
-	else if (input.substr(0,3) == "END")
+	else if (input.startsWith("END"))
 	  break;
 	else {
-	  int space = input.find_first_of(' ');
-	  std::string record = input.substr(0, space);
+	  std::string line = input.str();
+	  int space = line.find_first_of(' ');
+	  std::string record = line.substr(0, space);
 	  if (seen.find(record) == seen.end()) {
 	    std::cerr << "Warning - unknown PDB record '" << record << "'" << std::endl;
 	    seen.insert(record);
@@ -388,6 +458,19 @@ namespace loos {
       periodicBox(c);
     }
 
+    // A triclinic CRYST1 record takes precedence over the box, since
+    // the XTAL remark only holds the box lengths.  Angles that don't
+    // make a valid cell are ignored...
+    if (has_cryst) {
+      try {
+        TriclinicBox c = TriclinicBox::fromLengthsAndAngles(GCoord(cell.a(), cell.b(), cell.c()),
+                                                            GCoord(cell.alpha(), cell.beta(), cell.gamma()));
+        if (!c.isOrthorhombic())
+          periodicCell(c);
+      }
+      catch (LOOSError& e) { }
+    }
+
     // Force atom id's to be monotonic if there was an overflow event...
     if (atoms.size() >= 100000)
       renumber();
@@ -528,7 +611,15 @@ namespace loos {
   PDB PDB::fromAtomicGroup(const AtomicGroup& g) {
     PDB p(g);
 
-    if (p.isPeriodic())
+    if (p.isTriclinic()) {
+      TriclinicBox cell = p.periodicCell();
+      UnitCell uc(cell.edgeLengths());
+      GCoord angles = cell.angles();
+      uc.alpha(angles[0]);
+      uc.beta(angles[1]);
+      uc.gamma(angles[2]);
+      p.unitCell(uc);
+    } else if (p.isPeriodic())
       p.unitCell(UnitCell(p.periodicBox()));
 
     return(p);
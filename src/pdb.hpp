@@ -41,6 +41,7 @@
 #include <cryst.hpp>
 #include <utils.hpp>
 #include <utils_structural.hpp>
+#include <TextBuffer.hpp>
 
 
 
@@ -147,6 +148,11 @@ namespace loos {
         void read(std::istream& is);
 
     private:
+        struct AtomRecordParser;
+
+        //! Parses all records (ATOM records are pre-parsed in parallel)
+        void read(const TextBuffer& text);
+
         class ComparePatoms {
             bool operator()(const pAtom& a, const pAtom& b) { return(a->id() < b->id()); }
         };
@@ -165,7 +171,8 @@ namespace loos {
 
         // These will modify the PDB upon a successful parse...
         void parseRemark(const std::string&);
-        void parseAtomRecord(const std::string&);
+        pAtom parseAtomRecord(const TextBuffer::Line&) const;
+        void addAtomRecord(pAtom pa, const TextBuffer::Line&);
         void parseConectRecord(const std::string&);
         void parseCryst1Record(const std::string&);
 
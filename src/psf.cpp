@@ -22,6 +22,8 @@
 #include <psf.hpp>
 #include <exceptions.hpp>
 
+#include <sstream>
+
 
 namespace loos {
 
@@ -40,81 +42,117 @@ namespace loos {
 
 
 
+  // Parses a range of atom lines.  Failures are left as null atoms
+  // so the error can be thrown in the order it appears in the file.
+  struct PSF::AtomRecordParser {
+    AtomRecordParser(const TextBuffer& text, const uint first, const uint n) :
+      text_(text), first_(first), atoms(n)
+    { }
+
+    void operator()(const uint begin, const uint end) {
+      for (uint i=begin; i<end; ++i)
+        atoms[i] = PSF::parseAtomRecord(text_[first_ + i]);
+    }
+
+    const TextBuffer& text_;
+    uint first_;
+    std::vector<pAtom> atoms;
+  };
+
+
+
   void PSF::read(std::istream& is) {
-    std::string input;
+    TextBuffer text(is);
+    read(text);
+  }
+
+
+  void PSF::read(const TextBuffer& text) {
+    uint ln = 0;
 
     // first line is the PSF header
-    if (!getline(is, input))
+    if (ln >= text.size())
       throw(FileReadError(_filename, "Failed reading first line of psf"));
-    if (input.substr(0,3) != "PSF")
+    if (!text[ln++].startsWith("PSF"))
       throw(FileReadError(_filename, "PSF detected a non-PSF file"));
 
     // second line is blank
-    if (!getline(is, input))
+    if (ln++ >= text.size())
       throw(FileReadError(_filename, "PSF failed reading first header blank"));
 
     // third line is title header
-    getline(is, input);
     int num_title_lines;
-    if (!(std::stringstream(input) >> num_title_lines)) 
+    if (!LineScanner(text[ln++]).next(num_title_lines))
       throw(FileReadError(_filename, "PSF has malformed title header"));        
 
     // skip the rest of the title
-    for (int i=0; i<num_title_lines; i++) 
-      getline(is, input);
+    if (num_title_lines > 0)
+      ln += num_title_lines;
         
     // verify nothing went wrong
-    if (!(is.good()))
+    if (ln > text.size())
       // Yes, I know, I should figure out what went wrong instead
       // of running home crying.  Sorry, Tod...
       throw(FileReadError(_filename, "PSF choked reading the header"));
 
     // next line is blank 
-    if (!getline(is, input))
+    if (ln++ >= text.size())
       throw(FileReadError(_filename, "PSF failed reading second header blank"));
 
     // next line is the number of atoms
     
-    if (!getline(is, input))
+    if (ln >= text.size())
       throw(FileReadError(_filename, "PSF failed reading natom line"));
     int num_atoms;
-    if (!(std::stringstream(input) >> num_atoms))
+    if (!LineScanner(text[ln++]).next(num_atoms))
       throw(FileReadError(_filename, "PSF has malformed natom line"));
+    if (num_atoms < 0)
+      num_atoms = 0;
+
+    // Atom records are parsed up front (in parallel for big systems)
+    uint navail = ln < text.size() ? text.size() - ln : 0;
+    AtomRecordParser parser(text, ln, static_cast<uint>(num_atoms) < navail ? num_atoms : navail);
+    parseInParallel(parser.atoms.size(), parser);
 
     for (int i=0; i<num_atoms; i++) {
-      if (!getline(is, input)) {
+      if (ln >= text.size()) {
 	std::ostringstream oss;
 	oss << "Failed reading PSF atom line for atom #" << (i+1);
         throw(FileReadError(_filename, oss.str()));
       }
-      parseAtomRecord(input);
+      pAtom pa = parser.atoms[i];
+      if (!pa)
+        throw(FileReadError(_filename, "PSF parse error.\n> " + text[ln].str()));
+      pa->index(_max_index++);
+      append(pa);
+      ++ln;
     }
 
     // next line is blank 
-    if (!getline(is, input))
+    if (ln++ >= text.size())
       throw(FileReadError(_filename, "PSF failed reading blank after atom lines"));
 
     // next block of lines is the list of bonds
     // Bond title line
-    if (!getline(is, input))
+    if (ln >= text.size())
       throw(FileReadError(_filename, "PSF failed reading nbond line"));
     int num_bonds;
-    if (!(std::stringstream(input) >> num_bonds))
+    if (!LineScanner(text[ln++]).next(num_bonds))
       throw(FileReadError(_filename, "PSF has malformed nbond line"));
 
     int bonds_found = 0;
-    getline(is, input);
-    while (input.size() > 1) { // end of the block is marked by a blank line
-                               // Note: >1 to handle \r in files that came from windows...
+    TextBuffer::Line input = text[ln++];
+    while (input.size > 1) { // end of the block is marked by a blank line
+                             // Note: >1 to handle \r in files that came from windows...
       int ind1, ind2;
-      std::stringstream s(input);
+      LineScanner s(input);
 
-      while (s.good()) {
-        if (!(s >> ind1 >> ind2))
-          throw(FileReadError(_filename, "PSF error parsing bonds.\n> " + input));
+      while (!s.atEnd()) {
+        if (!(s.next(ind1) && s.next(ind2)))
+          throw(FileReadError(_filename, "PSF error parsing bonds.\n> " + input.str()));
 
         if (ind1 > num_atoms || ind2 > num_atoms)
-          throw(FileReadError(_filename, "PSF bond error: bound atomid exceeds number of atoms.\n> " + input));
+          throw(FileReadError(_filename, "PSF bond error: bound atomid exceeds number of atoms.\n> " + input.str()));
 
         ind1--;  // our indices are 1 off from the numbering in the pdb/psf file
         ind2--;
@@ -128,7 +166,7 @@ namespace loos {
         if (s.peek() == '\r')
           break;
       }
-      getline(is, input);
+      input = text[ln++];
     }
     // sanity check
     if (bonds_found != num_bonds) 
@@ -140,7 +178,9 @@ namespace loos {
 
 
 
-  void PSF::parseAtomRecord(const std::string s) {
+  // Returns a null pAtom if the line can't be parsed.  This does not
+  // touch the PSF, so it's safe to call from multiple threads.
+  pAtom PSF::parseAtomRecord(const TextBuffer::Line& s) {
     gint index;
     std::string segname;
     gint resid;
@@ -149,32 +189,29 @@ namespace loos {
     std::string atomtype;
     greal charge;
     greal mass;
-    gint fixed;
 
     pAtom pa(new Atom);
-    pa->index(_max_index++);
-         
-    std::stringstream ss(s);
+    LineScanner ss(s);
 
-    if (!(ss >> index))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
+    if (!ss.next(index))
+      return(pAtom());
     pa->id(index);
      
-    if (!(ss >> segname))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
+    if (!ss.next(segname))
+      return(pAtom());
     pa->segid(segname);
 
 
-    if (!(ss >> resid))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
+    if (!ss.next(resid))
+      return(pAtom());
     pa->resid(resid);
 
-    if (!(ss >> resname))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
+    if (!ss.next(resname))
+      return(pAtom());
     pa->resname(resname);
 
-    if (!(ss >> atomname))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
+    if (!ss.next(atomname))
+      return(pAtom());
     pa->name(atomname);
 
     // If this is a charmm psf, the atomtype will be an integer.
@@ -183,22 +220,21 @@ namespace loos {
     // used in charmm and namd as a means to look up parameters), so we're going to
     // discard it.  However, if we ever decide we're going to use this, we'll need
     // to keep track of the distinction between charmm and namd usage.
-    if (!(ss >> atomtype))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
+    if (!ss.next(atomtype))
+      return(pAtom());
 
-    if (!(ss >> charge))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
+    if (!ss.next(charge))
+      return(pAtom());
     pa->charge(charge);
 
-    if (!(ss >> mass))
-      throw(FileReadError(_filename, "PSF parse error.\n> " + s));
+    if (!ss.next(mass))
+      return(pAtom());
     pa->mass(mass);
 
     // Is the atom fixed or mobile?
     // for now, we're going to silently drop this
-    ss >> fixed;  
 
-    append(pa);
+    return(pa);
   }
 
 }
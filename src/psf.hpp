@@ -30,6 +30,7 @@
 
 #include <loos_defs.hpp>
 #include <AtomicGroup.hpp>
+#include <TextBuffer.hpp>
 
 
 namespace loos {
@@ -63,10 +64,8 @@ namespace loos {
     virtual ~PSF() {}
 
     explicit PSF(const std::string& fname) : _max_index(0), _filename(fname) {
-      std::ifstream ifs(fname.c_str());
-      if (!ifs)
-        throw(FileOpenError(fname));
-      read(ifs);
+      TextBuffer text(fname);
+      read(text);
     }
 
     explicit PSF(std::fstream &ifs) : _max_index(0), _filename("stream") {
@@ -87,9 +86,11 @@ namespace loos {
 
 
   private:
+    struct AtomRecordParser;
 
     PSF(const AtomicGroup& grp) : AtomicGroup(grp) { }
-    void parseAtomRecord(const std::string s);  
+    void read(const TextBuffer& text);
+    static pAtom parseAtomRecord(const TextBuffer::Line& line);
 
     uint _max_index;
     std::string _filename;
@@ -47,6 +47,7 @@
 #include <tinkerxyz.hpp>
 #include <tinker_arc.hpp>
 #include <gro.hpp>
+#include <snapshot.hpp>
 #include <xtc.hpp>
 #include <trr.hpp>
 
@@ -72,6 +73,7 @@ namespace loos {
       { "psf", "CHARMM/NAMD PSF", &PSF::create },
       { "gro", "Gromacs", &Gromacs::create },
       { "xyz", "Tinker", &TinkerXYZ::create },
+      { "lsnap", "LOOS system snapshot", &SystemSnapshot::create },
       { "", "", 0}
     };
   }
@@ -92,8 +94,11 @@ namespace loos {
   pAtomicGroup createSystemPtr(const std::string& filename, const std::string& filetype) {
 
     for (internal::SystemNameBindingType* p = internal::system_name_bindings; p->creator != 0; ++p)
-      if (p->suffix == filetype)
+      if (p->suffix == filetype) {
+        if (p->creator != &SystemSnapshot::create && !snapshotCacheDirectory().empty())
+          return(SystemSnapshot::cached(filename, filetype, p->creator));
         return(*(p->creator))(filename);
+      }
 
     throw(std::runtime_error("Error- unknown output system file type '" + filetype + "' for file '" + filename + "'.  Try --help to see available types."));
   }
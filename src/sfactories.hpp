@@ -54,6 +54,10 @@ namespace loos {
    * group.  Otherwise, the prmtop will be loaded without coords and
    * returned.
    *
+   * If a snapshot cache directory is set (i.e. via the
+   * LOOS_SNAPSHOT_CACHE environment variable), models are loaded from
+   * a cached binary snapshot when possible.  See
+   * SystemSnapshot::cached() for details.
    */
   AtomicGroup createSystem(const std::string& filename);
   AtomicGroup createSystem(const std::string& filename, const std::string& filetype);
@@ -0,0 +1,494 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <snapshot.hpp>
+#include <exceptions.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/cstdint.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    const char snapshot_magic[] = "LOOSSNAP";
+    const boost::uint32_t snapshot_endian = 0x01020304;
+    const boost::uint32_t snapshot_version = 2;
+
+    // Version 1 snapshots have no triclinic cells, but are otherwise the same
+    const boost::uint32_t oldest_snapshot_version = 1;
+
+    // Values of the periodic flag in the header.  A triclinic cell is
+    // stored as its three box vectors rather than the box lengths.
+    enum { not_periodic = 0, periodic_box = 1, periodic_cell = 2 };
+
+    // Number of string fields stored for each atom
+    const uint nstring_fields = 8;
+
+    const Atom::bits property_bits[] = {
+      Atom::coordsbit, Atom::bondsbit, Atom::massbit, Atom::chargebit, Atom::anumbit,
+      Atom::flagbit, Atom::usr1bit, Atom::usr2bit, Atom::usr3bit, Atom::indexbit,
+      Atom::velbit, Atom::nullbit
+    };
+
+    const boost::uint32_t user_bits = Atom::flagbit | Atom::usr1bit | Atom::usr2bit | Atom::usr3bit;
+
+    bool cache_dir_set = false;
+    std::string cache_dir;
+
+
+
+    template<typename T>
+    void put(std::ostream& os, const T& val) {
+      os.write(reinterpret_cast<const char*>(&val), sizeof(T));
+    }
+
+
+    // Sequential access to snapshot data with bounds checking
+    class Reader {
+    public:
+      Reader(const char* data, const ulong size, const std::string& fname) :
+        p_(data), end_(data + size), fname_(fname) { }
+
+      template<typename T>
+      T get() {
+        T val;
+        memcpy(&val, take(sizeof(T)), sizeof(T));
+        return(val);
+      }
+
+      const char* take(const ulong n) {
+        if (n > static_cast<ulong>(end_ - p_))
+          throw(FileReadError(fname_, "Unexpected end of snapshot data"));
+        const char* p = p_;
+        p_ += n;
+        return(p);
+      }
+
+    private:
+      const char* p_;
+      const char* end_;
+      std::string fname_;
+    };
+
+
+    // Read-only memory map of an entire file
+    class MappedFile {
+    public:
+      explicit MappedFile(const std::string& fname) : data_(0), size_(0) {
+        int fd = open(fname.c_str(), O_RDONLY);
+        if (fd < 0)
+          throw(FileOpenError(fname, "", errno));
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+          int err = errno;
+          close(fd);
+          throw(FileReadError(fname, "Cannot stat snapshot", err));
+        }
+
+        size_ = st.st_size;
+        if (size_ != 0) {
+          void* p = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+          if (p == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            throw(FileReadError(fname, "Cannot map snapshot into memory", err));
+          }
+          data_ = static_cast<const char*>(p);
+        }
+        close(fd);
+      }
+
+      ~MappedFile() {
+        if (data_ != 0)
+          munmap(const_cast<char*>(data_), size_);
+      }
+
+      const char* data() const { return(data_); }
+      ulong size() const { return(size_); }
+
+    private:
+      MappedFile(const MappedFile&);
+      MappedFile& operator=(const MappedFile&);
+
+      const char* data_;
+      ulong size_;
+    };
+
+
+    std::string absolutePath(const std::string& fname) {
+      char* p = realpath(fname.c_str(), 0);
+      if (p == 0)
+        return(fname);
+      std::string path(p);
+      free(p);
+      return(path);
+    }
+
+
+    // FNV-1a
+    std::string hashName(const std::string& s) {
+      boost::uint64_t h = 14695981039346656037ULL;
+      for (std::string::const_iterator i = s.begin(); i != s.end(); ++i) {
+        h ^= static_cast<unsigned char>(*i);
+        h *= 1099511628211ULL;
+      }
+
+      char buf[17];
+      snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(h));
+      return(std::string(buf));
+    }
+
+  }
+
+
+
+  SystemSnapshot::SystemSnapshot(const std::string& fname) {
+    MappedFile file(fname);
+    read(file.data(), file.size(), fname);
+  }
+
+
+  SystemSnapshot::SystemSnapshot(std::istream& is) {
+    std::vector<char> data;
+    const ulong chunk = 1 << 20;
+
+    while (is) {
+      ulong n = data.size();
+      data.resize(n + chunk);
+      is.read(&data[n], chunk);
+      data.resize(n + is.gcount());
+    }
+
+    read(data.empty() ? 0 : &data[0], data.size(), "stream");
+  }
+
+
+
+  SystemSnapshot* SystemSnapshot::clone(void) const {
+    return(new SystemSnapshot(*this));
+  }
+
+  SystemSnapshot SystemSnapshot::copy(void) const {
+    AtomicGroup grp = this->AtomicGroup::copy();
+    SystemSnapshot p(grp);
+    p._meta = _meta;
+
+    return(p);
+  }
+
+
+
+  // Strings are stored once in a table and referred to by index from
+  // each atom.  Property bits are stored so that only the values that
+  // were actually set get set when the snapshot is read back in.
+  void SystemSnapshot::write(std::ostream& os, const AtomicGroup& grp, const std::string& meta) {
+    std::map<InternedString, boost::uint32_t> table;
+    std::vector<InternedString> strings;
+    std::vector<boost::uint32_t> string_ids;
+    string_ids.reserve(grp.size() * nstring_fields);
+
+    for (AtomicGroup::const_iterator i = grp.begin(); i != grp.end(); ++i) {
+      InternedString fields[nstring_fields] = {
+        (*i)->internedRecordName(), (*i)->internedName(), (*i)->internedAltLoc(), (*i)->internedResname(),
+        (*i)->internedChainId(), (*i)->internedICode(), (*i)->internedSegid(), (*i)->internedPDBelement()
+      };
+
+      for (uint j=0; j<nstring_fields; ++j) {
+        std::map<InternedString, boost::uint32_t>::iterator k = table.find(fields[j]);
+        if (k == table.end()) {
+          k = table.insert(std::make_pair(fields[j], static_cast<boost::uint32_t>(strings.size()))).first;
+          strings.push_back(fields[j]);
+        }
+        string_ids.push_back(k->second);
+      }
+    }
+
+    os.write(snapshot_magic, strlen(snapshot_magic));
+    put(os, snapshot_endian);
+    put(os, snapshot_version);
+    put<boost::uint32_t>(os, meta.size());
+    os.write(meta.data(), meta.size());
+
+    put<boost::uint32_t>(os, grp.size());
+    if (grp.isTriclinic()) {
+      put<boost::uint32_t>(os, periodic_cell);
+      TriclinicBox cell = grp.periodicCell();
+      for (uint j=0; j<3; ++j)
+        put<double>(os, cell.a()[j]);
+      for (uint j=0; j<3; ++j)
+        put<double>(os, cell.b()[j]);
+      for (uint j=0; j<3; ++j)
+        put<double>(os, cell.c()[j]);
+    } else {
+      put<boost::uint32_t>(os, grp.isPeriodic() ? periodic_box : not_periodic);
+      GCoord box = grp.periodicBox();
+      for (uint j=0; j<3; ++j)
+        put<double>(os, box[j]);
+    }
+
+    put<boost::uint32_t>(os, strings.size());
+    for (std::vector<InternedString>::const_iterator i = strings.begin(); i != strings.end(); ++i) {
+      put<boost::uint32_t>(os, i->str().size());
+      os.write(i->str().data(), i->str().size());
+    }
+
+    std::vector<boost::uint32_t>::const_iterator sid = string_ids.begin();
+    for (AtomicGroup::const_iterator i = grp.begin(); i != grp.end(); ++i) {
+      pAtom atom = *i;
+
+      boost::uint32_t mask = 0;
+      for (const Atom::bits* b = property_bits; *b != Atom::nullbit; ++b)
+        if (atom->checkProperty(*b))
+          mask |= *b;
+
+      put<boost::int32_t>(os, atom->id());
+      put<boost::uint32_t>(os, atom->index());
+      put<boost::int32_t>(os, atom->resid());
+      put<boost::int32_t>(os, atom->atomic_number());
+      put<boost::int32_t>(os, atom->atomType());
+      put(os, mask);
+
+      put<double>(os, atom->bfactor());
+      put<double>(os, atom->occupancy());
+      put<double>(os, (mask & Atom::chargebit) ? atom->charge() : 0.0);
+      put<double>(os, atom->mass());
+      // Non-const access to the coords would set their property bits...
+      const Atom& a = *atom;
+      const GCoord& c = a.coords();
+      const GCoord& v = a.velocities();
+      for (uint j=0; j<3; ++j)
+        put<double>(os, c[j]);
+      for (uint j=0; j<3; ++j)
+        put<double>(os, v[j]);
+
+      for (uint j=0; j<nstring_fields; ++j)
+        put(os, *sid++);
+
+      std::vector<int> bonds;
+      if (mask & Atom::bondsbit)
+        bonds = atom->getBonds();
+      put<boost::uint32_t>(os, bonds.size());
+      for (std::vector<int>::const_iterator b = bonds.begin(); b != bonds.end(); ++b)
+        put<boost::int32_t>(os, *b);
+    }
+
+    if (!os.good())
+      throw(FileWriteError("stream", "Could not write system snapshot"));
+  }
+
+
+  void SystemSnapshot::write(const std::string& fname, const AtomicGroup& grp, const std::string& meta) {
+    std::ofstream ofs(fname.c_str(), std::ios::out | std::ios::binary);
+    if (!ofs)
+      throw(FileOpenError(fname));
+
+    write(ofs, grp, meta);
+    ofs.close();
+    if (ofs.fail())
+      throw(FileWriteError(fname, "Could not write system snapshot"));
+  }
+
+
+
+  void SystemSnapshot::read(const char* data, const ulong size, const std::string& fname) {
+    Reader reader(data, size, fname);
+
+    uint nmagic = strlen(snapshot_magic);
+    if (size < nmagic || strncmp(reader.take(nmagic), snapshot_magic, nmagic) != 0)
+      throw(FileReadError(fname, "Not a LOOS system snapshot"));
+    if (reader.get<boost::uint32_t>() != snapshot_endian)
+      throw(FileReadError(fname, "System snapshot was written on a machine with a different byte order"));
+    boost::uint32_t version = reader.get<boost::uint32_t>();
+    if (version < oldest_snapshot_version || version > snapshot_version)
+      throw(FileReadError(fname, "Unsupported system snapshot version"));
+
+    boost::uint32_t nmeta = reader.get<boost::uint32_t>();
+    _meta = std::string(reader.take(nmeta), nmeta);
+
+    boost::uint32_t natoms = reader.get<boost::uint32_t>();
+    boost::uint32_t periodic = reader.get<boost::uint32_t>();
+    GCoord vecs[3];
+    for (uint j=0; j<3; ++j)
+      vecs[0][j] = reader.get<double>();
+    if (periodic == periodic_cell)
+      for (uint i=1; i<3; ++i)
+        for (uint j=0; j<3; ++j)
+          vecs[i][j] = reader.get<double>();
+
+    boost::uint32_t nstrings = reader.get<boost::uint32_t>();
+    std::vector<InternedString> strings;
+    strings.reserve(nstrings);
+    for (boost::uint32_t i=0; i<nstrings; ++i) {
+      boost::uint32_t n = reader.get<boost::uint32_t>();
+      strings.push_back(InternedString(std::string(reader.take(n), n)));
+    }
+
+    atoms.reserve(natoms);
+    std::vector<int> bonds;
+    for (boost::uint32_t i=0; i<natoms; ++i) {
+      pAtom atom(new Atom);
+
+      atom->id(reader.get<boost::int32_t>());
+      boost::uint32_t index = reader.get<boost::uint32_t>();
+      atom->resid(reader.get<boost::int32_t>());
+      int anum = reader.get<boost::int32_t>();
+      atom->atomType(reader.get<boost::int32_t>());
+      boost::uint32_t mask = reader.get<boost::uint32_t>();
+
+      atom->bfactor(reader.get<double>());
+      atom->occupancy(reader.get<double>());
+      double charge = reader.get<double>();
+      double mass = reader.get<double>();
+      GCoord c, v;
+      for (uint j=0; j<3; ++j)
+        c[j] = reader.get<double>();
+      for (uint j=0; j<3; ++j)
+        v[j] = reader.get<double>();
+
+      InternedString fields[nstring_fields];
+      for (uint j=0; j<nstring_fields; ++j) {
+        boost::uint32_t k = reader.get<boost::uint32_t>();
+        if (k >= strings.size())
+          throw(FileReadError(fname, "Corrupt system snapshot"));
+        fields[j] = strings[k];
+      }
+      atom->recordName(fields[0]);
+      atom->name(fields[1]);
+      atom->altLoc(fields[2]);
+      atom->resname(fields[3]);
+      atom->chainId(fields[4]);
+      atom->iCode(fields[5]);
+      atom->segid(fields[6]);
+      atom->PDBelement(fields[7]);
+
+      boost::uint32_t nbonds = reader.get<boost::uint32_t>();
+      bonds.resize(nbonds);
+      for (boost::uint32_t j=0; j<nbonds; ++j)
+        bonds[j] = reader.get<boost::int32_t>();
+
+      if (mask & Atom::indexbit)
+        atom->index(index);
+      if (mask & Atom::anumbit)
+        atom->atomic_number(anum);
+      if (mask & Atom::chargebit)
+        atom->charge(charge);
+      if (mask & Atom::massbit)
+        atom->mass(mass);
+      if (mask & Atom::coordsbit)
+        atom->coords(c);
+      if (mask & Atom::velbit)
+        atom->velocities(v);
+      if (mask & Atom::bondsbit)
+        atom->setBonds(bonds);
+      if (mask & user_bits)
+        atom->setProperty(static_cast<Atom::bits>(mask & user_bits));
+
+      append(atom);
+    }
+
+    if (periodic == periodic_cell)
+      periodicCell(TriclinicBox(vecs[0], vecs[1], vecs[2]));
+    else if (periodic)
+      periodicBox(vecs[0]);
+  }
+
+
+
+  pAtomicGroup SystemSnapshot::cached(const std::string& fname, const std::string& type, pAtomicGroup (*creator)(const std::string&)) {
+    std::string dir = snapshotCacheDirectory();
+    struct stat st;
+    if (dir.empty() || stat(fname.c_str(), &st) != 0)
+      return((*creator)(fname));
+
+    std::string path = absolutePath(fname);
+    std::ostringstream key;
+    key << "source=" << path << "\ntype=" << type << "\nsize=" << st.st_size << "\nmtime=" << st.st_mtime << "\n";
+
+    std::string::size_type slash = path.rfind('/');
+    std::string basename = slash == std::string::npos ? path : path.substr(slash + 1);
+    std::string cname = dir + "/" + basename + "-" + hashName(path + '\n' + type) + ".lsnap";
+
+    // A stale or unreadable snapshot is simply replaced
+    struct stat cst;
+    if (stat(cname.c_str(), &cst) == 0) {
+      try {
+        boost::shared_ptr<SystemSnapshot> snap(new SystemSnapshot(cname));
+        if (snap->metadata() == key.str())
+          return(snap);
+      }
+      catch (std::exception& e) { }
+    }
+
+    pAtomicGroup grp = (*creator)(fname);
+
+    // Write to a temporary file first so other processes never see a
+    // partial snapshot
+    std::ostringstream tmpname;
+    tmpname << cname << "." << getpid() << ".tmp";
+    try {
+      write(tmpname.str(), *grp, key.str());
+      if (std::rename(tmpname.str().c_str(), cname.c_str()) != 0)
+        std::remove(tmpname.str().c_str());
+    }
+    catch (std::exception& e) {
+      std::remove(tmpname.str().c_str());
+    }
+
+    return(grp);
+  }
+
+
+
+  std::string snapshotCacheDirectory() {
+    if (!cache_dir_set) {
+      const char* p = getenv("LOOS_SNAPSHOT_CACHE");
+      if (p != 0)
+        cache_dir = p;
+      cache_dir_set = true;
+    }
+
+    return(cache_dir);
+  }
+
+
+  void snapshotCacheDirectory(const std::string& dir) {
+    cache_dir = dir;
+    cache_dir_set = true;
+  }
+
+}
@@ -0,0 +1,111 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2016, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_SNAPSHOT_HPP)
+#define LOOS_SNAPSHOT_HPP
+
+#include <iostream>
+#include <string>
+
+#include <loos_defs.hpp>
+#include <AtomicGroup.hpp>
+
+
+namespace loos {
+
+  //! A binary snapshot of a complete model
+  /**
+   * A snapshot holds everything LOOS knows about a model (all of the
+   * atom properties, the connectivity, and the periodic box) in a
+   * compact binary form that can be loaded without any parsing.
+   * Snapshots are written with SystemSnapshot::write() and are
+   * recognized by createSystem() via the ".lsnap" suffix.  They are
+   * not portable between machines with different byte orders.
+   *
+   * Which properties were set (see Atom::checkProperty()) is preserved,
+   * so a snapshot of a PSF will still have no coordinates.  Anything
+   * format-specific (i.e. PDB remarks) is not kept.
+   */
+  class SystemSnapshot : public AtomicGroup {
+  public:
+    SystemSnapshot() { }
+    virtual ~SystemSnapshot() { }
+
+    //! Load the snapshot in \a fname (the file is mapped into memory)
+    explicit SystemSnapshot(const std::string& fname);
+
+    //! Load a snapshot from a stream
+    explicit SystemSnapshot(std::istream& is);
+
+    static pAtomicGroup create(const std::string& fname) {
+      return(pAtomicGroup(new SystemSnapshot(fname)));
+    }
+
+    //! Clones an object for polymorphism (see AtomicGroup::clone() for more info)
+    virtual SystemSnapshot* clone(void) const;
+
+    //! Creates a deep copy (see AtomicGroup::copy() for more info)
+    SystemSnapshot copy(void) const;
+
+    //! Any extra text stored with the snapshot
+    std::string metadata() const { return(_meta); }
+
+    //! Write \a grp to \a os as a snapshot, along with optional \a meta text
+    static void write(std::ostream& os, const AtomicGroup& grp, const std::string& meta = "");
+
+    //! Write \a grp to the file \a fname
+    static void write(const std::string& fname, const AtomicGroup& grp, const std::string& meta = "");
+
+    //! Load a model using the snapshot cache
+    /**
+     * If a snapshot cache directory is set (see
+     * snapshotCacheDirectory()), a snapshot of \a fname is looked for
+     * there.  The cached snapshot is only used if the source file has
+     * the same path, size, and modification time as when the snapshot
+     * was made (and was read as the same \a type).  Otherwise the
+     * model is read using \a creator and a new snapshot is written to
+     * the cache.  Problems writing to the cache are ignored.
+     */
+    static pAtomicGroup cached(const std::string& fname, const std::string& type, pAtomicGroup (*creator)(const std::string&));
+
+  private:
+    SystemSnapshot(const AtomicGroup& grp) : AtomicGroup(grp) { }
+    void read(const char* data, const ulong size, const std::string& fname);
+
+    std::string _meta;
+  };
+
+
+  //! Directory used to cache snapshots of model files
+  /**
+   * Defaults to the LOOS_SNAPSHOT_CACHE environment variable.  An empty
+   * string (the default if the variable is not set) disables caching.
+   */
+  std::string snapshotCacheDirectory();
+
+  //! Set the snapshot cache directory (empty disables caching)
+  void snapshotCacheDirectory(const std::string& dir);
+
+}
+
+
+#endif
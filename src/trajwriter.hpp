@@ -73,7 +73,7 @@ namespace loos {
      * the TrajectoryWriter object.
      */
     TrajectoryWriter(std::iostream* s, const bool append = false)
-      : _filename("stream"), appending_(append), delete_(false) {}
+      : stream_(s), _filename("stream"), appending_(append), delete_(false) {}
 
 
     virtual ~TrajectoryWriter() {
@@ -122,6 +122,17 @@ namespace loos {
     //! Returns true if appending to an existing trajectory
     bool isAppending() const { return(appending_); }
 
+    //! Allow up to \a n frames to be held in memory before being written
+    /**
+     * Not all formats support this.  Buffered frames are written out
+     * when the buffer fills, when flush() is called, or when the
+     * writer is destroyed.
+     */
+    virtual void bufferFrames(const uint) { }
+
+    //! Write out any buffered frames and update the trajectory metadata
+    virtual void flush() { stream_->flush(); }
+
   protected:
     std::iostream* stream_;
     std::string _filename;
@@ -168,7 +168,7 @@ namespace loos {
 		}
 
 		if (hdr_.box_size)
-			g.periodicBox(box);
+			g.periodicCell(cell);
 	}
 
 	void TRR::updateGroupVelocitiesImpl(AtomicGroup& g) {
@@ -181,7 +181,7 @@ namespace loos {
 		}
 
 		if (hdr_.box_size)
-			g.periodicBox(box);
+			g.periodicCell(cell);
 	}
 
 
@@ -131,6 +131,7 @@ namespace loos {
 		uint nframes(void) const { return(frame_indices.size()); }
 		bool hasPeriodicBox(void) const { return(hdr_.box_size != 0); }
 		GCoord periodicBox(void) const { return(box); }
+		TriclinicBox periodicCell(void) const { return(cell); }
 
 
 		std::vector<GCoord> coords(void) const { return(coords_); }
@@ -217,7 +218,8 @@ namespace loos {
 
 			if (hdr_.box_size) {
 				readBlock<T>(box_, DIM*DIM, "box");
-				box = GCoord(box_[0], box_[4], box_[8]) * 10.0;   // Convert
+				cell = TriclinicBox::fromBoxMatrix(&box_[0], 10.0);   // Convert
+				box = cell.lengths();
 				// to angstroms
 			}
 
@@ -251,6 +253,7 @@ namespace loos {
 		internal::XDRReader xdr_file;
 		std::vector<GCoord> coords_;
 		GCoord box;
+		TriclinicBox cell;
 		std::vector<size_t> frame_indices;   // Index into file for start
 		// of frame header
 
@@ -268,40 +268,45 @@ namespace loos {
     if (pos + n > source.size())
       return(0);
 
+    return(parseHybrid36(source.data() + pos, n));
+  }
+
+
+  int parseHybrid36(const char* s, uint n) {
     if (n > 6)
       throw(std::logic_error("Requested size exceeds max"));
     
-    std::string s(source.substr(pos, n));
+    const char* si = s;
+    const char* end = s + n;
     bool negative(false);
-    std::string::iterator si(s.begin());
-    n = s.size();
 
-    if (*si == '-') {
+    if (si != end && *si == '-') {
       negative = true;
       ++si;
       --n;
     }
 
     // Skip leading whitespace
-    for (;si != s.end() && *si == ' '; ++si, --n) ;
+    for (;si != end && *si == ' '; ++si, --n) ;
 
     int offset = 0;   // This adjusts the range of the result
     char cbase = 'a'; // Which set or characters (upper or lower) for the alpha-part
     int ibase = 10;   // Number-base (i.e. 10 or 36)
 
     // Decide which chunk we're in...
-    if (*si >= 'a') {
+    char lead = (si != end) ? *si : '\0';
+    if (lead >= 'a') {
       offset = pow10[n] + 16*pow36[n-1];
       cbase = 'a';
       ibase = 36;
-    } else if (*si >= 'A') {
+    } else if (lead >= 'A') {
       offset = pow10[n] - 10*pow36[n-1];
       cbase = 'A';
       ibase = 36;
     }
 
     int result = 0;
-    while (si != s.end()) {
+    while (si != end) {
       int c = (*si >= cbase) ? *si-cbase+10 : *si-'0';
       result = result * ibase + c;
       ++si;
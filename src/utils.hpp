@@ -369,6 +369,9 @@ namespace loos {
   //! Convert a hybrid-36 encoded string into an int
   int parseStringAsHybrid36(const std::string& source, const uint pos =0, const uint nelem =0);
 
+  //! Convert \a n hybrid-36 encoded chars into an int
+  int parseHybrid36(const char* s, uint n);
+
   //! Convert an int into a hybrid-36 encoded string
   std::string hybrid36AsString(int value, uint fieldsize);
 
@@ -236,12 +236,10 @@ namespace loos {
       //! Writes an opaque array of n-bytes
       uint write(const char* p, const uint n) {
 	uint rndup;
-	static char buf[sizeof(block_type)];
-	static bool init(false);
+	char buf[sizeof(block_type)];   // Not static so multiple writers can run in parallel
 
-	if (!init)
-	  for (uint i=0; i<sizeof(block_type); ++i)
-	    buf[i] = '\0';
+	for (uint i=0; i<sizeof(block_type); ++i)
+	  buf[i] = '\0';
 
 	rndup = n % sizeof(block_type);
 	if (rndup > 0)
@@ -367,7 +367,7 @@ namespace loos {
     }
     
     // XTC files *always* have a periodic box...
-    g.periodicBox(box);
+    g.periodicCell(cell);
   }
 
 
@@ -382,9 +382,8 @@ namespace loos {
     if (!readFrameHeader(current_header_))
       return(false);
     
-    box = GCoord(current_header_.box[0], 
-		 current_header_.box[4], 
-		 current_header_.box[8]) * 10.0; // Convert to Angstroms
+    cell = TriclinicBox::fromBoxMatrix(current_header_.box, 10.0); // Convert to Angstroms
+    box = cell.lengths();
     if (natoms_ <= min_compressed_system_size)
 	return(readUncompressedCoords());
     else
@@ -100,6 +100,7 @@ namespace loos {
     uint nframes(void) const { return(frame_indices.size()); }
     bool hasPeriodicBox(void) const { return(true); }
     GCoord periodicBox(void) const { return(box); }
+    TriclinicBox periodicCell(void) const { return(cell); }
 
     uint currentStep(void) const { return(current_header_.step); }
     double currentTime(void) const { return(current_header_.time); }
@@ -124,6 +125,7 @@ namespace loos {
     std::vector<size_t> frame_indices;
     uint natoms_;
     GCoord box;
+    TriclinicBox cell;
     double precision_;
     std::vector<GCoord> coords_;
     double timestep_;
@@ -23,6 +23,8 @@
 #include <xtcwriter.hpp>
 #include <xtc.hpp>
 
+#include <boost/bind.hpp>
+
 namespace loos 
 {
   
@@ -688,24 +690,35 @@ Library.
 
 
   // Write a periodic box, translating from A to nm
-  void XTCWriter::writeBox(const GCoord& box) {
+  void XTCWriter::writeBox(const TriclinicBox& box) {
     float outbox[DIM*DIM];
-    for (uint i=0; i < DIM*DIM; ++i)
-      outbox[i] = 0.0;
-    outbox[0] = box[0] / 10.0;
-    outbox[4] = box[1] / 10.0;
-    outbox[8] = box[2] / 10.0; 
+    for (uint i=0; i<DIM; ++i) {
+      outbox[i] = box.a()[i] / 10.0;
+      outbox[DIM+i] = box.b()[i] / 10.0;
+      outbox[2*DIM+i] = box.c()[i] / 10.0;
+    }
 
     xdr.write(outbox, DIM*DIM);
   }
 
   
 
+  void XTCWriter::writeFrameData(float* crds, const uint natoms, const TriclinicBox& box, const uint step, const float time) {
+    writeHeader(natoms, step, time);
+    writeBox(box);
+    writeCompressedCoordsFloat(crds, natoms, precision_);
+  }
+
+
   // Write a frame, converting units from A to nm.  Will allocate a temp array to hold coords...
   void XTCWriter::writeFrame(const AtomicGroup& model, const uint step, const double time) {
 
-    writeHeader(model.size(), step, time);
-    writeBox(model.periodicBox());
+    if (!workers_.empty()) {
+      queueFrame(model, step, time);
+      ++current_;
+      return;
+    }
+
     uint n = model.size();
 
     if (n > crds_size_) {
@@ -720,7 +733,7 @@ Library.
       crds_[k++] = c.y() / 10.0;
       crds_[k++] = c.z() / 10.0;
     }
-    writeCompressedCoordsFloat(crds_, n, precision_);
+    writeFrameData(crds_, n, model.periodicCell(), step, time);
 
     ++current_;
   }
@@ -733,6 +746,165 @@ Library.
   }
 
 
+
+  // Copies the frame into the next free slot in the queue, writing
+  // out any compressed frames while waiting for one to free up...
+  void XTCWriter::queueFrame(const AtomicGroup& model, const uint step, const float time) {
+    boost::unique_lock<boost::mutex> lock(mtx_);
+    while (tail_ - head_ >= queue_.size()) {
+      if (queue_[head_ % queue_.size()].done)
+        writeCompressedFrames(lock, false);
+      else
+        done_cond_.wait(lock);
+    }
+
+    // Workers won't touch this slot until tail_ is bumped
+    PendingFrame& frame = queue_[tail_ % queue_.size()];
+    lock.unlock();
+
+    uint n = model.size();
+    frame.crds.resize(n * 3);
+    for (uint i=0,k=0; i<n; ++i) {
+      GCoord c = model[i]->coords();
+      frame.crds[k++] = c.x() / 10.0;       // Convert to nm
+      frame.crds[k++] = c.y() / 10.0;
+      frame.crds[k++] = c.z() / 10.0;
+    }
+    frame.natoms = n;
+    frame.box = model.periodicCell();
+    frame.step = step;
+    frame.time = time;
+    frame.done = false;
+
+    lock.lock();
+    ++tail_;
+    work_cond_.notify_one();
+    writeCompressedFrames(lock, false);
+  }
+
+
+
+  // Writes out compressed frames, in order, from the head of the
+  // queue.  The lock is released while writing.
+  void XTCWriter::writeCompressedFrames(boost::unique_lock<boost::mutex>& lock, const bool wait_for_all) {
+    while (head_ < tail_) {
+      PendingFrame& frame = queue_[head_ % queue_.size()];
+      if (!frame.done) {
+        if (!wait_for_all)
+          break;
+        done_cond_.wait(lock);
+        continue;
+      }
+
+      std::string error;
+      error.swap(frame.error);
+      if (error.empty()) {
+        lock.unlock();
+        stream_->write(frame.data.data(), frame.data.size());
+        if (stream_->fail())
+          throw(FileWriteError(_filename, "Error while writing compressed coordinates to XTC file"));
+        lock.lock();
+      }
+
+      frame.done = false;
+      ++head_;
+      if (!error.empty())
+        throw(LOOSError(error));
+    }
+  }
+
+
+
+  // Each compression thread has its own XTCWriter that writes
+  // into memory (so it has its own scratch buffers)
+  void XTCWriter::compressFrames() {
+    std::stringstream ss;
+    XTCWriter encoder(&ss, precision_);
+
+    boost::unique_lock<boost::mutex> lock(mtx_);
+    while (true) {
+      while (!quit_ && next_ == tail_)
+        work_cond_.wait(lock);
+      if (next_ == tail_)
+        break;
+
+      PendingFrame& frame = queue_[next_ % queue_.size()];
+      ++next_;
+      lock.unlock();
+
+      try {
+        ss.str("");
+        encoder.writeFrameData(&frame.crds[0], frame.natoms, frame.box, frame.step, frame.time);
+        frame.data = ss.str();
+        frame.error.clear();
+      }
+      catch (std::exception& e) {
+        frame.error = e.what();
+      }
+
+      lock.lock();
+      frame.done = true;
+      done_cond_.notify_all();
+    }
+  }
+
+
+
+  void XTCWriter::stopWorkers() {
+    {
+      boost::lock_guard<boost::mutex> lock(mtx_);
+      quit_ = true;
+      work_cond_.notify_all();
+    }
+
+    for (uint i=0; i<workers_.size(); ++i) {
+      workers_[i]->join();
+      delete workers_[i];
+    }
+    workers_.clear();
+    quit_ = false;
+  }
+
+
+
+  void XTCWriter::flush() {
+    if (!workers_.empty()) {
+      boost::unique_lock<boost::mutex> lock(mtx_);
+      writeCompressedFrames(lock, true);
+    }
+    stream_->flush();
+  }
+
+
+
+  void XTCWriter::bufferFrames(const uint n) {
+    flush();
+    stopWorkers();
+    queue_.clear();
+    head_ = next_ = tail_ = 0;
+
+    if (n <= 1)
+      return;
+
+    uint nthreads = nthreads_ ? nthreads_ : boost::thread::hardware_concurrency();
+    if (nthreads == 0)
+      nthreads = 1;
+
+    queue_.resize(n);
+    for (uint i=0; i<nthreads; ++i)
+      workers_.push_back(new boost::thread(boost::bind(&XTCWriter::compressFrames, this)));
+  }
+
+
+
+  void XTCWriter::compressionThreads(const uint n) {
+    nthreads_ = n;
+    if (!queue_.empty())
+      bufferFrames(queue_.size());
+  }
+
+
+
   // Read existing XTC to get frame count...
   void XTCWriter::prepareToAppend() {
     stream_->seekg(0);
@@ -24,10 +24,15 @@
 #define LOOS_XTCWRITER_HPP
 
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <stdexcept>
 #include <vector>
 
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
 #include <loos_defs.hpp>
 #include <AtomicGroup.hpp>
 #include <xdr.hpp>
@@ -46,6 +51,12 @@ namespace loos {
    * counters, so you should use on form of writeFrame() or the other
    * and not mix them.  If you must, use currentStep() to update the
    * internal step counter (and possibly timePerStep()).
+   *
+   * Compressing coordinates is relatively expensive.  Calling
+   * bufferFrames() with more than one frame will hand frames off to
+   * a pool of compression threads so that the caller can go on to
+   * the next frame.  Compressed frames are still written out in the
+   * order they were given.
    */
 
 
@@ -77,7 +88,10 @@ namespace loos {
       current_(0),
       crds_size_(0),
       crds_(0),
-      precision_(1e3)
+      precision_(1e3),
+      head_(0), next_(0), tail_(0),
+      quit_(false),
+      nthreads_(0)
     {
       xdr.setStream(stream_);
       if (appending_)
@@ -96,7 +110,10 @@ namespace loos {
       current_(0),
       crds_size_(0),
       crds_(0),
-      precision_(1e3)
+      precision_(1e3),
+      head_(0), next_(0), tail_(0),
+      quit_(false),
+      nthreads_(0)
     {
       xdr.setStream(stream_);
       if (appending_)
@@ -115,7 +132,10 @@ namespace loos {
       current_(0),
       crds_size_(0),
       crds_(0),
-      precision_(precision)
+      precision_(precision),
+      head_(0), next_(0), tail_(0),
+      quit_(false),
+      nthreads_(0)
     {
       xdr.setStream(stream_);
       if (appending_)
@@ -129,6 +149,14 @@ namespace loos {
 
 
     ~XTCWriter() {
+      try {
+        flush();
+      }
+      catch (std::exception& e) {
+        std::cerr << "Warning- " << e.what() << std::endl;
+      }
+      stopWorkers();
+
       delete[] buf1;
       delete[] buf2;
       delete[] crds_;
@@ -162,7 +190,58 @@ namespace loos {
 
     uint framesWritten() const { return(current_); }
 
+    //! Compress up to \a n frames at a time in separate threads
+    /**
+     * Frames passed to writeFrame() are copied into a queue of \a n
+     * frames and compressed by worker threads.  writeFrame() only
+     * blocks when the queue is full.  Setting \a n to 0 or 1 turns
+     * off the threading and compresses each frame as it is written.
+     */
+    void bufferFrames(const uint n);
+
+    //! Number of compression threads to use when buffering (0 = all available)
+    void compressionThreads(const uint n);
+    uint compressionThreads() const { return(nthreads_); }
+
+    //! Waits for any queued frames to be compressed and writes them out
+    void flush();
+
   private:
+    // Used by the compression threads to write into memory
+    XTCWriter(std::iostream* s, const float precision) :
+      TrajectoryWriter(s),
+      buf1size(0), buf2size(0),
+      buf1(0), buf2(0),
+      natoms_(0),
+      dt_(1.0),
+      step_(0),
+      steps_per_frame_(1),
+      current_(0),
+      crds_size_(0),
+      crds_(0),
+      precision_(precision),
+      head_(0), next_(0), tail_(0),
+      quit_(false),
+      nthreads_(0)
+    {
+      xdr.setStream(stream_);
+    }
+
+
+    // A frame waiting to be compressed (coords are in nm)
+    struct PendingFrame {
+      PendingFrame() : natoms(0), step(0), time(0.0), done(false) { }
+
+      std::vector<float> crds;
+      TriclinicBox box;
+      uint natoms;
+      uint step;
+      float time;
+      std::string data;
+      std::string error;
+      bool done;
+    };
+
     int sizeofint(const int size) const;
     int sizeofints(const int num_of_bits, const unsigned int sizes[]) const;
     void encodebits(int* buf, int num_of_bits, const int num) const;
@@ -173,9 +252,15 @@ namespace loos {
     void allocateBuffers(const size_t size);
 
     void writeHeader(const int natoms, const int step, const float time);
-    void writeBox(const GCoord& box);
+    void writeBox(const TriclinicBox& box);
+    void writeFrameData(float* crds, const uint natoms, const TriclinicBox& box, const uint step, const float time);
 
     void prepareToAppend();
+
+    void queueFrame(const AtomicGroup& model, const uint step, const float time);
+    void writeCompressedFrames(boost::unique_lock<boost::mutex>& lock, const bool wait_for_all);
+    void compressFrames();
+    void stopWorkers();
     
   private:
     uint buf1size, buf2size;
@@ -191,6 +276,16 @@ namespace loos {
     float precision_;
 
     internal::XDRWriter xdr;
+
+    // Compression pipeline...  Frames [head_, tail_) are in the queue
+    // and frames [next_, tail_) have not been picked up by a worker yet
+    std::vector<PendingFrame> queue_;
+    unsigned long head_, next_, tail_;
+    bool quit_;
+    uint nthreads_;
+    std::vector<boost::thread*> workers_;
+    boost::mutex mtx_;
+    boost::condition_variable work_cond_, done_cond_;
   };
 
 